@@ -38,17 +38,26 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/**Base for G.711 decoders.
+   The whole payload is decoded via a 256 entry lookup table rather than a
+   virtual ConvertOne() call per sample.
+  */
 class Opal_G711_PCM : public OpalStreamedTranscoder {
   public:
-    Opal_G711_PCM(const OpalMediaFormat & inputMediaFormat);
+    Opal_G711_PCM(
+      const OpalMediaFormat & inputMediaFormat,
+      const short * decodeTable
+    );
 
-#if OPAL_G711PLC 
-   virtual PBoolean Convert(
+    virtual PBoolean Convert(
       const RTP_DataFrame & input,  ///<  Input data
       RTP_DataFrame & output        ///<  Output data
     );
 
   protected:
+    const short * m_decodeTable;
+
+#if OPAL_G711PLC 
     OpalG711_PLC plc;
     PINDEX       lastPayloadSize;
 #endif
@@ -70,6 +79,7 @@ class Opal_G711_uLaw_PCM : public Opal_G711_PCM {
 class Opal_PCM_G711_uLaw : public OpalStreamedTranscoder {
   public:
     Opal_PCM_G711_uLaw();
+    virtual PBoolean Convert(const RTP_DataFrame & input, RTP_DataFrame & output);
     virtual int ConvertOne(int sample) const;
     static int ConvertSample(int sample);
 };
@@ -90,6 +100,35 @@ class Opal_G711_ALaw_PCM : public Opal_G711_PCM {
 class Opal_PCM_G711_ALaw : public OpalStreamedTranscoder {
   public:
     Opal_PCM_G711_ALaw();
+    virtual PBoolean Convert(const RTP_DataFrame & input, RTP_DataFrame & output);
+    virtual int ConvertOne(int sample) const;
+    static int ConvertSample(int sample);
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Direct A-Law to uLaw transcoder.
+   This uses the conversion tables from the G.711 recommendation, so avoids two hops via
+   PCM-16 when both sides of a call use G.711 but disagree on the law.
+  */
+class Opal_G711_ALaw_uLaw : public OpalStreamedTranscoder {
+  public:
+    Opal_G711_ALaw_uLaw();
+    virtual PBoolean Convert(const RTP_DataFrame & input, RTP_DataFrame & output);
+    virtual int ConvertOne(int sample) const;
+    static int ConvertSample(int sample);
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Direct uLaw to A-Law transcoder.
+  */
+class Opal_G711_uLaw_ALaw : public OpalStreamedTranscoder {
+  public:
+    Opal_G711_uLaw_ALaw();
+    virtual PBoolean Convert(const RTP_DataFrame & input, RTP_DataFrame & output);
     virtual int ConvertOne(int sample) const;
     static int ConvertSample(int sample);
 };
@@ -101,7 +140,9 @@ class Opal_PCM_G711_ALaw : public OpalStreamedTranscoder {
 OPAL_REGISTER_TRANSCODER(Opal_G711_uLaw_PCM, OpalG711_ULAW_64K, OpalPCM16); \
 OPAL_REGISTER_TRANSCODER(Opal_PCM_G711_uLaw, OpalPCM16,         OpalG711_ULAW_64K); \
 OPAL_REGISTER_TRANSCODER(Opal_G711_ALaw_PCM, OpalG711_ALAW_64K, OpalPCM16); \
-OPAL_REGISTER_TRANSCODER(Opal_PCM_G711_ALaw, OpalPCM16,         OpalG711_ALAW_64K)
+OPAL_REGISTER_TRANSCODER(Opal_PCM_G711_ALaw, OpalPCM16,         OpalG711_ALAW_64K); \
+OPAL_REGISTER_TRANSCODER(Opal_G711_ALaw_uLaw, OpalG711_ALAW_64K, OpalG711_ULAW_64K); \
+OPAL_REGISTER_TRANSCODER(Opal_G711_uLaw_ALaw, OpalG711_ULAW_64K, OpalG711_ALAW_64K)
 
 #endif // OPAL_CODEC_G711CODEC_H
 
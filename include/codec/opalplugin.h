@@ -227,6 +227,27 @@ struct PluginCodec_Definition;
 #define PLUGINCODEC_CONTROL_SET_LOG_FUNCTION      "set_log_function"
 #define PLUGINCODEC_CONTROL_GET_STATISTICS        "get_statistics"
 #define PLUGINCODEC_CONTROL_TERMINATE_CODEC       "terminate_codec"
+#define PLUGINCODEC_CONTROL_RESET_CODEC           "reset_codec"
+#define PLUGINCODEC_CONTROL_TRANSCODE_BATCH       "transcode_batch"
+
+
+/* Batch transcode, an optional control allowing OPAL to convert frames for
+   many independent codec instances in one call, e.g. for all participants
+   in a conference. The parm is an array of these structures, and *parmLen
+   is the size of the array in bytes. The context passed to the control is
+   NULL, each entry has its own. Each entry is equivalent to a call to the
+   codecFunction, with the result placed in the entry, and entries for the
+   same context must be processed in array order. The control returns the
+   number of entries processed, or -1 if it is not supported. */
+struct PluginCodec_BatchItem {
+  void       * context;   // codec context, as returned by createCodec
+  const void * from;      // input data
+  unsigned     fromLen;   // input length, updated to consumed length
+  void       * to;        // output buffer
+  unsigned     toLen;     // output buffer size, updated to created length
+  unsigned     flags;     // PluginCodec_CoderFlags in, PluginCodec_ReturnCoderFlags out
+  int          result;    // return value of codecFunction
+};
 
 
 /* Log function, plug in gets a pointer to this function which allows
@@ -395,6 +416,32 @@ struct PluginCodec_Definition {
   // to this structure without an API version change!!!!
 };
 
+
+/* Define a PLUGINCODEC_CONTROL_TRANSCODE_BATCH control function, that calls
+   the codecFunction for each PluginCodec_BatchItem. This is sufficient for
+   most plug ins, which just want to save a control call per frame, and
+   is used by both C plug ins and the C++ PluginCodec class. */
+#define PLUGINCODEC_TRANSCODE_BATCH_FUNCTION(name) \
+  static int name(const struct PluginCodec_Definition * codec, \
+                  void * context, \
+                  const char * key, \
+                  void * parm, \
+                  unsigned * parmLen) \
+  { \
+    struct PluginCodec_BatchItem * items = (struct PluginCodec_BatchItem *)parm; \
+    unsigned i, count; \
+    (void)context; (void)key; \
+    if (codec == NULL || parmLen == NULL || parm == NULL || (*parmLen % sizeof(struct PluginCodec_BatchItem)) != 0) \
+      return -1; \
+    count = *parmLen / sizeof(struct PluginCodec_BatchItem); \
+    for (i = 0; i < count; i++) \
+      items[i].result = (*codec->codecFunction)(codec, items[i].context, \
+                                                items[i].from, &items[i].fromLen, \
+                                                items[i].to, &items[i].toLen, \
+                                                &items[i].flags); \
+    return (int)count; \
+  }
+
 typedef const struct PluginCodec_Definition * (* PluginCodec_GetCodecFunction)(unsigned int *, unsigned int);
 typedef unsigned (* PluginCodec_GetAPIVersionFunction)();
 
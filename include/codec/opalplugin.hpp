@@ -666,6 +666,18 @@ class PluginCodec : public PluginCodec_Utilities
     }
 
 
+    /** Reset the codec to the state it was in immediately after construction
+        and setting of options, discarding any history from previous media.
+        This allows OPAL to reuse a codec context for a new media stream
+        rather than destroying it and creating a new one. The default returns
+        false, indicating the codec cannot be reused.
+      */
+    virtual bool Reset()
+    {
+      return false;
+    }
+
+
     /// Convert from one media format to another.
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
@@ -978,6 +990,15 @@ class PluginCodec : public PluginCodec_Utilities
       return codec != NULL && codec->Terminate();
     }
 
+    static int Reset_s(const PluginCodec_Definition *, void * context, const char *, void *, unsigned *)
+    {
+      PluginCodec * codec = (PluginCodec *)context;
+      return codec != NULL && codec->Reset();
+    }
+
+    // Calls Transcode_s(), via the definition, for each item
+    PLUGINCODEC_TRANSCODE_BATCH_FUNCTION(TranscodeBatch_s)
+
     static struct PluginCodec_ControlDefn * GetControls()
     {
       static PluginCodec_ControlDefn ControlsTable[] = {
@@ -992,6 +1013,8 @@ class PluginCodec : public PluginCodec_Utilities
         { PLUGINCODEC_CONTROL_SET_INSTANCE_ID,       PluginCodec::SetInstanceID_s },
         { PLUGINCODEC_CONTROL_GET_STATISTICS,        PluginCodec::GetStatistics_s },
         { PLUGINCODEC_CONTROL_TERMINATE_CODEC,       PluginCodec::Terminate_s },
+        { PLUGINCODEC_CONTROL_RESET_CODEC,           PluginCodec::Reset_s },
+        { PLUGINCODEC_CONTROL_TRANSCODE_BATCH,       PluginCodec::TranscodeBatch_s },
         PLUGINCODEC_CONTROL_LOG_FUNCTION_INC
         { NULL }
       };
@@ -217,6 +217,7 @@ class OpalPluginTranscoder
 
     bool UpdateOptions(OpalMediaFormat & fmt);
     bool ExecuteCommand(const OpalMediaCommand & command);
+    bool ResetContext();
     bool Transcode(const void * from, unsigned * fromLen, void * to, unsigned * toLen, unsigned * flags) const
     {
       return codecDef != NULL && codecDef->codecFunction != NULL &&
@@ -233,6 +234,8 @@ class OpalPluginTranscoder
     OpalPluginControl freeOptionsControl;
     OpalPluginControl getOutputDataSizeControl;
     OpalPluginControl getCodecStatistics;
+    OpalPluginControl resetCodecControl;
+    OpalPluginControl transcodeBatchControl;
 #if PTRACING
     bool m_firstLoggedUpdateOptions[2];
 #endif
@@ -268,12 +271,17 @@ class OpalPluginFramedAudioTranscoder : public OpalFramedTranscoder, public Opal
     OpalPluginFramedAudioTranscoder(const OpalTranscoderKey & key, const PluginCodec_Definition * codecDefn, bool isEncoder);
     bool UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output);
     PBoolean ExecuteCommand(const OpalMediaCommand & command);
+    bool Reset();
     void GetStatistics(OpalMediaStatistics & statistics) const;
     PBoolean ConvertFrame(const BYTE * input, PINDEX & consumed, BYTE * output, PINDEX & created);
     virtual PBoolean ConvertSilentFrame(BYTE * buffer);
     virtual bool AcceptComfortNoise() const { return comfortNoise; }
+    virtual const void * GetBatchKey() const;
   protected:
+    virtual void ConvertFrameBatch(BatchFrame * frames, PINDEX count);
+
     bool comfortNoise;
+    std::vector<PluginCodec_BatchItem> m_batchItems;
 };
 
 
@@ -284,6 +292,7 @@ class OpalPluginStreamedAudioTranscoder : public OpalStreamedTranscoder, public
     OpalPluginStreamedAudioTranscoder(const OpalTranscoderKey & key, const PluginCodec_Definition * codec, bool isEncoder);
     bool UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output);
     PBoolean ExecuteCommand(const OpalMediaCommand & command);
+    bool Reset();
     virtual bool AcceptComfortNoise() const { return comfortNoise; }
     virtual int ConvertOne(int from) const;
   protected:
@@ -325,6 +334,7 @@ class OpalPluginVideoTranscoder : public OpalVideoTranscoder, public OpalPluginT
     PBoolean ConvertFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
     bool UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output);
     PBoolean ExecuteCommand(const OpalMediaCommand & command);
+    bool Reset();
 
   protected:
     bool EncodeFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
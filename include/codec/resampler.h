@@ -0,0 +1,186 @@
+/*
+ * resampler.h
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_RESAMPLER_H
+#define OPAL_CODEC_RESAMPLER_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#include <opal/transcoders.h>
+
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Sample rate conversion between PCM-16 formats.
+   This is a polyphase FIR resampler for any rational ratio of rates, it
+   keeps the filter history and phase between calls so that a stream may be
+   converted a packet at a time without discontinuities. Stereo data is
+   interleaved, as for OpalPCM16S.
+
+   The transcoder is registered between all of the OpalPCM16 and
+   OpalPCM16S rates, so OpalTranscoder::SelectFormats() can use it as the
+   second of a pair of transcoders, e.g. Opus-48 to OpalPCM16_48KHZ to
+   OpalPCM16_16KHZ, or as the middle of three via
+   OpalTranscoder::FindIntermediateFormats(), e.g. Opus-48 to
+   OpalPCM16_48KHZ to OpalPCM16 to G.711-uLaw.
+  */
+class OpalPCM16Resampler : public OpalTranscoder
+{
+    PCLASSINFO(OpalPCM16Resampler, OpalTranscoder);
+  public:
+  /**@name Construction */
+  //@{
+    /**Create a resampler between two PCM-16 media formats.
+       The formats must have the same number of channels.
+      */
+    OpalPCM16Resampler(
+      const OpalMediaFormat & inputMediaFormat,  ///<  Input media format
+      const OpalMediaFormat & outputMediaFormat  ///<  Output media format
+    );
+
+    /**Create a resampler not attached to media formats.
+      */
+    OpalPCM16Resampler(
+      unsigned inputRate,   ///<  Input sample rate
+      unsigned outputRate,  ///<  Output sample rate
+      unsigned channels = 1 ///<  Channels, 1 or 2
+    );
+  //@}
+
+  /**@name Operations */
+  //@{
+    /**Get the optimal size for data frames to be converted.
+       This is one millisecond of audio, as for OpalStreamedTranscoder.
+      */
+    virtual PINDEX GetOptimalDataFrameSize(
+      PBoolean input      ///<  Flag for input or output data size
+    ) const;
+
+    /**Convert the data from one format to another.
+       The number of output samples may vary by one between calls, when the
+       ratio of the rates does not divide the packet size exactly.
+      */
+    virtual PBoolean Convert(
+      const RTP_DataFrame & input,  ///<  Input data
+      RTP_DataFrame & output        ///<  Output data
+    );
+
+    /**Resample a block of audio.
+       The \p output must have space for GetMaxOutputFrames(inputFrames)
+       frames, where a frame is one sample per channel.
+
+       @return number of frames written to \p output.
+      */
+    PINDEX Resample(
+      const short * input,    ///<  Input samples, interleaved if stereo
+      PINDEX inputFrames,     ///<  Number of input frames
+      short * output          ///<  Output samples, interleaved if stereo
+    );
+
+    /**Get the maximum number of frames Resample() produces.
+      */
+    PINDEX GetMaxOutputFrames(
+      PINDEX inputFrames      ///<  Number of input frames
+    ) const;
+
+    /**Discard the filter history, e.g. on a discontinuity in the input.
+      */
+    void Reset();
+
+    unsigned GetInputRate() const { return m_inputRate; }
+    unsigned GetOutputRate() const { return m_outputRate; }
+    unsigned GetChannels() const { return m_channels; }
+  //@}
+
+  protected:
+    void Initialise();
+
+    unsigned m_inputRate;
+    unsigned m_outputRate;
+    unsigned m_channels;
+    unsigned m_upFactor;    // Interpolation, number of filter phases
+    unsigned m_downFactor;  // Decimation
+    unsigned m_taps;        // Taps per phase, multiple of 8
+
+    std::vector<short> m_coefficients; // m_upFactor phases of m_taps, Q14
+    std::vector<short> m_buffer[2];    // Per channel history plus input
+    unsigned           m_phase;
+    PINDEX             m_position;
+};
+
+
+/**Template for the registered resamplers, as the factory needs a default
+   constructor.
+  */
+template <unsigned InputRate, unsigned OutputRate, unsigned Channels>
+class OpalPCM16ResamplerTemplate : public OpalPCM16Resampler
+{
+  public:
+    OpalPCM16ResamplerTemplate()
+      : OpalPCM16Resampler(GetOpalPCM16(InputRate, Channels), GetOpalPCM16(OutputRate, Channels))
+    { }
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+#define OPAL_REGISTER_PCM16_RESAMPLER(inRate, outRate, channels) \
+  typedef OpalPCM16ResamplerTemplate<inRate, outRate, channels> OpalPCM16Resampler_##inRate##_##outRate##_##channels; \
+  OPAL_REGISTER_TRANSCODER(OpalPCM16Resampler_##inRate##_##outRate##_##channels, \
+                           GetOpalPCM16(inRate, channels), GetOpalPCM16(outRate, channels))
+
+#define OPAL_REGISTER_PCM16_RESAMPLER_PAIR(rate1, rate2) \
+  OPAL_REGISTER_PCM16_RESAMPLER(rate1, rate2, 1); \
+  OPAL_REGISTER_PCM16_RESAMPLER(rate2, rate1, 1); \
+  OPAL_REGISTER_PCM16_RESAMPLER(rate1, rate2, 2); \
+  OPAL_REGISTER_PCM16_RESAMPLER(rate2, rate1, 2)
+
+#define OPAL_REGISTER_PCM16_RESAMPLERS() \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR( 8000, 12000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR( 8000, 16000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR( 8000, 24000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR( 8000, 32000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR( 8000, 48000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(12000, 16000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(12000, 24000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(12000, 32000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(12000, 48000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(16000, 24000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(16000, 32000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(16000, 48000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(24000, 32000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(24000, 48000); \
+  OPAL_REGISTER_PCM16_RESAMPLER_PAIR(32000, 48000)
+
+
+#endif // OPAL_CODEC_RESAMPLER_H
+
+
+/////////////////////////////////////////////////////////////////////////////
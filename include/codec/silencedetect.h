@@ -47,7 +47,8 @@ class OpalSilenceDetector : public PObject
     P_DECLARE_STREAMABLE_ENUM(Modes,
       NoSilenceDetection,
       FixedSilenceDetection,
-      AdaptiveSilenceDetection
+      AdaptiveSilenceDetection,
+      SpectralSilenceDetection
     );
     typedef Modes Mode; // Backward compatibility
 
@@ -93,8 +94,9 @@ class OpalSilenceDetector : public PObject
        This adjusts the silence detector "agression". The deadband and 
        adaptive periods are in ms units to work for any clock rate.
 	   The clock rate value is optional: 0 leaves value unchanged.
-       This may be called while audio is being transferred, but if in
-       adaptive mode calling this will reset the filter.
+       This may be called while audio is being transferred, the new values
+       are taken up by the next call to Detect(), and if in adaptive mode
+       this will reset the filter.
       */
     void SetParameters(
       const Params & params,  ///< New parameters for silence detector
@@ -109,8 +111,9 @@ class OpalSilenceDetector : public PObject
 
     /**Set the sampling clock rate for the preprocessor.
        Adusts the interpretation of time values.
-       This may be called while audio is being transferred, but if in
-       adaptive mode calling this will reset the filter.
+       This may be called while audio is being transferred, the new value
+       is taken up by the next call to Detect(), and if in adaptive mode
+       this will reset the filter.
      */
     void SetClockRate(
       unsigned clockRate     ///< Sampling clock rate for the preprocessor
@@ -142,6 +145,9 @@ class OpalSilenceDetector : public PObject
     ) const;
 
     /**Detemine (in context) if audio stream is currently silent.
+       This is intended to be called from a single thread, e.g. the media
+       patch thread, and does not take any locks unless the parameters have
+       been changed.
       */
     Result Detect(
       const BYTE * audioPtr,
@@ -162,32 +168,52 @@ class OpalSilenceDetector : public PObject
       PINDEX size           ///<  Size of payload buffer
     ) = 0;
 
-  private:
+    /**Determine if the frame contains speech, rather than background noise.
+       This is called from within the silence detection algorithm when in
+       SpectralSilenceDetection mode.
+
+       The default behaviour returns false, which indicates the stream cannot
+       be analysed, and AdaptiveSilenceDetection is used.
+      */
+    virtual bool DetectSpeech(
+      const BYTE * buffer,  ///<  RTP payload being detected
+      PINDEX size,          ///<  Size of payload buffer
+      bool & speech         ///<  Set to true if speech is present
+    );
+
+  protected:
     /**Reset the adaptive filter
      */
-    void AdaptiveReset();
+    virtual void AdaptiveReset();
+
+    void ApplyParameters();
 
-  protected:
     PDECLARE_NOTIFIER(RTP_DataFrame, OpalSilenceDetector, ReceivedPacket);
 
     PNotifier m_receiveHandler;
 
+    // Configuration, may be changed from any thread
+    Params       m_parameters;
+    unsigned     m_clockRate;             // audio sampling rate
+    atomic<bool> m_parametersChanged;
+    PMutex       m_inUse;                 // Protects values to allow change while running
+
+    // Detector state, only used by thread calling Detect()
     Mode     m_mode;
     unsigned m_signalDeadband;        // #samples of signal needed
     unsigned m_silenceDeadband;       // #samples of silence needed
     unsigned m_adaptivePeriod;        // #samples window for adaptive threshold
-    unsigned m_clockRate;             // audio sampling rate
-
     unsigned m_lastTimestamp;         // Last timestamp received
     unsigned m_receivedTime;          // Signal/Silence duration received so far.
-    unsigned m_levelThreshold;        // Threshold level for silence/signal
     unsigned m_signalMinimum;         // Minimum of frames above threshold
     unsigned m_silenceMaximum;        // Maximum of frames below threshold
     unsigned m_signalReceivedTime;    // Duration of signal received
     unsigned m_silenceReceivedTime;   // Duration of silence received
-    unsigned m_lastSignalLevel;       // Energy level from last data frame
-    Result   m_lastResult;            // What it says
-    PMutex   m_inUse;                 // Protects values to allow change while running
+
+    // Detector results, may be read from any thread
+    atomic<unsigned> m_levelThreshold;  // Threshold level for silence/signal
+    atomic<unsigned> m_lastSignalLevel; // Energy level from last data frame
+    atomic<Result>   m_lastResult;      // What it says
 };
 
 
@@ -199,7 +225,7 @@ class OpalPCM16SilenceDetector : public OpalSilenceDetector
       */
     OpalPCM16SilenceDetector(
       const Params & newParam ///<  New parameters for silence detector
-    ) : OpalSilenceDetector(newParam) { }
+    );
 
   /**@name Overrides from OpalSilenceDetector */
   //@{
@@ -215,7 +241,55 @@ class OpalPCM16SilenceDetector : public OpalSilenceDetector
       const BYTE * buffer,  ///<  RTP payload being detected
       PINDEX size           ///<  Size of payload buffer
     );
+
+    /**Determine if the frame contains speech, rather than background noise.
+       The audio is split into four bands, and the noise floor of each band
+       is tracked by minimum statistics over a two second window. Speech is
+       indicated when the weighted signal to noise ratio across the bands,
+       favouring the lower bands where most speech energy is, is high enough.
+       Stationary noise, of any colour, and slow changes in its level are
+       thus not considered speech, no matter how loud.
+      */
+    virtual bool DetectSpeech(
+      const BYTE * buffer,  ///<  RTP payload being detected
+      PINDEX size,          ///<  Size of payload buffer
+      bool & speech         ///<  Set to true if speech is present
+    );
   //@}
+
+  /**@name Signal processing */
+  //@{
+    enum { NumBands = 4 };
+
+    /**Calculate the mean of the absolute value of the samples.
+      */
+    static unsigned CalculateAverageLevel(
+      const short * pcm,    ///<  Samples
+      PINDEX samples        ///<  Number of samples
+    );
+
+    /**Calculate the mean energy in each of NumBands equal width bands.
+       This uses a four point Walsh-Hadamard transform, which is crude in its
+       band separation but very cheap.
+      */
+    static void CalculateBandEnergy(
+      const short * pcm,        ///<  Samples
+      PINDEX samples,           ///<  Number of samples
+      float energy[NumBands]    ///<  Energy per band
+    );
+  //@}
+
+  protected:
+    virtual void AdaptiveReset();
+
+    enum { NoiseWindows = 8 };
+    bool     m_noiseInitialised;
+    float    m_bandSmoothed[NumBands];
+    float    m_bandMinimum[NumBands];
+    float    m_bandWindowMinimum[NoiseWindows][NumBands];
+    unsigned m_noiseWindowLength;
+    unsigned m_noiseWindowSamples;
+    unsigned m_noiseWindowIndex;
 };
 
 
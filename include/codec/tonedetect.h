@@ -0,0 +1,194 @@
+/*
+ * tonedetect.h
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_TONEDETECT_H
+#define OPAL_CODEC_TONEDETECT_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#include <deque>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Shared in-band DTMF and fax tone detector.
+   One instance serves many channels, e.g. every leg of a gateway. Audio
+   written to a channel is queued and a small pool of worker threads takes
+   batches of channels with pending audio and runs them through a bank of
+   Goertzel filters, covering the eight DTMF frequencies and the fax CNG
+   (1100Hz) and CED (2100Hz) tones together, using SIMD where available.
+
+   Note that the SIMD lanes are the filter frequencies of one channel, not
+   the same frequency across several channels. Channel audio arrives in
+   unaligned, unequal lengths so could not fill vector lanes across
+   channels. A batch is thus only a way to take many channels from the
+   ready queue with one lock, each channel in it is processed in turn, and
+   throughput across channels comes from the number of worker threads.
+
+   Results are delivered via Channel::OnTone() from a worker thread, using
+   the same characters as PDTMFDecoder: '0'-'9', '*', '#', 'A'-'D', and 'X'
+   for CNG and 'Y' for CED.
+
+   If created with no worker threads, audio is processed synchronously in
+   the thread calling Write().
+
+   Audio is 16 bit linear PCM at 8kHz.
+  */
+class OpalToneDetector : public PObject
+{
+    PCLASSINFO(OpalToneDetector, PObject);
+  public:
+    enum {
+      SampleRate = 8000,
+      BlockSize = 102,  ///< Samples per Goertzel block, 12.75ms
+      NumFrequencies = 10
+    };
+
+    /**A channel of audio to be analysed.
+       The derived class must call OpalToneDetector::Detach() before it is
+       destroyed, usually in its destructor.
+      */
+    class Channel
+    {
+      public:
+        Channel();
+        virtual ~Channel();
+
+        /**Set scaling of input samples, e.g. for low level lines.
+          */
+        void SetScale(
+          unsigned multiplier,
+          unsigned divisor
+        );
+
+        /**Indicate channel is attached to a detector.
+          */
+        bool IsAttached() const { return m_detector != NULL; }
+
+        /**Tone has been detected.
+           This is called from a worker thread of the detector, so should not
+           block for any length of time.
+          */
+        virtual void OnTone(
+          char tone,          ///< Tone detected
+          unsigned duration   ///< Duration of the tone so far, in milliseconds
+        ) = 0;
+
+      protected:
+        void Reset();
+
+        OpalToneDetector * m_detector;
+        PSyncPoint         m_idle;      // Signalled when no longer active after detach
+        bool               m_scheduled; // In ready queue or being processed
+        bool               m_active;    // Being processed by a worker
+        std::vector<short> m_pending;
+        float              m_gain;
+
+        // Goertzel state, in SIMD friendly lanes
+        float    m_state1[12];
+        float    m_state2[12];
+        float    m_energy[3];   // Per third of block
+        unsigned m_blockSamples;
+
+        // Tone state machines, in blocks
+        char     m_digit;
+        unsigned m_digitBlocks;
+        unsigned m_digitGapBlocks;
+        bool     m_digitReported;
+        char     m_faxTone;
+        unsigned m_faxBlocks;
+        bool     m_faxReported;
+
+      friend class OpalToneDetector;
+    };
+
+  /**@name Construction */
+  //@{
+    /**Create a new detector engine.
+      */
+    OpalToneDetector(
+      unsigned threads = GetDefaultThreadCount() ///< Number of worker threads, zero is synchronous
+    );
+
+    /**Stop worker threads. All channels should be detached first.
+      */
+    ~OpalToneDetector();
+  //@}
+
+  /**@name Operations */
+  //@{
+    /**Get the default number of worker threads.
+       This is the number of processors in the system.
+      */
+    static unsigned GetDefaultThreadCount();
+
+    /**Attach a channel to the detector.
+       If the channel is already attached, it is detached first.
+      */
+    void Attach(
+      Channel & channel
+    );
+
+    /**Detach a channel from the detector.
+       On return the channel will no longer be accessed by a worker thread.
+      */
+    void Detach(
+      Channel & channel
+    );
+
+    /**Queue audio for analysis.
+      */
+    void Write(
+      Channel & channel,
+      const short * samples,
+      PINDEX count
+    );
+
+    /**Get number of worker threads.
+      */
+    unsigned GetThreadCount() const { return m_threads.size(); }
+  //@}
+
+  protected:
+    void WorkerMain();
+    void ProcessSamples(Channel & channel, const short * samples, PINDEX count);
+    void ProcessBlock(Channel & channel);
+
+    PDECLARE_MUTEX(m_mutex);
+    std::deque<Channel *>  m_ready;
+    std::vector<PThread *> m_threads;
+    PSemaphore             m_workAvailable;
+    bool                   m_running;
+};
+
+
+#endif // OPAL_CODEC_TONEDETECT_H
+
+
+/////////////////////////////////////////////////////////////////////////////
@@ -97,6 +97,10 @@ class OpalIntraFrameControl : public PObject
       */
     void IntraFrameDetected();
 
+    /**Reset to initial state, e.g. when transcoder is reused.
+      */
+    void Reset();
+
     /**Set throttle times for controlling Intra Frame.
        This is 
       */
@@ -202,6 +206,11 @@ class OpalVideoTranscoder : public OpalTranscoder
       const OpalMediaCommand & command    ///<  Command to execute.
     );
 
+    /**Reset the transcoder so it may be reused for another media stream.
+       This resets the frame drop, freeze and intra frame request state.
+      */
+    virtual bool Reset();
+
     /**Convert the data from one format to another.
        This function takes the input data as a RTP_DataFrame and converts it
        to its output format, placing it into the RTP_DataFrame provided.
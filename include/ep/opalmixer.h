@@ -42,6 +42,7 @@
 
 #include <ep/localep.h>
 #include <codec/vidcodec.h>
+#include <codec/silencedetect.h>
 
 
 class RTP_DataFrame;
@@ -328,7 +329,7 @@ class OpalVideoMixer : public OpalBaseMixer
       bool pushThread = true  ///< A push thread is to be created
     );
 
-    ~OpalVideoMixer() { StopPushThread(); }
+    ~OpalVideoMixer();
 
     /**Get output video frame width.
       */
@@ -357,14 +358,37 @@ class OpalVideoMixer : public OpalBaseMixer
       unsigned height   ///< new height
     );
 
+    /**Set the number of additional threads used to composite tiles.
+       When more than one tile has changed in an output frame, the scaling
+       of the tiles is spread over these threads and the mixing thread.
+       Zero, the default, does all compositing on the mixing thread.
+      */
+    void SetComposeThreads(
+      unsigned count    ///< Number of extra compositing threads
+    );
+
+    /**Get the number of additional threads used to composite tiles.
+      */
+    unsigned GetComposeThreads() const { return m_composeThreads.size(); }
+
+    /**Get the rate at which decoded pixels arrive at the mixer.
+       This is the sum, over all inputs, of the width times height of every
+       frame received, in pixels per second, measured over the last second.
+      */
+    uint64_t GetDecodedPixelRate() const;
+
   protected:
     struct VideoStream : public Stream
     {
       VideoStream(OpalVideoMixer & mixer);
       virtual void QueuePacket(const RTP_DataFrame & rtp);
+      bool UpdateVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h, bool redraw);
       void InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h);
 
       OpalVideoMixer & m_mixer;
+      RTP_DataFrame    m_lastFrame;   // Last input frame, kept for redraws
+      unsigned         m_lastX, m_lastY, m_lastWidth, m_lastHeight;
+      unsigned         m_tileWidth, m_tileHeight; // Size last indicated via OnInputTileSize()
     };
 
     friend struct VideoStream;
@@ -377,6 +401,21 @@ class OpalVideoMixer : public OpalBaseMixer
     virtual bool StartMix(unsigned & x, unsigned & y, unsigned & w, unsigned & h, unsigned & left);
     virtual bool NextMix(unsigned & x, unsigned & y, unsigned & w, unsigned & h, unsigned & left);
     void InsertVideoFrame(const StreamMap_T::iterator & it, unsigned x, unsigned y, unsigned w, unsigned h);
+    void ComposeTiles();
+
+    /**Indicate the size of the tile an input now occupies.
+       This is called, with the mixer locked, whenever the layout changes the
+       tile size for an input, so the source of that input may be asked to
+       send no more pixels than are used.
+
+       Default behaviour does nothing.
+      */
+    virtual void OnInputTileSize(
+      const Key_T & key,    ///< Key for input stream
+      unsigned width,       ///< Width of tile
+      unsigned height       ///< Height of tile
+    );
+    void ComposeThreadMain();
 
   protected:
     Styles     m_style;
@@ -385,6 +424,22 @@ class OpalVideoMixer : public OpalBaseMixer
 
     PBYTEArray m_frameStore;
     size_t     m_lastStreamCount;
+    bool       m_redrawAll;         // Background was filled, all tiles must be redrawn
+
+    struct Tile {
+      VideoStream * m_stream;
+      unsigned      m_x, m_y, m_width, m_height;
+    };
+    std::vector<Tile>      m_dirtyTiles;      // Tiles with new content for this output frame
+    atomic<size_t>         m_nextTile;        // Next entry in m_dirtyTiles to be composited
+    std::vector<PThread *> m_composeThreads;
+    PSemaphore             m_composeStart;
+    PSemaphore             m_composeDone;
+    bool                   m_composeRunning;
+
+    PTime                  m_pixelWindowStart;
+    uint64_t               m_pixelWindowCount;
+    uint64_t               m_decodedPixelRate;
 };
 
 #endif // OPAL_VIDEO
@@ -410,6 +465,8 @@ struct OpalMixerNodeInfo
     , m_width(PVideoFrameInfo::CIFWidth)
     , m_height(PVideoFrameInfo::CIFHeight)
     , m_rate(15)
+    , m_videoForwarding(false)
+    , m_forwardedThumbnails(0)
 #endif
     , m_mediaPassThru(false)
   { }
@@ -428,6 +485,11 @@ struct OpalMixerNodeInfo
   unsigned m_width;               ///< Width of mixed video
   unsigned m_height;              ///< Height of mixed video
   unsigned m_rate;                ///< Frame rate of mixed video
+  bool     m_videoForwarding;     /**< Forward encoded video of selected participants rather
+                                       than decoding, mixing and re-encoding. All participants
+                                       should use the same video codec. */
+  unsigned m_forwardedThumbnails; /**< When forwarding, number of extra video streams per
+                                       participant that carry recent speakers. */
 #endif
   bool     m_mediaPassThru;       /**< Enable media pass through to optimise mixer node
                                        with precisely two attached connections. */
@@ -444,6 +506,7 @@ struct OpalMixerNodeInfo
 class OpalMixerNode;
 class OpalAudioStreamMixer;
 class OpalVideoStreamMixer;
+class OpalVideoStreamForwarder;
 
 
 /** Mixer node manager.
@@ -565,6 +628,9 @@ class OpalMixerNodeManager
 #if OPAL_VIDEO
     /// Create the instance of the video mixer
     virtual OpalVideoStreamMixer * CreateVideoMixer(const OpalMixerNodeInfo & info);
+
+    /// Create the instance of the video forwarder
+    virtual OpalVideoStreamForwarder * CreateVideoForwarder(const OpalMixerNodeInfo & info);
 #endif
 
     /// Get manager
@@ -1030,17 +1096,24 @@ class OpalMixerMediaStream : public OpalMediaStream
 
 #if OPAL_VIDEO
     bool CheckMixedVideoSize(unsigned width, unsigned height);
+
+    /**Get the detector used to determine if the participant is speaking.
+       This is only present for audio into the mixer.
+      */
+    OpalSilenceDetector * GetSpeechDetector() const { return m_speechDetector; }
 #endif
 
   protected:
     virtual void InternalClose();
     virtual bool InternalSetJitterBuffer(const OpalJitterBuffer::Init & init);
+    virtual bool InternalExecuteCommand(const OpalMediaCommand & command);
 
     PSafePtr<OpalMixerNode> m_node;
     bool m_listenOnly;
 #if OPAL_VIDEO
     unsigned m_mixedVideoWidth;
     unsigned m_mixedVideoHeight;
+    OpalSilenceDetector * m_speechDetector;
 #endif
 };
 
@@ -1076,11 +1149,13 @@ class OpalAudioStreamMixer : public OpalAudioMixer, public OpalMediaStreamMixer
       ~CachedAudio();
       enum
       {
-        Collecting, Collected, Completed
+        Collecting, Collected, Encoding, Completed
       } m_state;
       RTP_DataFrame    m_raw;
       RTP_DataFrame    m_encoded;
       OpalTranscoder * m_transcoder;
+      OpalTranscoder * m_resampler;  // When encoder is not at mixer sample rate
+      RTP_DataFrame    m_resampled;
     };
     std::map<PString, CachedAudio> m_cache;
 
@@ -1089,6 +1164,19 @@ class OpalAudioStreamMixer : public OpalAudioMixer, public OpalMediaStreamMixer
       CachedAudio & cache,
       const short * audioToSubtract
     );
+    void PushEncoded();
+
+    // Encoding for all streams is done in one batch, then the packets pushed
+    struct PendingPush
+    {
+      PendingPush(const PSafePtr<OpalMixerMediaStream> & stream, CachedAudio & cache)
+        : m_stream(stream), m_cache(&cache) { m_stream.SetSafetyMode(PSafeReference); }
+      PSafePtr<OpalMixerMediaStream> m_stream;
+      CachedAudio                  * m_cache;
+    };
+    std::vector<PendingPush>     m_pendingPushes;
+    OpalTranscoder::BatchEntries m_batchEntries;
+    std::vector<CachedAudio *>   m_batchCaches;
 
 #ifdef OPAL_MIXER_AUDIO_DEBUG
     class PAudioMixerDebug * m_audioDebug;
@@ -1111,12 +1199,172 @@ class OpalVideoStreamMixer : public OpalVideoMixer, public OpalMediaStreamMixer
     OpalVideoStreamMixer(const OpalMixerNodeInfo & info);
     ~OpalVideoStreamMixer();
 
+    /**Add a stream from a participant to be mixed.
+      */
+    virtual bool AddInput(
+      OpalMixerMediaStream & stream     ///< Sink stream of mixer connection
+    );
+
+    virtual void RemoveStream(const Key_T & key);
     virtual bool SetFrameRate(unsigned rate);
     virtual bool OnMixed(RTP_DataFrame * & output);
 
   protected:
+    virtual void OnInputTileSize(const Key_T & key, unsigned width, unsigned height);
+    virtual void RequestInputSize(OpalMixerMediaStream & stream, unsigned width, unsigned height);
+
     typedef PDictionary<PString, OpalTranscoder> TranscoderMap;
     TranscoderMap m_transcoders;
+
+    typedef std::map<Key_T, PSafePtr<OpalMixerMediaStream> > InputMediaStreamMap;
+    InputMediaStreamMap m_inputMediaStreams;
+
+    struct TileSize {
+      unsigned m_width;
+      unsigned m_height;
+    };
+    typedef std::map<Key_T, TileSize> TileSizeMap;
+    TileSizeMap m_tileSizeRequests;
+};
+
+
+/** Video forwarder.
+    This class is a selective forwarding unit for video. Rather than decoding,
+    mixing and re-encoding, the encoded packets of the active speaker are
+    passed on to each participant, with timestamps rewritten to be continuous
+    across changes of speaker. The RTP stream supplies its own SSRC and
+    sequence numbers.
+
+    A participant with more than one video stream attached to the node gets
+    recent speakers on the extra streams, up to m_forwardedThumbnails. If an
+    input has several SSRCs, e.g. simulcast, the highest bit rate that fits
+    in the receivers bandwidth is used, thumbnails always get the lowest.
+
+    On a switch a key frame is requested from the new input, and the old
+    input continues to be forwarded until the new one sends a key frame, so
+    receivers never get inter frames they cannot decode. For codecs without
+    a key frame detector the switch is on the next frame boundary.
+*/
+class OpalVideoStreamForwarder : public OpalBaseMixer, public OpalMediaStreamMixer
+{
+    PCLASSINFO(OpalVideoStreamForwarder, OpalBaseMixer);
+  public:
+    OpalVideoStreamForwarder(const OpalMixerNodeInfo & info);
+    ~OpalVideoStreamForwarder();
+
+    /**Add a stream from a participant, whose video may be forwarded.
+      */
+    virtual bool AddInput(
+      OpalMixerMediaStream & stream     ///< Sink stream of mixer connection
+    );
+
+    /**Add a stream to a participant, which forwarded video is sent to.
+      */
+    virtual void AddOutput(
+      OpalMixerMediaStream & stream     ///< Source stream of mixer connection
+    );
+
+    /**Remove a stream to a participant.
+      */
+    virtual void RemoveOutput(
+      OpalMixerMediaStream & stream     ///< Source stream of mixer connection
+    );
+
+    virtual void RemoveStream(const Key_T & key);
+    virtual bool WriteStream(const Key_T & key, const RTP_DataFrame & input);
+
+    /**Indicate the current audio level for a participant.
+       This is used to determine the active speaker.
+      */
+    virtual void SetAudioLevel(
+      const PString & token,  ///< Token for participants connection
+      unsigned level          ///< Mean absolute PCM-16 sample value, zero if not speaking
+    );
+
+    /**Handle a command received on an output stream.
+       Picture update requests are passed to the forwarded input, flow
+       control adjusts the simulcast layer selection.
+      */
+    virtual bool OnOutputCommand(
+      OpalMixerMediaStream & stream,    ///< Source stream of mixer connection
+      const OpalMediaCommand & command  ///< Command received
+    );
+
+    /**Get the key for the input stream currently the active speaker.
+      */
+    Key_T GetActiveSpeaker() const;
+
+  protected:
+    struct Layer
+    {
+      Layer();
+      void Update(const RTP_DataFrame & rtp);
+      bool IsKeyFrame(const RTP_DataFrame & rtp, const PString & encoding, bool frameStart);
+
+      PTime         m_lastPacket;
+      PTime         m_windowStart;
+      PINDEX        m_windowBytes;
+      OpalBandwidth m_bitRate;
+      bool          m_frameStart;
+      bool          m_detectorChecked;
+      OpalVideoFormat::FrameDetectorPtr m_detector;
+    };
+    typedef std::map<RTP_SyncSourceId, Layer> LayerMap;
+
+    struct ForwardStream : public Stream
+    {
+      ForwardStream();
+      virtual void QueuePacket(const RTP_DataFrame &) { }
+      RTP_SyncSourceId SelectLayer(OpalBandwidth bitRate, bool lowest) const;
+
+      PSafePtr<OpalMixerMediaStream> m_stream;
+      PString  m_token;
+      PString  m_encoding;
+      LayerMap m_layers;
+      unsigned m_audioLevel;
+      PTime    m_lastSpoke;
+    };
+
+    struct Output
+    {
+      Output();
+
+      PSafePtr<OpalMixerMediaStream> m_stream;
+      PString          m_token;
+      PString          m_encoding;
+      unsigned         m_sequence;
+      OpalBandwidth    m_bitRate;
+      Key_T            m_input;
+      RTP_SyncSourceId m_layer;
+      Key_T            m_pendingInput;
+      RTP_SyncSourceId m_pendingLayer;
+      bool             m_started;
+      RTP_Timestamp    m_lastTimestamp;
+      RTP_Timestamp    m_timestampOffset;
+      PTime            m_keyFrameRequested;
+    };
+    typedef std::map<PString, Output> OutputMap;
+    typedef std::map<PString, Key_T> InputByTokenMap;
+
+    typedef std::vector< std::pair<PSafePtr<OpalMixerMediaStream>, RTP_DataFrame> > PacketList;
+    typedef std::vector< std::pair<PSafePtr<OpalMixerMediaStream>, RTP_SyncSourceId> > KeyFrameList;
+
+    virtual Stream * CreateStream();
+    virtual bool MixStreams(RTP_DataFrame & frame);
+    virtual size_t GetOutputSize() const;
+
+    virtual void UpdateSelection();
+    void RequestKeyFrame(const Key_T & input, RTP_SyncSourceId layer);
+    void FlushKeyFrameRequests();
+
+    unsigned     m_thumbnails;
+    Key_T        m_activeSpeaker;
+    PTime        m_lastSpeakerChange;
+    PTime        m_lastSelection;
+    unsigned     m_nextSequence;
+    OutputMap    m_outputs;
+    KeyFrameList m_keyFrameRequests;
+    InputByTokenMap m_inputByToken;
 };
 #endif // OPAL_VIDEO
 
@@ -1210,6 +1458,21 @@ class OpalMixerNode : public PSafeObject
       const RTP_DataFrame & input           ///< Input RTP data for media
     );
 
+#if OPAL_VIDEO
+    /**Get the rate at which decoded pixels arrive at the video mixers.
+       See OpalVideoMixer::GetDecodedPixelRate().
+      */
+    uint64_t GetDecodedPixelRate() const;
+#endif
+
+    /**Handle a command received on a mixer output stream.
+       Returns false if not handled by the node.
+      */
+    virtual bool OnOutputCommand(
+      OpalMixerMediaStream & stream,    ///< Source stream of mixer connection
+      const OpalMediaCommand & command  ///< Command received
+    );
+
     /**Send a user input indication to all connections.
       */
     virtual void BroadcastUserInput(
@@ -1310,6 +1573,8 @@ class OpalMixerNode : public PSafeObject
 #if OPAL_VIDEO
     typedef std::map<OpalVideoFormat::ContentRole, OpalVideoStreamMixer *> VideoMixerMap;
     VideoMixerMap m_videoMixers;
+    typedef std::map<OpalVideoFormat::ContentRole, OpalVideoStreamForwarder *> VideoForwarderMap;
+    VideoForwarderMap m_videoForwarders;
 #endif // OPAL_VIDEO
 
     typedef std::map<PString, OpalBaseMixer *> MixerByIdMap;
@@ -39,10 +39,13 @@
 #if OPAL_H323
 
 #include <opal/mediafmt.h>
+#include <opal/keepalive.h>
 #include <h323/h225ras.h>
 #include <h323/h235auth.h>
 #include <h460/h460.h>
 
+#include <ptclib/threadpool.h>
+
 class H323Connection;
 class H225_ArrayOf_AliasAddress;
 class H225_H323_UU_PDU;
@@ -56,6 +59,10 @@ class H460_FeatureSet;
 ///////////////////////////////////////////////////////////////////////////////
 
 /**This class embodies the H.225.0 RAS protocol to gatekeepers.
+   Each instance is one registration. Keep alives for all registrations are
+   scheduled by the managers OpalKeepAliveScheduler and done by the endpoint
+   GkMonitor thread pool, but each registration still has its own RAS socket
+   and transactor thread, sequence numbers are only unique per registration.
   */
 class H323Gatekeeper : public H225_RAS
 {
@@ -334,6 +341,46 @@ class H323Gatekeeper : public H225_RAS
 
     void ReRegisterNow();
 
+    /**Round trip times for requests to the gatekeeper of one type.
+      */
+    struct RequestStatistics
+    {
+      RequestStatistics();
+
+      unsigned      m_count;    ///< Number of requests confirmed
+      unsigned      m_failed;   ///< Number of requests rejected or timed out
+      PTimeInterval m_last;     ///< Round trip time of last confirmed request
+      PTimeInterval m_minimum;  ///< Minimum round trip time of confirmed requests
+      PTimeInterval m_maximum;  ///< Maximum round trip time of confirmed requests
+      PTimeInterval m_total;    ///< Total round trip time of confirmed requests, for the average
+    };
+
+    /**Get the round trip times for RRQ, ARQ etc, to this gatekeeper.
+       As each H323Gatekeeper is a registration, this gives per registration
+       latency when the endpoint has many registrations.
+      */
+    RequestStatistics GetRequestStatistics(
+      unsigned requestTag   ///< Request PDU tag, e.g. H225_RasMessage::e_registrationRequest
+    );
+
+    /**Work done for the gatekeeper by a thread from the endpoint pool.
+       As a work group is used per gatekeeper, registration and IRR for a
+       gatekeeper are not done concurrently, as they were not with a thread
+       per gatekeeper.
+      */
+    class MonitorWork
+    {
+      public:
+        MonitorWork(H323Gatekeeper & gk, bool registration) : m_gatekeeper(&gk), m_registration(registration) { }
+        virtual ~MonitorWork() { }
+        virtual void Work() { if (m_gatekeeper != NULL) m_gatekeeper->Monitor(*this); }
+      protected:
+        H323Gatekeeper * m_gatekeeper; // NULL if cancelled by StopChannel()
+        bool             m_registration;
+      friend class H323Gatekeeper;
+    };
+    typedef PQueuedThreadPool<MonitorWork> MonitorPool;
+
   protected:
     bool StartGatekeeper(const H323TransportAddress & address);
     virtual bool DiscoverGatekeeper();
@@ -363,6 +410,9 @@ class H323Gatekeeper : public H225_RAS
     virtual PBoolean MakeRequest(
       Request & request
     );
+    bool InternalMakeRequest(
+      Request & request
+    );
     PBoolean MakeRequestWithReregister(
       Request & request,
       unsigned unregisteredTag
@@ -416,8 +466,10 @@ class H323Gatekeeper : public H225_RAS
     AlternateList m_alternates;
     bool          m_alternateTemporary;
 
-    PMutex             m_requestMutex;
+    PReadWriteMutex    m_requestMutex;  ///< Write lock only needed to change to alternate gatekeeper
     H235Authenticators m_authenticators;
+    PDECLARE_MUTEX(m_statisticsMutex);
+    std::map<unsigned, RequestStatistics> m_requestStatistics;
 	
 #if OPAL_H460
     H460_FeatureSet * m_features;
@@ -439,10 +491,37 @@ class H323Gatekeeper : public H225_RAS
     bool          m_requiresDiscovery;
     PTimeInterval m_infoRequestTime;
     bool          m_willRespondToIRR;
-    PThread     * m_monitorThread;
+    bool          m_discoveryDelayed;
+    PSimpleTimer  m_discoveryDelay;
+
+    /* The lightweight RRQ and unsolicited IRR are sent by the shared keep
+       alive scheduler queueing MonitorWork to the endpoint pool, rather than
+       a thread per gatekeeper. */
+    class MonitorClient : public OpalKeepAliveScheduler::Client
+    {
+      public:
+        MonitorClient(H323Gatekeeper & gk, bool registration)
+          : OpalKeepAliveScheduler::Client(OpalKeepAliveScheduler::e_GatekeeperKeepAlive)
+          , m_gatekeeper(gk)
+          , m_registration(registration)
+        { }
+        virtual bool OnKeepAlive() { return m_gatekeeper.QueueMonitorWork(m_registration); }
+      protected:
+        H323Gatekeeper & m_gatekeeper;
+        bool             m_registration;
+    };
+    MonitorClient m_registrationClient;
+    MonitorClient m_infoRequestClient;
+
+    PDECLARE_MUTEX(m_monitorMutex);
     bool          m_monitorRunning;
-    PSyncPoint    m_monitorTickle;
-    void Monitor();
+    bool          m_registrationQueued;
+    bool          m_infoRequestQueued;
+    std::list<MonitorWork *> m_monitorWork; // Queued or running
+    PSyncPoint    m_monitorWorkDone; // Signalled when m_monitorWork becomes empty
+    PThread     * m_monitorWorkThread;
+    bool QueueMonitorWork(bool registration);
+    void Monitor(MonitorWork & work);
     PTimeInterval InternalRegister();
 
     std::set< PSafePtr<H323Connection> > m_activeConnections;
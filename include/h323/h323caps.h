@@ -71,6 +71,7 @@ class H245_GenericParameter;
 class H245_EncryptionSync;
 class H245_EncryptionAuthenticationAndIntegrity;
 class H235SecurityCapability;
+class H323ControlPDU;
 
 #if OPAL_H239
   const OpalMediaFormat & GetH239VideoMediaFormat();
@@ -303,6 +304,28 @@ class H323Capability : public PObject
     virtual PBoolean IsUsable(
       const H323Connection & connection
     ) const;
+
+    /// Hash used as the key for cached PDUs, see H323CapabilitySetCache
+    typedef PUInt64 Signature;
+
+    /**Add a signature of everything that determines what OnSendingPDU()
+       puts in a TerminalCapabilitySet, used as the key for cached PDUs, see
+       H323CapabilitySetCache. A descendant that has members of its own which
+       change the PDU must override this and add them.
+
+       The default behaviour adds the class, capability number, direction,
+       format name and all media format options. Option values are hashed
+       directly rather than converted to strings, as this is done for every
+       TerminalCapabilitySet sent.
+      */
+    virtual void AddSignature(
+      Signature & signature   ///< Signature to add to
+    ) const;
+
+    /// Add data to a signature, using 64 bit FNV-1a
+    static void AddToSignature(Signature & signature, const void * data, size_t size);
+    static void AddToSignature(Signature & signature, const PString & str);
+    static void AddToSignature(Signature & signature, unsigned value);
   //@}
 
   /**@name Member variable access */
@@ -1717,6 +1740,11 @@ class H235SecurityCapability : public H323Capability
       const H323Connection & connection,
       const H323Capabilities & capabilities
     );
+
+    /// Add the media capability and crypto suites to the signature
+    virtual void AddSignature(
+      Signature & signature
+    ) const;
   //@}
 
     virtual bool OnSendingPDU(H245_EncryptionAuthenticationAndIntegrity & pdu) const = 0;
@@ -2764,6 +2792,16 @@ class H323Capabilities : public PObject
       H245_TerminalCapabilitySet & pdu    ///<  PDU to build
     ) const;
 
+    /**Get a signature of the PDU BuildPDU() would create for the connection,
+       for use as the key in H323CapabilitySetCache. As with BuildPDU(), this
+       customises the media format options of the usable capabilities, so
+       the state of the capabilities is the same whether the PDU is built or
+       taken from the cache.
+      */
+    H323Capability::Signature GetPDUSignature(
+      const H323Connection & connection   ///<  Connection building PDU for
+    ) const;
+
     /**Merge the capabilities into this set.
       */
     PBoolean Merge(
@@ -2822,6 +2860,76 @@ class H323Capabilities : public PObject
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+/**Cache of PER encoded TerminalCapabilitySet PDUs.
+   Endpoints usually offer the same capabilities on every call, so rather
+   than build the ASN.1 from the capability table and encode it each time,
+   the encoded H.245 message is kept, keyed by H323Capabilities::GetPDUSignature()
+   and anything else that affects the PDU. As the key is a 64 bit hash, there
+   is a very small chance of two different capability sets sharing a key. Only the sequence number differs
+   between calls, and that is patched into the saved bytes.
+
+   The cache is disabled by default, and must be enabled by the application
+   with SetMaxEntries(). Note that when a cached PDU is used,
+   H323Connection::OnSendCapabilitySet() is not called, and the PDU is not
+   traced, so it should not be enabled if that function is overridden to
+   alter the PDU differently for each call.
+  */
+class H323CapabilitySetCache : public PObject
+{
+    PCLASSINFO(H323CapabilitySetCache, PObject);
+  public:
+    H323CapabilitySetCache(
+      PINDEX maxEntries = 0     ///< Maximum different PDUs to keep, zero disables
+    );
+
+    /**Get the encoded TerminalCapabilitySet control PDU for the key, with
+       the sequence number set.
+       @return false if not in cache.
+      */
+    bool GetCapabilitySet(
+      H323Capability::Signature key, ///< Key for PDU
+      unsigned sequenceNumber,  ///< Sequence number for the PDU
+      PBYTEArray & encoded      ///< Encoded H.245 message
+    );
+
+    /**Save the TerminalCapabilitySet control PDU for the key.
+      */
+    void SetCapabilitySet(
+      H323Capability::Signature key, ///< Key for PDU
+      const H323ControlPDU & pdu  ///< H.245 message containing TerminalCapabilitySet
+    );
+
+    /// Remove all cached PDUs
+    void RemoveAll();
+
+    /// Set maximum number of entries, zero disables the cache
+    void SetMaxEntries(PINDEX maxEntries);
+
+    /// Get maximum number of entries, zero is disabled
+    PINDEX GetMaxEntries() const { return m_maxEntries; }
+
+    /// Get number of times the cache was used
+    unsigned GetHits() const { return m_hits; }
+
+    /// Get number of times the PDU had to be built
+    unsigned GetMisses() const { return m_misses; }
+
+  protected:
+    struct Entry {
+      PBYTEArray m_encoded;
+      PINDEX     m_sequenceNumberOffset;
+    };
+    typedef std::map<H323Capability::Signature, Entry> EntryMap;
+    EntryMap m_entries;
+    PINDEX   m_maxEntries;
+    unsigned m_hits;
+    unsigned m_misses;
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /* New capability registration macros based on abstract factories
@@ -404,6 +404,32 @@ class H323Connection : public OpalRTPConnection
      */
     virtual void HandleSignallingChannel();
 
+    /**Handle a single read from the signalling channel, returns false when
+       the channel should no longer be read.
+       This is an internal function and is unlikely to be used by applications.
+     */
+    virtual PBoolean HandleReceivedSignalPDU(
+      PBoolean readStatus,      ///<  Result of reading the PDU
+      H323SignalPDU & pdu       ///<  PDU read
+    );
+
+    /**Handle a single read from the signalling channel, returns false when
+       the channel should no longer be read. The read error is supplied by
+       the caller, rather than taken from the channel, as the read may have
+       been done by another thread, e.g. H323SignalReactor.
+       This is an internal function and is unlikely to be used by applications.
+     */
+    virtual PBoolean HandleReceivedSignalPDU(
+      PBoolean readStatus,      ///<  Result of reading the PDU
+      PChannel::Errors readError, ///<  Error code for read, if readStatus false
+      H323SignalPDU & pdu       ///<  PDU read
+    );
+
+    /**Called when the signalling channel is no longer being read.
+       This is an internal function and is unlikely to be used by applications.
+     */
+    void EndHandleSignallingChannel();
+
     /**Handle PDU from the signalling channel.
        This is an internal function and is unlikely to be used by applications.
      */
@@ -1054,6 +1080,14 @@ class H323Connection : public OpalRTPConnection
       const H323ControlPDU & pdu
     );
 
+    /**Write an already PER encoded PDU to the control channel.
+       As for WriteControlPDU(), if there is no control channel open then
+       this will tunnel the PDU into the signalling channel.
+      */
+    virtual bool WriteEncodedControlPDU(
+      const PBYTEArray & encoded
+    );
+
     /**Start control channel negotiations.
       */
     virtual PBoolean StartControlNegotiations();
@@ -1090,6 +1124,16 @@ class H323Connection : public OpalRTPConnection
       PPER_Stream & strm
     );
 
+    /**Handle a single received PDU from the control channel, with the read
+       error supplied by the caller rather than taken from the channel.
+       This is an internal function and is unlikely to be used by applications.
+    */
+    virtual PBoolean HandleReceivedControlPDU(
+      PBoolean readStatus,
+      PChannel::Errors readError,
+      PPER_Stream & strm
+    );
+
     /**This function is called from the HandleControlPDU() function
        for unhandled PDU types.
 
@@ -2300,6 +2344,8 @@ class H323Connection : public OpalRTPConnection
     PTimer       m_UserInputIndicationTimer;
     PDECLARE_NOTIFIER(PTimer, H323Connection, UserInputIndicationTimeout);
 
+  friend class H323SignalReactor;
+
   private:
     P_REMOVE_VIRTUAL_VOID(CleanUpOnCallEnd());
     P_REMOVE_VIRTUAL_VOID(OnCleared());
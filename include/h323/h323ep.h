@@ -43,6 +43,7 @@
 #include <opal/call.h>
 #include <opal/transports.h>
 #include <h323/h323con.h>
+#include <h323/q931.h>
 #include <h323/h323caps.h>
 #include <h323/h235auth.h>
 #include <h323/gkclient.h>
@@ -60,6 +61,8 @@ class H235SecurityInfo;
 
 class H323Gatekeeper;
 class H323SignalPDU;
+class H323SignalPreParse;
+class H323SignalReactor;
 class H323ServiceControlSession;
 
 class H46019Server;
@@ -94,7 +97,8 @@ class H323EndPoint : public OpalRTPEndPoint
     /**Create a new endpoint.
      */
     H323EndPoint(
-      OpalManager & manager
+      OpalManager & manager,
+      unsigned maxGatekeeperThreads = 10  ///< Maximum threads for gatekeeper registrations
     );
 
     /**Destroy endpoint.
@@ -420,6 +424,23 @@ class H323EndPoint : public OpalRTPEndPoint
       bool reused = false
     );
 
+    /**Call back for the first Setup PDU on an incoming signalling channel,
+       after it has been pre-parsed and before it is fully decoded.
+       This allows calls to be screened, or rejected under overload, without
+       the cost of the full decode.
+
+       Return Q931::ErrorInCauseIE to continue with the call, or a cause to
+       reject it with a Release Complete PDU.
+
+       The default behaviour rejects the call with Q931::Congestion if there
+       are GetMaxIncomingCalls() or more connections, or if the manager's
+       OpalAdmissionController does not accept the call.
+      */
+    virtual Q931::CauseValues OnIncomingSetupPreParse(
+      const OpalTransport & transport,      ///<  Transport the PDU came in on
+      const H323SignalPreParse & preParse   ///<  Fields of the Setup PDU
+    );
+
     /**Create a connection that uses the specified call.
       */
     virtual H323Connection * CreateConnection(
@@ -1038,6 +1059,56 @@ class H323EndPoint : public OpalRTPEndPoint
      */
     const H323Capabilities & GetCapabilities() const { return m_capabilities; }
 
+    /**Get the cache of encoded TerminalCapabilitySet PDUs, shared by all
+       connections. Caching is disabled until SetMaxEntries() is used on it.
+     */
+    H323CapabilitySetCache & GetCapabilitySetCache() { return m_capabilitySetCache; }
+
+    /**Multiplex the H.225 and H.245 TCP channels of all calls on a few
+       threads, instead of a thread per channel. This must be done before
+       any calls are made, and cannot be undone.
+
+       Returns false if already set or the threads could not be started.
+     */
+    bool SetSignalReactor(
+      unsigned selectThreads,   ///< Number of threads waiting on sockets
+      unsigned maxWorkers       ///< Maximum number of threads handling PDUs
+    );
+
+    /**Get the signalling channel reactor, NULL if a thread per channel is used.
+     */
+    H323SignalReactor * GetSignalReactor() const { return m_signalReactor; }
+
+    /**Get the number of PDUs queued, or being handled, by the signalling
+       channel reactor.
+     */
+    virtual unsigned GetPendingWorkCount() const;
+
+    /**Set the number of connections at which new incoming calls are
+       rejected by OnIncomingSetupPreParse(). Zero is no limit.
+     */
+    void SetMaxIncomingCalls(PINDEX max) { m_maxIncomingCalls = max; }
+
+    /**Get the number of connections at which new incoming calls are
+       rejected by OnIncomingSetupPreParse(). Zero is no limit.
+     */
+    PINDEX GetMaxIncomingCalls() const { return m_maxIncomingCalls; }
+
+    struct PreParseStatistics
+    {
+      PreParseStatistics();
+
+      PUInt64 m_parsed;     ///< PDUs pre-parsed on new or reused signalling channels
+      PUInt64 m_discarded;  ///< PDUs that were not a Setup, discarded without full decode
+      PUInt64 m_rejected;   ///< Setup PDUs rejected without full decode
+      PUInt64 m_decoded;    ///< Setup PDUs accepted and fully decoded
+    };
+
+    /**Get the statistics for the pre-parse of the first PDUs on incoming
+       signalling channels.
+     */
+    PreParseStatistics GetPreParseStatistics();
+
     /**Endpoint types.
      */
     enum TerminalTypes {
@@ -1367,6 +1438,10 @@ class H323EndPoint : public OpalRTPEndPoint
 
     PTimeInterval InternalGetGatekeeperStartDelay();
 
+    /**Get the pool of threads doing gatekeeper registrations.
+      */
+    H323Gatekeeper::MonitorPool & GetGatekeeperMonitorPool() { return m_gatekeeperMonitorPool; }
+
   protected:
     bool InternalStartGatekeeper(const H323TransportAddress & remoteAddress, const PString & localAddress);
     bool InternalRestartGatekeeper(bool adjustingRegistrations = true);
@@ -1459,10 +1534,12 @@ class H323EndPoint : public OpalRTPEndPoint
     std::set<OpalTransportPtr> m_reusableTransports;
     PMutex                     m_reusableTransportMutex;
 
-    H323Capabilities m_capabilities;
+    H323Capabilities       m_capabilities;
+    H323CapabilitySetCache m_capabilitySetCache;
 
     typedef PDictionary<PString, H323Gatekeeper> GatekeeperByAlias;
 
+    H323Gatekeeper::MonitorPool m_gatekeeperMonitorPool;
     GatekeeperList            m_gatekeepers;
     GatekeeperByAlias         m_gatekeeperByAlias;
     OpalTransportAddressArray m_gatekeeperInterfaces;
@@ -1492,6 +1569,12 @@ class H323EndPoint : public OpalRTPEndPoint
     typedef map<H323Connection::CompatibilityIssues, PRegularExpression> CompatibilityEndpoints;
     CompatibilityEndpoints m_compatibility;
 
+    H323SignalReactor * m_signalReactor;
+
+    atomic<PINDEX>     m_maxIncomingCalls;
+    PreParseStatistics m_preParseStatistics;
+    PDECLARE_MUTEX(m_preParseMutex);
+
   private:
     P_REMOVE_VIRTUAL_VOID(OnConnectionCleared(H323Connection &, const PString &));
     P_REMOVE_VIRTUAL_VOID(OnRTPStatistics(const H323Connection &, const OpalRTPSession &) const);
@@ -171,6 +171,13 @@ class H323SignalPDU : public H225_H323_UserInformation
       H323Transport & transport   ///<  Transport to read from
     );
 
+    /**Decode PDU from data already read from the transport, minus the TPKT
+       header. Returns false if the Q.931 PDU could not be parsed.
+      */
+    PBoolean ProcessReadData(
+      const PBYTEArray & rawData  ///<  Data read from transport
+    );
+
     /**Write the PDU to the transport.
       */
     PBoolean Write(
@@ -248,6 +255,35 @@ class H323SignalPDU : public H225_H323_UserInformation
 };
 
 
+/**Fields of an H.225 call signalling PDU, extracted from the raw data without
+   the full decode of H323SignalPDU::ProcessReadData().
+   This is enough for call screening and overload rejection, which may then
+   be done before the cost of decoding a Setup PDU with all of its fast
+   start, security and feature elements.
+ */
+class H323SignalPreParse
+{
+  public:
+    H323SignalPreParse();
+
+    /**Parse data read from the transport, minus the TPKT header.
+       Returns false if the Q.931 PDU could not be parsed, in which case
+       H323SignalPDU::ProcessReadData() would also fail.
+      */
+    bool Parse(
+      const PBYTEArray & rawData  ///<  Data read from transport
+    );
+
+    Q931::MsgTypes       m_messageType;
+    unsigned             m_callReference;
+    bool                 m_fromDestination;
+    PString              m_callingPartyNumber;
+    PString              m_calledPartyNumber;
+    unsigned             m_bodyTag;       ///< H225_H323_UU_PDU_h323_message_body tag, UINT_MAX if not present
+    OpalGloballyUniqueID m_conferenceID;  ///< Only for Setup PDU, NULL if not present
+};
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 /**Wrapper class for the H323 control channel.
@@ -0,0 +1,170 @@
+/*
+ * h323reactor.h
+ *
+ * H.323 signalling channel reactor
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_H323_H323REACTOR_H
+#define OPAL_H323_H323REACTOR_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_H323
+
+#include <opal/transports.h>
+#include <ptclib/threadpool.h>
+
+
+class H323EndPoint;
+class H323Connection;
+
+
+/**Multiplex the H.225 and H.245 TCP channels of many calls on a few threads.
+   Without this, each channel has a thread blocked reading it for the
+   duration of the call.
+
+   Each select thread waits on its channels with PSocket::Select() and
+   reassembles the TPKT framed PDUs as data arrives. The PDUs are queued to
+   a thread pool using the connection token as the work group, so all PDUs
+   for a call, on either channel, are handled in order and never
+   concurrently, as they would be with a thread per channel.
+
+   Channel read timeouts, as set by H323Connection, are honoured, so call
+   status monitoring and signalling timeouts work as before.
+
+   Only plain TCP channels are multiplexed, TLS channels still get a thread.
+  */
+class H323SignalReactor : public PObject
+{
+    PCLASSINFO(H323SignalReactor, PObject);
+  public:
+    enum ChannelType {
+      SignallingChannel,
+      ControlChannel
+    };
+
+    H323SignalReactor(
+      H323EndPoint & endpoint,  ///< Endpoint for connections
+      unsigned selectThreads,   ///< Number of threads waiting on sockets
+      unsigned maxWorkers       ///< Maximum number of threads handling PDUs
+    );
+
+    ~H323SignalReactor();
+
+    /**Indicate the threads were started.
+      */
+    bool IsRunning() const { return !m_selectThreads.empty(); }
+
+    /**Determine if the transport can be multiplexed by the reactor.
+      */
+    bool CanMultiplex(
+      const OpalTransport & transport
+    ) const;
+
+    /**Start reading the channel for the connection.
+       Returns false if the channel cannot be multiplexed, in which case the
+       caller should use a thread as before.
+      */
+    bool AddChannel(
+      H323Connection & connection,
+      const OpalTransportPtr & transport,
+      ChannelType type
+    );
+
+    /**Stop reading the channel, e.g. so it may be reused for another call.
+      */
+    void RemoveChannel(
+      const OpalTransport & transport
+    );
+
+    /**Queue a call to H323Connection::HandleControlChannel() in the work
+       group for the connection, for a newly connected H.245 channel.
+      */
+    void QueueStartControlChannel(
+      H323Connection & connection
+    );
+
+    /**Stop all threads. Channels are not closed.
+      */
+    void ShutDown();
+
+    /**Get the number of channels being read.
+      */
+    PINDEX GetChannelCount();
+
+    /**Get the number of PDUs queued, or being handled, by the workers.
+      */
+    unsigned GetPendingWorkCount() const { return m_pendingWork; }
+
+  protected:
+    struct Channel;
+    class SelectThread;
+
+    class WorkItem : public PObject
+    {
+        PCLASSINFO(WorkItem, PObject);
+      public:
+        WorkItem(
+          H323SignalReactor & reactor,
+          const PSmartPointer & channel,
+          PChannel::Errors error,
+          const PBYTEArray & pdu = PBYTEArray()
+        );
+        WorkItem(
+          H323SignalReactor & reactor,
+          H323Connection & connection
+        );
+        ~WorkItem();
+
+        virtual void Work();
+
+      protected:
+        H323SignalReactor      & m_reactor;
+        PSmartPointer            m_channel;
+        PSafePtr<H323Connection> m_connection;
+        PChannel::Errors         m_error;
+        PBYTEArray               m_pdu;
+    };
+
+    typedef PQueuedThreadPool<WorkItem> WorkerPool;
+
+    void QueueWork(WorkItem * work, const PString & token);
+    void HandleChannel(Channel & channel, PChannel::Errors error, const PBYTEArray & data);
+
+    H323EndPoint               & m_endpoint;
+    atomic<unsigned>             m_pendingWork;
+    WorkerPool                   m_workers;
+    std::vector<SelectThread *>  m_selectThreads;
+};
+
+
+#endif // OPAL_H323
+
+#endif // OPAL_H323_H323REACTOR_H
+
+
+/////////////////////////////////////////////////////////////////////////////
@@ -54,6 +54,14 @@ class H323TransactionPDU {
     virtual PBoolean Read(H323Transport & transport);
     virtual PBoolean Write(H323Transport & transport);
 
+    /**Encode the PDU and finalise any security, as done by Write().
+      */
+    void Encode(PPER_Stream & strm);
+
+    /**Write PDU previously encoded by Encode() to the transport.
+      */
+    PBoolean WriteEncoded(H323Transport & transport, const PBYTEArray & encoded);
+
     virtual PASN_Object & GetPDU() = 0;
     virtual PASN_Choice & GetChoice() = 0;
     virtual const PASN_Object & GetPDU() const = 0;
@@ -276,16 +284,21 @@ class H323Transactor : public PObject
         PCLASSINFO(Response, PString);
       public:
         Response(const H323TransportAddress & addr, unsigned seqNum);
-        ~Response();
 
-        void SetPDU(const H323TransactionPDU & pdu);
+        void SetPDU(const PBYTEArray & encoded, unsigned delay);
         PBoolean SendCachedResponse(H323Transport & transport);
 
-        PTime                m_lastUsedTime;
-        PTimeInterval        m_retirementAge;
-        H323TransactionPDU * m_replyPDU;
+        PTime         m_lastUsedTime;
+        PTimeInterval m_retirementAge;
+        PBYTEArray    m_replyPDU;
     };
 
+    /* The request PDU is handed to H323Transaction rather than copied when
+       it is the one just read by HandleTransactions(), avoiding a deep copy
+       of the decoded tree for every request a gatekeeper receives. */
+    H323TransactionPDU * DetachReadPDU(const H323TransactionPDU & pdu);
+    void ReleaseReadPDU(H323TransactionPDU * pdu);
+
     // Configuration variables
     H323EndPoint  & m_endpoint;
     WORD            m_defaultLocalPort;
@@ -301,6 +314,12 @@ class H323Transactor : public PObject
 
     PMutex                m_pduWriteMutex;
     PSortedList<Response> m_responses;
+
+    PMutex               m_readPDUMutex;
+    H323TransactionPDU * m_readPDU;
+    bool                 m_readPDUDetached;
+
+  friend class H323Transaction;
 };
 
 
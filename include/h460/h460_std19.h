@@ -41,6 +41,7 @@
 #if OPAL_H460_NAT
 
 #include <rtp/rtp.h>
+#include <opal/keepalive.h>
 
 #if _MSC_VER
 #pragma once
@@ -211,9 +212,20 @@ class H46019UDPSocket : public PNATUDPSocket
     PTimeInterval               m_keepAliveTTL;         ///< KeepAlive TTL
     WORD                        m_keepAliveSequence;    ///< KeepAlive sequence number
 
-    PDECLARE_NOTIFIER(PTimer, H46019UDPSocket, KeepAliveTimeout);
-    PTimer m_keepAliveTimer;
-    void SendKeepAliveRTP(const PIPSocketAddressAndPort & ipAndPort);
+    class KeepAliveClient : public OpalKeepAliveScheduler::Client
+    {
+      public:
+        KeepAliveClient(H46019UDPSocket & socket, OpalKeepAliveScheduler::Types type)
+          : OpalKeepAliveScheduler::Client(type)
+          , m_socket(socket)
+        { }
+        virtual bool OnKeepAlive() { return m_socket.KeepAliveTimeout(); }
+      protected:
+        H46019UDPSocket & m_socket;
+    } m_keepAliveClient;
+    bool KeepAliveTimeout();
+    OpalKeepAliveScheduler & m_keepAliveScheduler;
+    bool SendKeepAliveRTP(const PIPSocketAddressAndPort & ipAndPort);
 
     // H.460.19 multiplex transmit
     bool     m_multiplexedTransmit;
@@ -94,6 +94,27 @@ class IAX2Frame :  public PObject
   /**True if is is an audio frame */
   PBoolean IsAudio() const { return isAudio; }
 
+  /**True if it is a meta trunk frame, holding mini frames for many calls */
+  PBoolean IsTrunkFrame() const { return isTrunk; }
+
+  /**True if the contents have been encrypted for transmission */
+  PBoolean IsEncrypted() const { return isEncrypted; }
+
+  /**Split a meta trunk frame into the mini frames it carries, which are
+     added to the supplied list. This frame is not altered.*/
+  void SplitTrunkFrame(IAX2FrameList & frames);
+
+  /**Meta command values, in the third byte of a meta frame */
+  enum MetaCommands {
+    MetaTrunk = 1  /*!< Meta trunk frame, with mini frames for many calls */
+  };
+
+  /**Meta trunk command data values, in the fourth byte of a meta frame */
+  enum MetaTrunkCommandData {
+    MetaTrunkSuperMini = 0,  /*!< Trunk entries have no timestamps */
+    MetaTrunkMini      = 1   /*!< Trunk entries have a 16 bit timestamp */
+  };
+
   /**Pointer to the beginning of the media (after the header) in this packet.
      The low level frame has no idea on headers, so just return pointer to beginning
      of data. */
@@ -274,6 +295,12 @@ class IAX2Frame :  public PObject
   
   /**Flag to indicate if this is a MiniFrame with audio */
   PBoolean               isAudio;
+
+  /**Flag to indicate if this is a meta trunk frame */
+  PBoolean               isTrunk;
+
+  /**Flag to indicate the contents have been encrypted */
+  PBoolean               isEncrypted;
   
   /**Index of where we are reading from the internal data area */
   PINDEX               currentReadIndex;  
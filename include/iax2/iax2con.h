@@ -272,6 +272,9 @@ class IAX2Connection : public OpalConnection
   /**Get information on Remote class (remote node address & port + source & dest call number.) */
   IAX2Remote & GetRemoteInfo() { return iax2Processor.GetRemoteInfo(); }
 
+  /**Get the processor which handles the frames of this connection */
+  IAX2CallProcessor & GetCallProcessor() { return iax2Processor; }
+
   /**Get the sequence number info (inSeqNo and outSeqNo) */
   IAX2SequenceNumbers & GetSequenceInfo() { return iax2Processor.GetSequenceInfo(); }
   
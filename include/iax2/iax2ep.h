@@ -107,7 +107,8 @@ class IAX2EndPoint : public OpalEndPoint
   //@{
   /**Create the endpoint, and define local variables */
   IAX2EndPoint(
-    OpalManager & manager
+    OpalManager & manager,
+    unsigned maxThreads = 10  ///< Maximum threads processing calls and registrations
   );
   
   /**Destroy the endpoint, and all associated connections*/
@@ -237,6 +238,22 @@ class IAX2EndPoint : public OpalEndPoint
      @return True if a connection (which matches this Frame ) can be
      found. */
   PBoolean ConnectionForFrameIsAlive(IAX2Frame *f);
+
+  /**Look up the call processor for the frame in the call number table, and
+     if found give the frame to it. This avoids building and translating the
+     connection token for every voice frame.
+
+     @return false if the frame was not handled, and the token based
+     search must be used. */
+  PBoolean ProcessInCallNumberTable(IAX2Frame *f);
+
+  /**Enter the call numbers of the connection, as found from the frame
+     delivered to it, in the call number table. */
+  void AddToCallNumberTable(IAX2Connection & connection, IAX2Frame & frame);
+
+  /**Remove all call number table entries for the connection, which must
+     be done before it is deleted. */
+  void RemoveFromCallNumberTable(IAX2Connection & connection);
  
   /**Get out sequence number to use on status query frames*/
   PINDEX GetOutSequenceNumberForStatusQuery();
@@ -333,6 +350,23 @@ class IAX2EndPoint : public OpalEndPoint
 
   /**Copy to the supplied OpalMediaList the media formats we support*/
   void CopyLocalMediaFormats(OpalMediaFormatList & list);
+
+  /**Enable or disable trunking to a remote peer, given as host[:port].
+     When enabled, the audio of all calls to the peer is aggregated into
+     meta trunk frames, which greatly reduces the packet rate. IAX2 has
+     no negotiation for this, so the peer must also be configured to
+     accept trunk frames, e.g. "trunk=yes" in Asterisk. Return false if
+     the host could not be resolved. */
+  PBoolean SetTrunkPeer(
+      const PString & host,
+      PBoolean enable = true
+    );
+
+  /**Set the interval between meta trunk frames to each peer. This is
+     also the maximum delay added to audio frames. Default 20ms */
+  void SetTrunkInterval(
+      const PTimeInterval & interval
+    );
   
   /**Register with a remote iax2 server.  The host can either be a 
      hostname or ip address.  The password is optional as some servers
@@ -397,6 +431,10 @@ class IAX2EndPoint : public OpalEndPoint
   /**Report if this iax2 endpoint class is correctly initialised */
   PBoolean InitialisedOK() { return (transmitter != NULL) && (receiver != NULL); }
 
+  /**Get the thread pool that runs the processing for all calls and
+     registrations */
+  IAX2ProcessorThreadPool & GetProcessorThreadPool() { return m_processorThreadPool; }
+
   /**Report if there are frames (from the ethernet) waiting to be
      processed */
   PBoolean EthernetFramesToBeProcessed() 
@@ -412,6 +450,9 @@ class IAX2EndPoint : public OpalEndPoint
      list. */
   IAX2IncomingEthernetFrames m_incomingFrameHandler;
 
+  /**Threads which run the processors, rather than a thread per call */
+  IAX2ProcessorThreadPool m_processorThreadPool;
+
   /**List of iax2 packets which has been read from the ethernet, and
      is to be sent to the matching IAX2Connection */
   IAX2FrameList   m_packetsReadFromEthernet;
@@ -493,6 +534,33 @@ class IAX2EndPoint : public OpalEndPoint
      threads.  */
   PReadWriteMutex  m_mutexTokenTable;
 
+  enum {
+    /**Call numbers are 15 bits */
+    MaxCallNumbers = 0x8000
+  };
+
+  struct CallNumberEntry {
+    CallNumberEntry() : m_processor(NULL) { }
+    PIPSocket::Address  m_address;
+    IAX2CallProcessor * m_processor;
+  };
+
+  /**Processors indexed by the remote's source call number, which is in
+     every frame including mini frames. If two remotes use the same call
+     number to us, the later ones go in m_callNumberOverflow. */
+  std::vector<CallNumberEntry> m_remoteCallNumbers;
+  std::multimap<PINDEX, CallNumberEntry> m_callNumberOverflow;
+
+  /**Processors indexed by our source call number, for the transmitter
+     checking the connection for a frame is still alive. */
+  std::vector<IAX2CallProcessor *> m_localCallNumbers;
+
+  /**The call numbers entered for each connection, so they may be removed */
+  std::map<IAX2Connection *, std::pair<PINDEX, PINDEX> > m_callNumbersOfConnection;
+
+  /**Threading mutex on the call number table */
+  PReadWriteMutex  m_mutexCallNumberTable;
+
   /**Thread safe counter which keeps track of the calls created by this endpoint.
      This value is used when giving outgoing calls a unique ID */
   atomic<uint32_t> m_callsEstablished;
@@ -65,7 +65,7 @@ Note that all connections send data to the same IAX2Transmit.
 \li IAX2FrameList              - A list of frames, which can be accessed in a thread safe fashion.
 \li IAX2Connection          - Manage the IAX2 protocol for one call, and connect to Opal
 \li IAX2EndPoint            - Manage the IAX2 protocol specific issues which are common to all calls, and connect to Opal.
-\li IAX2Processor           - Separate thread to handle all IAX2 protocol requests, and transfer media frames.
+\li IAX2Processor           - Handles all IAX2 protocol requests, and transfers media frames, run from a shared thread pool.
 \li IAX2IncomingEthernetFrames - Separate thread to transfer all frames from the IAX2Receiver to the 
                                   appropriate IAX2Connection.
 \li OpalIAX2MediaStream     - Transfer media frames between IAX2Connection to Opal.
@@ -37,6 +37,7 @@
 #if OPAL_IAX2
 
 #include <opal/connection.h>
+#include <ptclib/threadpool.h>
 
 #include <iax2/frame.h>
 #include <iax2/iedata.h>
@@ -47,6 +48,7 @@
 class IAX2EndPoint;
 class IAX2Connection;
 class IAX2ThreadHelper;
+class IAX2Processor;
 
 ////////////////////////////////////////////////////////////////////////////////
 /**This class defines what the processor is to do on receiving an ack
@@ -115,6 +117,36 @@ class IAX2WaitingForAck : public PObject
   ResponseToAck response;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/**A unit of work for the thread pool, which runs the processing of all
+   the pending frames, sounds, and commands for one IAX2Processor. */
+class IAX2ProcessorWork : public PObject
+{
+  PCLASSINFO(IAX2ProcessorWork, PObject);
+ public:
+  /**Construct work item for the processor */
+  IAX2ProcessorWork(IAX2Processor & processor)
+    : m_processor(processor) { }
+
+  /**Called by the thread pool to do the work */
+  virtual void Work();
+
+ protected:
+  IAX2Processor & m_processor;
+};
+
+/**Thread pool shared by all processors in an endpoint */
+class IAX2ProcessorThreadPool : public PQueuedThreadPool<IAX2ProcessorWork>
+{
+  typedef PQueuedThreadPool<IAX2ProcessorWork> BaseClass;
+  PCLASSINFO(IAX2ProcessorThreadPool, BaseClass);
+ public:
+  IAX2ProcessorThreadPool(unsigned maxWorkers)
+    : BaseClass(maxWorkers, 0, "IAX2 Processor", PThread::HighPriority)
+  {
+  }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /** This class is an abstract base class for iax2 processors.  This class is
     responsible for handling all the iax2 protocol command messages.
@@ -126,10 +158,12 @@ class IAX2WaitingForAck : public PObject
     frames) are used to determine which processor will handle which incoming
     packet.
  
-    Each processor runs in its own thread so as to process incoming packets in
-    a timely fashion.
+    Processors do not have their own thread. When there is something to do,
+    e.g. a frame arrives or a timer fires, the processor queues itself to the
+    thread pool in the endpoint. All work for one processor is in the same
+    work group, so it is only ever run by one thread at a time, in order.
  */
-class IAX2Processor : public PThread
+class IAX2Processor : public PObject
 {
   PCLASSINFO(IAX2Processor, PObject);
   
@@ -176,10 +210,14 @@ class IAX2Processor : public PThread
   /**Get the call start tick */
   const PTimeInterval & GetCallStartTick() { return callStartTick; }
   
-  /**The worker method of this thread. In here, all incoming frames (for this call)
-     are handled.
+  /**Start processing. Until this is called, frames and commands are queued
+     but not processed. */
+  void Start();
+
+  /**The worker method, called from the thread pool. In here, all incoming
+     frames (for this call) are handled.
   */
-  void Main();
+  void ProcessWork();
   
   /**Test to see if it is a status query type IAX2 frame (eg lagrq) and handle it. If the frame
      is a status query, and it is handled, return true */
@@ -189,13 +227,22 @@ class IAX2Processor : public PThread
      packets which are not sent to any particular call) */
   void SetSpecialPackets(PBoolean newValue) { specialPackets = newValue; }
   
-  /**Cause this thread to die immediately */
+  /**Cause this processor to finish, after processing what is pending */
   void Terminate();
-  
-  /**Cause this thread to come to life, and process events that are
-   * pending at IAX2Connection. This method does not start this
-   * thread. This method causes this thread to be joggled back into
-   * life, after waiting on a PSyncPoint. */
+
+  /**Wait for the processor to finish after Terminate(). Returns false
+     on timeout. If true is returned, the worker thread is no longer using
+     the processor, and it may be deleted. */
+  PBoolean WaitForTermination(
+    const PTimeInterval & maxWait = PMaxTimeInterval
+  );
+
+  /**Return true if the processor has finished after Terminate() */
+  PBoolean IsTerminated() const { return terminated; }
+
+  /**Cause this processor to process events that are pending at
+   * IAX2Connection. This queues the processor to the thread pool in the
+   * endpoint, if it is not already queued. */
   void Activate();
 
   /**Test the sequence number of the incoming frame. This is only
@@ -232,18 +279,39 @@ class IAX2Processor : public PThread
   /** The timer which is used to test for no reply to our outgoing call setup messages */
   PTimer noResponseTimer;
   
-  /**Activate this thread to process all the lists of queued frames */
-  void CleanPendingLists() { activate.Signal(); }
+  /**Activate this processor to process all the lists of queued frames */
+  void CleanPendingLists() { Activate(); }
   
   /**Action to perform on receiving an ACK packet (which is required
      during call setup phase for receiver */
   IAX2WaitingForAck nextTask;
   
-   /**Flag which is used to activate this thread, so all pending tasks/packets are processed */
-  PSyncPoint activate;
-  
-  /**Flag to indicate, end this thread */
-  PBoolean endThread;
+  /**Protects the state of queuing to the thread pool */
+  PMutex activateMutex;
+
+  /**Flag to indicate Start() has been called */
+  bool started;
+
+  /**Flag to indicate the processor is queued in the thread pool */
+  bool workQueued;
+
+  /**Flag to indicate Activate() was called before Start() */
+  bool activatePending;
+
+  /**Flag to indicate the no response timer fired, handled in the pool */
+  atomic<bool> noResponseTimedOut;
+
+  /**Flag to indicate, end this processor */
+  atomic<bool> endThread;
+
+  /**Flag to indicate the processor has finished after endThread set */
+  atomic<bool> terminated;
+
+  /**Signalled when terminated is set */
+  PSyncPoint terminatedSync;
+
+  /**Unique work group in the thread pool for this processor */
+  PString workGroup;
   
   /**Status of encryption for this processor - by default, no encryption */
   IAX2Encryption encryption;
@@ -258,7 +326,8 @@ class IAX2Processor : public PThread
      associated call */
   SafeString callToken;
   
-  /**A threaded pure threaded callback for the sub classes of processor */
+  /**Callback, run from the thread pool, for the sub classes of processor
+     when there has been no response */
   virtual void OnNoResponseTimeout() = 0;
   
   /** A defined value which is the maximum time we will wait for an answer to
@@ -111,6 +111,21 @@ class IAX2Transmit : public PThread
 
   /** Report on the contents of the lists waiting for transmission */
   void ReportLists(PString & answer, bool getFullReport=false);
+
+  /**Enable or disable trunking to the remote peer. When enabled, the
+     audio mini frames for all calls to the peer are aggregated into meta
+     trunk frames, sent once every trunk interval. */
+  void SetTrunkPeer(
+    const PIPSocket::Address & address,  ///< Address of remote peer
+    WORD port,                           ///< UDP port of remote peer
+    bool enable                          ///< Enable or disable trunking
+  );
+
+  /**Set the interval between meta trunk frames. Default 20ms */
+  void SetTrunkInterval(const PTimeInterval & interval);
+
+  /**Get the interval between meta trunk frames. */
+  PTimeInterval GetTrunkInterval() const { return trunkInterval; }
   //@}
   
  protected:
@@ -121,6 +136,41 @@ class IAX2Transmit : public PThread
   
   /**Go through the send list:: send all frames on this list */
   void ProcessSendList();
+
+  /**Add the frame to the meta trunk frame for the remote peer. Return
+     false if the frame cannot be trunked, and must be sent as is. */
+  bool AddToTrunk(IAX2Frame * frame);
+
+  /**Send the meta trunk frames which have waited the trunk interval, or
+     all of them if forced. Returns the time until the next one is due. */
+  PTimeInterval ProcessTrunks(bool force = false);
+
+  /**The meta trunk frame being built for one remote peer */
+  struct TrunkPeer {
+    TrunkPeer(const PIPSocket::Address & addr, WORD port);
+
+    PIPSocket::Address address;   ///< Address of remote peer
+    WORD               port;      ///< UDP port of remote peer
+    PTimeInterval      startTick; ///< Origin of the trunk timestamps
+    PTimeInterval      firstTick; ///< Time the first entry was added
+    PBYTEArray         data;      ///< The trunk frame being built
+    PINDEX             size;      ///< Bytes used in data, 0 if empty
+  };
+  typedef std::pair<PIPSocket::Address, WORD> TrunkPeerKey;
+  typedef std::map<TrunkPeerKey, TrunkPeer> TrunkPeerMap;
+
+  /**Trunk frames being built, indexed by address and port */
+  TrunkPeerMap trunkPeers;
+
+  /**Set when trunkPeers is not empty, so the lock can be avoided when
+     no trunking is done */
+  atomic<bool> trunking;
+
+  /**Protects trunkPeers */
+  PMutex trunkMutex;
+
+  /**Interval between meta trunk frames to a peer */
+  PTimeInterval trunkInterval;
   
   /**Global variable specifying application specific variables */
   IAX2EndPoint &ep;
@@ -508,7 +508,8 @@ typedef enum OpalSilenceDetectMode {
   OpalSilenceDetectNoChange,  /**< No change to the silence detect mode. */
   OpalSilenceDetectDisabled,  /**< Indicate silence detect is disabled */
   OpalSilenceDetectFixed,     /**< Indicate silence detect uses a fixed threshold */
-  OpalSilenceDetectAdaptive   /**< Indicate silence detect uses an adaptive threashold */
+  OpalSilenceDetectAdaptive,  /**< Indicate silence detect uses an adaptive threashold */
+  OpalSilenceDetectSpectral   /**< Indicate silence detect uses spectral speech detection */
 } OpalSilenceDetectMode;
 
 
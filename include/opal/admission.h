@@ -0,0 +1,190 @@
+/*
+ * admission.h
+ *
+ * Call admission control and overload protection
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_OPAL_ADMISSION_H
+#define OPAL_OPAL_ADMISSION_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#include <ptlib/safecoll.h>
+
+
+class OpalManager;
+
+
+/**Decide if new incoming calls may be accepted, according to the load on
+   the system.
+
+   The media and signalling code reports what it sees as it goes: the CPU
+   used by media patch threads and whether they were throttled, how late
+   media packets are read from the jitter buffers, and how many packets
+   arrived too late to be played. About once a second OpalManager garbage
+   collection calls Update(), and at the end of each sample interval these
+   reports, and the signalling work queued on the endpoints, are checked
+   against the limits to decide if the system is overloaded.
+
+   CanAcceptCall() then only has to look at the result of the last sample,
+   and at a token bucket limiting the rate of new calls, so it is cheap
+   enough to be called for every incoming call attempt. Endpoints reject the
+   call in the manner appropriate to the protocol, e.g. SIP 503 Service
+   Unavailable with Retry-After, H.323 Release Complete or ARJ, or IAX2
+   Reject.
+
+   An application may derive from this class, override CheckOverload() or
+   CanAcceptCall(), and use OpalManager::SetAdmissionController().
+  */
+class OpalAdmissionController : public PSafeObject
+{
+    PCLASSINFO(OpalAdmissionController, PSafeObject);
+  public:
+    /**Limits for admission. A zero value disables the check, and all of
+       the checks are disabled by default.
+      */
+    struct Params
+    {
+      Params();
+
+      unsigned      m_callsPerSecond;     ///< Rate at which new calls are admitted
+      unsigned      m_callBurst;          ///< Calls admitted in a burst above the rate, zero is same as one
+      unsigned      m_maxMediaCPU;        ///< Percentage of a CPU used by busiest media thread
+      unsigned      m_maxMediaThrottles;  ///< Media threads throttled for excess CPU in a sample
+      PTimeInterval m_maxMediaLag;        ///< Time media may be read late from a jitter buffer
+      unsigned      m_maxJitterUnderruns; ///< Packets too late for jitter buffers in a sample
+      unsigned      m_maxQueueDepth;      ///< Signalling work items pending on all endpoints
+      PTimeInterval m_sampleInterval;     ///< Time over which reports are collected
+      PTimeInterval m_retryAfter;         ///< Suggested time before a rejected call retries
+    };
+
+    /**What was reported over a sample interval.
+      */
+    struct Sample
+    {
+      Sample();
+
+      unsigned      m_mediaCPU;
+      unsigned      m_mediaThrottles;
+      PTimeInterval m_mediaLag;
+      unsigned      m_jitterUnderruns;
+      unsigned      m_queueDepth;
+    };
+
+    struct Statistics
+    {
+      Statistics();
+
+      PUInt64 m_accepted;           ///< Calls admitted
+      PUInt64 m_rejectedOverload;   ///< Calls rejected as system was overloaded
+      PUInt64 m_rejectedRate;       ///< Calls rejected by the rate limit
+      Sample  m_lastSample;         ///< Reports from last complete sample interval
+      bool    m_overloaded;         ///< Last sample indicated overload
+    };
+
+    OpalAdmissionController(
+      OpalManager & manager,
+      const Params & params = Params()
+    );
+
+    /**Set the limits for admission.
+      */
+    void SetParams(
+      const Params & params
+    );
+
+    /**Get the limits for admission.
+      */
+    Params GetParams();
+
+    /**Determine if a new incoming call may be accepted.
+       If it is, it is counted against the rate limit.
+      */
+    virtual bool CanAcceptCall();
+
+    /**Get the time a rejected caller should wait before retrying.
+      */
+    PTimeInterval GetRetryAfter();
+
+    /**Get the statistics for admission.
+      */
+    Statistics GetStatistics();
+
+    /**Report the percentage of a CPU used by a media patch thread, and if
+       it had to be throttled.
+      */
+    void OnMediaCPU(
+      unsigned percentage,
+      bool throttled
+    );
+
+    /**Report the time media was read late from a jitter buffer, beyond the
+       jitter delay itself.
+      */
+    void OnMediaLag(
+      const PTimeInterval & lag
+    );
+
+    /**Report packets that arrived too late for a jitter buffer.
+      */
+    void OnJitterUnderruns(
+      unsigned count
+    );
+
+    /**Collect the reports and queue depths, if the sample interval has
+       elapsed, and determine if the system is overloaded.
+       This is called by OpalManager::GarbageCollection().
+      */
+    virtual void Update();
+
+  protected:
+    /**Determine if the system is overloaded from a sample.
+       Called with the internal mutex held, so must not call back into the
+       controller or take any other lock.
+      */
+    virtual bool CheckOverload(
+      const Sample & sample
+    );
+
+    OpalManager & m_manager;
+    Params        m_params;
+    Sample        m_current;
+    Statistics    m_statistics;
+    PSimpleTimer  m_sampleTimer;
+    double        m_tokens;
+    PInt64        m_lastRefill;
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
+typedef PSafePtr<OpalAdmissionController, PSafePtrMultiThreaded> OpalAdmissionControllerPtr;
+
+
+#endif // OPAL_OPAL_ADMISSION_H
+
+
+/////////////////////////////////////////////////////////////////////////////
@@ -570,6 +570,11 @@ class OpalCall : public PSafeObject
       */
     bool IsRecording() const;
 
+    /**Indicate if recording takes media still encoded, e.g. to a packet
+       spool file. See OpalRecordManager::IsEncodedRecording().
+      */
+    bool IsRecordingEncoded() const;
+
     /** Stop a recording.
         Returns true if the call does exists, an active call is not indicated.
       */
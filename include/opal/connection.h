@@ -41,6 +41,7 @@
 #include <opal/mediastrm.h>
 #include <opal/guid.h>
 #include <opal/transports.h>
+#include <codec/tonedetect.h>
 #include <ptclib/dtmf.h>
 #include <ptlib/safecoll.h>
 #include <rtp/rtp.h>
@@ -1984,7 +1985,15 @@ class OpalConnection : public PSafeObject
     // The In-Band DTMF detector. This is used inside an audio filter which is
     // added to the audio channel.
 #if OPAL_PTLIB_DTMF
-    PDTMFDecoder m_dtmfDecoder;
+    class InBandDTMFDetector : public OpalToneDetector::Channel
+    {
+      public:
+        InBandDTMFDetector(OpalConnection & connection) : m_connection(connection) { }
+        virtual void OnTone(char tone, unsigned duration);
+      protected:
+        OpalConnection & m_connection;
+    };
+    InBandDTMFDetector m_dtmfDetector;
     bool         m_detectInBandDTMF;
     unsigned     m_dtmfScaleMultiplier;
     unsigned     m_dtmfScaleDivisor;
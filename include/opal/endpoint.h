@@ -828,6 +828,12 @@ class OpalEndPoint : public PObject
         Default behaviour deletes the objects in the connectionsActive list.
       */
     virtual PBoolean GarbageCollection();
+
+    /**Get the number of signalling work items queued, or being handled, by
+       the endpoint. This is used by OpalAdmissionController to detect
+       overload. Default behaviour returns zero.
+      */
+    virtual unsigned GetPendingWorkCount() const { return 0; }
   //@}
 
   /**@name Member variable access */
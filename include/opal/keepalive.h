@@ -0,0 +1,172 @@
+/*
+ * keepalive.h
+ *
+ * Shared NAT keep alive scheduler
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_OPAL_KEEPALIVE_H
+#define OPAL_OPAL_KEEPALIVE_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#include <set>
+
+
+/**Send all the keep alives for NAT pin-holes from one thread.
+   Rather than a PTimer for every transport and media socket, each of which
+   must be reset whenever anything is sent, the keep alives are placed in
+   buckets according to when they are due. A single thread wakes up once per
+   bucket, and sends every keep alive in it.
+
+   When a client indicates it has sent other traffic, via ResetKeepAlive(),
+   nothing is sent when it becomes due, it is just moved to a later bucket.
+
+   The time for each keep alive is pulled forward by a random amount, up to
+   a percentage of the interval, so that keep alives started at the same
+   time, e.g. after a restart, are spread out rather than sent in a burst.
+  */
+class OpalKeepAliveScheduler : public PObject
+{
+    PCLASSINFO(OpalKeepAliveScheduler, PObject);
+  public:
+    P_DECLARE_TRACED_ENUM(Types,
+      e_TransportKeepAlive, ///< Signalling transport, e.g. SIP CRLF or OPTIONS, H.225 empty TPKT
+      e_RTPKeepAlive,       ///< Media pin-hole, e.g. H.460.19 RTP
+      e_RTCPKeepAlive,      ///< Media control pin-hole, e.g. H.460.19 RTCP
+      e_GatekeeperKeepAlive ///< Gatekeeper lightweight RRQ and unsolicited IRR
+    );
+
+    /**Something that sends keep alives.
+       The client must be removed from the scheduler before it is destroyed.
+      */
+    class Client
+    {
+      public:
+        Client(Types type);
+        virtual ~Client();
+
+        /**Send the keep alive.
+           Return false if the send failed.
+          */
+        virtual bool OnKeepAlive() = 0;
+
+        /**Indicate other traffic was sent, so keep alive need not be sent
+           until the interval has elapsed from now.
+          */
+        void ResetKeepAlive();
+
+        /// Get the type of keep alive
+        Types GetKeepAliveType() const { return m_type; }
+
+        /// Indicate the client has been added to a scheduler
+        bool IsKeepAliveActive() const { return m_interval > 0; }
+
+      protected:
+        const Types        m_type;
+        PTimeInterval      m_interval;
+        atomic<uint32_t>   m_lastActivity;
+        uint32_t           m_scheduledActivity;
+        PInt64             m_bucket;
+
+      friend class OpalKeepAliveScheduler;
+    };
+
+    OpalKeepAliveScheduler(
+      const PTimeInterval & granularity = PTimeInterval(0, 1),  ///< Time covered by each bucket
+      unsigned jitterPercent = 10                               ///< Maximum random reduction of interval
+    );
+
+    ~OpalKeepAliveScheduler();
+
+    /**Add the client, or change its interval if already added.
+       The first keep alive is sent after the interval, less jitter. A zero
+       interval removes the client, without waiting, see Remove().
+      */
+    void Add(
+      Client & client,
+      const PTimeInterval & interval
+    );
+
+    /**Remove the client.
+       If the client is in the middle of sending, and \p wait is true, this
+       waits for it to finish, unless called from OnKeepAlive() itself. If
+       \p wait is false, the client is not sent again, but OnKeepAlive()
+       may still be executing on return, so the client must not be
+       destroyed. This is for when the caller may hold a lock needed by
+       OnKeepAlive().
+      */
+    void Remove(
+      Client & client,
+      bool wait = true
+    );
+
+    /**Stop the thread. Clients are not removed.
+      */
+    void ShutDown();
+
+    struct Statistics
+    {
+      Statistics();
+
+      unsigned m_clients;   ///< Number of clients of this type
+      PUInt64  m_sent;      ///< Number of keep alives sent
+      PUInt64  m_skipped;   ///< Number of keep alives not needed due to other traffic
+      PUInt64  m_failed;    ///< Number of keep alives that failed to send
+    };
+
+    /**Get the statistics for the type of keep alive.
+      */
+    Statistics GetStatistics(
+      Types type
+    );
+
+  protected:
+    void Schedule(Client & client, PInt64 lastActivity);
+    void Unschedule(Client & client);
+    void ThreadMain();
+
+    PInt64            m_granularity;
+    unsigned          m_jitterPercent;
+
+    typedef std::map<PInt64, std::set<Client *> > BucketMap;
+    BucketMap         m_buckets;
+    Statistics        m_statistics[NumTypes];
+    Client          * m_currentClient;
+    PSyncPoint        m_currentFinished;
+    unsigned          m_removeWaiters;
+    PDECLARE_MUTEX(m_mutex);
+
+    PThread         * m_thread;
+    PSyncPoint        m_wakeUp;
+    bool              m_running;
+};
+
+
+#endif // OPAL_OPAL_KEEPALIVE_H
+
+
+/////////////////////////////////////////////////////////////////////////////
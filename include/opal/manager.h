@@ -38,8 +38,12 @@
 #include <opal/call.h>
 #include <opal/connection.h> //OpalConnection::AnswerCallResponse
 #include <opal/guid.h>
+#include <opal/transcoders.h>
+#include <opal/keepalive.h>
+#include <opal/admission.h>
 #include <codec/silencedetect.h>
 #include <codec/echocancel.h>
+#include <codec/tonedetect.h>
 #include <im/im.h>
 
 #include <ptclib/pstun.h>
@@ -1914,6 +1918,33 @@ class OpalManager : public PObject
       PBoolean mode ///<  New default mode
     ) { m_disableDetectInBandDTMF = mode; } 
 
+#if OPAL_PTLIB_DTMF
+    /**Get the in-band DTMF and fax tone detector shared by all connections.
+       This is created on first use.
+      */
+    OpalToneDetector & GetToneDetector();
+
+    /**Set the number of worker threads for the shared tone detector.
+       This must be called before any call is made, as it has no effect once
+       the detector has been created. Zero means tones are detected in the
+       media patch thread of each connection. Default is the number of
+       processors, see OpalToneDetector::GetDefaultThreadCount().
+      */
+    void SetToneDetectorThreads(
+      unsigned threads  ///< Number of threads
+    ) { m_toneDetectorThreads = threads; }
+
+    /**Get the number of worker threads for the shared tone detector.
+      */
+    unsigned GetToneDetectorThreads() const { return m_toneDetectorThreads; }
+#endif
+
+    /**Get the pool of reusable transcoder instances used by media patches.
+       The pool sizes may be adjusted via OpalTranscoderPool::SetSizes(),
+       setting a maximum per key of zero disables reuse.
+      */
+    OpalTranscoderPool & GetTranscoderPool() { return m_transcoderPool; }
+
     /**Get the amount of time with no media that will cause a call to clear
      */
     const PTimeInterval & GetNoMediaTimeout() const { return m_noMediaTimeout; }
@@ -1964,6 +1995,23 @@ class OpalManager : public PObject
       const PTimeInterval & newInterval  ///<  New timeout
     ) { m_natKeepAliveTime = newInterval; }
 
+    /**Get the scheduler for all NAT pin-hole keep alives.
+    */
+    OpalKeepAliveScheduler & GetKeepAliveScheduler() { return m_keepAliveScheduler; }
+
+    /**Set the admission controller deciding if new incoming calls may be
+       accepted. The manager takes ownership of the object. The previous
+       controller is deleted once nothing is using it any more.
+    */
+    void SetAdmissionController(
+      OpalAdmissionController * controller
+    );
+
+    /**Get the admission controller deciding if new incoming calls may be
+       accepted.
+    */
+    OpalAdmissionControllerPtr GetAdmissionController() const { return m_admissionController; }
+
 #if OPAL_ICE
     /**Get the amount of time to wait for ICE/STUN packets.
     */
@@ -2090,11 +2138,19 @@ class OpalManager : public PObject
     PStringArray  m_mediaFormatOrder;
     PStringArray  m_mediaFormatMask;
     bool          m_disableDetectInBandDTMF;
+#if OPAL_PTLIB_DTMF
+    unsigned           m_toneDetectorThreads;
+    OpalToneDetector * m_toneDetector;
+    PDECLARE_MUTEX(m_toneDetectorMutex);
+#endif
+    OpalTranscoderPool m_transcoderPool;
     PTimeInterval m_noMediaTimeout;
     PTimeInterval m_txMediaTimeout;
     PTimeInterval m_signalingTimeout;
     PTimeInterval m_transportIdleTime;
     PTimeInterval m_natKeepAliveTime;
+    OpalKeepAliveScheduler m_keepAliveScheduler;
+    OpalAdmissionControllerPtr m_admissionController;
 #if OPAL_ICE
     PTimeInterval m_iceTimeout;
 #endif
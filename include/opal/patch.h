@@ -42,6 +42,77 @@
 
 class OpalTranscoder;
 
+
+#if OPAL_STATISTICS
+/**Statistics accumulated by a media patch sink, per sync source.
+   The counters are updated by the patch thread, and occasionally a command
+   thread, without taking any lock, so GetStatistics() never blocks the
+   media. There is a fixed number of slots, the first being the aggregate
+   for all sync sources, any SSRC beyond that is only counted in the
+   aggregate.
+  */
+class OpalMediaPatchStatistics
+{
+  public:
+    OpalMediaPatchStatistics();
+
+    enum { MaxSyncSources = 8 };
+
+    /// Count an audio frame of the type indicated
+    void IncrementAudio(
+      RTP_SyncSourceId ssrc,
+      OpalAudioFormat::FrameType type
+    );
+
+#if OPAL_VIDEO
+    /// Count a video frame, as per OpalVideoStatistics::IncrementFrames()
+    void IncrementFrames(
+      RTP_SyncSourceId ssrc,
+      bool key
+    );
+
+    /// Count an update request, as per OpalVideoStatistics::IncrementUpdateCount()
+    void IncrementUpdateCount(
+      RTP_SyncSourceId ssrc,
+      bool full
+    );
+#endif
+
+    /// Get snapshot of counters for statistics.m_SSRC
+    void GetStatistics(
+      OpalMediaStatistics & statistics
+    ) const;
+
+  protected:
+    struct Counters
+    {
+      Counters();
+
+      atomic<RTP_SyncSourceId> m_ssrc;
+      atomic<bool>             m_hasAudio;
+      atomic<unsigned>         m_silent;
+      atomic<unsigned>         m_FEC;
+#if OPAL_VIDEO
+      atomic<bool>             m_hasVideo;
+      atomic<unsigned>         m_totalFrames;
+      atomic<unsigned>         m_keyFrames;
+      atomic<unsigned>         m_fullUpdateRequests;
+      atomic<unsigned>         m_pictureLossRequests;
+      atomic<int64_t>          m_lastKeyFrameTime;      // Microseconds since epoch, zero is never
+      atomic<int64_t>          m_lastUpdateRequestTime; // Microseconds since epoch, zero is never
+      atomic<int64_t>          m_updateResponseTime;    // Milliseconds
+#endif
+    };
+
+    const Counters * Find(RTP_SyncSourceId ssrc) const;
+    Counters * Get(RTP_SyncSourceId ssrc);
+
+    Counters m_counters[MaxSyncSources];
+    PDECLARE_MUTEX(m_claimMutex);
+};
+#endif // OPAL_STATISTICS
+
+
 /**Media stream "patch cord".
    This class is the thread of control that transfers data from one
    "source" OpalMediStream to one or more other "sink" OpalMediStream
@@ -259,6 +330,7 @@ class OpalMediaPatch : public PSafeObject
         bool UpdateMediaFormat(const OpalMediaFormat & mediaFormat);
         bool ExecuteCommand(const OpalMediaCommand & command, bool atLeastOne);
         bool WriteFrame(RTP_DataFrame & sourceFrame, bool bypassing);
+        bool WriteSecondary(RTP_DataFrame & sourceFrame, RTP_DataFrame & interFrame);
 #if OPAL_STATISTICS
         void GetStatistics(OpalMediaStatistics & statistics, bool fromSource) const;
 #endif
@@ -266,27 +338,20 @@ class OpalMediaPatch : public PSafeObject
         OpalMediaPatch  &  m_patch;
         OpalMediaStreamPtr m_stream;
         OpalTranscoder   * m_primaryCodec;
+        OpalTranscoder   * m_resampler;       // Between primary and secondary, if at different rates
         OpalTranscoder   * m_secondaryCodec;
         RTP_DataFrameList  m_intermediateFrames;
+        RTP_DataFrameList  m_resampledFrames;
         RTP_DataFrameList  m_finalFrames;
 
 #if OPAL_STATISTICS
         OpalAudioFormat m_audioFormat;
         OpalAudioFormat::FrameDetectorPtr m_audioFrameDetector;
-        struct AudioStats {
-          unsigned m_silent;
-          unsigned m_FEC;
-          AudioStats() : m_silent(0), m_FEC(0) { }
-        };
-        typedef map<RTP_SyncSourceId, AudioStats> AudioStatsMap;
-        AudioStatsMap m_audioStatistics;
 #if OPAL_VIDEO
         OpalVideoFormat m_videoFormat;
         OpalVideoFormat::FrameDetectorPtr m_videoFrameDetector;
-        typedef map<RTP_SyncSourceId, OpalVideoStatistics> VideoStatsMap;
-        VideoStatsMap m_videoStatistics;
 #endif // OPAL_VIDEO
-        PDECLARE_MUTEX(m_statsMutex);
+        OpalMediaPatchStatistics m_statistics;
 #endif // OPAL_STATISTICS
     };
     PList<Sink> m_sinks;
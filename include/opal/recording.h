@@ -38,9 +38,19 @@
 
 
 class OpalMediaFormat;
+class OpalTranscoder;
 class RTP_DataFrame;
 
 
+/**File type for packet spool recording.
+   Recording to a file of this type does no decoding, mixing or encoding
+   during the call. The still encoded RTP packets of each stream are simply
+   appended to the file with their arrival time. The OpalRecordSpoolRenderer
+   class is used later, offline, to produce a WAV/MP4 etc file from it.
+  */
+#define OPAL_RECORD_SPOOL_FILE_TYPE ".opalspool"
+
+
 /** This is an abstract class for recording OPAL calls.
     A factory is used to created concrete classes based on the file extension
     supported by the individual record manager.
@@ -194,6 +204,15 @@ class OpalRecordManager : public PObject
     ) = 0;
 #endif
 
+    /**Indicate the recording takes media in its encoded form.
+       If true, WriteAudio() and WriteVideo() are given the RTP packets as
+       they are at the source of the media patch, before any transcoding,
+       rather than PCM-16 or YUV420P.
+
+       Default behaviour returns false.
+      */
+    virtual bool IsEncodedRecording() const { return false; }
+
     /**Get the options for this recording.
       */
     const Options & GetOptions() const { return m_options; }
@@ -211,6 +230,171 @@ class OpalRecordManager : public PObject
     Options m_options;
 };
 
+
+
+/**Packet spool file for deferred call recording.
+   The file is a 16 byte header, followed by a sequence of records. Each
+   record has a fixed 16 byte header and is padded to a multiple of 8 bytes,
+   so the file can be memory mapped and walked directly. All multi-byte
+   values are little endian. The file is only ever appended to, and writes
+   are buffered so that recording a packet is usually just a memory copy.
+  */
+class OpalRecordSpoolFile : public PFile
+{
+    PCLASSINFO(OpalRecordSpoolFile, PFile);
+  public:
+    enum RecordTypes {
+      e_StreamOpen = 1, ///< Data is media format name and stream identifier, each NUL terminated
+      e_Packet,         ///< Data is complete RTP packet
+      e_StreamClose     ///< No data
+    };
+
+    struct Record
+    {
+      Record() : m_type(e_Packet), m_stream(0), m_time(0) { }
+
+      RecordTypes m_type;
+      unsigned    m_stream;
+      PTime       m_time;
+      PBYTEArray  m_data;
+    };
+
+    /**Create a spool file.
+      */
+    OpalRecordSpoolFile(
+      PINDEX bufferSize = 65536 ///< Size of write buffer
+    );
+    ~OpalRecordSpoolFile();
+
+    /**Close the file, flushing any buffered records.
+      */
+    virtual PBoolean Close();
+
+    /**Append a stream open record.
+      */
+    bool WriteStreamOpen(
+      unsigned stream,                ///< Index for stream
+      const OpalMediaFormat & format, ///< Encoded format of stream
+      const PString & id,             ///< Identifier for stream
+      const PTime & when = PTime()    ///< Time of event
+    );
+
+    /**Append a packet record.
+       If \p when is invalid, the packets received time meta data is used,
+       and if that is invalid, the current time.
+      */
+    bool WritePacket(
+      unsigned stream,                ///< Index for stream
+      const RTP_DataFrame & rtp,      ///< Packet to save
+      const PTime & when = PTime(0)   ///< Time of arrival
+    );
+
+    /**Append a stream close record.
+      */
+    bool WriteStreamClose(
+      unsigned stream,                ///< Index for stream
+      const PTime & when = PTime()    ///< Time of event
+    );
+
+    /**Flush buffered records to disk.
+      */
+    bool FlushRecords();
+
+    /**Read the next record from the file.
+       @return false if end of file or error.
+      */
+    bool ReadRecord(
+      Record & record
+    );
+
+  protected:
+    virtual bool InternalOpen(OpenMode mode, OpenOptions opt, PFileInfo::Permissions permissions);
+    bool InternalWriteRecord(RecordTypes type, unsigned stream, const PTime & when, const void * data, PINDEX length);
+
+    struct FileHeader
+    {
+      char     m_magic[8];
+      PUInt32l m_version;
+      PUInt32l m_reserved;
+    };
+
+    struct RecordHeader
+    {
+      PUInt16l m_type;
+      PUInt16l m_stream;
+      PUInt32l m_length;    // Data length, not including header or padding
+      PUInt64l m_time;      // Microseconds since 1970
+    };
+
+    PBYTEArray m_buffer;
+    PINDEX     m_bufferUsed;
+    PDECLARE_MUTEX(m_bufferMutex);
+};
+
+
+/**Render a packet spool file, produced by recording to a file of type
+   OPAL_RECORD_SPOOL_FILE_TYPE, into a final media file. The packets are
+   decoded, aligned by arrival time and mixed using the OpalRecordManager
+   for the output file type, as fast as the CPU allows rather than in
+   real time.
+  */
+class OpalRecordSpoolRenderer : public PObject
+{
+    PCLASSINFO(OpalRecordSpoolRenderer, PObject);
+  public:
+    OpalRecordSpoolRenderer();
+    ~OpalRecordSpoolRenderer();
+
+    /**Render the spool file to the output file.
+       Note the m_pushThreads option is ignored.
+      */
+    bool Render(
+      const PFilePath & spoolFile,  ///< Spool file to read
+      const PFilePath & outputFile, ///< Output file, type determines format
+      const OpalRecordManager::Options & options = OpalRecordManager::Options() ///< Mixing options
+    );
+
+    /**Set the delay between packet arrival and mixing.
+       This acts like a jitter buffer, allowing for late packets in other
+       streams. Default 100ms.
+      */
+    void SetAlignmentDelay(
+      const PTimeInterval & delay
+    ) { m_alignmentDelay = delay; }
+
+    /// Get the number of packets read in last Render()
+    unsigned GetPacketCount() const { return m_packetCount; }
+
+    /// Get the number of packets that could not be decoded in last Render()
+    unsigned GetDecodeErrors() const { return m_decodeErrors; }
+
+  protected:
+    struct Stream
+    {
+      Stream() : m_decoder(NULL), m_isAudio(true) { }
+
+      PString          m_id;
+      OpalTranscoder * m_decoder;
+      bool             m_isAudio;
+    };
+    typedef std::map<unsigned, Stream> StreamMap;
+
+    bool OpenStream(OpalRecordManager & output, Stream & stream, const PBYTEArray & data);
+    void CloseStream(OpalRecordManager & output, Stream & stream);
+    bool WritePacket(OpalRecordManager & output, Stream & stream, RTP_DataFrame & rtp);
+    void PushUntil(OpalRecordManager & output, const PTime & when);
+
+    PTimeInterval m_alignmentDelay;
+    StreamMap     m_streams;
+    PTime         m_nextAudioPush;
+#if OPAL_VIDEO
+    PTime         m_nextVideoPush;
+#endif
+    unsigned      m_packetCount;
+    unsigned      m_decodeErrors;
+};
+
+
 #endif // OPAL_HAS_MIXER
 
 #endif // OPAL_OPAL_AUDIORECORD_H
@@ -177,6 +177,17 @@ class OpalTranscoder : public OpalMediaFormatPair
       const OpalMediaCommand & command    ///<  Command to execute.
     );
 
+    /**Reset the transcoder so it may be reused for another media stream.
+       All conversion state from previous media is discarded, but the
+       options set via UpdateMediaFormats() are retained.
+
+       The default behaviour resets the state held by this class and returns
+       false, as a descendant may have state that cannot be reset.
+
+       @returns true if the transcoder may be reused.
+      */
+    virtual bool Reset();
+
     /**Get the optimal size for data frames to be converted.
        This function returns the size of frames that will be most efficient
        in conversion. A RTP_DataFrame will attempt to provide or use data in
@@ -213,6 +224,48 @@ class OpalTranscoder : public OpalMediaFormatPair
       RTP_DataFrame & output        ///<  Output data
     ) = 0;
 
+    /// Entry for ConvertBatch()
+    struct BatchEntry
+    {
+      BatchEntry(
+        OpalTranscoder * transcoder = NULL,
+        const RTP_DataFrame * input = NULL,
+        RTP_DataFrame * output = NULL
+      ) : m_transcoder(transcoder)
+        , m_input(input)
+        , m_output(output)
+        , m_result(false)
+      { }
+
+      OpalTranscoder      * m_transcoder;
+      const RTP_DataFrame * m_input;
+      RTP_DataFrame       * m_output;
+      bool                  m_result;   ///< Result of conversion
+    };
+    typedef std::vector<BatchEntry> BatchEntries;
+
+    /**Convert the data for a number of independent transcoders.
+       Each entry is equivalent to calling Convert() on its transcoder, with
+       the return value placed in m_result. Entries whose transcoders have the
+       same non-NULL GetBatchKey() are passed together to ConvertBatchGroup(),
+       allowing, for example, a plug in to encode audio for all participants
+       of a conference in a single call.
+
+       As for ConvertFrames(), the update mutex of each transcoder is held
+       while converting, in this case for the whole batch.
+      */
+    static void ConvertBatch(
+      BatchEntries & entries    ///< Entries to convert
+    );
+
+    /**Get the key used to group transcoders in ConvertBatch().
+       Transcoders returning the same non-NULL key must be able to have all
+       their entries converted by the ConvertBatchGroup() of any one of them.
+
+       The default behaviour returns NULL, indicating no batching.
+      */
+    virtual const void * GetBatchKey() const;
+
     /**Create an instance of a media conversion function.
        Returns NULL if there is no registered media transcoder between the two
        named formats.
@@ -265,6 +318,24 @@ class OpalTranscoder : public OpalMediaFormatPair
       OpalMediaFormat & intermediateFormat  ///<  Intermediate format that can be used
     );
 
+    /**Find media intermediate formats for three transcoders.
+       This function attempts to find two intermediate media formats that
+       will allow three transcoders to be used to get data from the source
+       format to the destination format. Typically, the middle transcoder is
+       an OpalPCM16Resampler, e.g. Opus-48 to OpalPCM16_48KHZ to OpalPCM16 to
+       G.711.
+
+       This should only be used if FindIntermediateFormat() fails.
+
+       Returns false if there is no such set of registered media transcoders.
+      */
+    static bool FindIntermediateFormats(
+      const OpalMediaFormat & srcFormat,    ///<  Selected source format to be used
+      const OpalMediaFormat & dstFormat,    ///<  Selected destination format to be used
+      OpalMediaFormat & decodedFormat,      ///<  Output format of first transcoder
+      OpalMediaFormat & resampledFormat     ///<  Input format of last transcoder
+    );
+
     /**Get a list of possible destination media formats for the destination.
       */
     static OpalMediaFormatList GetDestinationFormats(
@@ -290,6 +361,13 @@ class OpalTranscoder : public OpalMediaFormatPair
       */
     PINDEX GetMaxOutputSize() const { return maxOutputSize; }
 
+    /**Get the number of output frame buffers allocated by ConvertFrames().
+       Output frames are re-used from call to call, so in the steady state
+       this should not increase, and may be used to check for allocations
+       per second on the media path.
+      */
+    unsigned GetOutputFrameAllocations() const { return m_outputFrameAllocations; }
+
     /**Set the maximum output size.
       */
     void SetMaxOutputSize(
@@ -344,6 +422,35 @@ class OpalTranscoder : public OpalMediaFormatPair
   //@}
 
   protected:
+    /**Convert a group of entries from ConvertBatch(), whose transcoders all
+       have the same batch key as this one. The update mutex of all the
+       transcoders is already locked.
+
+       The default behaviour calls Convert() for each entry.
+      */
+    virtual void ConvertBatchGroup(
+      BatchEntry * const * entries,   ///< Entries to convert
+      PINDEX count                    ///< Number of entries
+    );
+
+    /**Get an output frame for ConvertFrames(), re-using the frames left in
+       the list from the previous call. The transcoder owns the output
+       frames, but a frame buffer may still be referenced elsewhere, e.g.
+       queued for transmission, in which case a new buffer is allocated
+       rather than overwriting it. The returned frame has an empty payload.
+      */
+    RTP_DataFrame & GetOutputFrame(
+      RTP_DataFrameList & output,   ///< List of output frames
+      PINDEX index,                 ///< Index of frame, at most output.GetSize()
+      PINDEX size                   ///< Minimum buffer size
+    );
+
+    /// Remove any frames beyond those used via GetOutputFrame()
+    static void TrimOutputFrames(
+      RTP_DataFrameList & output,   ///< List of output frames
+      PINDEX count                  ///< Number of frames used
+    );
+
     PINDEX    maxOutputSize;
     PNotifier commandNotifier;
     PDECLARE_MUTEX(updateMutex);
@@ -357,6 +464,9 @@ class OpalTranscoder : public OpalMediaFormatPair
 
     RTP_DataFrame::PayloadTypes m_lastPayloadType;
     unsigned                    m_consecutivePayloadTypeMismatches;
+    unsigned                    m_outputFrameAllocations;
+
+  friend class OpalTranscoderPool;
 };
 
 
@@ -401,6 +511,11 @@ class OpalFramedTranscoder : public OpalTranscoder
       const OpalMediaFormat & outputMediaFormat  ///<  Output media format
     );
 
+    /**Reset the transcoder so it may be reused for another media stream.
+       This resets the empty payload handling state.
+      */
+    virtual bool Reset();
+
     /**Get the optimal size for data frames to be converted.
        This function returns the size of frames that will be most efficient
        in conversion. A RTP_DataFrame will attempt to provide or use data in
@@ -441,11 +556,48 @@ class OpalFramedTranscoder : public OpalTranscoder
   //@}
 
   protected:
+    /// Frame for ConvertFrameBatch()
+    struct BatchFrame
+    {
+      OpalFramedTranscoder * m_transcoder;
+      const BYTE           * m_input;
+      PINDEX                 m_consumed;  ///< Input length, updated to bytes consumed
+      BYTE                 * m_output;
+      PINDEX                 m_created;   ///< Output space, updated to bytes created
+      bool                   m_result;
+    };
+
+    /**Convert a group of entries from ConvertBatch().
+       Packets containing a whole number of raw audio frames are split into
+       frames, and all the frames for all entries are passed to one call of
+       ConvertFrameBatch(). If the codec does not consume all of a frame that
+       is not the last in its packet, the entry fails, as the remainder
+       cannot be carried into the next frame.
+      */
+    virtual void ConvertBatchGroup(
+      BatchEntry * const * entries,   ///< Entries to convert
+      PINDEX count                    ///< Number of entries
+    );
+
+    /**Convert a number of frames, whose transcoders all have the same batch
+       key as this one. Frames for the same transcoder are in stream order.
+
+       The default behaviour calls ConvertFrame() for each frame.
+      */
+    virtual void ConvertFrameBatch(
+      BatchFrame * frames,    ///< Frames to convert
+      PINDEX count            ///< Number of frames
+    );
+
+    PINDEX GetBatchFrameCount(const RTP_DataFrame & input) const;
+    bool ConvertFrameLoop(const BYTE * inputPtr, PINDEX inputLength, BYTE * outputPtr, PINDEX & outLen);
+    void CompleteConvert(RTP_DataFrame & output, PINDEX outLen);
     void CalculateSizes();
 
     PINDEX inputBytesPerFrame;
     PINDEX outputBytesPerFrame;
     PINDEX maxOutputDataSize;
+    bool   m_rawInput;
     enum
     {
       AwaitingFirstNonEmptyPayload,
@@ -517,6 +669,144 @@ class OpalStreamedTranscoder : public OpalTranscoder
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+/**This class maintains a pool of idle transcoder instances.
+   Creating a transcoder, especially a plug in video codec, can involve a
+   significant amount of allocation and initialisation. Under high call
+   churn, instances are returned to the pool when a media stream closes and
+   handed out again for the next stream with the same media formats.
+
+   Idle instances are keyed by the source and destination format names and
+   a hash of their options. A transcoder is only kept if its Reset()
+   function succeeds, otherwise it is deleted as usual.
+ */
+class OpalTranscoderPool : public PObject
+{
+    PCLASSINFO(OpalTranscoderPool, PObject);
+  public:
+    enum {
+      DefaultMaxPerKey = 4,
+      DefaultMaxTotal = 64
+    };
+
+  /**@name Construction */
+  //@{
+    /**Create a new transcoder pool.
+      */
+    OpalTranscoderPool(
+      PINDEX maxPerKey = DefaultMaxPerKey,  ///< Maximum idle instances for each format pair
+      PINDEX maxTotal = DefaultMaxTotal     ///< Maximum idle instances in total
+    );
+
+    /**Destroy the pool, deleting all idle instances.
+      */
+    ~OpalTranscoderPool();
+  //@}
+
+  /**@name Overrides from PObject */
+  //@{
+    virtual void PrintOn(
+      ostream & strm
+    ) const;
+  //@}
+
+  /**@name Operations */
+  //@{
+    /**Get a transcoder instance from the pool.
+       If there is an idle instance with the same formats and options, it is
+       given the new instance ID and the media formats applied again, as they
+       could have been altered at run time. Otherwise, a new instance is made
+       via OpalTranscoder::Create().
+
+       Returns NULL if there is no registered media transcoder between the
+       two formats.
+      */
+    OpalTranscoder * Acquire(
+      const OpalMediaFormat & srcFormat,  ///<  Name of source format
+      const OpalMediaFormat & dstFormat,  ///<  Name of destination format
+      const BYTE * instance = NULL,       ///<  Unique instance identifier for transcoder
+      unsigned instanceLen = 0            ///<  Length of instance identifier
+    );
+
+    /**Return a transcoder to the pool.
+       The transcoder is reset and retained for reuse if it was obtained via
+       Acquire(), the transcoder supports Reset() and there is room in the
+       pool. Otherwise it is deleted. A NULL pointer is ignored.
+      */
+    void Release(
+      OpalTranscoder * transcoder   ///< Transcoder no longer in use
+    );
+
+    /**Delete all idle instances.
+      */
+    void Flush();
+
+    /**Set the pool size limits.
+       A maximum per key of zero disables the pool, all instances are created
+       and deleted as if the pool were not there.
+      */
+    void SetSizes(
+      PINDEX maxPerKey,   ///< Maximum idle instances for each format pair
+      PINDEX maxTotal     ///< Maximum idle instances in total
+    );
+
+    /// Get the maximum idle instances for each format pair.
+    PINDEX GetMaxPerKey() const { return m_maxPerKey; }
+
+    /// Get the maximum idle instances in total.
+    PINDEX GetMaxTotal() const { return m_maxTotal; }
+
+    /// Get the current number of idle instances.
+    PINDEX GetIdleCount() const;
+
+    /// Pool metrics
+    struct Statistics
+    {
+      Statistics();
+
+      unsigned      m_acquired;   ///< Number of calls to Acquire()
+      unsigned      m_reused;     ///< Number satisfied from the pool
+      unsigned      m_created;    ///< Number of new instances created
+      unsigned      m_retained;   ///< Number of released instances kept
+      unsigned      m_discarded;  ///< Number of released instances deleted
+      PTimeInterval m_createTime; ///< Total time spent creating new instances
+      PTimeInterval m_reuseTime;  ///< Total time spent reusing pooled instances
+
+      /// Get the ratio of instances reused to instances acquired.
+      double GetReuseRate() const;
+
+      /// Get estimated setup time saved, based on the average creation time.
+      PTimeInterval GetTimeSaved() const;
+    };
+
+    /// Get the pool metrics.
+    Statistics GetStatistics() const;
+  //@}
+
+  protected:
+    PString MakeKey(
+      const OpalMediaFormat & srcFormat,
+      const OpalMediaFormat & dstFormat
+    ) const;
+
+    PINDEX m_maxPerKey;
+    PINDEX m_maxTotal;
+
+    typedef std::list<OpalTranscoder *> Instances;
+    typedef std::map<PString, Instances> IdleMap;
+    IdleMap m_idle;
+    PINDEX  m_idleCount;
+
+    typedef std::map<OpalTranscoder *, PString> ActiveMap;
+    ActiveMap m_active;
+
+    Statistics m_statistics;
+
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 class Opal_Linear16Mono_PCM : public OpalStreamedTranscoder {
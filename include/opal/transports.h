@@ -38,6 +38,8 @@
 
 #include <opal_config.h>
 
+#include <opal/keepalive.h>
+
 #include <ptlib/sockets.h>
 #include <ptclib/psockbun.h>
 #include <ptclib/http.h>
@@ -983,7 +985,7 @@ class OpalTransport : public PSafeObject
     );
 
     /// Indicate keep alive is active
-    bool HasKeepAlive() const { return !m_keepAliveData.IsEmpty() && m_keepAliveTimer.IsRunning(); }
+    bool HasKeepAlive() const { return !m_keepAliveData.IsEmpty() && m_keepAliveClient.IsKeepAliveActive(); }
 
     /**Attach a thread to the transport.
       */
@@ -1018,12 +1020,24 @@ class OpalTransport : public PSafeObject
     void Dereference() { --m_referenceCount; }
 
   protected:
-    PDECLARE_NOTIFIER(PTimer, OpalTransport, KeepAlive);
+    bool KeepAlive();
+
+    class KeepAliveClient : public OpalKeepAliveScheduler::Client
+    {
+      public:
+        KeepAliveClient(OpalTransport & transport)
+          : OpalKeepAliveScheduler::Client(OpalKeepAliveScheduler::e_TransportKeepAlive)
+          , m_transport(transport)
+        { }
+        virtual bool OnKeepAlive() { return m_transport.KeepAlive(); }
+      protected:
+        OpalTransport & m_transport;
+    };
 
     OpalEndPoint & m_endpoint;
     PChannel     * m_channel;
     PThread      * m_thread;      ///<  Thread handling the transport
-    PTimer         m_keepAliveTimer;
+    KeepAliveClient m_keepAliveClient;
     PBYTEArray     m_keepAliveData;
     PSimpleTimer   m_idleTimer;
     atomic<unsigned> m_referenceCount;
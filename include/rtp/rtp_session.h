@@ -702,6 +702,38 @@ class OpalRTPSession : public OpalMediaSession
     };
     NotifierMap m_notifiers;
 
+    /* Out of order packets waiting to be resequenced, a ring indexed by the
+       low bits of the sequence number, so insert and in order removal are
+       O(1) and frames are never copied. Grows as needed to cover the
+       distance from the next expected sequence number. */
+    class PendingRing
+    {
+      public:
+        PendingRing();
+
+        bool IsEmpty() const { return m_count == 0; }
+        size_t GetSize() const { return m_count; }
+        bool Contains(RTP_SequenceNumber sequenceNumber) const;
+        enum InsertResult { e_Inserted, e_Duplicate, e_Overflow };
+        InsertResult Insert(const RTP_DataFrame & frame, RTP_SequenceNumber expectedSequenceNumber);
+        bool Remove(RTP_SequenceNumber sequenceNumber, RTP_DataFrame & frame);
+        bool RemoveLowest(RTP_SequenceNumber expectedSequenceNumber, RTP_DataFrame & frame);
+
+      protected:
+        bool Resize(size_t size);
+
+        struct Slot
+        {
+          Slot() : m_used(false), m_sequenceNumber(0) { }
+          bool               m_used;
+          RTP_SequenceNumber m_sequenceNumber;
+          RTP_DataFrame      m_frame;
+        };
+        std::vector<Slot> m_slots;
+        unsigned          m_mask;
+        size_t            m_count;
+    };
+
     friend struct SyncSource;
     struct SyncSource
     {
@@ -721,6 +753,8 @@ class OpalRTPSession : public OpalMediaSession
       virtual bool IsExpectingRetransmit(RTP_SequenceNumber sequenceNumber);
       virtual SendReceiveStatus OnOutOfOrderPacket(RTP_DataFrame & frame);
       virtual bool HandlePendingFrames();
+      virtual void RequestRetransmit(RTP_SequenceNumber from, RTP_SequenceNumber to);
+      PTimeInterval GetOutOfOrderWaitTime() const;
 #if OPAL_RTP_FEC
       virtual SendReceiveStatus OnSendRedundantFrame(RTP_DataFrame & frame);
       virtual SendReceiveStatus OnSendRedundantData(RTP_DataFrame & primary, RTP_DataFrameList & redundancies);
@@ -776,7 +810,11 @@ class OpalRTPSession : public OpalMediaSession
       unsigned           m_lateOutOfOrderAdaptMax;
       PTimeInterval      m_lateOutOfOrderAdaptBoost;
       PTimeInterval      m_lateOutOfOrderAdaptPeriod;
-      RTP_DataFrameList  m_pendingPackets;
+      PTimeInterval      m_lateOutOfOrderAdaptTotal; // Added to session wait time, only for this SSRC
+      PendingRing        m_pendingPackets;
+      bool               m_pendingQueued;   // In OpalRTPSession::m_pendingSyncSources
+      std::set<RTP_SequenceNumber>    m_retransmitRequested; // NACKed, still missing
+      RTP_ControlFrame::LostPacketMask m_retransmitToSend;   // NACK to send once unlocked
 
       // Generating real time stamping in RTP packets
       // For e_Receive, times are from last received Sender Report, or Receiver Reference Time Report
@@ -832,6 +870,11 @@ class OpalRTPSession : public OpalMediaSession
       OpalJitterBuffer * m_jitterBuffer;
       OpalJitterBuffer * GetJitterBuffer() const;
 
+      /* Lock for data/statistics of this SSRC only. The send and receive
+         paths hold this plus the session read lock, anything holding the
+         session write lock does not need it. */
+      PDECLARE_MUTEX(m_mutex);
+
       PTRACE_THROTTLE(m_throttleSendData,3,20000);
       PTRACE_THROTTLE(m_throttleReceiveData,3,20000);
       PTRACE_THROTTLE(m_throttleRxSR,3,60000,5);
@@ -849,6 +892,32 @@ class OpalRTPSession : public OpalMediaSession
     SyncSource       m_dummySyncSource;
     RTP_SyncSourceId m_defaultSSRC[2]; // For e_Sender and e_Receiver
 
+    /* Open addressed hash table mirroring m_SSRC, rebuilt whenever m_SSRC
+       changes (under write lock), for per packet look up of SSRC. */
+    class SyncSourceIndex
+    {
+      public:
+        SyncSourceIndex() : m_mask(0) { }
+        void Rebuild(const SyncSourceMap & ssrcs);
+        SyncSource * Find(RTP_SyncSourceId ssrc) const;
+      protected:
+        struct Entry
+        {
+          Entry() : m_ssrc(0), m_source(NULL) { }
+          RTP_SyncSourceId m_ssrc;
+          SyncSource     * m_source;
+        };
+        std::vector<Entry> m_table;
+        unsigned           m_mask;
+    };
+    SyncSourceIndex m_syncSourceIndex;
+
+    // Receivers with out of order packets waiting, only used by receive thread
+    typedef std::vector<SyncSource *> PendingSyncSources;
+    PendingSyncSources m_pendingSyncSources;
+
+    void InternalRemoveSyncSource(SyncSourceMap::iterator it);
+
     const SyncSource & GetSyncSource(RTP_SyncSourceId ssrc, Direction dir) const;
     virtual bool GetSyncSource(RTP_SyncSourceId ssrc, Direction dir, SyncSource * & info);
     virtual SyncSource * UseSyncSource(RTP_SyncSourceId ssrc, Direction dir, bool force);
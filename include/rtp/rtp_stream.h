@@ -221,6 +221,10 @@ protected:
     unsigned      m_jbLatencySampleCount;
 #endif
 
+    unsigned      m_admissionPacketCount;
+    unsigned      m_admissionTooLate;
+    PTimeInterval m_admissionMaxLag;
+
     PTRACE_THROTTLE(m_throttleWriteData,3,500);
     PTRACE_THROTTLE(m_throttleSendReport,3,500);
 };
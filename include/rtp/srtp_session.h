@@ -66,6 +66,8 @@ typedef struct srtp_ctx_t_ srtp_ctx_t;
 //     AES_CM_128_HMAC_SHA1_32,
 //     AES_CM_128_NULL_AUTH,   
 //     NULL_CIPHER_HMAC_SHA1_80
+//     AEAD_AES_128_GCM
+//     AEAD_AES_256_GCM
 //     STRONGHOLD
 //
 
@@ -90,12 +92,16 @@ class OpalSRTPKeyInfo : public OpalMediaCryptoKeyInfo
     const OpalSRTPCryptoSuite & GetCryptoSuite() const { return m_cryptoSuite; }
 
   protected:
+    enum { MaxKeySaltSize = 46 }; // 256 bit key and 112 bit salt
+    void GetKeySalt(BYTE key_salt[MaxKeySaltSize]) const;
+
     const OpalSRTPCryptoSuite & m_cryptoSuite;
     PBYTEArray m_key;
     PBYTEArray m_salt;
-    BYTE       m_key_salt[32]; // libsrtp internal
+    BYTE       m_key_salt[MaxKeySaltSize]; // libsrtp internal
 
   friend class OpalSRTPSession;
+  friend class OpalSRTPContext;
 };
 
 
@@ -117,6 +123,43 @@ class OpalSRTPCryptoSuite : public OpalMediaCryptoSuite
     virtual OpalMediaCryptoKeyInfo * CreateKeyInfo() const;
 
     virtual void SetCryptoPolicy(struct srtp_crypto_policy_t & policy) const = 0;
+
+    /**Indicate the crypto suite can be used with the SRTP library.
+       The AEAD suites require libSRTP to be built with OpenSSL.
+      */
+    virtual bool IsAvailable() const;
+};
+
+
+/**Stand alone libSRTP context, protecting or unprotecting a single SSRC.
+   OpalSRTPSession manages its own contexts, this is for applications that
+   need SRTP without a media session, e.g. benchmarking the crypto suites.
+   All operations are in place, the frame buffer is expanded for the SRTP
+   authentication tag if required.
+  */
+class OpalSRTPContext
+{
+  public:
+    OpalSRTPContext();
+    ~OpalSRTPContext();
+
+    bool Open(const OpalSRTPKeyInfo & keyInfo, RTP_SyncSourceId ssrc, bool rx);
+    void Close();
+    bool IsOpen() const { return m_context != NULL; }
+
+    /**Protect, or unprotect if opened for receive, a batch of frames.
+       @return number of frames, from the start, that were processed.
+      */
+    PINDEX Process(RTP_DataFrame * frames, PINDEX count);
+    bool Process(RTP_DataFrame & frame) { return Process(&frame, 1) == 1; }
+
+  protected:
+    srtp_ctx_t * m_context;
+    bool         m_receiver;
+
+  private:
+    OpalSRTPContext(const OpalSRTPContext &);
+    void operator=(const OpalSRTPContext &);
 };
 
 
@@ -157,6 +200,7 @@ class OpalSRTPSession : public OpalRTPSession
 
     bool                       m_anyRTCP_SSRC;
     srtp_ctx_t               * m_context;
+    PDECLARE_MUTEX(            m_contextMutex); // libSRTP context is not thread safe, send and receive are only read locked
     std::set<RTP_SyncSourceId> m_addedStream;
     OpalSRTPKeyInfo          * m_keyInfo[2]; // rx & tx
     unsigned                   m_consecutiveErrors[2][2];
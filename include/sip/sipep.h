@@ -177,6 +177,11 @@ class SIPEndPoint : public OpalSDPEndPoint
       */
     virtual PBoolean GarbageCollection();
 
+    /**Get the number of work items in the thread pool, queued or being
+       handled.
+      */
+    virtual unsigned GetPendingWorkCount() const { return m_pendingWorkCount; }
+
     /** Get available string option names.
       */
     virtual PStringList GetAvailableStringOptions() const;
@@ -1089,7 +1094,9 @@ class SIPEndPoint : public OpalSDPEndPoint
     PStringSet    m_registrarDomains;
 
     // Thread pooling
-    SIPThreadPool m_threadPool;
+    atomic<unsigned> m_pendingWorkCount;
+    SIPThreadPool    m_threadPool;
+    friend class SIPWorkItem;
 
     // Network interface checking
     PDECLARE_InterfaceNotifier(SIPEndPoint, OnHighPriorityInterfaceChange);
@@ -876,6 +876,7 @@ class SIPWorkItem : public PObject
     PCLASSINFO(SIPWorkItem, PObject);
   public:
     SIPWorkItem(SIPEndPoint & ep, const PString & token);
+    ~SIPWorkItem();
 
     virtual void Work() = 0;
 
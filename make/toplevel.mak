@@ -73,6 +73,9 @@ ifeq ($(OPAL_SAMPLES),yes)
   ifeq ($(OPAL_PTLIB_CLI)$(OPAL_IVR)$(OPAL_HAS_MIXER),yesyesyes)
     SUBDIRS += $(OPAL_TOP_LEVEL_DIR)/samples/mcu
   endif
+  ifeq ($(OPAL_HAS_MIXER),yes)
+    SUBDIRS += $(OPAL_TOP_LEVEL_DIR)/samples/spoolrender
+  endif
   ifeq ($(OPAL_GSTREAMER),yes)
     SUBDIRS += $(OPAL_TOP_LEVEL_DIR)/samples/gstreamer
   endif
@@ -129,6 +132,8 @@ SOURCES += $(OPAL_SRCDIR)/opal/manager.cxx \
            $(OPAL_SRCDIR)/opal/patch.cxx \
            $(OPAL_SRCDIR)/opal/transcoders.cxx \
            $(OPAL_SRCDIR)/opal/transports.cxx \
+           $(OPAL_SRCDIR)/opal/keepalive.cxx \
+           $(OPAL_SRCDIR)/opal/admission.cxx \
            $(OPAL_SRCDIR)/opal/guid.cxx \
            $(OPAL_SRCDIR)/rtp/rtp.cxx \
            $(OPAL_SRCDIR)/rtp/rtp_session.cxx \
@@ -224,6 +229,7 @@ ifeq ($(OPAL_H323),yes)
              $(OPAL_SRCDIR)/h323/gkserver.cxx \
              $(OPAL_SRCDIR)/h323/h225ras.cxx \
              $(OPAL_SRCDIR)/h323/h323trans.cxx \
+             $(OPAL_SRCDIR)/h323/h323reactor.cxx \
              $(OPAL_SRCDIR)/h323/h235auth.cxx \
 
   ifeq ($(OPAL_H501),yes)
@@ -423,6 +429,8 @@ SOURCES += $(OPAL_SRCDIR)/codec/g711codec.cxx \
            $(OPAL_SRCDIR)/codec/rfc2833.cxx \
            $(OPAL_SRCDIR)/codec/opalwavfile.cxx \
            $(OPAL_SRCDIR)/codec/silencedetect.cxx \
+           $(OPAL_SRCDIR)/codec/resampler.cxx \
+           $(OPAL_SRCDIR)/codec/tonedetect.cxx \
            $(OPAL_SRCDIR)/codec/opalpluginmgr.cxx
 
 ifeq ($(OPAL_VIDEO), yes)
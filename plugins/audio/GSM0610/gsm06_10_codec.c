@@ -337,10 +337,18 @@ static int valid_for_h323(
           STRCMPI((const char *)parm, "h323") == 0) ? 1 : 0;
 }
 
+PLUGINCODEC_TRANSCODE_BATCH_FUNCTION(transcode_batch)
+
+static struct PluginCodec_ControlDefn coderControls[] = {
+  { PLUGINCODEC_CONTROL_TRANSCODE_BATCH, transcode_batch },
+  { NULL }
+};
+
 static struct PluginCodec_ControlDefn h323CoderControls[] = {
   { "valid_for_protocol",       valid_for_h323 },
   //{ "get_codec_options",      coder_get_sip_options },
   //{ "set_codec_options",      encoder_set_options },
+  { PLUGINCODEC_CONTROL_TRANSCODE_BATCH, transcode_batch },
   { NULL }
 };
 
@@ -380,7 +388,7 @@ static struct PluginCodec_Definition gsmCodecDefn[4] =
     create_codec,                       // create codec function
     destroy_codec,                      // destroy codec
     codec_encoder,                      // encode/decode
-    NULL,                               // codec controls
+    coderControls,                      // codec controls
 
     PluginCodec_H323AudioCodec_gsmFullRate,  // h323CapabilityType 
     &gsmCaps                             // h323CapabilityData
@@ -417,7 +425,7 @@ static struct PluginCodec_Definition gsmCodecDefn[4] =
     create_codec,                       // create codec function
     destroy_codec,                      // destroy codec
     codec_decoder,                      // encode/decode
-    NULL,                               // codec controls
+    coderControls,                      // codec controls
 
     PluginCodec_H323AudioCodec_gsmFullRate,  // h323CapabilityType 
     &gsmCaps                             // h323CapabilityData
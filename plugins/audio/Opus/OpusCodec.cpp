@@ -444,6 +444,17 @@ class OpusPluginEncoder : public OpusPluginCodec
     }
 
 
+    virtual bool Reset()
+    {
+      if (m_encoder == NULL || opus_encoder_ctl(m_encoder, OPUS_RESET_STATE) != OPUS_OK)
+        return false;
+
+      // Packet loss is dynamic, so put it back to the initial state
+      m_dynamicPacketLoss = 0;
+      return OnChangedOptions();
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
@@ -508,6 +519,16 @@ class OpusPluginDecoder : public OpusPluginCodec
     }
 
 
+    virtual bool Reset()
+    {
+      if (m_decoder == NULL || opus_decoder_ctl(m_decoder, OPUS_RESET_STATE) != OPUS_OK)
+        return false;
+
+      m_lostPacketState = AwaitingInitialPacket;
+      return true;
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
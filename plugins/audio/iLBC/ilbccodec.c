@@ -384,9 +384,13 @@ static int free_codec_options(const struct PluginCodec_Definition * defn,
 }
 
 
+PLUGINCODEC_TRANSCODE_BATCH_FUNCTION(transcode_batch)
+
+
 static struct PluginCodec_ControlDefn h323CoderControls[] = {
   { PLUGINCODEC_CONTROL_VALID_FOR_PROTOCOL, valid_for_h323 },
   { PLUGINCODEC_CONTROL_SET_CODEC_OPTIONS,  set_codec_options },
+  { PLUGINCODEC_CONTROL_TRANSCODE_BATCH,    transcode_batch },
   { NULL }
 };
 
@@ -396,6 +400,7 @@ static struct PluginCodec_ControlDefn h323AndSIPCoderControls[] = {
   { PLUGINCODEC_CONTROL_SET_CODEC_OPTIONS,     set_codec_options },
   { PLUGINCODEC_CONTROL_GET_CODEC_OPTIONS,     get_codec_options },
   { PLUGINCODEC_CONTROL_GET_ACTIVE_OPTIONS,    get_active_options },
+  { PLUGINCODEC_CONTROL_TRANSCODE_BATCH,       transcode_batch },
   { NULL }
 };
 
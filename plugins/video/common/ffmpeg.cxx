@@ -297,6 +297,21 @@ void FFMPEGCodec::CloseCodec()
 }
 
 
+bool FFMPEGCodec::ResetDecoder()
+{
+  if (!m_open)
+    return false;
+
+  // Drop reference frames and any partial frame, ready for a new stream
+  avcodec_flush_buffers(m_context);
+  m_fullFrame->Reset();
+  m_consecutiveFails = 0;
+  m_hadMissingPacket = false;
+  PTRACE(4, m_prefix, "Decoder reset");
+  return true;
+}
+
+
 bool FFMPEGCodec::SetResolution(unsigned width, unsigned height)
 {
   bool wasOpen = m_open;
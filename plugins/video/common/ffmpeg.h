@@ -124,6 +124,7 @@ class FFMPEGCodec
 
     virtual bool OpenCodec();
     virtual void CloseCodec();
+    virtual bool ResetDecoder();
 
     virtual bool EncodeVideoPacket(const PluginCodec_RTP & in, PluginCodec_RTP & out, unsigned & flags);
     virtual bool DecodeVideoPacket(const PluginCodec_RTP & in, unsigned & flags);
@@ -779,6 +779,18 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
     }
 
 
+    virtual bool Reset()
+    {
+      if (m_encoder == NULL)
+        return false;
+
+      // Discard packets of any partial frame, new receiver must start with an IDR
+      m_encapsulation.Reset();
+      m_quality = -1;
+      return m_encoder->ForceIntraFrame(true) == cmResultSuccess;
+    }
+
+
     virtual int GetStatistics(char * bufferPtr, unsigned bufferSize)
     {
       size_t len = BaseClass::GetStatistics(bufferPtr, bufferSize);
@@ -921,6 +933,27 @@ class H264_Decoder : public PluginVideoDecoder<MY_CODEC>
       m_decoder->SetOption(DECODER_OPTION_TRACE_LEVEL, &TraceLevel);
 #endif
 
+      return Initialise();
+    }
+
+
+    virtual bool Reset()
+    {
+      if (m_decoder == NULL)
+        return false;
+
+      // Drop reference frames and any partial frame, ready for a new stream
+      m_decoder->Uninitialize();
+      m_encapsulation.Reset();
+      memset(&m_bufferInfo, 0, sizeof(m_bufferInfo));
+      memset(&m_bufferData, 0, sizeof(m_bufferData));
+      m_lastId = -1;
+      return Initialise();
+    }
+
+
+    bool Initialise()
+    {
       SDecodingParam param;
       memset(&param, 0, sizeof(param));
       param.eOutputColorFormat = videoFormatI420;// color space format to be outputed, EVideoFormatType specified in codec_def.h
@@ -227,6 +227,10 @@ int main(int argc, char *argv[])
           x264.ApplyOptions();
           WritePipe(&msg, sizeof(msg)); 
         break;
+      case RESET_ENCODER:
+          x264.Reset();
+          WritePipe(&msg, sizeof(msg)); 
+        break;
       case SET_TARGET_BITRATE:
           ReadPipe(&val, sizeof(val));
           x264.SetTargetBitrate(val);
@@ -609,6 +609,7 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
     unsigned m_packetisationModeH323;
     bool     m_isH323;
     unsigned m_rateControlPeriod;
+    bool     m_forceIntraFrame;
 
     H264Encoder m_encoder;
 
@@ -625,6 +626,7 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
       , m_packetisationModeH323(1)
       , m_isH323(false)
       , m_rateControlPeriod(1000)
+      , m_forceIntraFrame(false)
     {
       PTRACE(4, MY_CODEC_LOG, "Created encoder");
     }
@@ -820,12 +822,25 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
     }
 
 
+    virtual bool Reset()
+    {
+      // New stream, so new receiver, must start with an IDR
+      m_forceIntraFrame = true;
+      return m_encoder.Reset();
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
                              unsigned & toLen,
                              unsigned & flags)
     {
+      if (m_forceIntraFrame) {
+        flags |= PluginCodec_CoderForceIFrame;
+        m_forceIntraFrame = false;
+      }
+
       if (!m_encoder.EncodeFrames((const unsigned char *)fromPtr, fromLen,
                                   (unsigned char *)toPtr, toLen,
                                    PluginCodec_RTP_GetHeaderLength(toPtr),
@@ -889,6 +904,12 @@ class H264_Decoder : public PluginVideoDecoder<MY_CODEC>, public FFMPEGCodec
     }
 
 
+    virtual bool Reset()
+    {
+      return ResetDecoder();
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
@@ -944,6 +965,12 @@ class H264_FlashEncoder : public H264_Encoder, protected H264FlashPacketizer
     }
 
 
+    virtual bool Reset()
+    {
+      return false; // Flash packetiser state is not reset, so do not reuse
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
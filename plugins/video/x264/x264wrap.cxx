@@ -290,6 +290,14 @@ bool H264Encoder::ApplyOptions()
 }
 
 
+bool H264Encoder::Reset()
+{
+  // Discard any packets left over from the last frame, next frame is forced to IDR by caller
+  m_encapsulation.Reset();
+  return m_codec != NULL;
+}
+
+
 bool H264Encoder::EncodeFrames(const unsigned char * src, unsigned & srcLen,
                                unsigned char * dst, unsigned & dstLen,
                                unsigned /*headerLen*/, unsigned int & flags)
@@ -898,6 +906,14 @@ bool H264Encoder::ApplyOptions()
 }
 
 
+bool H264Encoder::Reset()
+{
+  m_startNewFrame = true;
+  unsigned msg = RESET_ENCODER;
+  return WritePipe(&msg, sizeof(msg)) && ReadPipe(&msg, sizeof(msg)) && msg == RESET_ENCODER;
+}
+
+
 bool H264Encoder::EncodeFrames(const unsigned char * src, unsigned & srcLen,
                                unsigned char * dst, unsigned & dstLen,
                                unsigned headerLen, unsigned int & flags)
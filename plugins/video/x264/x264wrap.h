@@ -69,6 +69,7 @@ extern "C" {
 #define SET_PROFILE_LEVEL         13
 #define SET_MAX_NALU_SIZE         14
 #define SET_RATE_CONTROL_PERIOD   15
+#define RESET_ENCODER             16
 
 
 class H264Encoder
@@ -91,6 +92,7 @@ class H264Encoder
     bool SetMaxKeyFramePeriod(unsigned period);
 
     bool ApplyOptions();
+    bool Reset();
 
     bool EncodeFrames(
       const unsigned char * src,
@@ -231,6 +231,21 @@ void MyManager::Run()
   }
 
   cout << "Total calls: " << m_totalCalls << " attempted, " << m_totalEstablished << " established.\n";
+
+  // Rough measure of call set up overhead, when run with short calls
+  double cpuSeconds = (double)clock()/CLOCKS_PER_SEC;
+  cout << "CPU used: " << cpuSeconds << " seconds";
+  if (m_totalCalls > 0)
+    cout << ", " << cpuSeconds*1000/m_totalCalls << " ms per call";
+  cout << '\n';
+
+#if OPAL_H323
+  H323EndPoint * h323 = FindEndPointAs<H323EndPoint>(OPAL_PREFIX_H323);
+  if (h323 != NULL) {
+    H323CapabilitySetCache & cache = h323->GetCapabilitySetCache();
+    cout << "H.323 capability set cache: " << cache.GetHits() << " hits, " << cache.GetMisses() << " misses\n";
+  }
+#endif
 }
 
 
@@ -28,12 +28,20 @@
 #include "precompile.h"
 #include "main.h"
 
-//#include <opal/patch.h>
-
 #include <ptclib/random.h>
+#include <ep/opalmixer.h>
+#include <codec/g711codec.h>
+#include <codec/tonedetect.h>
+#include <codec/silencedetect.h>
+#include <rtp/srtp_session.h>
+#include <opal/patch.h>
 
 #include <math.h>
 
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
 
 #define OUTPUT_BPS(strm, rate) \
   if (rate < 10000ULL) strm << rate << ' '; \
@@ -88,16 +96,30 @@ void CodecTest::Main()
              "T-statistics. output statistics files\n"
              "d-drop: randomly drop N% of encoded packets\n"
              "-count: set number of frames to transcode\n"
+             "-no-frame-reuse. empty transcoder output lists every frame, to compare allocations\n"
              "-noprompt. do not prompt for commands, i.e. exit when input closes\n"
              "-snr. calculate signal-to-noise ratio between input and output\n"
              "i-info. display per-frame info (use multiple times for more info)\n"
              "-pcap: save encoded packets in a PCAP file\n"
              "-list. list all available plugin codecs\n"
+             "-mixer-bench: benchmark video mixer compositing with N inputs\n"
+             "-mixer-input: input frame size for mixer benchmark, default 720p\n"
+             "-compose-threads: extra compositing threads for mixer benchmark\n"
+             "-g711-bench. benchmark G.711 transcoders, per sample vs bulk conversion\n"
+             "-dtmf-test. check in-band DTMF and fax tone detection accuracy\n"
+             "-dtmf-bench: benchmark in-band tone detection with N channels\n"
+             "-silence-test. check silence detection signal processing against scalar code\n"
+             "-srtp-bench: benchmark SRTP crypto suites with N byte payloads\n"
+             "-stats-bench: benchmark media patch statistics with N SSRCs\n"
              PTRACE_ARGLIST
              "h-help. print this help message.\n"
              , false);
   if (!args.IsParsed() || args.HasOption('h') ||
-              (args.GetCount() == 0 && !args.HasOption("list"))) {
+              (args.GetCount() == 0 && !args.HasOption("list") &&
+               !args.HasOption("mixer-bench") && !args.HasOption("g711-bench") &&
+               !args.HasOption("dtmf-test") && !args.HasOption("dtmf-bench") &&
+               !args.HasOption("silence-test") &&
+               !args.HasOption("srtp-bench") && !args.HasOption("stats-bench"))) {
     cerr << "usage: " << GetFile().GetTitle() << " [ options ] fmtname [ fmtname ]\n"
               "  where fmtname is the Media Format Name for the codec(s) to test, up to two\n"
               "  formats (one audio and one video) may be specified.\n";
@@ -143,6 +165,36 @@ void CodecTest::Main()
     return;
   }
 
+  if (args.HasOption("mixer-bench")) {
+    MixerBenchmark(args);
+    return;
+  }
+
+  if (args.HasOption("g711-bench")) {
+    G711Benchmark(args);
+    return;
+  }
+
+  if (args.HasOption("dtmf-test") || args.HasOption("dtmf-bench")) {
+    ToneDetectTest(args);
+    return;
+  }
+
+  if (args.HasOption("silence-test")) {
+    SilenceDetectTest(args);
+    return;
+  }
+
+  if (args.HasOption("srtp-bench")) {
+    SRTPBenchmark(args);
+    return;
+  }
+
+  if (args.HasOption("stats-bench")) {
+    StatisticsBenchmark(args);
+    return;
+  }
+
   g_infoCount = args.GetOptionCount('i');
 
   unsigned threadCount = args.GetOptionString('S').AsInteger();
@@ -277,6 +329,532 @@ void CodecTest::Main()
 }
 
 
+void CodecTest::MixerBenchmark(PArgList & args)
+{
+#if OPAL_VIDEO && OPAL_HAS_MIXER
+  unsigned inputs = args.GetOptionString("mixer-bench").AsUnsigned();
+  if (inputs == 0)
+    inputs = 16;
+
+  unsigned outWidth = 1280, outHeight = 720;
+  if (args.HasOption('s') && !PVideoFrameInfo::ParseSize(args.GetOptionString('s'), outWidth, outHeight)) {
+    cerr << "Illegal output frame size" << endl;
+    return;
+  }
+
+  unsigned inWidth = 1280, inHeight = 720;
+  if (args.HasOption("mixer-input") && !PVideoFrameInfo::ParseSize(args.GetOptionString("mixer-input"), inWidth, inHeight)) {
+    cerr << "Illegal input frame size" << endl;
+    return;
+  }
+
+  unsigned count = args.HasOption("count") ? args.GetOptionString("count").AsUnsigned() : 300;
+
+  PINDEX frameBytes = PVideoFrameInfo::CalculateFrameBytes(inWidth, inHeight);
+  RTP_DataFrame input(sizeof(PluginCodec_Video_FrameHeader) + frameBytes);
+  PluginCodec_Video_FrameHeader * header = (PluginCodec_Video_FrameHeader *)input.GetPayloadPtr();
+  header->x = header->y = 0;
+  header->width = inWidth;
+  header->height = inHeight;
+  BYTE * pixels = OpalVideoFrameDataPtr(header);
+  for (PINDEX i = 0; i < frameBytes; ++i)
+    pixels[i] = (BYTE)PRandom::Number();
+
+  OpalVideoMixer mixer(OpalVideoMixer::eGrid, outWidth, outHeight, 30, false);
+  mixer.SetComposeThreads(args.GetOptionString("compose-threads").AsUnsigned());
+
+  for (unsigned i = 0; i < inputs; ++i)
+    mixer.AddStream(PString(i));
+
+  cout << "Mixing " << inputs << " inputs of " << inWidth << 'x' << inHeight
+       << " into " << outWidth << 'x' << outHeight << ", "
+       << mixer.GetComposeThreads() << " extra threads, " << count << " frames" << endl;
+
+  static const unsigned UpdateRatios[] = { 1, 4, 0 };
+  for (PINDEX r = 0; r < PARRAYSIZE(UpdateRatios); ++r) {
+    RTP_DataFrame output;
+    mixer.ReadMixed(output); // Settle layout
+
+    PTimeInterval elapsed;
+    for (unsigned frame = 0; frame < count; ++frame) {
+      for (unsigned i = 0; i < inputs; ++i) {
+        if (UpdateRatios[r] != 0 && (i + frame) % UpdateRatios[r] == 0)
+          mixer.WriteStream(PString(i), input);
+      }
+
+      PTimeInterval start = PTimer::Tick();
+      mixer.ReadMixed(output);
+      elapsed += PTimer::Tick() - start;
+    }
+
+    if (UpdateRatios[r] == 0)
+      cout << "  No inputs changing:";
+    else
+      cout << "  1 in " << UpdateRatios[r] << " inputs changing:";
+    cout << ' ' << setprecision(3) << (double)elapsed.GetMicroSeconds()/count/1000.0 << " ms/frame" << endl;
+  }
+#else
+  cerr << "Mixer benchmark requires video and mixer support" << endl;
+#endif
+}
+
+
+static bool G711BenchmarkOne(const char * name,
+                             OpalStreamedTranscoder & transcoder,
+                             const RTP_DataFrame & input,
+                             unsigned count)
+{
+  RTP_DataFrame perSample, bulk;
+
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i)
+    transcoder.OpalStreamedTranscoder::Convert(input, perSample);
+  PTimeInterval perSampleTime = PTimer::Tick() - start;
+
+  start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i)
+    transcoder.Convert(input, bulk);
+  PTimeInterval bulkTime = PTimer::Tick() - start;
+
+  bool same = perSample.GetPayloadSize() == bulk.GetPayloadSize() &&
+              memcmp(perSample.GetPayloadPtr(), bulk.GetPayloadPtr(), bulk.GetPayloadSize()) == 0;
+
+  cout << "  " << setw(24) << left << name << right
+       << " per sample " << setw(8) << perSampleTime.GetMilliSeconds() << "ms,"
+          " bulk " << setw(8) << bulkTime.GetMilliSeconds() << "ms";
+  if (bulkTime > 0)
+    cout << ", x" << setprecision(3) << (double)perSampleTime.GetMicroSeconds()/bulkTime.GetMicroSeconds();
+  if (!same)
+    cout << "  MISMATCH";
+  cout << endl;
+
+  return same;
+}
+
+
+void CodecTest::G711Benchmark(PArgList & args)
+{
+  unsigned count = args.HasOption("count") ? args.GetOptionString("count").AsUnsigned() : 100000;
+  const PINDEX samples = 160; // 20ms at 8kHz
+
+  RTP_DataFrame linear(samples*sizeof(short));
+  short * pcm = (short *)linear.GetPayloadPtr();
+  for (PINDEX i = 0; i < samples; ++i)
+    pcm[i] = (short)PRandom::Number();
+
+  Opal_PCM_G711_uLaw uLawEncoder;
+  Opal_PCM_G711_ALaw ALawEncoder;
+  RTP_DataFrame uLaw, ALaw;
+  uLawEncoder.Convert(linear, uLaw);
+  ALawEncoder.Convert(linear, ALaw);
+
+  Opal_G711_uLaw_PCM uLawDecoder;
+  Opal_G711_ALaw_PCM ALawDecoder;
+  Opal_G711_ALaw_uLaw ALawToULaw;
+  Opal_G711_uLaw_ALaw uLawToALaw;
+
+  cout << "G.711 conversion of " << count << " frames of " << samples << " samples" << endl;
+
+  bool ok = G711BenchmarkOne("PCM-16 to uLaw", uLawEncoder, linear, count);
+  ok = G711BenchmarkOne("PCM-16 to A-Law", ALawEncoder, linear, count) && ok;
+  ok = G711BenchmarkOne("uLaw to PCM-16", uLawDecoder, uLaw, count) && ok;
+  ok = G711BenchmarkOne("A-Law to PCM-16", ALawDecoder, ALaw, count) && ok;
+  ok = G711BenchmarkOne("A-Law to uLaw", ALawToULaw, ALaw, count) && ok;
+  ok = G711BenchmarkOne("uLaw to A-Law", uLawToALaw, uLaw, count) && ok;
+
+  // What direct A-Law/uLaw conversion replaces: two hops via PCM-16
+  RTP_DataFrame intermediate, output;
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i) {
+    ALawDecoder.OpalStreamedTranscoder::Convert(ALaw, intermediate);
+    uLawEncoder.OpalStreamedTranscoder::Convert(intermediate, output);
+  }
+  cout << "  " << setw(24) << left << "A-Law to uLaw, two hops" << right
+       << " per sample " << setw(8) << (PTimer::Tick() - start).GetMilliSeconds() << "ms" << endl;
+
+  if (!ok)
+    cerr << "Bulk conversion did not match per sample conversion!" << endl;
+}
+
+
+void CodecTest::SRTPBenchmark(PArgList & args)
+{
+#if OPAL_SRTP
+  unsigned count = args.HasOption("count") ? args.GetOptionString("count").AsUnsigned() : 100000;
+  PINDEX payloadSize = args.GetOptionString("srtp-bench").AsUnsigned();
+  if (payloadSize == 0)
+    payloadSize = 160; // 20ms of G.711
+  static const PINDEX BatchSize = 16;
+  static const RTP_SyncSourceId SSRC = 0x12345678;
+
+  PBYTEArray payload(payloadSize);
+  for (PINDEX i = 0; i < payloadSize; ++i)
+    payload[i] = (BYTE)PRandom::Number();
+
+  std::vector<RTP_DataFrame> batch;
+  for (PINDEX i = 0; i < BatchSize; ++i)
+    batch.push_back(RTP_DataFrame(payloadSize));
+
+  cout << "SRTP of " << count << " packets of " << payloadSize << " bytes,"
+          " in batches of " << BatchSize << ", single thread" << endl;
+
+  OpalMediaCryptoSuiteFactory::KeyList_T all = OpalMediaCryptoSuiteFactory::GetKeyList();
+  for (OpalMediaCryptoSuiteFactory::KeyList_T::iterator it = all.begin(); it != all.end(); ++it) {
+    const OpalSRTPCryptoSuite * cryptoSuite = dynamic_cast<const OpalSRTPCryptoSuite *>(OpalMediaCryptoSuiteFactory::CreateInstance(*it));
+    if (cryptoSuite == NULL)
+      continue;
+
+    cout << "  " << setw(24) << left << *it << right;
+    if (!cryptoSuite->IsAvailable()) {
+      cout << " not available in SRTP library" << endl;
+      continue;
+    }
+
+    PAutoPtr<OpalSRTPKeyInfo> keyInfo(dynamic_cast<OpalSRTPKeyInfo *>(cryptoSuite->CreateKeyInfo()));
+    keyInfo->Randomise();
+
+    OpalSRTPContext protector, unprotector;
+    if (!protector.Open(*keyInfo, SSRC, false) || !unprotector.Open(*keyInfo, SSRC, true)) {
+      cout << " could not create SRTP context" << endl;
+      continue;
+    }
+
+    PTimeInterval protectTime, unprotectTime;
+    RTP_SequenceNumber sequenceNumber = 0;
+    unsigned done = 0;
+    bool ok = true;
+    while (ok && done < count) {
+      PINDEX n = std::min(BatchSize, (PINDEX)(count - done));
+      for (PINDEX i = 0; i < n; ++i) {
+        RTP_DataFrame & frame = batch[i];
+        frame.SetPayloadSize(payloadSize);
+        frame.SetSyncSource(SSRC);
+        frame.SetSequenceNumber(sequenceNumber++);
+        frame.SetTimestamp((done+i)*payloadSize);
+        memcpy(frame.GetPayloadPtr(), payload, payloadSize);
+      }
+
+      PTimeInterval start = PTimer::Tick();
+      ok = protector.Process(&batch[0], n) == n;
+      PTimeInterval middle = PTimer::Tick();
+      ok = ok && unprotector.Process(&batch[0], n) == n;
+      protectTime += middle - start;
+      unprotectTime += PTimer::Tick() - middle;
+
+      for (PINDEX i = 0; ok && i < n; ++i)
+        ok = batch[i].GetPayloadSize() == payloadSize && memcmp(batch[i].GetPayloadPtr(), payload, payloadSize) == 0;
+
+      done += n;
+    }
+
+    if (!ok) {
+      cout << " failed at packet " << done << endl;
+      continue;
+    }
+
+    cout << " protect " << setw(9) << done*1000000LL/std::max(protectTime.GetMicroSeconds(), (PInt64)1) << " pkt/s,"
+            " unprotect " << setw(9) << done*1000000LL/std::max(unprotectTime.GetMicroSeconds(), (PInt64)1) << " pkt/s" << endl;
+  }
+#else
+  cerr << "SRTP benchmark requires SRTP support" << endl;
+#endif
+}
+
+
+void CodecTest::StatisticsBenchmark(PArgList & args)
+{
+#if OPAL_STATISTICS
+  unsigned count = args.HasOption("count") ? args.GetOptionString("count").AsUnsigned() : 10000000;
+  unsigned ssrcCount = std::max(1U, args.GetOptionString("stats-bench").AsUnsigned());
+
+  cout << "Media patch statistics for " << count << " packets from " << ssrcCount << " SSRCs" << endl;
+
+  // Statistics off, so just the loop overhead
+  PTimeInterval start = PTimer::Tick();
+  volatile RTP_SyncSourceId lastSSRC = 0;
+  for (unsigned i = 0; i < count; ++i)
+    lastSSRC = 0x1000 + i%ssrcCount;
+  PTimeInterval offTime = PTimer::Tick() - start;
+
+  // How it used to be done, a map per SSRC and a mutex
+  struct AudioStats {
+    unsigned m_silent;
+    unsigned m_FEC;
+    AudioStats() : m_silent(0), m_FEC(0) { }
+  };
+  std::map<RTP_SyncSourceId, AudioStats> statsMap;
+  PMutex statsMutex;
+  start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i) {
+    RTP_SyncSourceId ssrc = lastSSRC = 0x1000 + i%ssrcCount;
+    PWaitAndSignal mutex(statsMutex);
+    ++statsMap[0].m_silent;
+    ++statsMap[ssrc].m_silent;
+  }
+  PTimeInterval mapTime = PTimer::Tick() - start;
+
+  OpalMediaPatchStatistics statistics;
+  start = PTimer::Tick();
+  for (unsigned i = 0; i < count; ++i)
+    statistics.IncrementAudio(lastSSRC = 0x1000 + i%ssrcCount, OpalAudioFormat::e_SilenceFrame);
+  PTimeInterval lockFreeTime = PTimer::Tick() - start;
+
+  cout << fixed << setprecision(1)
+       << "  off        " << setw(8) << offTime.GetMicroSeconds()*1000.0/count << " ns/packet\n"
+          "  map+mutex  " << setw(8) << (mapTime - offTime).GetMicroSeconds()*1000.0/count << " ns/packet overhead\n"
+          "  lock free  " << setw(8) << (lockFreeTime - offTime).GetMicroSeconds()*1000.0/count << " ns/packet overhead" << endl;
+#else
+  cerr << "Statistics benchmark requires statistics support" << endl;
+#endif
+}
+
+
+class ToneDetectTestChannel : public OpalToneDetector::Channel
+{
+  public:
+    virtual void OnTone(char tone, unsigned)
+    {
+      PWaitAndSignal lock(m_mutex);
+      m_tones += tone;
+    }
+
+    PString GetTones()
+    {
+      PWaitAndSignal lock(m_mutex);
+      return m_tones;
+    }
+
+  protected:
+    PDECLARE_MUTEX(m_mutex);
+    PString m_tones;
+};
+
+
+static const char ToneDetectKeys[] = "123A456B789C*0#D";
+static const double ToneDetectRows[4] = { 697, 770, 852, 941 };
+static const double ToneDetectCols[4] = { 1209, 1336, 1477, 1633 };
+
+
+static double ToneDetectAmplitude(double dBm0)
+{
+  return 22706*pow(10.0, dBm0/20); // 0dBm0 sine wave, G.711 scale
+}
+
+
+static void ToneDetectGenerate(std::vector<short> & audio,
+                               double freq1, double dBm1,
+                               double freq2, double dBm2,
+                               unsigned ms,
+                               double noise = 0)
+{
+  double amp1 = freq1 > 0 ? ToneDetectAmplitude(dBm1) : 0;
+  double amp2 = freq2 > 0 ? ToneDetectAmplitude(dBm2) : 0;
+  size_t start = audio.size();
+  for (unsigned i = 0; i < ms*8; ++i) {
+    double t = (start + i)/8000.0;
+    double sample = amp1*sin(2*M_PI*freq1*t) + amp2*sin(2*M_PI*freq2*t);
+    if (noise > 0)
+      sample += noise*((double)PRandom::Number(20000)/10000 - 1);
+    audio.push_back((short)std::max(-32768.0, std::min(32767.0, sample)));
+  }
+}
+
+
+static PString ToneDetectRun(OpalToneDetector & detector, const std::vector<short> & audio)
+{
+  ToneDetectTestChannel channel;
+  detector.Attach(channel);
+  for (size_t i = 0; i < audio.size(); i += 160)
+    detector.Write(channel, &audio[i], std::min((size_t)160, audio.size() - i));
+  detector.Detach(channel);
+  return channel.GetTones();
+}
+
+
+static bool ToneDetectCheck(const char * name, const PString & tones, const PString & expected)
+{
+  bool ok = tones == expected;
+  cout << "  " << setw(40) << left << name << right << (ok ? " pass" : " FAIL");
+  if (!ok)
+    cout << ", expected \"" << expected << "\" got \"" << tones << '"';
+  cout << endl;
+  return ok;
+}
+
+
+void CodecTest::ToneDetectTest(PArgList & args)
+{
+  OpalToneDetector detector(0); // Synchronous, results are in before Detach()
+
+  if (args.HasOption("dtmf-test")) {
+    cout << "In-band tone detection accuracy" << endl;
+    bool ok = true;
+
+    // All digits, 40ms on 40ms off, at frequency offsets, twist and levels (of weakest tone)
+    static const double Offsets[] = { -0.015, 0, 0.015 };
+    static const double Twists[] = { -4, 0, 8 };  // Positive is high group louder
+    static const double Levels[] = { -25, -15, -10 };
+    for (PINDEX o = 0; o < PARRAYSIZE(Offsets); ++o) {
+      for (PINDEX t = 0; t < PARRAYSIZE(Twists); ++t) {
+        for (PINDEX l = 0; l < PARRAYSIZE(Levels); ++l) {
+          std::vector<short> audio;
+          for (PINDEX k = 0; k < 16; ++k) {
+            ToneDetectGenerate(audio,
+                               ToneDetectRows[k/4]*(1+Offsets[o]), Levels[l] + std::max(-Twists[t], 0.0),
+                               ToneDetectCols[k%4]*(1+Offsets[o]), Levels[l] + std::max(Twists[t], 0.0),
+                               40);
+            ToneDetectGenerate(audio, 0, 0, 0, 0, 40);
+          }
+          PStringStream name;
+          name << "offset " << Offsets[o]*100 << "%, twist " << Twists[t] << "dB, " << Levels[l] << "dBm0";
+          ok = ToneDetectCheck(name, ToneDetectRun(detector, audio), ToneDetectKeys) && ok;
+        }
+      }
+    }
+
+    std::vector<short> audio;
+    for (PINDEX k = 0; k < 16; ++k) {
+      ToneDetectGenerate(audio, ToneDetectRows[k/4], -10, ToneDetectCols[k%4], -10, 20);
+      ToneDetectGenerate(audio, 0, 0, 0, 0, 60);
+    }
+    ok = ToneDetectCheck("20ms tones rejected", ToneDetectRun(detector, audio), "") && ok;
+
+    audio.clear();
+    for (PINDEX k = 0; k < 16; ++k) {
+      ToneDetectGenerate(audio, ToneDetectRows[k/4]*1.035, -10, ToneDetectCols[k%4]*0.965, -10, 50);
+      ToneDetectGenerate(audio, 0, 0, 0, 0, 50);
+    }
+    ok = ToneDetectCheck("3.5% offset rejected", ToneDetectRun(detector, audio), "") && ok;
+
+    audio.clear();
+    ToneDetectGenerate(audio, 0, 0, 0, 0, 60000, 5000);
+    ok = ToneDetectCheck("60 seconds of noise, no talk off", ToneDetectRun(detector, audio), "") && ok;
+
+    audio.clear();
+    ToneDetectGenerate(audio, ToneDetectRows[1], -10, ToneDetectCols[2], -10, 50, 1500);
+    ok = ToneDetectCheck("Digit in noise", ToneDetectRun(detector, audio), "6") && ok;
+
+    audio.clear();
+    ToneDetectGenerate(audio, 1100, -20, 0, 0, 500);
+    ToneDetectGenerate(audio, 0, 0, 0, 0, 3000);
+    ToneDetectGenerate(audio, 1100, -20, 0, 0, 500);
+    ToneDetectGenerate(audio, 2100, -15, 0, 0, 3000);
+    ok = ToneDetectCheck("Fax CNG, CNG, CED", ToneDetectRun(detector, audio), "XXY") && ok;
+
+    if (!ok)
+      cerr << "Tone detection accuracy failed!" << endl;
+  }
+
+  if (args.HasOption("dtmf-bench")) {
+    unsigned channels = args.GetOptionString("dtmf-bench").AsUnsigned();
+    if (channels == 0)
+      channels = 1000;
+    unsigned count = args.HasOption("count") ? args.GetOptionString("count").AsUnsigned() : 500;
+
+    std::vector<short> audio;
+    ToneDetectGenerate(audio, 0, 0, 0, 0, 20, 4000);
+
+    std::vector<ToneDetectTestChannel> testChannels(channels);
+    for (unsigned c = 0; c < channels; ++c)
+      detector.Attach(testChannels[c]);
+
+    PTimeInterval start = PTimer::Tick();
+    for (unsigned i = 0; i < count; ++i) {
+      for (unsigned c = 0; c < channels; ++c)
+        detector.Write(testChannels[c], &audio[0], audio.size());
+    }
+    PTimeInterval elapsed = PTimer::Tick() - start;
+
+    for (unsigned c = 0; c < channels; ++c)
+      detector.Detach(testChannels[c]);
+
+    cout << "Tone detection of " << channels << " channels, " << count << " frames of 20ms: "
+         << elapsed.GetMilliSeconds() << "ms";
+    if (elapsed > 0)
+      cout << ", " << (unsigned)(channels*count*20.0/elapsed.GetMilliSeconds()) << " real time channels per core";
+    cout << endl;
+  }
+}
+
+
+static bool SilenceDetectCheck(const char * name, const short * pcm, PINDEX samples)
+{
+  // Straight scalar versions of the calculations, to compare against any vectorised code
+  PUInt64 levelSum = 0;
+  for (PINDEX i = 0; i < samples; ++i)
+    levelSum += PABS((int)pcm[i]);
+  unsigned expectedLevel = (unsigned)(levelSum/samples);
+
+  PINDEX blocks = samples/4;
+  double expectedEnergy[OpalPCM16SilenceDetector::NumBands] = { 0, 0, 0, 0 };
+  for (PINDEX i = 0; i < blocks*4; i += 4) {
+    int a = pcm[i], b = pcm[i+1], c = pcm[i+2], d = pcm[i+3];
+    double band[OpalPCM16SilenceDetector::NumBands] = { a+b+c+d, a+b-c-d, a-b-c+d, a-b+c-d };
+    for (PINDEX n = 0; n < OpalPCM16SilenceDetector::NumBands; ++n)
+      expectedEnergy[n] += band[n]*band[n];
+  }
+
+  unsigned level = OpalPCM16SilenceDetector::CalculateAverageLevel(pcm, samples);
+  bool ok = level == expectedLevel;
+
+  // Vector code accumulates in single precision, so allow for rounding
+  float energy[OpalPCM16SilenceDetector::NumBands];
+  OpalPCM16SilenceDetector::CalculateBandEnergy(pcm, samples, energy);
+  for (PINDEX n = 0; n < OpalPCM16SilenceDetector::NumBands; ++n) {
+    double expected = blocks > 0 ? expectedEnergy[n]/blocks : 0;
+    if (fabs(energy[n] - expected) > expected*1e-4 + 1e-3)
+      ok = false;
+  }
+
+  cout << "  " << setw(40) << left << name << right << (ok ? " pass" : " FAIL");
+  if (!ok) {
+    cout << ", level " << level << " expected " << expectedLevel << ", energy";
+    for (PINDEX n = 0; n < OpalPCM16SilenceDetector::NumBands; ++n)
+      cout << ' ' << energy[n] << '/' << (blocks > 0 ? expectedEnergy[n]/blocks : 0);
+  }
+  cout << endl;
+  return ok;
+}
+
+
+void CodecTest::SilenceDetectTest(PArgList &)
+{
+  cout << "Silence detection signal processing against scalar code" << endl;
+  bool ok = true;
+
+  // Odd lengths and misaligned starts exercise the scalar tail and unaligned loads
+  std::vector<short> audio(8000+1);
+  for (size_t i = 0; i < audio.size(); ++i)
+    audio[i] = (short)PRandom::Number();
+  static const PINDEX Lengths[] = { 1, 3, 7, 8, 9, 15, 80, 160, 161, 320, 8000 };
+  for (PINDEX l = 0; l < PARRAYSIZE(Lengths); ++l) {
+    for (PINDEX offset = 0; offset < 2; ++offset) {
+      PStringStream name;
+      name << "random, " << Lengths[l] << " samples, offset " << offset;
+      ok = SilenceDetectCheck(name, &audio[offset], Lengths[l]) && ok;
+    }
+  }
+
+  // Full scale, -32768 has no 16 bit positive equivalent
+  std::fill(audio.begin(), audio.end(), (short)-32768);
+  ok = SilenceDetectCheck("full scale negative", &audio[0], 160) && ok;
+  std::fill(audio.begin(), audio.end(), (short)32767);
+  ok = SilenceDetectCheck("full scale positive", &audio[0], 160) && ok;
+  for (size_t i = 0; i < audio.size(); ++i)
+    audio[i] = (i&1) != 0 ? 32767 : -32768;
+  ok = SilenceDetectCheck("full scale alternating", &audio[0], 160) && ok;
+
+  // Long enough to flush the vector accumulator more than once
+  std::vector<short> longAudio(300000);
+  for (size_t i = 0; i < longAudio.size(); ++i)
+    longAudio[i] = (i%3) != 0 ? -32768 : (short)PRandom::Number();
+  ok = SilenceDetectCheck("300000 samples", &longAudio[0], longAudio.size()) && ok;
+
+  if (!ok)
+    cerr << "Silence detection check failed!" << endl;
+}
+
+
 int TranscoderThread::InitialiseCodec(PArgList & args,
                                       const OpalMediaType & mediaType,
                                       OpalMediaFormat & mediaFormat,
@@ -303,6 +881,7 @@ int TranscoderThread::InitialiseCodec(PArgList & args,
   }
 
   m_calcSNR = args.HasOption("snr");
+  m_frameReuse = !args.HasOption("no-frame-reuse");
   m_headerExtension = (BYTE)args.GetOptionString("ext-hdr", "255").AsUnsigned();
 
   for (PINDEX i = 0; i < args.GetCount(); i++) {
@@ -921,6 +1500,7 @@ void TranscoderThread::Main()
   //
 
   RTP_DataFrame srcFrame;
+  RTP_DataFrameList encFrames, outFrames; // Outside loop so frames are re-used
 
   OpalAudioFormat audioFormat(m_encoder->GetOutputFormat());
   OpalAudioFormat::FrameDetectorPtr audioDetector;
@@ -954,9 +1534,10 @@ void TranscoderThread::Main()
     //
     //  push frames through encoder
     //
-    RTP_DataFrameList encFrames;
-    if (m_encoder == NULL) 
-      encFrames.Append(new RTP_DataFrame(srcFrame)); 
+    if (m_encoder == NULL) {
+      encFrames.RemoveAll();
+      encFrames.Append(new RTP_DataFrame(srcFrame));
+    }
     else {
       if (isVideo) {
         if (m_forceIFrame) {
@@ -972,6 +1553,8 @@ void TranscoderThread::Main()
         srcFrame.SetHeaderExtension(1, 1, &m_headerExtension, RTP_DataFrame::RFC5285_OneByte);
 
 
+      if (!m_frameReuse)
+        encFrames.RemoveAll();
       bool newInState = m_encoder->ConvertFrames(srcFrame, encFrames);
       if (oldEncState != newInState) {
         oldEncState = newInState;
@@ -1075,10 +1658,11 @@ void TranscoderThread::Main()
     //
     else {
       totalEncodedByteCount += encodedPayloadSize;
-      RTP_DataFrameList outFrames;
       for (PINDEX i = 0; i < encFrames.GetSize(); i++) {
         if (encFrames[i].GetPayloadSize() > largestPacket)
           largestPacket = encFrames[i].GetPayloadSize();
+        if (!m_frameReuse)
+          outFrames.RemoveAll();
         bool state = m_decoder->ConvertFrames(encFrames[i], outFrames);
         if (oldDecState != state) {
           oldDecState = state;
@@ -1223,6 +1807,23 @@ void TranscoderThread::Main()
     OUTPUT_BPS(cout, maximumBitRate);
   cout << '\n';
 
+  {
+    unsigned allocations = 0;
+    if (m_encoder != NULL)
+      allocations += m_encoder->GetOutputFrameAllocations();
+    if (m_decoder != NULL)
+      allocations += m_decoder->GetOutputFrameAllocations();
+    cout << "Frame allocations: " << allocations;
+    PInt64 msecs = duration.GetMilliSeconds();
+    if (msecs > 0)
+      cout << " (" << allocations*1000.0/msecs << "/s)";
+    if (totalInputFrameCount > 0)
+      cout << ", " << (double)allocations/totalInputFrameCount << " per input frame";
+    if (!m_frameReuse)
+      cout << ", without re-use";
+    cout << '\n';
+  }
+
   cout << "CPU used: " << cpuTimes << endl;
 
   coutMutex.Signal();
@@ -42,6 +42,7 @@ class TranscoderThread : public PThread
       , m_timestamp(0)
       , m_markerHandling(NormalMarkers)
       , m_dropPercent(0)
+      , m_frameReuse(true)
     {
     }
 
@@ -95,6 +96,7 @@ class TranscoderThread : public PThread
     bool m_calcSNR;
     BYTE m_headerExtension;
     uint32_t m_dropPercent;
+    bool m_frameReuse;
 
     OpalPCAPFile m_pcapFile;
 };
@@ -192,6 +194,12 @@ class CodecTest : public PProcess
     ~CodecTest();
 
     virtual void Main();
+    void MixerBenchmark(PArgList & args);
+    void G711Benchmark(PArgList & args);
+    void ToneDetectTest(PArgList & args);
+    void SilenceDetectTest(PArgList & args);
+    void SRTPBenchmark(PArgList & args);
+    void StatisticsBenchmark(PArgList & args);
 
     class TestThreadInfo : public PObject
     {
@@ -0,0 +1,108 @@
+/*
+ * main.cxx
+ *
+ * OPAL application source file for rendering packet spool recordings
+ *
+ * Main program entry point.
+ *
+ * Copyright (c) 2019 Equivalence Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Equivalence Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+#include <ptlib/pprocess.h>
+#include <opal/recording.h>
+#include <opal/transcoders.h>
+
+#if OPAL_VIDEO
+#include <ptlib/videoio.h>
+#endif
+
+
+class SpoolRender : public PProcess
+{
+    PCLASSINFO(SpoolRender, PProcess)
+  public:
+    SpoolRender();
+    virtual void Main();
+};
+
+
+PCREATE_PROCESS(SpoolRender);
+
+
+SpoolRender::SpoolRender()
+  : PProcess("OPAL Recording Spool Renderer", "SpoolRender", 1, 0, ReleaseCode, 0)
+{
+}
+
+
+void SpoolRender::Main()
+{
+  PArgList & args = GetArguments();
+
+  if (!args.Parse("[Options:]"
+                  "m-mono. Mix all audio to mono, default is stereo\n"
+                  "a-audio-format: Audio format in output file\n"
+#if OPAL_VIDEO
+                  "v-video-format: Video format in output file\n"
+                  "s-size: Video size in output file, e.g. CIF or 704x288\n"
+                  "r-rate: Video frame rate in output file\n"
+#endif
+                  "d-delay: Alignment delay in milliseconds, default 100\n"
+                  PTRACE_ARGLIST
+                  "h-help. print this help message.\n"
+                  , false) || args.HasOption('h') || args.GetCount() < 2) {
+    args.Usage(cerr, "[ options ] spool-file output-file") << "\n"
+               "e.g. " << GetFile().GetTitle() << " call" OPAL_RECORD_SPOOL_FILE_TYPE " call.wav\n\n";
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  OpalRecordManager::Options options;
+  options.m_stereo = !args.HasOption('m');
+  options.m_audioFormat = args.GetOptionString('a');
+#if OPAL_VIDEO
+  options.m_videoFormat = args.GetOptionString('v');
+  if (args.HasOption('s') && !PVideoFrameInfo::ParseSize(args.GetOptionString('s'), options.m_videoWidth, options.m_videoHeight)) {
+    cerr << "Invalid video size \"" << args.GetOptionString('s') << '"' << endl;
+    return;
+  }
+  if (args.HasOption('r'))
+    options.m_videoRate = args.GetOptionString('r').AsUnsigned();
+#endif
+
+  OpalRecordSpoolRenderer renderer;
+  if (args.HasOption('d'))
+    renderer.SetAlignmentDelay(args.GetOptionString('d').AsUnsigned());
+
+  PTime start;
+  if (!renderer.Render(args[0], args[1], options)) {
+    cerr << "Could not render \"" << args[0] << "\" to \"" << args[1] << '"' << endl;
+    return;
+  }
+
+  cout << "Rendered " << renderer.GetPacketCount() << " packets"
+          " (" << renderer.GetDecodeErrors() << " decode errors)"
+          " in " << PTime() - start << " seconds." << endl;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -0,0 +1,235 @@
+/*
+ * main.cxx
+ *
+ * OPAL application source file for measuring H.323 PDU allocations
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <opal/manager.h>
+#include <rtp/pcapfile.h>
+#include <h323/h323pdu.h>
+#include <h323/h225ras.h>
+#include <h323/h323ep.h>
+#include <h323/q931.h>
+
+#include <stdlib.h>
+
+
+#if PMEMORY_CHECK
+
+static unsigned GetAllocationCount()
+{
+  PMemoryHeap::State state;
+  PMemoryHeap::GetState(state);
+  return state.allocationNumber;
+}
+
+#else
+
+static atomic<unsigned> AllocationCount(0);
+
+static unsigned GetAllocationCount()
+{
+  return AllocationCount;
+}
+
+void * operator new(size_t size)
+{
+  ++AllocationCount;
+  void * ptr = malloc(size > 0 ? size : 1);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void * operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void * ptr) throw()
+{
+  free(ptr);
+}
+
+void operator delete[](void * ptr) throw()
+{
+  free(ptr);
+}
+
+#endif // PMEMORY_CHECK
+
+
+class Test : public PProcess
+{
+    PCLASSINFO(Test, PProcess)
+  public:
+    Test();
+
+    virtual void Main();
+};
+
+
+PCREATE_PROCESS(Test);
+
+
+struct Counts
+{
+  Counts() : m_count(0), m_decode(0), m_copy(0) { }
+
+  void PrintOn(ostream & strm, const char * name) const
+  {
+    strm << setw(14) << left << name << right << setw(8) << m_count;
+    if (m_count > 0)
+      strm << setw(12) << m_decode/m_count << setw(12) << m_copy/m_count;
+    strm << '\n';
+  }
+
+  unsigned m_count;
+  unsigned m_decode;
+  unsigned m_copy;
+};
+
+
+static bool IsRequest(unsigned tag)
+{
+  switch (tag) {
+    case H225_RasMessage::e_gatekeeperRequest :
+    case H225_RasMessage::e_registrationRequest :
+    case H225_RasMessage::e_unregistrationRequest :
+    case H225_RasMessage::e_admissionRequest :
+    case H225_RasMessage::e_bandwidthRequest :
+    case H225_RasMessage::e_disengageRequest :
+    case H225_RasMessage::e_locationRequest :
+    case H225_RasMessage::e_infoRequestResponse :
+    case H225_RasMessage::e_resourcesAvailableIndicate :
+    case H225_RasMessage::e_serviceControlIndication :
+      return true;
+  }
+  return false;
+}
+
+
+Test::Test()
+  : PProcess("Open Phone Abstraction Library", "H.323 PDU Test", OPAL_MAJOR, OPAL_MINOR, ReleaseCode, OPAL_BUILD)
+{
+}
+
+
+void Test::Main()
+{
+  PArgList & args = GetArguments();
+  args.Parse("[Options:]"
+             "-ras-port: UDP port for H.225 RAS, default 1719\n"
+             "-h225-port: TCP port for H.225 call signalling, default 1720\n"
+             PTRACE_ARGLIST
+             "h-help."
+             , false);
+  if (!args.IsParsed() || args.HasOption('h') || args.GetCount() == 0) {
+    args.Usage(cerr, "[ options ] file.pcap ...") <<
+      "Decodes the H.225 RAS and call signalling PDUs in the captures and reports\n"
+      "the heap allocations per PDU for the decode, and for the copy of the PDU\n"
+      "a gatekeeper used to make for each request and cached response.\n";
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  WORD rasPort = args.GetOptionAs<WORD>("ras-port", H225_RAS::DefaultRasUdpPort);
+  WORD h225Port = args.GetOptionAs<WORD>("h225-port", H323EndPoint::DefaultTcpSignalPort);
+
+  Counts rasRequests, rasResponses, h225;
+  PTimeInterval decodeTime;
+
+  for (PINDEX arg = 0; arg < args.GetCount(); ++arg) {
+    OpalPCAPFile pcap;
+    if (!pcap.Open(args[arg], PFile::ReadOnly)) {
+      cerr << "Could not open " << args[arg] << endl;
+      continue;
+    }
+
+    PBYTEArray payload;
+    while (!pcap.IsEndOfFile()) {
+      if (pcap.GetUDP(payload) <= 0 || (pcap.GetSrcPort() != rasPort && pcap.GetDstPort() != rasPort))
+        continue;
+
+      unsigned before = GetAllocationCount();
+      PTimeInterval start = PTimer::Tick();
+
+      H323RasPDU * pdu = new H323RasPDU;
+      PPER_Stream strm(payload);
+      if (pdu->Decode(strm)) {
+        decodeTime += PTimer::Tick() - start;
+        unsigned decoded = GetAllocationCount();
+
+        delete pdu->ClonePDU();
+
+        Counts & counts = IsRequest(pdu->GetTag()) ? rasRequests : rasResponses;
+        ++counts.m_count;
+        counts.m_decode += decoded - before;
+        counts.m_copy += GetAllocationCount() - decoded;
+      }
+      delete pdu;
+    }
+
+    if (!pcap.Restart())
+      continue;
+
+    while (!pcap.IsEndOfFile()) {
+      // Only handles one TPKT per TCP segment, which is usual for H.225
+      if (pcap.GetTCP(payload) <= 4 || (pcap.GetSrcPort() != h225Port && pcap.GetDstPort() != h225Port))
+        continue;
+      if (payload[0] != 3 || ((payload[2] << 8) | payload[3]) != payload.GetSize())
+        continue;
+
+      unsigned before = GetAllocationCount();
+      PTimeInterval start = PTimer::Tick();
+
+      Q931 q931;
+      if (!q931.Decode(PBYTEArray(payload.GetPointer()+4, payload.GetSize()-4, false)) || !q931.HasIE(Q931::UserUserIE))
+        continue;
+
+      H323SignalPDU pdu;
+      PPER_Stream strm = q931.GetIE(Q931::UserUserIE);
+      if (!pdu.Decode(strm))
+        continue;
+
+      decodeTime += PTimer::Tick() - start;
+      ++h225.m_count;
+      h225.m_decode += GetAllocationCount() - before;
+    }
+  }
+
+  cout << "PDU type         Count  Allocs/dec Allocs/copy\n";
+  rasRequests.PrintOn(cout, "RAS requests");
+  rasResponses.PrintOn(cout, "RAS responses");
+  h225.PrintOn(cout, "H.225");
+
+  unsigned total = rasRequests.m_count + rasResponses.m_count + h225.m_count;
+  if (total > 0)
+    cout << "\nDecode time: " << decodeTime.GetMicroSeconds()/total << "us/PDU\n"
+            "Gatekeeper allocations per RAS request/response pair,"
+            " before: " << (rasRequests.m_decode + rasRequests.m_copy + rasResponses.m_copy)/std::max(rasRequests.m_count, 1U)
+         << " after: " << rasRequests.m_decode/std::max(rasRequests.m_count, 1U) << endl;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
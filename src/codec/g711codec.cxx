@@ -41,14 +41,155 @@ extern "C" {
   int linear2ulaw(int pcm_val);
   int alaw2linear(int u_val);
   int linear2alaw(int pcm_val);
+  int alaw2ulaw(int aval);
+  int ulaw2alaw(int uval);
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+/* Lookup tables for bulk conversion, built from the reference functions in
+   g711.c so the results are bit exact. The uLaw encoder depends on all 16
+   bits of the sample, the A-Law encoder discards the bottom three. */
+struct OpalG711Tables
+{
+  short m_uLawDecode[256];
+  short m_ALawDecode[256];
+  BYTE  m_uLawEncode[65536];
+  BYTE  m_ALawEncode[8192];
+  BYTE  m_ALawToULaw[256];
+  BYTE  m_uLawToALaw[256];
+
+  OpalG711Tables()
+  {
+    for (int i = 0; i < 256; ++i) {
+      m_uLawDecode[i] = (short)ulaw2linear(i);
+      m_ALawDecode[i] = (short)alaw2linear(i);
+      m_ALawToULaw[i] = (BYTE)alaw2ulaw(i);
+      m_uLawToALaw[i] = (BYTE)ulaw2alaw(i);
+    }
+    for (int i = 0; i < 65536; ++i)
+      m_uLawEncode[i] = (BYTE)linear2ulaw((short)i);
+    for (int i = 0; i < 8192; ++i)
+      m_ALawEncode[i] = (BYTE)linear2alaw((short)(i << 3));
+  }
+};
+
+static const OpalG711Tables & GetG711Tables()
+{
+  static const OpalG711Tables tables;
+  return tables;
+}
+
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPAL_G711_SSE2 1
+#include <emmintrin.h>
+
+/* Eight samples at a time. The segment is the count of thresholds the
+   magnitude reaches, the per lane variable shift of the mantissa is done by
+   a high multiply with a power of two halved once per threshold reached. */
+static __m128i EncodeULaw8(__m128i pcm)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i negative = _mm_cmplt_epi16(pcm, zero);
+  __m128i magnitude = _mm_sub_epi16(_mm_xor_si128(pcm, negative), negative); // -32768 stays 0x8000
+  __m128i clipped = _mm_cmpgt_epi16(_mm_subs_epu16(magnitude, _mm_set1_epi16(7904*4 - 1)), zero);
+  __m128i biased = _mm_add_epi16(_mm_min_epi16(_mm_andnot_si128(clipped, magnitude), _mm_set1_epi16(7904*4 - 1)), _mm_set1_epi16(131));
+
+  __m128i segment = zero;
+  __m128i multiplier = _mm_set1_epi16(0x2000);
+  for (int i = 1; i < 8; ++i) {
+    __m128i reached = _mm_cmpgt_epi16(biased, _mm_set1_epi16((short)((0x80 << i) - 1)));
+    segment = _mm_sub_epi16(segment, reached);
+    multiplier = _mm_sub_epi16(multiplier, _mm_and_si128(reached, _mm_srli_epi16(multiplier, 1)));
+  }
+
+  __m128i mantissa = _mm_and_si128(_mm_mulhi_epu16(biased, multiplier), _mm_set1_epi16(0xF));
+  __m128i value = _mm_or_si128(_mm_slli_epi16(segment, 4), mantissa);
+  value = _mm_or_si128(_mm_andnot_si128(clipped, value), _mm_and_si128(clipped, _mm_set1_epi16(0x7F)));
+  __m128i mask = _mm_sub_epi16(_mm_set1_epi16(0xFF), _mm_and_si128(negative, _mm_set1_epi16(0x80)));
+  return _mm_xor_si128(value, mask);
+}
+
+
+static __m128i EncodeALaw8(__m128i pcm)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i scaled = _mm_srai_epi16(pcm, 3);
+  __m128i negative = _mm_cmplt_epi16(scaled, zero);
+  __m128i magnitude = _mm_xor_si128(scaled, negative); // -x-1 == ~x
+
+  __m128i segment = zero;
+  __m128i multiplier = _mm_set1_epi16((short)0x8000);
+  for (int i = 0; i < 7; ++i) {
+    __m128i reached = _mm_cmpgt_epi16(magnitude, _mm_set1_epi16((short)((0x20 << i) - 1)));
+    segment = _mm_sub_epi16(segment, reached);
+    if (i > 0)
+      multiplier = _mm_sub_epi16(multiplier, _mm_and_si128(reached, _mm_srli_epi16(multiplier, 1)));
+  }
+
+  __m128i mantissa = _mm_and_si128(_mm_mulhi_epu16(magnitude, multiplier), _mm_set1_epi16(0xF));
+  __m128i value = _mm_or_si128(_mm_slli_epi16(segment, 4), mantissa);
+  __m128i mask = _mm_sub_epi16(_mm_set1_epi16(0xD5), _mm_and_si128(negative, _mm_set1_epi16(0x80)));
+  return _mm_xor_si128(value, mask);
+}
+#endif
+
+
+static void EncodeULaw(const short * src, BYTE * dst, PINDEX count)
+{
+  PINDEX i = 0;
+#if OPAL_G711_SSE2
+  for (; i + 16 <= count; i += 16) {
+    __m128i lo = EncodeULaw8(_mm_loadu_si128((const __m128i *)(src + i)));
+    __m128i hi = EncodeULaw8(_mm_loadu_si128((const __m128i *)(src + i + 8)));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+
+  const BYTE * table = GetG711Tables().m_uLawEncode;
+  for (; i < count; ++i)
+    dst[i] = table[(unsigned short)src[i]];
+}
+
+
+static void EncodeALaw(const short * src, BYTE * dst, PINDEX count)
+{
+  PINDEX i = 0;
+#if OPAL_G711_SSE2
+  for (; i + 16 <= count; i += 16) {
+    __m128i lo = EncodeALaw8(_mm_loadu_si128((const __m128i *)(src + i)));
+    __m128i hi = EncodeALaw8(_mm_loadu_si128((const __m128i *)(src + i + 8)));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+#endif
+
+  const BYTE * table = GetG711Tables().m_ALawEncode;
+  for (; i < count; ++i)
+    dst[i] = table[((unsigned short)src[i]) >> 3];
+}
+
+
+static PBoolean TranslateG711(const BYTE * table, const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  PINDEX count = input.GetPayloadSize();
+  output.SetPayloadSize(count);
+
+  const BYTE * src = input.GetPayloadPtr();
+  BYTE * dst = output.GetPayloadPtr();
+  for (PINDEX i = 0; i < count; ++i)
+    dst[i] = table[src[i]];
+
+  return true;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
-Opal_G711_PCM::Opal_G711_PCM(const OpalMediaFormat & inputMediaFormat)
+Opal_G711_PCM::Opal_G711_PCM(const OpalMediaFormat & inputMediaFormat, const short * decodeTable)
   : OpalStreamedTranscoder(inputMediaFormat, OpalPCM16, 8, 16)
+  , m_decodeTable(decodeTable)
 {
 #if OPAL_G711PLC 
   acceptEmptyPayload = true;
@@ -57,9 +198,9 @@ Opal_G711_PCM::Opal_G711_PCM(const OpalMediaFormat & inputMediaFormat)
 }
 
 
-#if OPAL_G711PLC 
 PBoolean Opal_G711_PCM::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
 {
+#if OPAL_G711PLC 
   PTRACE(7, "G.711\tPLC in_psz=" << input.GetPayloadSize()
          << " sn=" << input.GetSequenceNumber() << ", ts=" << input.GetTimestamp());
 
@@ -72,23 +213,30 @@ PBoolean Opal_G711_PCM::Convert(const RTP_DataFrame & input, RTP_DataFrame & out
     PTRACE(7, "G.711\tDOFE out_psz" << lastPayloadSize);
     return true;
   }
+#endif
+
+  PINDEX samples = input.GetPayloadSize();
+  output.SetPayloadSize(samples*sizeof(short));
 
-  if (!OpalStreamedTranscoder::Convert(input, output))
-    return false;
+  const BYTE * src = input.GetPayloadPtr();
+  short * dst = (short *)output.GetPayloadPtr();
+  for (PINDEX i = 0; i < samples; ++i)
+    dst[i] = m_decodeTable[src[i]];
 
+#if OPAL_G711PLC 
   lastPayloadSize = output.GetPayloadSize();
   plc.addtohistory((short*)output.GetPayloadPtr(), lastPayloadSize/sizeof(short));
   PTRACE(7, "G.711\tPLC ADD out_psz=" << lastPayloadSize);
+#endif
 
   return true;
 }
-#endif
 
 
 ///////////////////////////////////////////////////////////////////////////////
 
 Opal_G711_uLaw_PCM::Opal_G711_uLaw_PCM()
-  : Opal_G711_PCM(OpalG711_ULAW_64K)
+  : Opal_G711_PCM(OpalG711_ULAW_64K, GetG711Tables().m_uLawDecode)
 {
   PTRACE(3, "Codec\tG711-uLaw-64k decoder created");
 }
@@ -115,6 +263,15 @@ Opal_PCM_G711_uLaw::Opal_PCM_G711_uLaw()
 }
 
 
+PBoolean Opal_PCM_G711_uLaw::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  PINDEX samples = input.GetPayloadSize()/sizeof(short);
+  output.SetPayloadSize(samples);
+  EncodeULaw((const short *)input.GetPayloadPtr(), output.GetPayloadPtr(), samples);
+  return true;
+}
+
+
 int Opal_PCM_G711_uLaw::ConvertOne(int sample) const
 {
   return linear2ulaw(sample);
@@ -130,7 +287,7 @@ int Opal_PCM_G711_uLaw::ConvertSample(int sample)
 ///////////////////////////////////////////////////////////////////////////////
 
 Opal_G711_ALaw_PCM::Opal_G711_ALaw_PCM()
-  : Opal_G711_PCM(OpalG711_ALAW_64K)
+  : Opal_G711_PCM(OpalG711_ALAW_64K, GetG711Tables().m_ALawDecode)
 {
   PTRACE(3, "Codec\tG711-ALaw-64k decoder created");
 }
@@ -156,6 +313,15 @@ Opal_PCM_G711_ALaw::Opal_PCM_G711_ALaw()
 }
 
 
+PBoolean Opal_PCM_G711_ALaw::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  PINDEX samples = input.GetPayloadSize()/sizeof(short);
+  output.SetPayloadSize(samples);
+  EncodeALaw((const short *)input.GetPayloadPtr(), output.GetPayloadPtr(), samples);
+  return true;
+}
+
+
 int Opal_PCM_G711_ALaw::ConvertOne(int sample) const
 {
   return linear2alaw(sample);
@@ -168,4 +334,58 @@ int Opal_PCM_G711_ALaw::ConvertSample(int sample)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+Opal_G711_ALaw_uLaw::Opal_G711_ALaw_uLaw()
+  : OpalStreamedTranscoder(OpalG711_ALAW_64K, OpalG711_ULAW_64K, 8, 8)
+{
+  PTRACE(3, "Codec\tG711-ALaw-64k to G711-uLaw-64k transcoder created");
+}
+
+
+PBoolean Opal_G711_ALaw_uLaw::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  return TranslateG711(GetG711Tables().m_ALawToULaw, input, output);
+}
+
+
+int Opal_G711_ALaw_uLaw::ConvertOne(int sample) const
+{
+  return alaw2ulaw(sample);
+}
+
+
+int Opal_G711_ALaw_uLaw::ConvertSample(int sample)
+{
+  return alaw2ulaw(sample);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+Opal_G711_uLaw_ALaw::Opal_G711_uLaw_ALaw()
+  : OpalStreamedTranscoder(OpalG711_ULAW_64K, OpalG711_ALAW_64K, 8, 8)
+{
+  PTRACE(3, "Codec\tG711-uLaw-64k to G711-ALaw-64k transcoder created");
+}
+
+
+PBoolean Opal_G711_uLaw_ALaw::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  return TranslateG711(GetG711Tables().m_uLawToALaw, input, output);
+}
+
+
+int Opal_G711_uLaw_ALaw::ConvertOne(int sample) const
+{
+  return ulaw2alaw(sample);
+}
+
+
+int Opal_G711_uLaw_ALaw::ConvertSample(int sample)
+{
+  return ulaw2alaw(sample);
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
@@ -591,6 +591,8 @@ OpalPluginTranscoder::OpalPluginTranscoder(const PluginCodec_Definition * defn,
   , freeOptionsControl(defn, PLUGINCODEC_CONTROL_FREE_CODEC_OPTIONS)
   , getOutputDataSizeControl(defn, PLUGINCODEC_CONTROL_GET_OUTPUT_DATA_SIZE)
   , getCodecStatistics(defn, PLUGINCODEC_CONTROL_GET_STATISTICS)
+  , resetCodecControl(defn, PLUGINCODEC_CONTROL_RESET_CODEC)
+  , transcodeBatchControl(defn, PLUGINCODEC_CONTROL_TRANSCODE_BATCH)
 {
 #if PTRACING
   m_firstLoggedUpdateOptions[true] = m_firstLoggedUpdateOptions[false] = true;
@@ -687,6 +689,13 @@ bool OpalPluginTranscoder::ExecuteCommand(const OpalMediaCommand & command)
 }
 
 
+bool OpalPluginTranscoder::ResetContext()
+{
+  // Plug ins without the control cannot be reused, so are deleted as before
+  return context != NULL && resetCodecControl.Call(NULL, (unsigned *)NULL, context) > 0;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Plugin framed audio codec classes
@@ -727,6 +736,14 @@ PBoolean OpalPluginFramedAudioTranscoder::ExecuteCommand(const OpalMediaCommand
 }
 
 
+bool OpalPluginFramedAudioTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+  OpalFramedTranscoder::Reset();
+  return ResetContext();
+}
+
+
 #if OPAL_STATISTICS
 void OpalPluginFramedAudioTranscoder::GetStatistics(OpalMediaStatistics & statistics) const
 {
@@ -770,6 +787,47 @@ PBoolean OpalPluginFramedAudioTranscoder::ConvertFrame(const BYTE * input,
   return stat;
 }
 
+const void * OpalPluginFramedAudioTranscoder::GetBatchKey() const
+{
+  // All instances of the same plug in codec can be converted in one call
+  return context != NULL && transcodeBatchControl.Exists() ? codecDef : NULL;
+}
+
+
+void OpalPluginFramedAudioTranscoder::ConvertFrameBatch(BatchFrame * frames, PINDEX count)
+{
+  // Note updateMutex should already be locked at this point.
+
+  m_batchItems.resize(count);
+  for (PINDEX i = 0; i < count; ++i) {
+    PluginCodec_BatchItem & item = m_batchItems[i];
+    item.context = static_cast<OpalPluginFramedAudioTranscoder *>(frames[i].m_transcoder)->context;
+    item.from    = frames[i].m_input;
+    item.fromLen = frames[i].m_consumed;
+    item.to      = frames[i].m_output;
+    item.toLen   = frames[i].m_created;
+    item.flags   = 0;
+    item.result  = 0;
+  }
+
+  unsigned length = count*sizeof(PluginCodec_BatchItem);
+  int processed = transcodeBatchControl.Call(&m_batchItems[0], &length);
+  if (processed < 0)
+    processed = 0;
+
+  for (PINDEX i = 0; i < count; ++i) {
+    if (i < (PINDEX)processed) {
+      frames[i].m_result   = m_batchItems[i].result != 0;
+      frames[i].m_consumed = m_batchItems[i].fromLen;
+      frames[i].m_created  = m_batchItems[i].toLen;
+    }
+    else // Plug in stopped early, do rest individually
+      frames[i].m_result = frames[i].m_transcoder->ConvertFrame(frames[i].m_input, frames[i].m_consumed,
+                                                                frames[i].m_output, frames[i].m_created);
+  }
+}
+
+
 PBoolean OpalPluginFramedAudioTranscoder::ConvertSilentFrame(BYTE * buffer)
 { 
   if (codecDef == NULL || context == NULL)
@@ -838,6 +896,14 @@ PBoolean OpalPluginStreamedAudioTranscoder::ExecuteCommand(const OpalMediaComman
 }
 
 
+bool OpalPluginStreamedAudioTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+  OpalStreamedTranscoder::Reset();
+  return ResetContext();
+}
+
+
 int OpalPluginStreamedAudioTranscoder::ConvertOne(int from) const
 {
   if (context == NULL)
@@ -913,6 +979,28 @@ PBoolean OpalPluginVideoTranscoder::ExecuteCommand(const OpalMediaCommand & comm
 }
 
 
+bool OpalPluginVideoTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  OpalVideoTranscoder::Reset();
+  if (!ResetContext())
+    return false;
+
+  // Keep m_bufferRTP, it is only a work buffer and avoids a reallocation
+  m_totalFrames = 0;
+  m_markersState = e_MarkersInitial;
+  m_lastPacketMarker = false;
+  m_currentFrameTimestamp = UINT_MAX;
+  m_lastPacketTimestamp = UINT_MAX;
+  m_lastMarkerTimestamp = UINT_MAX;
+#if PTRACING
+  m_consecutiveIntraFrames = 0;
+#endif
+  return true;
+}
+
+
 PBoolean OpalPluginVideoTranscoder::ConvertFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList)
 {
   if (context == NULL)
@@ -925,13 +1013,15 @@ PBoolean OpalPluginVideoTranscoder::ConvertFrames(const RTP_DataFrame & src, RTP
 
 bool OpalPluginVideoTranscoder::EncodeFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList)
 {
-  dstList.RemoveAll();
+  /* The frames in the list from last time are re-used, as there are usually
+     much the same number of packets per video frame, and this avoids a lot
+     of large allocations on the media path. */
+  PINDEX frameCount = 0;
 
-  if (src.GetPayloadSize() == 0)
-    return true;
-
-  if (ShouldDropFrame(src.GetTimestamp()))
+  if (src.GetPayloadSize() == 0 || ShouldDropFrame(src.GetTimestamp())) {
+    TrimOutputFrames(dstList, frameCount);
     return true;
+  }
 
   // get the size of the output buffer
   int outputDataSize = std::max(GetOptimalDataFrameSize(false),
@@ -944,33 +1034,34 @@ bool OpalPluginVideoTranscoder::EncodeFrames(const RTP_DataFrame & src, RTP_Data
   PTRACE_IF(4, foreIFrame, "OpalPlugin\tI-Frame forced from video codec at frame " << m_totalFrames+1);
   do {
     // Some plug ins a very rude and use more memory than we say they can, so add an extra 1k
-    RTP_DataFrame * dst = new RTP_DataFrame((PINDEX)0, outputDataSize+1024);
-    dst->CopyHeader(src);
-    dst->SetPayloadType(GetPayloadType(false));
+    RTP_DataFrame & dst = GetOutputFrame(dstList, frameCount, outputDataSize+1024);
+    dst.CopyHeader(src);
+    dst.SetPayloadType(GetPayloadType(false));
 
     // call the codec function
     unsigned int fromLen = src.GetHeaderSize() + src.GetPayloadSize();
-    unsigned int toLen = dst->GetHeaderSize() + outputDataSize;
+    unsigned int toLen = dst.GetHeaderSize() + outputDataSize;
     flags = foreIFrame || m_totalFrames == 0 ? PluginCodec_CoderForceIFrame : 0;
 
-    if (!Transcode((const BYTE *)src, &fromLen, dst->GetPointer(), &toLen, &flags)) {
-      delete dst;
+    if (!Transcode((const BYTE *)src, &fromLen, dst.GetPointer(), &toLen, &flags)) {
+      TrimOutputFrames(dstList, 0);
       return false;
     }
 
     if ((flags & PluginCodec_ReturnCoderIFrame) != 0)
       m_lastFrameWasIFrame = true;
 
-    if (toLen < RTP_DataFrame::MinHeaderSize || (PINDEX)toLen < dst->GetHeaderSize())
-      delete dst;
-    else {
-      dst->SetPayloadSize(toLen - dst->GetHeaderSize());
-      dst->SetMarker((flags & PluginCodec_ReturnCoderLastFrame) != 0);
-      dstList.Append(dst);
+    // If nothing output, the frame is used again on the next pass
+    if (toLen >= RTP_DataFrame::MinHeaderSize && (PINDEX)toLen >= dst.GetHeaderSize()) {
+      dst.SetPayloadSize(toLen - dst.GetHeaderSize());
+      dst.SetMarker((flags & PluginCodec_ReturnCoderLastFrame) != 0);
+      ++frameCount;
     }
 
   } while ((flags & PluginCodec_ReturnCoderLastFrame) == 0);
 
+  TrimOutputFrames(dstList, frameCount);
+
   if (dstList.IsEmpty()) {
     PTRACE(4, "OpalPlugin\tEncoder skipping video frame at " << m_totalFrames);
     return true;
@@ -1041,8 +1132,11 @@ bool OpalPluginVideoTranscoder::DecodeFrames(const RTP_DataFrame & src, RTP_Data
   outputDataSize += VideoDecodeBufferFudgeFactor;
 
   if (m_bufferRTP == NULL) {
-    if (dstList.IsEmpty())
+    // Cannot re-use the frame if the buffer is still referenced by someone else
+    if (dstList.IsEmpty() || !dstList.front().IsUnique()) {
       m_bufferRTP = new RTP_DataFrame((PINDEX)0, outputDataSize);
+      ++m_outputFrameAllocations;
+    }
     else {
       // Re-use the previously allocated output frame. As video frames can be large
       // when the heap gets a bit fragmented it slows the system down substantially
@@ -1162,6 +1256,7 @@ bool OpalPluginVideoTranscoder::DecodeFrames(const RTP_DataFrame & src, RTP_Data
     // As we are doing this packets SN twice, reset our out of sequence packet detection
     if (m_bufferRTP == NULL) {
       m_bufferRTP = new RTP_DataFrame((PINDEX)0, outputDataSize);
+      ++m_outputFrameAllocations;
       m_lastFrameWasIFrame = false;
     }
 
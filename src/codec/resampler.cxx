@@ -0,0 +1,260 @@
+/*
+ * resampler.cxx
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "resampler.h"
+#endif
+
+#include <opal_config.h>
+
+#include <codec/resampler.h>
+
+#include <math.h>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define OPAL_RESAMPLER_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+#define new PNEW
+#define PTraceModule() "Resampler"
+
+
+/* Taps per phase at the lower of the two rates. With the Kaiser window below
+   this gives a transition band of about 14% of the lower rate, placed just
+   under its Nyquist frequency, and about 70dB of stop band rejection. */
+static const unsigned BaseTaps = 32;
+static const double KaiserBeta = 7.0;
+static const double KaiserAttenuation = KaiserBeta/0.1102 + 8.7; // dB
+static const int CoefficientBits = 14;
+
+
+static unsigned GreatestCommonDivisor(unsigned a, unsigned b)
+{
+  while (b != 0) {
+    unsigned t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+
+static double BesselI0(double x)
+{
+  double sum = 1, term = 1;
+  for (int k = 1; k < 50; ++k) {
+    term *= (x/(2*k))*(x/(2*k));
+    sum += term;
+    if (term < sum*1e-12)
+      break;
+  }
+  return sum;
+}
+
+
+static int DotProduct(const short * samples, const short * coefficients, unsigned taps)
+{
+#if OPAL_RESAMPLER_SSE2
+  __m128i acc = _mm_setzero_si128();
+  for (unsigned i = 0; i < taps; i += 8)
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(samples + i)),
+                                            _mm_loadu_si128((const __m128i *)(coefficients + i))));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(acc);
+#else
+  int acc = 0;
+  for (unsigned i = 0; i < taps; ++i)
+    acc += samples[i]*coefficients[i];
+  return acc;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalPCM16Resampler::OpalPCM16Resampler(const OpalMediaFormat & inputMediaFormat,
+                                       const OpalMediaFormat & outputMediaFormat)
+  : OpalTranscoder(inputMediaFormat, outputMediaFormat)
+  , m_inputRate(inputMediaFormat.GetClockRate())
+  , m_outputRate(outputMediaFormat.GetClockRate())
+  , m_channels(inputMediaFormat.GetOptionInteger(OpalAudioFormat::ChannelsOption(), 1))
+{
+  PAssert(m_channels == (unsigned)outputMediaFormat.GetOptionInteger(OpalAudioFormat::ChannelsOption(), 1),
+          "Resampler cannot change number of channels");
+  Initialise();
+}
+
+
+OpalPCM16Resampler::OpalPCM16Resampler(unsigned inputRate, unsigned outputRate, unsigned channels)
+  : OpalTranscoder(GetOpalPCM16(inputRate, channels), GetOpalPCM16(outputRate, channels))
+  , m_inputRate(inputRate)
+  , m_outputRate(outputRate)
+  , m_channels(channels)
+{
+  // Rates not in the PCM-16 media formats are still fine for the filter
+  m_inClockRate = inputRate;
+  m_outClockRate = outputRate;
+  Initialise();
+}
+
+
+void OpalPCM16Resampler::Initialise()
+{
+  acceptOtherPayloads = true; // Raw audio, payload type is whatever it was before decoding
+
+  if (m_channels < 1)
+    m_channels = 1;
+  else if (m_channels > 2)
+    m_channels = 2;
+
+  unsigned gcd = GreatestCommonDivisor(m_inputRate, m_outputRate);
+  m_upFactor = m_outputRate/gcd;
+  m_downFactor = m_inputRate/gcd;
+
+  // When decimating, the filter must be proportionally longer to keep the
+  // same transition band relative to the (lower) output rate.
+  m_taps = BaseTaps;
+  if (m_downFactor > m_upFactor)
+    m_taps = ((BaseTaps*m_downFactor + m_upFactor - 1)/m_upFactor + 7) & ~7;
+
+  /* Design the prototype low pass filter at the interpolated rate of
+     m_upFactor*m_inputRate, with the cut off in the middle of the transition
+     band below the Nyquist frequency of the lower rate. */
+  unsigned length = m_upFactor*m_taps;
+  double lowerRate = std::min(m_inputRate, m_outputRate);
+  double transition = (KaiserAttenuation - 8)/(2.285*2*M_PI) * lowerRate/BaseTaps;
+  double cutoff = (lowerRate - transition)/2/((double)m_upFactor*m_inputRate); // Cycles per sample
+  double centre = (length - 1)/2.0;
+  double windowScale = BesselI0(KaiserBeta);
+
+  std::vector<double> prototype(length);
+  for (unsigned n = 0; n < length; ++n) {
+    double t = n - centre;
+    double sinc = t == 0 ? 2*cutoff : sin(2*M_PI*cutoff*t)/(M_PI*t);
+    double r = t/centre;
+    prototype[n] = sinc * BesselI0(KaiserBeta*sqrt(std::max(0.0, 1 - r*r)))/windowScale;
+  }
+
+  /* Split into phases, reversed so output is a plain dot product with the
+     input, and normalise each phase to unity gain at DC. */
+  m_coefficients.resize(length);
+  for (unsigned phase = 0; phase < m_upFactor; ++phase) {
+    double sum = 0;
+    for (unsigned k = 0; k < m_taps; ++k)
+      sum += prototype[phase + k*m_upFactor];
+
+    short * coefficients = &m_coefficients[phase*m_taps];
+    for (unsigned k = 0; k < m_taps; ++k)
+      coefficients[m_taps-1-k] = (short)floor(prototype[phase + k*m_upFactor]/sum*(1 << CoefficientBits) + 0.5);
+  }
+
+  Reset();
+
+  PTRACE(4, "Created " << m_inputRate << "Hz to " << m_outputRate << "Hz resampler,"
+            " channels=" << m_channels << ", ratio=" << m_upFactor << '/' << m_downFactor << ", taps=" << m_taps);
+}
+
+
+void OpalPCM16Resampler::Reset()
+{
+  for (unsigned channel = 0; channel < m_channels; ++channel)
+    m_buffer[channel].assign(m_taps-1, 0);
+  m_phase = 0;
+  m_position = 0;
+}
+
+
+PINDEX OpalPCM16Resampler::GetOptimalDataFrameSize(PBoolean input) const
+{
+  return (input ? m_inputRate : m_outputRate)/1000*m_channels*sizeof(short);
+}
+
+
+PINDEX OpalPCM16Resampler::GetMaxOutputFrames(PINDEX inputFrames) const
+{
+  return (inputFrames*m_upFactor + m_downFactor - 1)/m_downFactor + 1;
+}
+
+
+PINDEX OpalPCM16Resampler::Resample(const short * input, PINDEX inputFrames, short * output)
+{
+  PINDEX history = m_taps-1;
+  PINDEX available = history + inputFrames;
+  PINDEX outputFrames = 0;
+  unsigned phase = 0;
+  PINDEX position = 0;
+
+  for (unsigned channel = 0; channel < m_channels; ++channel) {
+    std::vector<short> & buffer = m_buffer[channel];
+    buffer.resize(available);
+    for (PINDEX i = 0; i < inputFrames; ++i)
+      buffer[history + i] = input[i*m_channels + channel];
+
+    const short * samples = &buffer[0];
+    phase = m_phase;
+    position = m_position;
+    outputFrames = 0;
+    while (position + (PINDEX)m_taps <= available) {
+      int value = DotProduct(samples + position, &m_coefficients[phase*m_taps], m_taps);
+      value = (value + (1 << (CoefficientBits-1))) >> CoefficientBits;
+      output[outputFrames*m_channels + channel] = (short)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+      ++outputFrames;
+
+      phase += m_downFactor;
+      position += phase/m_upFactor;
+      phase %= m_upFactor;
+    }
+
+    // Keep the tail as history for next time
+    std::copy(buffer.end() - history, buffer.end(), buffer.begin());
+    buffer.resize(history);
+  }
+
+  m_phase = phase;
+  m_position = position - inputFrames;
+
+  return outputFrames;
+}
+
+
+PBoolean OpalPCM16Resampler::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  PINDEX inputFrames = input.GetPayloadSize()/sizeof(short)/m_channels;
+  output.SetPayloadSize(GetMaxOutputFrames(inputFrames)*m_channels*sizeof(short));
+  PINDEX outputFrames = Resample((const short *)input.GetPayloadPtr(), inputFrames, (short *)output.GetPayloadPtr());
+  output.SetPayloadSize(outputFrames*m_channels*sizeof(short));
+  return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
@@ -34,6 +34,13 @@
 #include <codec/silencedetect.h>
 #include <opal/patch.h>
 
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define OPAL_SILENCE_SSE2 1
+  #include <emmintrin.h>
+#endif
+
 #define new PNEW
 #define PTraceModule() "Silence"
 
@@ -48,10 +55,15 @@ extern "C" {
 
 OpalSilenceDetector::OpalSilenceDetector(const Params & theParam)
   : m_receiveHandler(PCREATE_NOTIFIER(ReceivedPacket))
-  , m_clockRate (8000)
+  , m_parameters(theParam)
+  , m_clockRate(8000)
+  , m_parametersChanged(false)
+  , m_levelThreshold(0)
+  , m_lastSignalLevel(0)
+  , m_lastResult(IsSilent)
 {
   // Initialise the adaptive threshold variables.
-  SetParameters(theParam);
+  ApplyParameters();
 
   PTRACE(4, "Handler created");
 }
@@ -78,14 +90,32 @@ void OpalSilenceDetector::AdaptiveReset()
 void OpalSilenceDetector::SetParameters(const Params & newParam, const int rate /*= 0*/)
 {
   PWaitAndSignal mutex(m_inUse);
+  m_parameters = newParam;
   if (rate)
     m_clockRate = rate;
-  m_mode = newParam.m_mode;
-  m_signalDeadband = newParam.m_signalDeadband*m_clockRate/1000;
-  m_silenceDeadband = newParam.m_silenceDeadband*m_clockRate/1000;
-  m_adaptivePeriod = newParam.m_adaptivePeriod*m_clockRate/1000;
+  m_parametersChanged = true;
+}
+
+
+void OpalSilenceDetector::SetClockRate(unsigned rate)
+{
+  PWaitAndSignal mutex(m_inUse);
+  m_clockRate = rate;
+  m_parametersChanged = true;
+}
+
+
+void OpalSilenceDetector::ApplyParameters()
+{
+  PWaitAndSignal mutex(m_inUse);
+  m_parametersChanged = false;
+
+  m_mode = m_parameters.m_mode;
+  m_signalDeadband = m_parameters.m_signalDeadband*m_clockRate/1000;
+  m_silenceDeadband = m_parameters.m_silenceDeadband*m_clockRate/1000;
+  m_adaptivePeriod = m_parameters.m_adaptivePeriod*m_clockRate/1000;
   if (m_mode == FixedSilenceDetection)
-    m_levelThreshold = newParam.m_threshold;// note: this value compared to uLaw encoded signal level
+    m_levelThreshold = m_parameters.m_threshold;// note: this value compared to uLaw encoded signal level
   else
     AdaptiveReset();
 
@@ -98,25 +128,12 @@ void OpalSilenceDetector::SetParameters(const Params & newParam, const int rate
 }
 
 
-void OpalSilenceDetector::SetClockRate(unsigned rate)
-{
-  PWaitAndSignal mutex(m_inUse);
-  m_signalDeadband = m_signalDeadband * 1000 / m_clockRate * rate / 1000;
-  m_silenceDeadband = m_silenceDeadband * 1000 / m_clockRate * rate / 1000;
-  m_adaptivePeriod = m_adaptivePeriod * 1000 / m_clockRate * rate / 1000;
-  m_clockRate = rate;
-  if (m_mode == AdaptiveSilenceDetection)
-    AdaptiveReset();
-}
-
-
 void OpalSilenceDetector::GetParameters(Params & params)
 {
-  params.m_mode = m_mode;
-  params.m_threshold = m_levelThreshold*1000/m_clockRate;
-  params.m_signalDeadband = m_signalDeadband*1000/m_clockRate;
-  params.m_silenceDeadband = m_silenceDeadband*1000/m_clockRate;
-  params.m_adaptivePeriod = m_adaptivePeriod*1000/m_clockRate;
+  PWaitAndSignal mutex(m_inUse);
+  params = m_parameters;
+  if (m_parameters.m_mode != FixedSilenceDetection)
+    params.m_threshold = m_levelThreshold;
 }
 
 
@@ -153,8 +170,6 @@ void OpalSilenceDetector::Params::FromString(const PString & str)
 
 OpalSilenceDetector::Result OpalSilenceDetector::GetResult(unsigned * currentThreshold, unsigned * currentLevel) const
 {
-  PWaitAndSignal mutex(m_inUse);
-
   if (currentThreshold != NULL)
     *currentThreshold = m_levelThreshold;
 
@@ -165,6 +180,12 @@ OpalSilenceDetector::Result OpalSilenceDetector::GetResult(unsigned * currentThr
 }
 
 
+bool OpalSilenceDetector::DetectSpeech(const BYTE *, PINDEX, bool &)
+{
+  return false;
+}
+
+
 void OpalSilenceDetector::ReceivedPacket(RTP_DataFrame & frame, P_INT_PTR)
 {
   switch (Detect(frame.GetPayloadPtr(), frame.GetPayloadSize(), frame.GetTimestamp())) {
@@ -186,7 +207,8 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
   if (audioLen == 0)
     return m_lastResult = IsSilent;
 
-  PWaitAndSignal mutex(m_inUse);
+  if (m_parametersChanged)
+    ApplyParameters();
 
   // Can never have silence if NoSilenceDetection
   if (m_mode == NoSilenceDetection)
@@ -205,14 +227,17 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
 
   // Can never have average signal level that high, this indicates that the
   // GetAverageSignalLevel (possibly hardware) cannot do energy calculation.
-  if (m_lastSignalLevel == UINT_MAX)
+  if (rawSignalLevel == UINT_MAX)
     return m_lastResult = VoiceActive;
 
   // Convert to a logarithmic scale - use uLaw which is complemented
-  m_lastSignalLevel = linear2ulaw(rawSignalLevel) ^ 0xff;
+  unsigned signalLevel = linear2ulaw(rawSignalLevel) ^ 0xff;
+  m_lastSignalLevel = signalLevel;
 
-  // Now if signal level above threshold we are "talking"
-  bool haveSignal = m_lastSignalLevel > m_levelThreshold;
+  // Now if signal level above threshold we are "talking", or speech detected
+  bool haveSignal;
+  if (m_mode != SpectralSilenceDetection || !DetectSpeech(audioPtr, audioLen, haveSignal))
+    haveSignal = signalLevel > m_levelThreshold;
 
   // If no change ie still talking or still silent, reset frame counter
   if ((m_lastResult != IsSilent) == haveSignal) {
@@ -227,7 +252,7 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
       m_lastResult = m_lastResult != IsSilent ? IsSilent : VoiceActivated;
       PTRACE(4, "Detector transition: "
              << (m_lastResult != IsSilent ? "Talk" : "Silent")
-             << " level=" << m_lastSignalLevel << " threshold=" << m_levelThreshold);
+             << " level=" << signalLevel << " threshold=" << m_levelThreshold);
 
       // If we had talk/silence transition restart adaptive threshold measurements
       m_signalMinimum = UINT_MAX;
@@ -244,11 +269,14 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
   if (m_mode == FixedSilenceDetection)
     return m_lastResult;
 
-  // Adaptive silence detection
+  /* Adaptive silence detection. This is also done when spectral detection
+     is making the decision, so the threshold still indicates the level at
+     which speech is seen, for GetResult(). */
+
   if (m_levelThreshold == 0) {
-    if (m_lastSignalLevel > 1) {
+    if (signalLevel > 1) {
       // Bootstrap condition, use first frame level as silence level
-      m_levelThreshold = m_lastSignalLevel/2;
+      m_levelThreshold = signalLevel/2;
       PTRACE(4, "Threshold initialised to: " << m_levelThreshold);
     }
     return m_lastResult;
@@ -256,13 +284,13 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
 
   // Count the number of silent and signal frames and calculate min/max
   if (haveSignal) {
-    if (m_lastSignalLevel < m_signalMinimum)
-      m_signalMinimum = m_lastSignalLevel;
+    if (signalLevel < m_signalMinimum)
+      m_signalMinimum = signalLevel;
     m_signalReceivedTime = m_signalReceivedTime + timeSinceLastFrame;
   }
   else {
-    if (m_lastSignalLevel > m_silenceMaximum)
-      m_silenceMaximum = m_lastSignalLevel;
+    if (signalLevel > m_silenceMaximum)
+      m_silenceMaximum = signalLevel;
     m_silenceReceivedTime = m_silenceReceivedTime + timeSinceLastFrame;
   }
 
@@ -320,21 +348,190 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
 
 /////////////////////////////////////////////////////////////////////////////
 
+/* Spectral detection tuning. The bias compensates for the minimum of a noisy
+   estimate being below its mean. Weights favour the bands below 2kHz (at
+   8kHz sample rate) where voiced speech has most of its energy, over the
+   upper bands where clicks and hiss are more prominent. */
+static const float SpeechThreshold = 2.5f;       // dB, weighted mean SNR over bands
+static const float NoiseMinimumBias = 2.0f;      // 3dB
+static const float NoiseSmoothing = 0.3f;        // Per frame
+static const float BandEnergyFloor = 64;         // Avoid log of zero, ~ -70dBm0
+static const float BandWeights[OpalPCM16SilenceDetector::NumBands] = { 1.0f, 1.0f, 0.6f, 0.3f };
+static const unsigned NoiseWindowsPerSecond = 4; // Eight gives two second window
+
+
+OpalPCM16SilenceDetector::OpalPCM16SilenceDetector(const Params & newParam)
+  : OpalSilenceDetector(newParam)
+{
+  OpalPCM16SilenceDetector::AdaptiveReset();
+}
+
+
+void OpalPCM16SilenceDetector::AdaptiveReset()
+{
+  OpalSilenceDetector::AdaptiveReset();
+  m_noiseInitialised = false;
+  m_noiseWindowLength = m_clockRate/NoiseWindowsPerSecond; // Called with m_inUse locked
+  m_noiseWindowSamples = 0;
+  m_noiseWindowIndex = 0;
+}
+
+
 unsigned OpalPCM16SilenceDetector::GetAverageSignalLevel(const BYTE * buffer, PINDEX size)
 {
   // Calculate the average signal level of this frame
-  int sum = 0;
+  return CalculateAverageLevel((const short *)buffer, size/2);
+}
+
+
+unsigned OpalPCM16SilenceDetector::CalculateAverageLevel(const short * pcm, PINDEX samples)
+{
+  if (samples <= 0)
+    return 0;
+
+  PUInt64 sum = 0;
+  PINDEX i = 0;
+
+#if OPAL_SILENCE_SSE2
+  while (i + 8 <= samples) {
+    // Flush 32 bit accumulator before it can overflow, each lane gets at most 2^30
+    PINDEX end = std::min(samples & ~7, i + 8*16384);
+    __m128i acc = _mm_setzero_si128();
+    for (; i < end; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(pcm + i));
+      /* Sign extend to 32 bits before taking absolute value, in 16 bits
+         -32768 has no positive equivalent. */
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      __m128i loSign = _mm_srai_epi32(lo, 31);
+      __m128i hiSign = _mm_srai_epi32(hi, 31);
+      acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(lo, loSign), loSign));
+      acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(hi, hiSign), hiSign));
+    }
+    unsigned lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    sum += (PUInt64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+#endif
+
+  for (; i < samples; ++i)
+    sum += PABS(pcm[i]);
+
+  return (unsigned)(sum/samples);
+}
+
+
+void OpalPCM16SilenceDetector::CalculateBandEnergy(const short * pcm, PINDEX samples, float energy[NumBands])
+{
+  PINDEX blocks = samples/4;
+  if (blocks <= 0) {
+    for (PINDEX band = 0; band < NumBands; ++band)
+      energy[band] = 0;
+    return;
+  }
+
+  /* For each block of four samples a,b,c,d the bands, lowest frequency
+     first, are: a+b+c+d, a+b-c-d, a-b-c+d and a-b+c-d */
+  PINDEX i = 0;
+  double sum[NumBands] = { 0, 0, 0, 0 };
+
+#if OPAL_SILENCE_SSE2
+  /* Each multiply-add of eight samples against the sign pattern gives the
+     pair sums, adding the swapped pairs gives each block total twice. */
+  const __m128i pattern0 = _mm_setr_epi16(1, 1, 1, 1, 1, 1, 1, 1);
+  const __m128i pattern1 = _mm_setr_epi16(1, 1,-1,-1, 1, 1,-1,-1);
+  const __m128i pattern2 = _mm_setr_epi16(1,-1,-1, 1, 1,-1,-1, 1);
+  const __m128i pattern3 = _mm_setr_epi16(1,-1, 1,-1, 1,-1, 1,-1);
+  __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+
+#define OPAL_BAND_ENERGY(n) \
+  { \
+    __m128i pairs = _mm_madd_epi16(v, pattern##n); \
+    __m128 total = _mm_cvtepi32_ps(_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)))); \
+    acc##n = _mm_add_ps(acc##n, _mm_mul_ps(total, total)); \
+  }
+
+  for (; i + 8 <= blocks*4; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pcm + i));
+    OPAL_BAND_ENERGY(0);
+    OPAL_BAND_ENERGY(1);
+    OPAL_BAND_ENERGY(2);
+    OPAL_BAND_ENERGY(3);
+  }
+
+#undef OPAL_BAND_ENERGY
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, acc0); sum[0] = ((double)lanes[0] + lanes[1] + lanes[2] + lanes[3])/2;
+  _mm_storeu_ps(lanes, acc1); sum[1] = ((double)lanes[0] + lanes[1] + lanes[2] + lanes[3])/2;
+  _mm_storeu_ps(lanes, acc2); sum[2] = ((double)lanes[0] + lanes[1] + lanes[2] + lanes[3])/2;
+  _mm_storeu_ps(lanes, acc3); sum[3] = ((double)lanes[0] + lanes[1] + lanes[2] + lanes[3])/2;
+#endif
+
+  for (; i < blocks*4; i += 4) {
+    int a = pcm[i], b = pcm[i+1], c = pcm[i+2], d = pcm[i+3];
+    int band0 = a+b+c+d, band1 = a+b-c-d, band2 = a-b-c+d, band3 = a-b+c-d;
+    sum[0] += (double)band0*band0;
+    sum[1] += (double)band1*band1;
+    sum[2] += (double)band2*band2;
+    sum[3] += (double)band3*band3;
+  }
+
+  for (PINDEX band = 0; band < NumBands; ++band)
+    energy[band] = (float)(sum[band]/blocks);
+}
+
+
+bool OpalPCM16SilenceDetector::DetectSpeech(const BYTE * buffer, PINDEX size, bool & speech)
+{
   PINDEX samples = size/2;
-  const short * pcm = (const short *)buffer;
-  const short * end = pcm + samples;
-  while (pcm != end) {
-    if (*pcm < 0)
-      sum -= *pcm++;
-    else
-      sum += *pcm++;
+  float energy[NumBands];
+  CalculateBandEnergy((const short *)buffer, samples, energy);
+
+  if (!m_noiseInitialised) {
+    for (PINDEX band = 0; band < NumBands; ++band) {
+      energy[band] += BandEnergyFloor;
+      m_bandSmoothed[band] = m_bandMinimum[band] = energy[band];
+      for (PINDEX window = 0; window < NoiseWindows; ++window)
+        m_bandWindowMinimum[window][band] = energy[band];
+    }
+    m_noiseInitialised = true;
+    speech = false;
+    return true;
+  }
+
+  float score = 0, totalWeight = 0;
+  for (PINDEX band = 0; band < NumBands; ++band) {
+    energy[band] += BandEnergyFloor;
+
+    // Noise floor is the minimum of the smoothed energy over the last few windows
+    m_bandSmoothed[band] += (energy[band] - m_bandSmoothed[band])*NoiseSmoothing;
+    if (m_bandMinimum[band] > m_bandSmoothed[band])
+      m_bandMinimum[band] = m_bandSmoothed[band];
+    float noise = m_bandMinimum[band];
+    for (PINDEX window = 0; window < NoiseWindows; ++window) {
+      if (noise > m_bandWindowMinimum[window][band])
+        noise = m_bandWindowMinimum[window][band];
+    }
+
+    float snr = 10*log10f(energy[band]/(noise*NoiseMinimumBias));
+    if (snr > 0)
+      score += snr*BandWeights[band];
+    totalWeight += BandWeights[band];
+  }
+
+  m_noiseWindowSamples += samples;
+  if (m_noiseWindowSamples >= m_noiseWindowLength) {
+    m_noiseWindowSamples = 0;
+    m_noiseWindowIndex = (m_noiseWindowIndex+1)%NoiseWindows;
+    for (PINDEX band = 0; band < NumBands; ++band) {
+      m_bandWindowMinimum[m_noiseWindowIndex][band] = m_bandMinimum[band];
+      m_bandMinimum[band] = m_bandSmoothed[band];
+    }
   }
 
-  return sum/samples;
+  speech = score > SpeechThreshold*totalWeight;
+  return true;
 }
 
 
@@ -0,0 +1,484 @@
+/*
+ * tonedetect.cxx
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "tonedetect.h"
+#endif
+
+#include <opal_config.h>
+
+#include <codec/tonedetect.h>
+
+#include <math.h>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define OPAL_TONEDETECT_SSE 1
+  #include <emmintrin.h>
+#endif
+
+#define new PNEW
+#define PTraceModule() "ToneDetect"
+
+
+/* Lanes 0-3 are the DTMF row (low group) frequencies, 4-7 the column (high
+   group), 8 is fax CNG and 9 is fax CED. Lanes 10 and 11 pad out the SIMD
+   registers and are ignored. */
+static const double Frequencies[OpalToneDetector::NumFrequencies] = {
+  697, 770, 852, 941, 1209, 1336, 1477, 1633, 1100, 2100
+};
+static const char DigitTable[4][4] = {
+  { '1', '2', '3', 'A' },
+  { '4', '5', '6', 'B' },
+  { '7', '8', '9', 'C' },
+  { '*', '0', '#', 'D' }
+};
+enum { CNGLane = 8, CEDLane = 9 };
+
+static const float MinimumAmplitude = 700;   // About -30dBm0 per tone
+static const float NormalTwist = 10.0f;      // High group up to 10dB above low
+static const float ReverseTwist = 4.0f;      // Low group up to 6dB above high
+static const float RelativePeak = 6.3f;      // 8dB above others in group
+static const float DigitToTotalEnergy = 0.5f;
+static const float FaxToTotalEnergy = 0.7f;
+static const unsigned DigitBlocks = 2;       // 25.5ms needed to detect
+static const float BlockStationarity = 0.5f; // 3dB between thirds of a block
+static const unsigned DigitGapBlocks = 2;    // 25.5ms needed for end of digit
+static const unsigned FaxToneMS = 400;       // CNG is 0.5s on, CED 2.6 to 4s
+static const PINDEX MaxPendingSamples = OpalToneDetector::SampleRate; // A second behind is too far
+
+#define BLOCKS_TO_MS(blocks) ((blocks)*OpalToneDetector::BlockSize*1000/OpalToneDetector::SampleRate)
+
+
+struct OpalGoertzelCoefficients
+{
+  float m_lane[12];
+
+  OpalGoertzelCoefficients()
+  {
+    for (PINDEX i = 0; i < PARRAYSIZE(m_lane); ++i)
+      m_lane[i] = i < OpalToneDetector::NumFrequencies
+                      ? (float)(2*cos(2*M_PI*Frequencies[i]/OpalToneDetector::SampleRate)) : 0;
+  }
+};
+
+static const OpalGoertzelCoefficients & GetGoertzelCoefficients()
+{
+  static const OpalGoertzelCoefficients coefficients;
+  return coefficients;
+}
+
+
+static void GoertzelUpdate(float * state1, float * state2, float & energy,
+                           const short * samples, PINDEX count, float gain)
+{
+  const float * coefficients = GetGoertzelCoefficients().m_lane;
+  float sum = energy;
+
+#if OPAL_TONEDETECT_SSE
+  __m128 c0 = _mm_loadu_ps(coefficients);
+  __m128 c1 = _mm_loadu_ps(coefficients+4);
+  __m128 c2 = _mm_loadu_ps(coefficients+8);
+  __m128 s10 = _mm_loadu_ps(state1), s11 = _mm_loadu_ps(state1+4), s12 = _mm_loadu_ps(state1+8);
+  __m128 s20 = _mm_loadu_ps(state2), s21 = _mm_loadu_ps(state2+4), s22 = _mm_loadu_ps(state2+8);
+
+  for (PINDEX i = 0; i < count; ++i) {
+    float x = samples[i]*gain;
+    sum += x*x;
+    __m128 vx = _mm_set1_ps(x);
+    __m128 s00 = _mm_sub_ps(_mm_add_ps(vx, _mm_mul_ps(c0, s10)), s20);
+    __m128 s01 = _mm_sub_ps(_mm_add_ps(vx, _mm_mul_ps(c1, s11)), s21);
+    __m128 s02 = _mm_sub_ps(_mm_add_ps(vx, _mm_mul_ps(c2, s12)), s22);
+    s20 = s10; s21 = s11; s22 = s12;
+    s10 = s00; s11 = s01; s12 = s02;
+  }
+
+  _mm_storeu_ps(state1, s10); _mm_storeu_ps(state1+4, s11); _mm_storeu_ps(state1+8, s12);
+  _mm_storeu_ps(state2, s20); _mm_storeu_ps(state2+4, s21); _mm_storeu_ps(state2+8, s22);
+#else
+  for (PINDEX i = 0; i < count; ++i) {
+    float x = samples[i]*gain;
+    sum += x*x;
+    for (PINDEX lane = 0; lane < OpalToneDetector::NumFrequencies; ++lane) {
+      float s0 = x + coefficients[lane]*state1[lane] - state2[lane];
+      state2[lane] = state1[lane];
+      state1[lane] = s0;
+    }
+  }
+#endif
+
+  energy = sum;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalToneDetector::Channel::Channel()
+  : m_detector(NULL)
+  , m_scheduled(false)
+  , m_active(false)
+  , m_gain(1)
+{
+  Reset();
+}
+
+
+OpalToneDetector::Channel::~Channel()
+{
+  // Too late to safely call OnTone(), but at least stop worker using memory
+  PAssert(m_detector == NULL, "Tone detector channel not detached");
+  if (m_detector != NULL)
+    m_detector->Detach(*this);
+}
+
+
+void OpalToneDetector::Channel::SetScale(unsigned multiplier, unsigned divisor)
+{
+  m_gain = divisor > 0 ? (float)multiplier/divisor : 1;
+}
+
+
+void OpalToneDetector::Channel::Reset()
+{
+  memset(m_state1, 0, sizeof(m_state1));
+  memset(m_state2, 0, sizeof(m_state2));
+  memset(m_energy, 0, sizeof(m_energy));
+  m_blockSamples = 0;
+  m_digit = '\0';
+  m_digitBlocks = 0;
+  m_digitGapBlocks = 0;
+  m_digitReported = false;
+  m_faxTone = '\0';
+  m_faxBlocks = 0;
+  m_faxReported = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalToneDetector::OpalToneDetector(unsigned threads)
+  : m_workAvailable(0, INT_MAX)
+  , m_running(true)
+{
+  for (unsigned i = 0; i < threads; ++i)
+    m_threads.push_back(new PThreadObj<OpalToneDetector>(*this,
+                                                         &OpalToneDetector::WorkerMain,
+                                                         false,
+                                                         "ToneDetect",
+                                                         PThread::HighPriority));
+  PTRACE(4, "Created tone detector with " << threads << " worker threads");
+}
+
+
+OpalToneDetector::~OpalToneDetector()
+{
+  m_mutex.Wait();
+  m_running = false;
+  m_mutex.Signal();
+
+  for (size_t i = 0; i < m_threads.size(); ++i)
+    m_workAvailable.Signal();
+  for (size_t i = 0; i < m_threads.size(); ++i)
+    PThread::WaitAndDelete(m_threads[i]);
+}
+
+
+unsigned OpalToneDetector::GetDefaultThreadCount()
+{
+  unsigned processors = PThread::GetNumProcessors();
+  return processors > 0 ? processors : 1;
+}
+
+
+void OpalToneDetector::Attach(Channel & channel)
+{
+  // Make sure no worker thread is using the channel before we reset it
+  if (channel.m_detector != NULL)
+    channel.m_detector->Detach(channel);
+
+  PWaitAndSignal mutex(m_mutex);
+
+  if (channel.m_active) {
+    PTRACE(1, "Tone detector channel still active, cannot attach");
+    return;
+  }
+
+  channel.m_detector = this;
+  channel.m_pending.clear();
+  channel.Reset();
+}
+
+
+void OpalToneDetector::Detach(Channel & channel)
+{
+  {
+    PWaitAndSignal mutex(m_mutex);
+
+    if (channel.m_detector == this) {
+      std::deque<Channel *>::iterator it = std::find(m_ready.begin(), m_ready.end(), &channel);
+      if (it != m_ready.end())
+        m_ready.erase(it);
+      channel.m_detector = NULL;
+      channel.m_pending.clear();
+    }
+
+    if (!channel.m_active) {
+      channel.m_scheduled = false;
+      return;
+    }
+  }
+
+  // A worker has it, it will notice m_detector is NULL when it is done and signal us
+  channel.m_idle.Wait();
+}
+
+
+void OpalToneDetector::Write(Channel & channel, const short * samples, PINDEX count)
+{
+  if (count <= 0)
+    return;
+
+  m_mutex.Wait();
+
+  if (channel.m_detector != this) {
+    m_mutex.Signal();
+    return;
+  }
+
+  if (m_threads.empty()) {
+    // Synchronous mode, as long as another thread is not in here with the same channel
+    if (channel.m_active) {
+      m_mutex.Signal();
+      return;
+    }
+    channel.m_active = true;
+    m_mutex.Signal();
+
+    ProcessSamples(channel, samples, count);
+
+    m_mutex.Wait();
+    channel.m_active = false;
+    if (channel.m_detector != this)
+      channel.m_idle.Signal();
+    m_mutex.Signal();
+    return;
+  }
+
+  if ((PINDEX)channel.m_pending.size() + count > MaxPendingSamples) {
+    PTRACE(2, "Tone detector overloaded, discarding " << channel.m_pending.size() << " samples");
+    channel.m_pending.clear();
+  }
+  channel.m_pending.insert(channel.m_pending.end(), samples, samples+count);
+
+  bool wake = !channel.m_scheduled;
+  if (wake) {
+    channel.m_scheduled = true;
+    m_ready.push_back(&channel);
+  }
+
+  m_mutex.Signal();
+
+  if (wake)
+    m_workAvailable.Signal();
+}
+
+
+void OpalToneDetector::WorkerMain()
+{
+  static const size_t MaxBatch = 32;
+  std::vector<Channel *> batch;
+  std::vector< std::vector<short> > audio(MaxBatch);
+
+  for (;;) {
+    m_workAvailable.Wait();
+
+    m_mutex.Wait();
+    if (!m_running) {
+      m_mutex.Signal();
+      return;
+    }
+
+    /* Take a batch of channels, their audio comes with them. The semaphore
+       count may now be higher than the ready queue length, which just means
+       an extra pass through here with nothing to do. */
+    batch.clear();
+    while (!m_ready.empty() && batch.size() < MaxBatch) {
+      Channel * channel = m_ready.front();
+      m_ready.pop_front();
+      channel->m_active = true;
+      audio[batch.size()].swap(channel->m_pending);
+      batch.push_back(channel);
+    }
+    m_mutex.Signal();
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (!audio[i].empty())
+        ProcessSamples(*batch[i], &audio[i][0], audio[i].size());
+      audio[i].clear();
+    }
+
+    m_mutex.Wait();
+    bool wake = false;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      Channel & channel = *batch[i];
+      channel.m_active = false;
+      if (channel.m_detector != this) {
+        channel.m_scheduled = false;
+        channel.m_idle.Signal();
+      }
+      else if (channel.m_pending.empty())
+        channel.m_scheduled = false;
+      else {
+        m_ready.push_back(&channel); // More arrived while we were busy
+        wake = true;
+      }
+    }
+    m_mutex.Signal();
+
+    if (wake)
+      m_workAvailable.Signal();
+  }
+}
+
+
+void OpalToneDetector::ProcessSamples(Channel & channel, const short * samples, PINDEX count)
+{
+  while (count > 0) {
+    static const unsigned ThirdSize = BlockSize/3;
+    unsigned third = channel.m_blockSamples/ThirdSize;
+    PINDEX todo = std::min(count, (PINDEX)((third+1)*ThirdSize - channel.m_blockSamples));
+    GoertzelUpdate(channel.m_state1, channel.m_state2, channel.m_energy[third], samples, todo, channel.m_gain);
+    channel.m_blockSamples += todo;
+    samples += todo;
+    count -= todo;
+
+    if (channel.m_blockSamples >= BlockSize) {
+      ProcessBlock(channel);
+      memset(channel.m_state1, 0, sizeof(channel.m_state1));
+      memset(channel.m_state2, 0, sizeof(channel.m_state2));
+      memset(channel.m_energy, 0, sizeof(channel.m_energy));
+      channel.m_blockSamples = 0;
+    }
+  }
+}
+
+
+void OpalToneDetector::ProcessBlock(Channel & channel)
+{
+  const float * coefficients = GetGoertzelCoefficients().m_lane;
+
+  float power[NumFrequencies];
+  for (PINDEX i = 0; i < NumFrequencies; ++i) {
+    float s1 = channel.m_state1[i], s2 = channel.m_state2[i];
+    power[i] = s1*s1 + s2*s2 - coefficients[i]*s1*s2;
+  }
+
+  // A pure tone of amplitude A gives a power of (A*N/2)^2, and a total energy of A^2*N/2
+  static const float MinimumPower = (MinimumAmplitude*BlockSize/2)*(MinimumAmplitude*BlockSize/2);
+  float totalPower = (channel.m_energy[0] + channel.m_energy[1] + channel.m_energy[2])*BlockSize/2;
+
+  /* A block only partly filled by a tone, at its start or end, can still pass
+     all the frequency tests, so would let a 20ms burst straddling a block
+     boundary count as two blocks. Requiring the energy to be even across the
+     block means only blocks entirely within the tone count, and 40ms always
+     contains two of those. */
+  float minEnergy = std::min(channel.m_energy[0], std::min(channel.m_energy[1], channel.m_energy[2]));
+  float maxEnergy = std::max(channel.m_energy[0], std::max(channel.m_energy[1], channel.m_energy[2]));
+
+  // DTMF
+  PINDEX row = 0, col = 4;
+  for (PINDEX i = 1; i < 4; ++i) {
+    if (power[i] > power[row])
+      row = i;
+    if (power[i+4] > power[col])
+      col = i+4;
+  }
+
+  char digit = '\0';
+  if (power[row] >= MinimumPower && power[col] >= MinimumPower &&
+      power[col] <= power[row]*NormalTwist &&
+      power[row] <= power[col]*ReverseTwist &&
+      power[row] + power[col] >= totalPower*DigitToTotalEnergy &&
+      minEnergy >= maxEnergy*BlockStationarity) {
+    digit = DigitTable[row][col-4];
+    for (PINDEX i = 0; i < 4; ++i) {
+      if ((i != row && power[i]*RelativePeak > power[row]) ||
+          (i+4 != col && power[i+4]*RelativePeak > power[col])) {
+        digit = '\0';
+        break;
+      }
+    }
+  }
+
+  if (digit != '\0') {
+    channel.m_digitGapBlocks = 0;
+    if (digit == channel.m_digit)
+      ++channel.m_digitBlocks;
+    else {
+      channel.m_digit = digit;
+      channel.m_digitBlocks = 1;
+      channel.m_digitReported = false;
+    }
+
+    if (!channel.m_digitReported && channel.m_digitBlocks >= DigitBlocks) {
+      channel.m_digitReported = true;
+      PTRACE(4, "Detected DTMF '" << digit << '\'');
+      channel.OnTone(digit, BLOCKS_TO_MS(channel.m_digitBlocks));
+    }
+  }
+  else if (channel.m_digit != '\0' && ++channel.m_digitGapBlocks >= DigitGapBlocks) {
+    channel.m_digit = '\0';
+    channel.m_digitBlocks = 0;
+    channel.m_digitReported = false;
+  }
+
+  // Fax tones
+  char faxTone = '\0';
+  if (digit == '\0') {
+    if (power[CNGLane] >= MinimumPower && power[CNGLane] >= totalPower*FaxToTotalEnergy)
+      faxTone = 'X';
+    else if (power[CEDLane] >= MinimumPower && power[CEDLane] >= totalPower*FaxToTotalEnergy)
+      faxTone = 'Y';
+  }
+
+  if (faxTone == '\0' || faxTone != channel.m_faxTone) {
+    channel.m_faxTone = faxTone;
+    channel.m_faxBlocks = faxTone != '\0' ? 1 : 0;
+    channel.m_faxReported = false;
+  }
+  else if (!channel.m_faxReported && BLOCKS_TO_MS(++channel.m_faxBlocks) >= FaxToneMS) {
+    channel.m_faxReported = true;
+    PTRACE(4, "Detected fax tone " << (faxTone == 'X' ? "CNG" : "CED"));
+    channel.OnTone(faxTone, BLOCKS_TO_MS(channel.m_faxBlocks));
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
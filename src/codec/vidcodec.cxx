@@ -184,6 +184,21 @@ PBoolean OpalVideoTranscoder::ExecuteCommand(const OpalMediaCommand & command)
 }
 
 
+bool OpalVideoTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  m_frozenTillIFrame = false;
+  m_lastFrameWasIFrame = false;
+  m_frameDropBits = 0;
+  m_lastTimestamp = UINT_MAX;
+  m_framesDropped = 0;
+  m_encodingIntraFrameControl.Reset();
+  m_decodingIntraFrameControl.Reset();
+  return OpalTranscoder::Reset();
+}
+
+
 bool OpalVideoTranscoder::HandleIFrameRequest()
 {
   if (outputMediaFormat == OpalYUV420P)
@@ -324,6 +339,17 @@ void OpalIntraFrameControl::SetTimes(const PTimeInterval & minThrottle,
 }
 
 
+void OpalIntraFrameControl::Reset()
+{
+  PWaitAndSignal mutex(m_mutex);
+  m_requestTimer.Stop(false);
+  m_currentThrottleTime = m_minThrottleTime;
+  m_state = e_Idle;
+  m_stuckCount = 0;
+  m_lastRequest = 0;
+}
+
+
 void OpalIntraFrameControl::IntraFrameRequest()
 {
   {
@@ -38,6 +38,14 @@
 #include <rtp/jitter.h>
 #include <ptlib/vconvert.h>
 #include <ptclib/pwavfile.h>
+
+#if OPAL_VIDEO
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+#endif
 #include <sip/handlers.h>
 #include <sip/sipcon.h>
 
@@ -528,6 +536,125 @@ const short * OpalAudioMixer::AudioStream::GetAudioDataPtr()
 
 #if OPAL_VIDEO
 
+/* Bilinear scaling of a single YUV420P plane. The vertical pass blends the
+   two contributing source rows across the whole row, which is where nearly
+   all the memory traffic is, so that is done with SIMD when available. The
+   horizontal pass then samples that row using precomputed index/weight
+   tables. Weights are 8 bit fixed point so intermediates fit in 16 bits.
+ */
+static void BlendRows(const BYTE * row0, const BYTE * row1, unsigned weight, BYTE * out, unsigned width)
+{
+  unsigned x = 0;
+
+#if defined(__AVX2__)
+  const __m256i w0 = _mm256_set1_epi16((short)(256 - weight));
+  const __m256i w1 = _mm256_set1_epi16((short)weight);
+  const __m256i round = _mm256_set1_epi16(128);
+  const __m256i zero = _mm256_setzero_si256();
+  for (; x + 32 <= width; x += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + x));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + x));
+    __m256i lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), w0),
+                                                   _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), w1)), round);
+    __m256i hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), w0),
+                                                   _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), w1)), round);
+    // Unpack/pack both operate within 128 bit lanes, so byte order is preserved
+    _mm256_storeu_si256((__m256i *)(out + x), _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8)));
+  }
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  const __m128i v0 = _mm_set1_epi16((short)(256 - weight));
+  const __m128i v1 = _mm_set1_epi16((short)weight);
+  const __m128i vround = _mm_set1_epi16(128);
+  const __m128i vzero = _mm_setzero_si128();
+  for (; x + 16 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(row0 + x));
+    __m128i b = _mm_loadu_si128((const __m128i *)(row1 + x));
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, vzero), v0),
+                                             _mm_mullo_epi16(_mm_unpacklo_epi8(b, vzero), v1)), vround);
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, vzero), v0),
+                                             _mm_mullo_epi16(_mm_unpackhi_epi8(b, vzero), v1)), vround);
+    _mm_storeu_si128((__m128i *)(out + x), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+  }
+#endif
+
+  for (; x < width; ++x)
+    out[x] = (BYTE)((row0[x]*(256 - weight) + row1[x]*weight + 128) >> 8);
+}
+
+
+static void ScalePlane(const BYTE * src, unsigned srcWidth, unsigned srcHeight,
+                       BYTE * dst, unsigned dstStride, unsigned dstWidth, unsigned dstHeight)
+{
+  if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0)
+    return;
+
+  if (srcWidth == dstWidth && srcHeight == dstHeight) {
+    for (unsigned y = 0; y < dstHeight; ++y)
+      memcpy(dst + y*dstStride, src + y*srcWidth, dstWidth);
+    return;
+  }
+
+  // Positions are 16.16 fixed point, sampling at pixel centres
+  std::vector<unsigned> xIndex(dstWidth);
+  std::vector<unsigned> xWeight(dstWidth);
+  unsigned step = (srcWidth << 16) / dstWidth;
+  int pos = (int)(step/2) - 0x8000;
+  for (unsigned x = 0; x < dstWidth; ++x, pos += step) {
+    int p = std::max(pos, 0);
+    xIndex[x] = std::min((unsigned)p >> 16, srcWidth - 1);
+    xWeight[x] = xIndex[x] < srcWidth - 1 ? ((p >> 8) & 0xff) : 0;
+  }
+
+  // Extra byte so xIndex+1 is always valid, its weight is zero at the edge
+  std::vector<BYTE> rowBuffer(srcWidth + 1);
+  BYTE * row = &rowBuffer[0];
+
+  step = (srcHeight << 16) / dstHeight;
+  pos = (int)(step/2) - 0x8000;
+  for (unsigned y = 0; y < dstHeight; ++y, pos += step) {
+    int p = std::max(pos, 0);
+    unsigned index = std::min((unsigned)p >> 16, srcHeight - 1);
+    unsigned weight = index < srcHeight - 1 ? ((p >> 8) & 0xff) : 0;
+
+    const BYTE * row0 = src + index*srcWidth;
+    if (weight == 0)
+      memcpy(row, row0, srcWidth);
+    else
+      BlendRows(row0, row0 + srcWidth, weight, row, srcWidth);
+    row[srcWidth] = row[srcWidth - 1];
+
+    BYTE * out = dst + y*dstStride;
+    for (unsigned x = 0; x < dstWidth; ++x) {
+      const BYTE * pixel = row + xIndex[x];
+      unsigned w = xWeight[x];
+      out[x] = (BYTE)((pixel[0]*(256 - w) + pixel[1]*w + 128) >> 8);
+    }
+  }
+}
+
+
+static void ScaleYUV420P(unsigned srcWidth, unsigned srcHeight, const BYTE * src,
+                         unsigned dstX, unsigned dstY, unsigned dstWidth, unsigned dstHeight,
+                         unsigned frameWidth, unsigned frameHeight, BYTE * frame)
+{
+  const BYTE * srcU = src + srcWidth*srcHeight;
+  const BYTE * srcV = srcU + (srcWidth/2)*(srcHeight/2);
+  BYTE * frameU = frame + frameWidth*frameHeight;
+  BYTE * frameV = frameU + (frameWidth/2)*(frameHeight/2);
+
+  ScalePlane(src, srcWidth, srcHeight,
+             frame + dstY*frameWidth + dstX, frameWidth, dstWidth, dstHeight);
+
+  unsigned chromaOffset = (dstY/2)*(frameWidth/2) + dstX/2;
+  ScalePlane(srcU, srcWidth/2, srcHeight/2,
+             frameU + chromaOffset, frameWidth/2, dstWidth/2, dstHeight/2);
+  ScalePlane(srcV, srcWidth/2, srcHeight/2,
+             frameV + chromaOffset, frameWidth/2, dstWidth/2, dstHeight/2);
+}
+
+
 OpalVideoMixer::OpalVideoMixer(Styles style, unsigned width, unsigned height, unsigned rate, bool pushThread)
   : OpalBaseMixer(pushThread, 1000/rate, OpalMediaFormat::VideoClockRate/rate)
   , m_style(style)
@@ -535,11 +662,52 @@ OpalVideoMixer::OpalVideoMixer(Styles style, unsigned width, unsigned height, un
   , m_bgFillGreen(0)
   , m_bgFillBlue(0)
   , m_lastStreamCount(0)
+  , m_redrawAll(true)
+  , m_nextTile(0)
+  , m_composeStart(0, INT_MAX)
+  , m_composeDone(0, INT_MAX)
+  , m_composeRunning(false)
+  , m_pixelWindowCount(0)
+  , m_decodedPixelRate(0)
 {
   SetFrameSize(width, height);
 }
 
 
+OpalVideoMixer::~OpalVideoMixer()
+{
+  StopPushThread();
+  SetComposeThreads(0);
+}
+
+
+void OpalVideoMixer::SetComposeThreads(unsigned count)
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  if (count == m_composeThreads.size())
+    return;
+
+  if (!m_composeThreads.empty()) {
+    m_composeRunning = false;
+    for (size_t i = 0; i < m_composeThreads.size(); ++i)
+      m_composeStart.Signal();
+    for (size_t i = 0; i < m_composeThreads.size(); ++i)
+      PThread::WaitAndDelete(m_composeThreads[i]);
+    m_composeThreads.clear();
+  }
+
+  m_composeRunning = true;
+  for (unsigned i = 0; i < count; ++i)
+    m_composeThreads.push_back(new PThreadObj<OpalVideoMixer>(*this,
+                                                              &OpalVideoMixer::ComposeThreadMain,
+                                                              false,
+                                                              "VidCompose",
+                                                              PThread::HighestPriority));
+  PTRACE(4, "Using " << count << " additional compositing threads");
+}
+
+
 bool OpalVideoMixer::SetFrameRate(unsigned rate)
 {
   if (rate == 0 || rate > 100)
@@ -564,6 +732,7 @@ bool OpalVideoMixer::SetFrameSize(unsigned width, unsigned height)
   PColourConverter::FillYUV420P(0, 0, m_width, m_height, m_width, m_height,
                                 m_frameStore.GetPointer(PVideoFrameInfo::CalculateFrameBytes(m_width, m_height)),
                                 m_bgFillRed, m_bgFillGreen, m_bgFillBlue);
+  m_redrawAll = true;
 
   m_mutex.Signal();
   return true;
@@ -578,7 +747,9 @@ OpalBaseMixer::Stream * OpalVideoMixer::CreateStream()
 
 bool OpalVideoMixer::MixStreams(RTP_DataFrame & frame)
 {
-  if (!MixVideo())
+  bool mixed = MixVideo();
+  ComposeTiles();
+  if (!mixed)
     return false;
 
   frame.SetPayloadSize(GetOutputSize());
@@ -609,6 +780,7 @@ bool OpalVideoMixer::MixVideo()
       break;
   }
 
+  m_redrawAll = false;
   return true;
 }
 
@@ -652,6 +824,7 @@ bool OpalVideoMixer::StartMix(unsigned & x, unsigned & y, unsigned & w, unsigned
                                       m_frameStore.GetPointer(),
                                       m_bgFillRed, m_bgFillGreen, m_bgFillBlue);
         m_lastStreamCount = m_inputStreams.size();
+        m_redrawAll = true;
       }
       switch (m_lastStreamCount) {
         case 0:
@@ -709,8 +882,89 @@ bool OpalVideoMixer::NextMix(unsigned & x, unsigned & y, unsigned & w, unsigned
 void OpalVideoMixer::InsertVideoFrame(const StreamMap_T::iterator & it, unsigned x, unsigned y, unsigned w, unsigned h)
 {
   VideoStream * vid = dynamic_cast<VideoStream *>(it->second);
-  if (vid != NULL)
-    vid->InsertVideoFrame(x, y, w, h);
+  if (vid == NULL)
+    return;
+
+  if (vid->m_tileWidth != w || vid->m_tileHeight != h) {
+    vid->m_tileWidth = w;
+    vid->m_tileHeight = h;
+    OnInputTileSize(it->first, w, h);
+  }
+
+  if (!vid->UpdateVideoFrame(x, y, w, h, m_redrawAll))
+    return;
+
+  Tile tile;
+  tile.m_stream = vid;
+  tile.m_x = x;
+  tile.m_y = y;
+  tile.m_width = w;
+  tile.m_height = h;
+  m_dirtyTiles.push_back(tile);
+}
+
+
+void OpalVideoMixer::ComposeTiles()
+{
+  if (m_dirtyTiles.empty())
+    return;
+
+  // Make sure frame store is unique before any thread writes to it
+  m_frameStore.GetPointer();
+
+  m_nextTile = 0;
+
+  /* Tiles never overlap, so each may be scaled into the frame store
+     independently. Only wake helpers if there is more than one tile. */
+  size_t helpers = std::min(m_composeThreads.size(), m_dirtyTiles.size() - 1);
+  for (size_t i = 0; i < helpers; ++i)
+    m_composeStart.Signal();
+
+  size_t index;
+  while ((index = m_nextTile++) < m_dirtyTiles.size()) {
+    const Tile & tile = m_dirtyTiles[index];
+    tile.m_stream->InsertVideoFrame(tile.m_x, tile.m_y, tile.m_width, tile.m_height);
+  }
+
+  for (size_t i = 0; i < helpers; ++i)
+    m_composeDone.Wait();
+
+  m_dirtyTiles.clear();
+}
+
+
+void OpalVideoMixer::ComposeThreadMain()
+{
+  PTRACE(4, "Compose thread start");
+
+  for (;;) {
+    m_composeStart.Wait();
+    if (!m_composeRunning)
+      break;
+
+    size_t index;
+    while ((index = m_nextTile++) < m_dirtyTiles.size()) {
+      const Tile & tile = m_dirtyTiles[index];
+      tile.m_stream->InsertVideoFrame(tile.m_x, tile.m_y, tile.m_width, tile.m_height);
+    }
+
+    m_composeDone.Signal();
+  }
+
+  PTRACE(4, "Compose thread end");
+}
+
+
+void OpalVideoMixer::OnInputTileSize(const Key_T & PTRACE_PARAM(key), unsigned PTRACE_PARAM(width), unsigned PTRACE_PARAM(height))
+{
+  PTRACE(4, "Input " << key << " tile size now " << width << 'x' << height);
+}
+
+
+uint64_t OpalVideoMixer::GetDecodedPixelRate() const
+{
+  PWaitAndSignal mutex(m_mutex);
+  return m_decodedPixelRate;
 }
 
 
@@ -722,38 +976,81 @@ size_t OpalVideoMixer::GetOutputSize() const
 
 OpalVideoMixer::VideoStream::VideoStream(OpalVideoMixer & mixer)
   : m_mixer(mixer)
+  , m_lastX(0)
+  , m_lastY(0)
+  , m_lastWidth(0)
+  , m_lastHeight(0)
+  , m_tileWidth(0)
+  , m_tileHeight(0)
 {
 }
 
 
 void OpalVideoMixer::VideoStream::QueuePacket(const RTP_DataFrame & rtp)
 {
+  // Already locked by WriteStream()
+  if (rtp.GetPayloadSize() >= (PINDEX)sizeof(PluginCodec_Video_FrameHeader)) {
+    const PluginCodec_Video_FrameHeader * header = (const PluginCodec_Video_FrameHeader *)rtp.GetPayloadPtr();
+    m_mixer.m_pixelWindowCount += header->width*header->height;
+
+    PTime now;
+    PTimeInterval elapsed = now - m_mixer.m_pixelWindowStart;
+    if (elapsed >= 1000) {
+      m_mixer.m_decodedPixelRate = elapsed < 2000 ? m_mixer.m_pixelWindowCount*1000/elapsed.GetMilliSeconds() : 0;
+      m_mixer.m_pixelWindowStart = now;
+      m_mixer.m_pixelWindowCount = 0;
+      PTRACE(5, "Decoded pixel rate " << m_mixer.m_decodedPixelRate << " pixels/second");
+    }
+  }
+
   m_queue.push(rtp);
 }
 
 
-void OpalVideoMixer::VideoStream::InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h)
+bool OpalVideoMixer::VideoStream::UpdateVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h, bool redraw)
 {
-  if (m_queue.empty())
-    return;
+  bool changed = redraw || x != m_lastX || y != m_lastY || w != m_lastWidth || h != m_lastHeight;
+
+  if (!m_queue.empty()) {
+    m_lastFrame = m_queue.front();
+    changed = true;
+
+    /* To avoid continual build up of frames in queue if input frame rate
+       greater than mixer frame, we flush the queue, but keep one to allow for
+       slight mismatches in timing when frame rates are identical. */
+    do {
+      m_queue.pop();
+    } while (m_queue.size() > 1);
+  }
+
+  // Nothing received yet, or input unchanged and tile still in place
+  if (m_lastFrame.GetPayloadSize() < (PINDEX)sizeof(PluginCodec_Video_FrameHeader) || !changed)
+    return false;
+
+  m_lastX = x;
+  m_lastY = y;
+  m_lastWidth = w;
+  m_lastHeight = h;
+  return true;
+}
 
-  PluginCodec_Video_FrameHeader * header = (PluginCodec_Video_FrameHeader *)m_queue.front().GetPayloadPtr();
+
+void OpalVideoMixer::VideoStream::InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  const PluginCodec_Video_FrameHeader * header = (const PluginCodec_Video_FrameHeader *)m_lastFrame.GetPayloadPtr();
 
   PTRACE(DETAIL_LOG_LEVEL, "Copying video: " << header->width << 'x' << header->height
          << " -> " << x << ',' << y << '/' << w << 'x' << h);
 
-  PColourConverter::CopyYUV420P(0, 0, header->width, header->height,
-                                header->width, header->height, OpalVideoFrameDataPtr(header),
-                                x, y, w, h,
-                                m_mixer.m_width, m_mixer.m_height, m_mixer.m_frameStore.GetPointer(),
-                                PVideoFrameInfo::eScale);
+  if (m_lastFrame.GetPayloadSize() < (PINDEX)(sizeof(PluginCodec_Video_FrameHeader) +
+                                     PVideoFrameInfo::CalculateFrameBytes(header->width, header->height))) {
+    PTRACE(2, "Video frame too small for " << header->width << 'x' << header->height);
+    return;
+  }
 
-  /* To avoid continual build up of frames in queue if input frame rate
-     greater than mixer frame, we flush the queue, but keep one to allow for
-     slight mismatches in timing when frame rates are identical. */
-  do {
-    m_queue.pop();
-  } while (m_queue.size() > 1);
+  ScaleYUV420P(header->width, header->height, OpalVideoFrameDataPtr(header),
+               x, y, w, h,
+               m_mixer.m_width, m_mixer.m_height, m_mixer.m_frameStore.GetPointer());
 }
 
 
@@ -1037,7 +1334,7 @@ void OpalMixerConnection::OnReleased()
 
 OpalMediaFormatList OpalMixerConnection::GetMediaFormats() const
 {
-  OpalMediaFormatList list = OpalTranscoder::GetPossibleFormats(OpalPCM16);
+  OpalMediaFormatList list = OpalTranscoder::GetPossibleFormats(GetOpalPCM16(m_node->GetNodeInfo().m_sampleRate));
   list += OpalRFC2833;
 #if OPAL_T38_CAPABILITY
   list += OpalCiscoNSE;
@@ -1134,6 +1431,7 @@ OpalMixerMediaStream::OpalMixerMediaStream(OpalConnection & conn,
 #if OPAL_VIDEO
   , m_mixedVideoWidth(0)
   , m_mixedVideoHeight(0)
+  , m_speechDetector(NULL)
 #endif
 {
   /* We are a bit sneaky here. OpalCall::OpenSourceMediaStream will have
@@ -1145,11 +1443,23 @@ OpalMixerMediaStream::OpalMixerMediaStream(OpalConnection & conn,
      connections. */
   if (IsSink()) {
 #if OPAL_VIDEO
-    if (m_mediaFormat.GetMediaType() == OpalMediaType::Video())
-      m_mediaFormat = OpalYUV420P;
-    else
+    if (m_mediaFormat.GetMediaType() == OpalMediaType::Video()) {
+      // When forwarding, video is passed through encoded
+      if (!node->GetNodeInfo().m_videoForwarding)
+        m_mediaFormat = OpalYUV420P;
+    }
+    else {
+      m_mediaFormat = GetOpalPCM16(node->GetNodeInfo().m_sampleRate);
+
+      // Speech, rather than just loudness, decides the active speaker for forwarded video
+      if (node->GetNodeInfo().m_videoForwarding) {
+        m_speechDetector = new OpalPCM16SilenceDetector(OpalSilenceDetector::Params(OpalSilenceDetector::SpectralSilenceDetection));
+        m_speechDetector->SetClockRate(m_mediaFormat.GetClockRate());
+      }
+    }
+#else
+    m_mediaFormat = GetOpalPCM16(node->GetNodeInfo().m_sampleRate);
 #endif
-      m_mediaFormat = OpalPCM16;
   }
 }
 
@@ -1157,6 +1467,9 @@ OpalMixerMediaStream::OpalMixerMediaStream(OpalConnection & conn,
 OpalMixerMediaStream::~OpalMixerMediaStream()
 {
   Close();
+#if OPAL_VIDEO
+  delete m_speechDetector;
+#endif
 }
 
 
@@ -1224,6 +1537,15 @@ bool OpalMixerMediaStream::InternalSetJitterBuffer(const OpalJitterBuffer::Init
 }
 
 
+bool OpalMixerMediaStream::InternalExecuteCommand(const OpalMediaCommand & command)
+{
+  if (IsSource() && m_node->OnOutputCommand(*this, command))
+    return true;
+
+  return OpalMediaStream::InternalExecuteCommand(command);
+}
+
+
 #if OPAL_VIDEO
 bool OpalMixerMediaStream::CheckMixedVideoSize(unsigned width, unsigned height)
 {
@@ -1288,6 +1610,9 @@ void OpalMixerNode::ShutDown()
     for (VideoMixerMap::iterator it = m_videoMixers.begin(); it != m_videoMixers.end(); ++it)
       delete it->second;
     m_videoMixers.clear();
+    for (VideoForwarderMap::iterator it = m_videoForwarders.begin(); it != m_videoForwarders.end(); ++it)
+      delete it->second;
+    m_videoForwarders.clear();
 #endif
     m_manager.RemoveNodeNames(GetNames());
     m_names.RemoveAll();
@@ -1391,6 +1716,26 @@ bool OpalMixerNode::AttachStream(OpalMixerMediaStream * stream)
          << " stream with id " << id << " to " << *this);
 
 #if OPAL_VIDEO
+  if (stream->GetMediaFormat().GetMediaType() == OpalMediaType::Video() && m_info->m_videoForwarding) {
+    OpalVideoFormat::ContentRole role = stream->GetMediaFormat().GetOptionEnum(OpalVideoFormat::ContentRoleOption(), OpalVideoFormat::eNoRole);
+    OpalVideoStreamForwarder * forwarder;
+    VideoForwarderMap::iterator it = m_videoForwarders.find(role);
+    if (it != m_videoForwarders.end())
+      forwarder = it->second;
+    else {
+      forwarder = m_manager.CreateVideoForwarder(*m_info);
+      m_videoForwarders[role] = forwarder;
+    }
+
+    m_mixerById[id] = forwarder;
+
+    if (stream->IsSink())
+      return forwarder->AddInput(*stream);
+
+    forwarder->AddOutput(*stream);
+    return true;
+  }
+
   if (stream->GetMediaFormat().GetMediaType() == OpalMediaType::Video()) {
     OpalVideoFormat::ContentRole role = stream->GetMediaFormat().GetOptionEnum(OpalVideoFormat::ContentRoleOption(), OpalVideoFormat::eNoRole);
     OpalVideoStreamMixer * videoMixer;
@@ -1405,7 +1750,7 @@ bool OpalMixerNode::AttachStream(OpalMixerMediaStream * stream)
     m_mixerById[id] = videoMixer;
 
     if (stream->IsSink())
-      return videoMixer->AddStream(id);
+      return videoMixer->AddInput(*stream);
 
     videoMixer->Append(stream);
     return true;
@@ -1431,6 +1776,17 @@ void OpalMixerNode::DetachStream(OpalMixerMediaStream * stream)
          << " stream with id " << id << " from " << *this);
 
 #if OPAL_VIDEO
+  if (stream->GetMediaFormat().GetMediaType() == OpalMediaType::Video() && m_info->m_videoForwarding) {
+    VideoForwarderMap::iterator it = m_videoForwarders.find(stream->GetMediaFormat().GetOptionEnum(OpalVideoFormat::ContentRoleOption(), OpalVideoFormat::eNoRole));
+    if (it == m_videoForwarders.end())
+      return;
+    if (stream->IsSource())
+      it->second->RemoveOutput(*stream);
+    else
+      it->second->RemoveStream(stream->GetID());
+    return;
+  }
+
   if (stream->GetMediaFormat().GetMediaType() == OpalMediaType::Video()) {
     VideoMixerMap::iterator it = m_videoMixers.find(stream->GetMediaFormat().GetOptionEnum(OpalVideoFormat::ContentRoleOption(), OpalVideoFormat::eNoRole));
     if (it == m_videoMixers.end())
@@ -1494,7 +1850,55 @@ bool OpalMixerNode::WritePacket(const OpalMixerMediaStream & stream, const RTP_D
 {
   PString id = stream.GetID();
   MixerByIdMap::iterator it = m_mixerById.find(id);
-  return it == m_mixerById.end() || it->second->WriteStream(id, input);
+  if (it == m_mixerById.end())
+    return true;
+
+#if OPAL_VIDEO
+  /* Audio level of each participant drives the choice of forwarded video.
+     Silence suppressed packets, and background noise that is not speech,
+     count as zero so a noisy line does not hold on to the active speaker. */
+  if (it->second == m_audioMixer && !m_videoForwarders.empty()) {
+    unsigned level = 0;
+    PINDEX count = input.GetPayloadSize()/sizeof(short);
+    if (count > 0) {
+      OpalSilenceDetector * speechDetector = stream.GetSpeechDetector();
+      if (speechDetector == NULL ||
+          speechDetector->Detect(input.GetPayloadPtr(), input.GetPayloadSize(), input.GetTimestamp()) != OpalSilenceDetector::IsSilent)
+        level = OpalPCM16SilenceDetector::CalculateAverageLevel((const short *)input.GetPayloadPtr(), count);
+    }
+    for (VideoForwarderMap::iterator fwd = m_videoForwarders.begin(); fwd != m_videoForwarders.end(); ++fwd)
+      fwd->second->SetAudioLevel(stream.GetConnection().GetToken(), level);
+  }
+#endif
+
+  return it->second->WriteStream(id, input);
+}
+
+
+#if OPAL_VIDEO
+uint64_t OpalMixerNode::GetDecodedPixelRate() const
+{
+  uint64_t rate = 0;
+  for (VideoMixerMap::const_iterator it = m_videoMixers.begin(); it != m_videoMixers.end(); ++it)
+    rate += it->second->GetDecodedPixelRate();
+  return rate;
+}
+#endif
+
+
+bool OpalMixerNode::OnOutputCommand(OpalMixerMediaStream & stream, const OpalMediaCommand & command)
+{
+  MixerByIdMap::iterator it = m_mixerById.find(stream.GetID());
+  if (it == m_mixerById.end())
+    return false;
+
+#if OPAL_VIDEO
+  OpalVideoStreamForwarder * forwarder = dynamic_cast<OpalVideoStreamForwarder *>(it->second);
+  if (forwarder != NULL)
+    return forwarder->OnOutputCommand(stream, command);
+#endif
+
+  return false;
 }
 
 
@@ -1743,6 +2147,13 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
       MIXER_DEBUG_OUT(",,,");
       return;
 
+    case CachedAudio::Encoding :
+      // Another listener has already queued this for encoding, push it after that
+      m_mutex.Signal();
+      MIXER_DEBUG_OUT(",,,");
+      m_pendingPushes.push_back(PendingPush(stream, cache));
+      return;
+
     case CachedAudio::Completed :
       m_mutex.Signal();
       MIXER_DEBUG_OUT(cache.m_encoded.GetPayloadType() << ','
@@ -1756,8 +2167,9 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
       return;
   }
 
+  OpalMediaFormat rawFormat = GetOpalPCM16(m_sampleRate);
   OpalMediaFormat mediaFormat = stream->GetMediaFormat();
-  if (mediaFormat == OpalPCM16) {
+  if (mediaFormat == rawFormat) {
     if (cache.m_raw.GetPayloadSize() < stream->GetDataSize()) {
       MIXER_DEBUG_OUT(','
                    << cache.m_raw.GetTimestamp() << ','
@@ -1778,7 +2190,16 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
   }
 
   if (cache.m_transcoder == NULL) {
-    cache.m_transcoder = OpalTranscoder::Create(OpalPCM16, mediaFormat);
+    cache.m_transcoder = OpalTranscoder::Create(rawFormat, mediaFormat);
+    if (cache.m_transcoder == NULL) {
+      // Encoder is at a different sample rate to the mixer, resample first
+      OpalMediaFormat intermediateFormat;
+      if (OpalTranscoder::FindIntermediateFormat(rawFormat, mediaFormat, intermediateFormat) && intermediateFormat.IsValid()) {
+        cache.m_resampler = OpalTranscoder::Create(rawFormat, intermediateFormat);
+        if (cache.m_resampler != NULL)
+          cache.m_transcoder = OpalTranscoder::Create(intermediateFormat, mediaFormat);
+      }
+    }
     if (cache.m_transcoder == NULL) {
       PTRACE(2, "Could not create transcoder to "
              << mediaFormat << " for stream id " << stream->GetID());
@@ -1788,32 +2209,89 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
     PTRACE(3, "Created transcoder to " << mediaFormat << " for stream id " << stream->GetID());
   }
 
-  if (cache.m_raw.GetPayloadSize() < cache.m_transcoder->GetOptimalDataFrameSize(true)) {
+  const RTP_DataFrame * raw = &cache.m_raw;
+  PINDEX rawSize = cache.m_transcoder->GetOptimalDataFrameSize(true);
+  if (cache.m_resampler != NULL) {
+    unsigned encoderRate = cache.m_transcoder->GetInputFormat().GetClockRate();
+    rawSize = (rawSize*m_sampleRate + encoderRate - 1)/encoderRate;
+  }
+
+  if (cache.m_raw.GetPayloadSize() < rawSize) {
     MIXER_DEBUG_OUT(','
                  << cache.m_raw.GetTimestamp() << ','
                  << cache.m_raw.GetPayloadSize() << ',');
     return;
   }
 
-  if (cache.m_encoded.SetPayloadSize(cache.m_transcoder->GetOptimalDataFrameSize(false)) &&
-      cache.m_transcoder->Convert(cache.m_raw, cache.m_encoded)) {
-    cache.m_encoded.SetPayloadType(cache.m_transcoder->GetPayloadType(false));
-    cache.m_encoded.SetTimestamp(cache.m_raw.GetTimestamp());
-    cache.m_state = CachedAudio::Completed;
-    MIXER_DEBUG_OUT(cache.m_encoded.GetPayloadType() << ','
+  if (cache.m_resampler != NULL) {
+    if (!cache.m_resampled.SetPayloadSize(cache.m_resampler->GetOptimalDataFrameSize(false)) ||
+        !cache.m_resampler->Convert(cache.m_raw, cache.m_resampled)) {
+      PTRACE(2, "Could not resample audio for " << mediaFormat << " on stream id " << stream->GetID());
+      CloseOne(stream);
+      return;
+    }
+    raw = &cache.m_resampled;
+  }
+
+  if (!cache.m_encoded.SetPayloadSize(cache.m_transcoder->GetOptimalDataFrameSize(false))) {
+    PTRACE(2, "Could not allocate encoded audio for " << mediaFormat << " on stream id " << stream->GetID());
+    CloseOne(stream);
+    return;
+  }
+
+  /* Encoding is deferred until all streams are collected, so those using
+     the same codec can be encoded with one call, see PushEncoded(). */
+  cache.m_state = CachedAudio::Encoding;
+  MIXER_DEBUG_WAV(stream->GetID(), cache.m_raw);
+  m_batchEntries.push_back(OpalTranscoder::BatchEntry(cache.m_transcoder, raw, &cache.m_encoded));
+  m_batchCaches.push_back(&cache);
+  m_pendingPushes.push_back(PendingPush(stream, cache));
+}
+
+
+void OpalAudioStreamMixer::PushEncoded()
+{
+  if (!m_batchEntries.empty()) {
+    OpalTranscoder::ConvertBatch(m_batchEntries);
+
+    for (size_t i = 0; i < m_batchEntries.size(); ++i) {
+      CachedAudio & cache = *m_batchCaches[i];
+      if (m_batchEntries[i].m_result) {
+        cache.m_encoded.SetPayloadType(cache.m_transcoder->GetPayloadType(false));
+        unsigned timestamp = cache.m_raw.GetTimestamp();
+        unsigned clockRate = cache.m_transcoder->GetOutputFormat().GetClockRate();
+        if (clockRate != m_sampleRate)
+          timestamp = (unsigned)((PUInt64)timestamp*clockRate/m_sampleRate);
+        cache.m_encoded.SetTimestamp(timestamp);
+        cache.m_state = CachedAudio::Completed;
+      }
+      else
+        cache.m_state = CachedAudio::Collected; // Will not be pushed, next OnPush starts again
+    }
+
+    m_batchEntries.clear();
+    m_batchCaches.clear();
+  }
+
+  // OpalMediaStream::PushPacket might block, so the pending streams are only referenced, not locked
+  for (std::vector<PendingPush>::iterator it = m_pendingPushes.begin(); it != m_pendingPushes.end(); ++it) {
+    CachedAudio & cache = *it->m_cache;
+    if (cache.m_state != CachedAudio::Completed) {
+      PTRACE(2, "Could not convert audio to " << it->m_stream->GetMediaFormat() << " for stream id " << it->m_stream->GetID());
+      CloseOne(it->m_stream);
+      continue;
+    }
+
+    MIXER_DEBUG_OUT(it->m_stream->GetID() << ','
+        << cache.m_encoded.GetPayloadType() << ','
         << cache.m_encoded.GetTimestamp() << ','
         << cache.m_encoded.GetPayloadSize() << ',');
-    MIXER_DEBUG_WAV(stream->GetID(), cache.m_raw);
-    stream.SetSafetyMode(PSafeReference); // OpalMediaStream::PushPacket might block
     PTRACE(6, "Pushing new packet: pt=" << cache.m_encoded.GetPayloadType()
             << " ts=" << cache.m_encoded.GetTimestamp() << " sz=" << cache.m_encoded.GetPayloadSize());
-    stream->PushPacket(cache.m_encoded);
-    stream.SetSafetyMode(PSafeReadOnly); // restore lock
-  }
-  else {
-    PTRACE(2, "Could not convert audio to " << mediaFormat << " for stream id " << stream->GetID());
-    CloseOne(stream);
+    it->m_stream->PushPacket(cache.m_encoded);
   }
+
+  m_pendingPushes.clear();
 }
 
 
@@ -1840,6 +2318,8 @@ bool OpalAudioStreamMixer::OnPush()
     }
   }
 
+  PushEncoded();
+
   for (std::map<PString, CachedAudio>::iterator iterCache = m_cache.begin(); iterCache != m_cache.end(); ++iterCache) {
     switch (iterCache->second.m_state) {
       case CachedAudio::Collected :
@@ -1868,6 +2348,7 @@ bool OpalAudioStreamMixer::OnPush()
 OpalAudioStreamMixer::CachedAudio::CachedAudio()
   : m_state(Collecting)
   , m_transcoder(NULL)
+  , m_resampler(NULL)
 {
 }
 
@@ -1875,6 +2356,7 @@ OpalAudioStreamMixer::CachedAudio::CachedAudio()
 OpalAudioStreamMixer::CachedAudio::~CachedAudio()
 {
   delete m_transcoder;
+  delete m_resampler;
 }
 
 
@@ -1893,6 +2375,67 @@ OpalVideoStreamMixer::~OpalVideoStreamMixer()
 }
 
 
+bool OpalVideoStreamMixer::AddInput(OpalMixerMediaStream & stream)
+{
+  PString id = stream.GetID();
+  if (!AddStream(id))
+    return false;
+
+  PWaitAndSignal mutex(m_mutex);
+  m_inputMediaStreams[id] = &stream;
+  return true;
+}
+
+
+void OpalVideoStreamMixer::RemoveStream(const Key_T & key)
+{
+  m_mutex.Wait();
+  m_inputMediaStreams.erase(key);
+  m_tileSizeRequests.erase(key);
+  m_mutex.Signal();
+
+  OpalVideoMixer::RemoveStream(key);
+}
+
+
+void OpalVideoStreamMixer::OnInputTileSize(const Key_T & key, unsigned width, unsigned height)
+{
+  // Already locked, and must not block mixing, so deferred to OnMixed()
+  TileSize & size = m_tileSizeRequests[key];
+  size.m_width = width;
+  size.m_height = height;
+}
+
+
+void OpalVideoStreamMixer::RequestInputSize(OpalMixerMediaStream & stream, unsigned width, unsigned height)
+{
+  OpalMediaPatchPtr patch = stream.GetPatch();
+  if (patch == NULL)
+    return;
+
+  OpalMediaFormat sourceFormat = patch->GetSource().GetMediaFormat();
+  OpalBandwidth maxBitRate = sourceFormat.GetMaxBandwidth();
+  uint64_t sourcePixels = sourceFormat.GetOptionInteger(OpalVideoFormat::FrameWidthOption())*
+                          sourceFormat.GetOptionInteger(OpalVideoFormat::FrameHeightOption());
+  if (maxBitRate == 0 || sourcePixels == 0)
+    return;
+
+  /* There is no generic way to ask a remote for a particular resolution,
+     but encoders pick a resolution to suit their bit rate, so ask for bits
+     in proportion to the pixels actually displayed. */
+  static const OpalBandwidth MinimumBitRate = 64000;
+  uint64_t bitRate = maxBitRate*(uint64_t)width*height/sourcePixels;
+  if (bitRate > maxBitRate)
+    bitRate = maxBitRate;
+  if (bitRate < MinimumBitRate)
+    bitRate = std::min(MinimumBitRate, maxBitRate);
+
+  PTRACE(4, "Requesting " << bitRate << "bps from input " << stream.GetID()
+         << " for " << width << 'x' << height << " tile");
+  stream.ExecuteCommand(OpalMediaFlowControl((OpalBandwidth::int_type)bitRate, OpalMediaType::Video(), stream.GetSessionID()));
+}
+
+
 bool OpalVideoStreamMixer::SetFrameRate(unsigned rate)
 {
   if (!OpalVideoMixer::SetFrameRate(rate))
@@ -1909,6 +2452,22 @@ bool OpalVideoStreamMixer::SetFrameRate(unsigned rate)
 
 bool OpalVideoStreamMixer::OnMixed(RTP_DataFrame * & output)
 {
+  // Tile size changes from the last mix, done outside the lock as commands go to remote
+  std::vector< std::pair<PSafePtr<OpalMixerMediaStream>, TileSize> > requests;
+  m_mutex.Wait();
+  for (TileSizeMap::iterator it = m_tileSizeRequests.begin(); it != m_tileSizeRequests.end(); ++it) {
+    InputMediaStreamMap::iterator stream = m_inputMediaStreams.find(it->first);
+    if (stream != m_inputMediaStreams.end())
+      requests.push_back(std::make_pair(stream->second, it->second));
+  }
+  m_tileSizeRequests.clear();
+  m_mutex.Signal();
+
+  for (size_t i = 0; i < requests.size(); ++i) {
+    if (requests[i].first != NULL)
+      RequestInputSize(*requests[i].first, requests[i].second.m_width, requests[i].second.m_height);
+  }
+
   typedef std::map<PString, RTP_DataFrameList> CachedPackets;
   CachedPackets cachedPackets;
   typedef std::map<unsigned, RTP_DataFrame> CachedFrameStore;
@@ -2015,6 +2574,510 @@ bool OpalVideoStreamMixer::OnMixed(RTP_DataFrame * & output)
 
   return true;
 }
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static const unsigned SpeakerThreshold = 300;     // Mean absolute PCM-16 value considered as speech
+static const PTimeInterval SpeakerHoldTime(2000); // Minimum time before changing active speaker
+static const PTimeInterval SelectionInterval(500);
+static const PTimeInterval LayerTimeout(2000);
+static const PTimeInterval KeyFrameRetryTime(1000); // Repeat request if no key frame from new input
+
+OpalVideoStreamForwarder::OpalVideoStreamForwarder(const OpalMixerNodeInfo & info)
+  : OpalBaseMixer(false, 1000/info.m_rate, OpalMediaFormat::VideoClockRate/info.m_rate)
+  , m_thumbnails(info.m_forwardedThumbnails)
+  , m_lastSpeakerChange(0)
+  , m_lastSelection(0)
+  , m_nextSequence(0)
+{
+}
+
+
+OpalVideoStreamForwarder::~OpalVideoStreamForwarder()
+{
+  RemoveAllStreams();
+}
+
+
+OpalBaseMixer::Stream * OpalVideoStreamForwarder::CreateStream()
+{
+  return new ForwardStream();
+}
+
+
+bool OpalVideoStreamForwarder::MixStreams(RTP_DataFrame &)
+{
+  return false; // Packets are forwarded as they arrive in WriteStream()
+}
+
+
+size_t OpalVideoStreamForwarder::GetOutputSize() const
+{
+  return 0;
+}
+
+
+bool OpalVideoStreamForwarder::AddInput(OpalMixerMediaStream & stream)
+{
+  PString id = stream.GetID();
+  if (!AddStream(id))
+    return false;
+
+  m_mutex.Wait();
+
+  ForwardStream * input = dynamic_cast<ForwardStream *>(m_inputStreams[id]);
+  if (input != NULL) {
+    input->m_stream = &stream;
+    input->m_token = stream.GetConnection().GetToken();
+    input->m_encoding = stream.GetMediaFormat().GetEncodingName();
+    m_inputByToken[input->m_token] = id;
+    PTRACE(4, "Added forwarding input " << stream.GetMediaFormat() << " for " << input->m_token << ", id " << id);
+  }
+
+  if (m_activeSpeaker.IsEmpty())
+    m_activeSpeaker = id;
+  UpdateSelection();
+
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+  return true;
+}
+
+
+void OpalVideoStreamForwarder::RemoveStream(const Key_T & key)
+{
+  m_mutex.Wait();
+
+  if (m_activeSpeaker == key)
+    m_activeSpeaker.MakeEmpty();
+
+  StreamMap_T::iterator itInput = m_inputStreams.find(key);
+  if (itInput != m_inputStreams.end()) {
+    InputByTokenMap::iterator itToken = m_inputByToken.find(static_cast<ForwardStream *>(itInput->second)->m_token);
+    if (itToken != m_inputByToken.end() && itToken->second == key)
+      m_inputByToken.erase(itToken);
+  }
+
+  for (OutputMap::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it) {
+    if (it->second.m_input == key)
+      it->second.m_input.MakeEmpty();
+    if (it->second.m_pendingInput == key)
+      it->second.m_pendingInput.MakeEmpty();
+  }
+
+  m_mutex.Signal();
+
+  OpalBaseMixer::RemoveStream(key);
+
+  m_mutex.Wait();
+  UpdateSelection();
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+}
+
+
+void OpalVideoStreamForwarder::AddOutput(OpalMixerMediaStream & stream)
+{
+  Append(&stream);
+
+  m_mutex.Wait();
+
+  Output & output = m_outputs[stream.GetID()];
+  output.m_stream = &stream;
+  output.m_token = stream.GetConnection().GetToken();
+  output.m_encoding = stream.GetMediaFormat().GetEncodingName();
+  output.m_sequence = m_nextSequence++;
+  output.m_bitRate = stream.GetMediaFormat().GetUsedBandwidth();
+  PTRACE(4, "Added forwarding output " << stream.GetMediaFormat() << " at " << output.m_bitRate
+         << " for " << output.m_token << ", id " << stream.GetID());
+
+  UpdateSelection();
+
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+}
+
+
+void OpalVideoStreamForwarder::RemoveOutput(OpalMixerMediaStream & stream)
+{
+  Remove(&stream);
+
+  m_mutex.Wait();
+  m_outputs.erase(stream.GetID());
+  UpdateSelection();
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+}
+
+
+bool OpalVideoStreamForwarder::WriteStream(const Key_T & key, const RTP_DataFrame & rtp)
+{
+  PacketList packets;
+
+  m_mutex.Wait();
+
+  StreamMap_T::iterator itInput = m_inputStreams.find(key);
+  if (itInput == m_inputStreams.end()) {
+    m_mutex.Signal();
+    return true; // Writing a stream not yet attached is non-fatal
+  }
+
+  ForwardStream & input = static_cast<ForwardStream &>(*itInput->second);
+
+  RTP_SyncSourceId ssrc = rtp.GetSyncSource();
+  bool newLayer = input.m_layers.find(ssrc) == input.m_layers.end();
+  PTRACE_IF(4, newLayer, "New layer SSRC=" << RTP_TRACE_SRC(ssrc) << " on input " << key);
+
+  Layer & layer = input.m_layers[ssrc];
+  bool frameStart = layer.m_frameStart;
+  layer.Update(rtp);
+
+  // Only look for a key frame when some output is waiting to switch to this layer
+  int keyFrame = -1;
+
+  for (OutputMap::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it) {
+    Output & output = it->second;
+
+    /* Switch to the new input/layer on a key frame, until then the old one
+       continues, so the receiver can always decode what it is sent. */
+    if (output.m_pendingInput == key && output.m_pendingLayer == ssrc) {
+      if (keyFrame < 0)
+        keyFrame = layer.IsKeyFrame(rtp, input.m_encoding, frameStart);
+      if (keyFrame > 0) {
+        PTRACE(4, "Forwarding input " << key << " SSRC=" << RTP_TRACE_SRC(ssrc)
+               << " to output " << it->first << " (was " << output.m_input << ')');
+        output.m_input = key;
+        output.m_layer = ssrc;
+        output.m_pendingInput.MakeEmpty();
+        output.m_pendingLayer = 0;
+        output.m_timestampOffset = output.m_started
+                    ? output.m_lastTimestamp + m_periodTS - rtp.GetTimestamp() : 0;
+      }
+    }
+
+    if (output.m_input != key || output.m_layer != ssrc || output.m_stream == NULL)
+      continue;
+
+    RTP_DataFrame packet((const BYTE *)rtp, rtp.GetPacketSize());
+    packet.SetPayloadType(output.m_stream->GetMediaFormat().GetPayloadType());
+    packet.SetTimestamp(rtp.GetTimestamp() + output.m_timestampOffset);
+    output.m_lastTimestamp = packet.GetTimestamp();
+    output.m_started = true;
+    packets.push_back(PacketList::value_type(output.m_stream, packet));
+  }
+
+  if (newLayer || m_lastSelection.GetElapsed() > SelectionInterval)
+    UpdateSelection();
+
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+
+  // Streams are only referenced, not locked, as OpalMediaStream::PushPacket might block
+  for (PacketList::iterator it = packets.begin(); it != packets.end(); ++it) {
+    if (!it->first->IsPaused())
+      it->first->PushPacket(it->second);
+  }
+
+  return true;
+}
+
+
+void OpalVideoStreamForwarder::SetAudioLevel(const PString & token, unsigned level)
+{
+  m_mutex.Wait();
+
+  InputByTokenMap::iterator itToken = m_inputByToken.find(token);
+  StreamMap_T::iterator itInput = itToken != m_inputByToken.end() ? m_inputStreams.find(itToken->second) : m_inputStreams.end();
+  if (itInput != m_inputStreams.end()) {
+    ForwardStream & input = static_cast<ForwardStream &>(*itInput->second);
+    input.m_audioLevel = (input.m_audioLevel*7 + level)/8;
+    if (input.m_audioLevel > SpeakerThreshold)
+      input.m_lastSpoke.SetCurrentTime();
+
+    /* Hysteresis, the new speaker must be clearly louder and the old one held
+       for a while. Each participant is compared against the active speaker
+       as its own audio arrives, so there is no scan of all participants. */
+    if (itInput->first != m_activeSpeaker &&
+        input.m_audioLevel > SpeakerThreshold &&
+        m_lastSpeakerChange.GetElapsed() > SpeakerHoldTime) {
+      StreamMap_T::iterator itActive = m_inputStreams.find(m_activeSpeaker);
+      unsigned activeLevel = itActive != m_inputStreams.end() ? static_cast<ForwardStream &>(*itActive->second).m_audioLevel : 0;
+      if (input.m_audioLevel > activeLevel*2) {
+        PTRACE(3, "Active speaker changed from " << m_activeSpeaker << " to " << itInput->first);
+        m_activeSpeaker = itInput->first;
+        m_lastSpeakerChange.SetCurrentTime();
+        UpdateSelection();
+      }
+    }
+  }
+
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+}
+
+
+OpalBaseMixer::Key_T OpalVideoStreamForwarder::GetActiveSpeaker() const
+{
+  PWaitAndSignal mutex(m_mutex);
+  return m_activeSpeaker;
+}
+
+
+bool OpalVideoStreamForwarder::OnOutputCommand(OpalMixerMediaStream & stream, const OpalMediaCommand & command)
+{
+  m_mutex.Wait();
+
+  bool handled = false;
+  OutputMap::iterator it = m_outputs.find(stream.GetID());
+  if (it != m_outputs.end()) {
+    Output & output = it->second;
+    if (dynamic_cast<const OpalVideoUpdatePicture *>(&command) != NULL) {
+      // Receiver needs a key frame, which only the forwarded sender can give
+      if (!output.m_pendingInput.IsEmpty())
+        RequestKeyFrame(output.m_pendingInput, output.m_pendingLayer);
+      else if (!output.m_input.IsEmpty())
+        RequestKeyFrame(output.m_input, output.m_layer);
+      handled = true;
+    }
+    else {
+      const OpalMediaFlowControl * flow = dynamic_cast<const OpalMediaFlowControl *>(&command);
+      if (flow != NULL) {
+        PTRACE(4, "Output " << it->first << " bandwidth changed from " << output.m_bitRate << " to " << flow->GetMaxBitRate());
+        output.m_bitRate = flow->GetMaxBitRate();
+        UpdateSelection();
+        handled = true;
+      }
+    }
+  }
+
+  m_mutex.Signal();
+
+  FlushKeyFrameRequests();
+  return handled;
+}
+
+
+void OpalVideoStreamForwarder::UpdateSelection()
+{
+  // Must already be locked
+
+  m_lastSelection.SetCurrentTime();
+
+  // Candidates are the active speaker, then the most recent speakers
+  typedef std::multimap<PTime, ForwardStream *, std::greater<PTime> > RecentMap;
+  RecentMap recent;
+  std::vector<ForwardStream *> candidates;
+  std::vector<Key_T> keys;
+  for (StreamMap_T::iterator it = m_inputStreams.begin(); it != m_inputStreams.end(); ++it) {
+    ForwardStream & input = dynamic_cast<ForwardStream &>(*it->second);
+
+    // Age out layers that have stopped, e.g. simulcast encoder paused
+    for (LayerMap::iterator layer = input.m_layers.begin(); layer != input.m_layers.end(); ) {
+      if (layer->second.m_lastPacket.GetElapsed() > LayerTimeout)
+        input.m_layers.erase(layer++);
+      else
+        ++layer;
+    }
+
+    if (it->first == m_activeSpeaker)
+      candidates.insert(candidates.begin(), &input);
+    else
+      recent.insert(RecentMap::value_type(input.m_lastSpoke, &input));
+  }
+  for (RecentMap::iterator it = recent.begin(); it != recent.end(); ++it)
+    candidates.push_back(it->second);
+
+  for (std::vector<ForwardStream *>::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+    for (StreamMap_T::iterator key = m_inputStreams.begin(); key != m_inputStreams.end(); ++key) {
+      if (key->second == *it) {
+        keys.push_back(key->first);
+        break;
+      }
+    }
+  }
+
+  for (OutputMap::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it) {
+    Output & output = it->second;
+
+    // Extra video streams to the same participant carry thumbnails
+    unsigned slot = 0;
+    for (OutputMap::iterator other = m_outputs.begin(); other != m_outputs.end(); ++other) {
+      if (other->second.m_token == output.m_token && other->second.m_sequence < output.m_sequence)
+        ++slot;
+    }
+
+    Key_T selectedInput;
+    RTP_SyncSourceId selectedLayer = 0;
+    if (slot <= m_thumbnails) {
+      unsigned index = 0;
+      for (size_t i = 0; i < candidates.size(); ++i) {
+        ForwardStream & input = *candidates[i];
+        if (input.m_token == output.m_token || input.m_encoding != output.m_encoding || input.m_layers.empty())
+          continue; // Not our own video, nor something we cannot send without transcoding
+        if (index++ == slot) {
+          selectedInput = keys[i];
+          selectedLayer = input.SelectLayer(output.m_bitRate, slot > 0);
+          break;
+        }
+      }
+    }
+
+    if (selectedInput == output.m_input && selectedLayer == output.m_layer) {
+      output.m_pendingInput.MakeEmpty();
+      output.m_pendingLayer = 0;
+      continue;
+    }
+
+    if (selectedInput == output.m_pendingInput && selectedLayer == output.m_pendingLayer) {
+      if (output.m_keyFrameRequested.GetElapsed() > KeyFrameRetryTime) {
+        PTRACE(4, "No key frame yet from input " << selectedInput << " for output " << it->first << ", requesting again");
+        output.m_keyFrameRequested.SetCurrentTime();
+        RequestKeyFrame(selectedInput, selectedLayer);
+      }
+      continue;
+    }
+
+    if (selectedInput.IsEmpty()) {
+      PTRACE(4, "No input to forward to output " << it->first);
+      output.m_input.MakeEmpty();
+      output.m_layer = 0;
+      output.m_pendingInput.MakeEmpty();
+      output.m_pendingLayer = 0;
+      continue;
+    }
+
+    PTRACE(4, "Switching output " << it->first << " to input " << selectedInput
+           << " SSRC=" << RTP_TRACE_SRC(selectedLayer) << ", slot " << slot);
+    output.m_pendingInput = selectedInput;
+    output.m_pendingLayer = selectedLayer;
+    output.m_keyFrameRequested.SetCurrentTime();
+    RequestKeyFrame(selectedInput, selectedLayer);
+  }
+}
+
+
+void OpalVideoStreamForwarder::RequestKeyFrame(const Key_T & key, RTP_SyncSourceId layer)
+{
+  // Must already be locked
+  StreamMap_T::iterator it = m_inputStreams.find(key);
+  if (it == m_inputStreams.end())
+    return;
+
+  ForwardStream & input = dynamic_cast<ForwardStream &>(*it->second);
+  if (input.m_stream == NULL)
+    return;
+
+  for (KeyFrameList::iterator req = m_keyFrameRequests.begin(); req != m_keyFrameRequests.end(); ++req) {
+    if (req->first == input.m_stream && req->second == layer)
+      return;
+  }
+
+  m_keyFrameRequests.push_back(KeyFrameList::value_type(input.m_stream, layer));
+}
+
+
+void OpalVideoStreamForwarder::FlushKeyFrameRequests()
+{
+  // Executed without the lock as command goes all the way back to remote
+  m_mutex.Wait();
+  KeyFrameList requests;
+  requests.swap(m_keyFrameRequests);
+  m_mutex.Signal();
+
+  for (KeyFrameList::iterator it = requests.begin(); it != requests.end(); ++it) {
+    PTRACE(4, "Requesting key frame from " << it->first->GetID() << " SSRC=" << RTP_TRACE_SRC(it->second));
+    it->first->ExecuteCommand(OpalVideoUpdatePicture(it->first->GetSessionID(), it->second));
+  }
+}
+
+
+OpalVideoStreamForwarder::Layer::Layer()
+  : m_windowStart(0)
+  , m_windowBytes(0)
+  , m_bitRate(0)
+  , m_frameStart(true)
+  , m_detectorChecked(false)
+{
+}
+
+
+void OpalVideoStreamForwarder::Layer::Update(const RTP_DataFrame & rtp)
+{
+  m_lastPacket.SetCurrentTime();
+  m_frameStart = rtp.GetMarker();
+
+  m_windowBytes += rtp.GetPacketSize();
+  PTimeInterval elapsed = m_lastPacket - m_windowStart;
+  if (elapsed >= 1000) {
+    if (m_windowStart.IsValid() && elapsed < 2000)
+      m_bitRate = (OpalBandwidth::int_type)(m_windowBytes*8000LL/elapsed.GetMilliSeconds());
+    m_windowStart = m_lastPacket;
+    m_windowBytes = 0;
+  }
+}
+
+
+bool OpalVideoStreamForwarder::Layer::IsKeyFrame(const RTP_DataFrame & rtp, const PString & encoding, bool frameStart)
+{
+  if (!m_detectorChecked) {
+    m_detectorChecked = true;
+    m_detector.reset(OpalVideoFormat::FrameDetectFactory::CreateInstance(encoding));
+    PTRACE_IF(3, m_detector.get() == NULL, "No key frame detector for " << encoding << ", switching on frame boundary");
+  }
+
+  if (m_detector.get() == NULL)
+    return frameStart;
+
+  return m_detector->GetFrameType(rtp.GetPayloadPtr(), rtp.GetPayloadSize()) == OpalVideoFormat::e_IntraFrame;
+}
+
+
+OpalVideoStreamForwarder::Output::Output()
+  : m_sequence(0)
+  , m_bitRate(0)
+  , m_layer(0)
+  , m_pendingLayer(0)
+  , m_started(false)
+  , m_lastTimestamp(0)
+  , m_timestampOffset(0)
+  , m_keyFrameRequested(0)
+{
+}
+
+
+OpalVideoStreamForwarder::ForwardStream::ForwardStream()
+  : m_audioLevel(0)
+  , m_lastSpoke(0)
+{
+}
+
+
+RTP_SyncSourceId OpalVideoStreamForwarder::ForwardStream::SelectLayer(OpalBandwidth bitRate, bool lowest) const
+{
+  RTP_SyncSourceId best = 0, smallest = 0;
+  OpalBandwidth bestRate = 0, smallestRate = 0;
+
+  for (LayerMap::const_iterator it = m_layers.begin(); it != m_layers.end(); ++it) {
+    OpalBandwidth rate = it->second.m_bitRate;
+    if (smallest == 0 || rate < smallestRate) {
+      smallest = it->first;
+      smallestRate = rate;
+    }
+    if ((bitRate == 0 || rate <= bitRate) && (best == 0 || rate > bestRate)) {
+      best = it->first;
+      bestRate = rate;
+    }
+  }
+
+  return lowest || best == 0 ? smallest : best;
+}
 #endif
 
 
@@ -2139,5 +3202,11 @@ OpalVideoStreamMixer * OpalMixerNodeManager::CreateVideoMixer(const OpalMixerNod
 {
   return new OpalVideoStreamMixer(info);
 }
+
+
+OpalVideoStreamForwarder * OpalMixerNodeManager::CreateVideoForwarder(const OpalMixerNodeInfo & info)
+{
+  return new OpalVideoStreamForwarder(info);
+}
 #endif
 #endif // OPAL_HAS_MIXER
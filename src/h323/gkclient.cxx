@@ -100,8 +100,13 @@ H323Gatekeeper::H323Gatekeeper(H323EndPoint & ep, H323Transport * trans)
   , m_forceRegister(false)
   , m_requiresDiscovery(false)
   , m_willRespondToIRR(false)
-  , m_monitorThread(NULL)
+  , m_discoveryDelayed(false)
+  , P_DISABLE_MSVC_WARNINGS(4355, m_registrationClient(*this, true))
+  , P_DISABLE_MSVC_WARNINGS(4355, m_infoRequestClient(*this, false))
   , m_monitorRunning(false)
+  , m_registrationQueued(false)
+  , m_infoRequestQueued(false)
+  , m_monitorWorkThread(NULL)
 {
   PTRACE_CONTEXT_ID_NEW();
   PInterfaceMonitor::GetInstance().AddNotifier(m_onHighPriorityInterfaceChange, 80);
@@ -250,11 +255,9 @@ bool H323Gatekeeper::StartGatekeeper(const H323TransportAddress & initialAddress
     return false;
   }
 
-  if (m_monitorThread == NULL) {
-    m_monitorRunning = true;
-    m_monitorThread = new PThreadObj<H323Gatekeeper>(*this, &H323Gatekeeper::Monitor, false, "GkMonitor");
-    PTRACE_CONTEXT_ID_TO(m_monitorThread);
-  }
+  m_monitorMutex.Wait();
+  m_monitorRunning = true;
+  m_monitorMutex.Signal();
 
   ReRegisterNow();
   return true;
@@ -289,13 +292,6 @@ bool H323Gatekeeper::DiscoverGatekeeper()
 {
   discoveryComplete = false;
 
-  PSimpleTimer delay(m_endpoint.InternalGetGatekeeperStartDelay());
-  while (delay.IsRunning()) {
-    if (!m_monitorRunning)
-      return false;
-    m_monitorTickle.Wait(delay.GetRemaining());
-  }
-
   for (;;) {
     H323RasPDU pdu;
     Request request(SetupGatekeeperRequest(pdu), pdu);
@@ -330,9 +326,35 @@ bool H323Gatekeeper::DiscoverGatekeeper()
 
 void H323Gatekeeper::StopChannel()
 {
+  m_monitorMutex.Wait();
   m_monitorRunning = false;
-  m_monitorTickle.Signal();
-  PThread::WaitAndDelete(m_monitorThread);
+  m_monitorMutex.Signal();
+
+  OpalKeepAliveScheduler & scheduler = m_endpoint.GetManager().GetKeepAliveScheduler();
+  scheduler.Remove(m_registrationClient);
+  scheduler.Remove(m_infoRequestClient);
+
+  m_monitorMutex.Wait();
+  if (m_monitorWorkThread == PThread::Current()) {
+    /* Stopped from within our own monitor work. Other work for this
+       gatekeeper is in the same pool group, so cannot run until this returns
+       and waiting for it would deadlock. Cancel it all, including the current
+       work, so none of it uses the gatekeeper after it is deleted. */
+    for (std::list<MonitorWork *>::iterator it = m_monitorWork.begin(); it != m_monitorWork.end(); ++it)
+      (*it)->m_gatekeeper = NULL;
+    m_monitorWork.clear();
+    m_monitorWorkThread = NULL;
+    m_registrationQueued = m_infoRequestQueued = false;
+  }
+  else {
+    // Wait for any queued work to find it is no longer running
+    while (!m_monitorWork.empty()) {
+      m_monitorMutex.Signal();
+      m_monitorWorkDone.Wait();
+      m_monitorMutex.Wait();
+    }
+  }
+  m_monitorMutex.Signal();
 
   H323Transactor::StopChannel();
 }
@@ -858,30 +880,53 @@ PBoolean H323Gatekeeper::OnReceiveRegistrationReject(const H225_RegistrationReje
 }
 
 
-void H323Gatekeeper::Monitor()
+bool H323Gatekeeper::QueueMonitorWork(bool registration)
 {
-  PTRACE(3, "Gatekeeper monitor thread started " << *this);
-  PSimpleTimer ttlTimer, irrTimer;
-  while (m_monitorRunning) {
-    PTimeInterval waitTime = PMaxTimeInterval;
-    if (m_currentTimeToLive > 0 && waitTime > ttlTimer.GetRemaining())
-      waitTime = ttlTimer.GetRemaining();
-    if (m_infoRequestTime > 0 && waitTime > irrTimer.GetRemaining())
-      waitTime = irrTimer.GetRemaining();
+  PWaitAndSignal mutex(m_monitorMutex);
 
-    m_monitorTickle.Wait(waitTime);
-    if (!m_monitorRunning)
-      break;
+  if (!m_monitorRunning)
+    return false;
 
-    if (m_forceRegister || (m_currentTimeToLive > 0 && ttlTimer.HasExpired()))
-      ttlTimer = InternalRegister();
+  bool & queued = registration ? m_registrationQueued : m_infoRequestQueued;
+  if (!queued) {
+    queued = true;
+    MonitorWork * work = new MonitorWork(*this, registration);
+    m_monitorWork.push_back(work);
+    m_endpoint.GetGatekeeperMonitorPool().AddWork(work, psprintf("GK%p", this));
+  }
 
-    if (m_infoRequestTime > 0 && irrTimer.HasExpired()) {
+  return true;
+}
+
+
+void H323Gatekeeper::Monitor(MonitorWork & work)
+{
+  bool registration = work.m_registration;
+
+  m_monitorMutex.Wait();
+  bool running = m_monitorRunning;
+  (registration ? m_registrationQueued : m_infoRequestQueued) = false;
+  m_monitorWorkThread = PThread::Current();
+  m_monitorMutex.Signal();
+
+  if (running) {
+    OpalKeepAliveScheduler & scheduler = m_endpoint.GetManager().GetKeepAliveScheduler();
+    if (registration)
+      scheduler.Add(m_registrationClient, InternalRegister()); // Zero interval removes it
+    else
       InfoRequestResponse();
-      irrTimer = m_infoRequestTime;
-    }
   }
-  PTRACE(3, "Gatekeeper monitor thread ended " << *this);
+
+  // Cancelled by StopChannel() from within the above, we may be deleted
+  if (work.m_gatekeeper == NULL)
+    return;
+
+  m_monitorMutex.Wait();
+  m_monitorWorkThread = NULL;
+  m_monitorWork.remove(&work);
+  if (m_monitorWork.empty())
+    m_monitorWorkDone.Signal();
+  m_monitorMutex.Signal();
 }
 
 PTimeInterval H323Gatekeeper::InternalRegister()
@@ -899,6 +944,17 @@ PTimeInterval H323Gatekeeper::InternalRegister()
 
   if (!discoveryComplete) {
     if (m_endpoint.GetSendGRQ()) {
+      // Stagger discovery by many gatekeepers, without blocking a pool thread
+      if (!m_discoveryDelayed) {
+        m_discoveryDelay = m_endpoint.InternalGetGatekeeperStartDelay();
+        m_discoveryDelayed = true;
+      }
+      if (m_discoveryDelay.IsRunning()) {
+        PTRACE(4, "Delaying discovery for " << m_discoveryDelay.GetRemaining());
+        return m_discoveryDelay.GetRemaining();
+      }
+      m_discoveryDelayed = false;
+
       if (!DiscoverGatekeeper()) {
         PTRACE_IF(2, !m_forceRegister, "Discovery failed, retrying in " << OffLineRetryTime);
         return OffLineRetryTime;
@@ -1685,15 +1741,21 @@ PBoolean H323Gatekeeper::OnReceiveBandwidthRequest(const H225_BandwidthRequest &
 
 void H323Gatekeeper::SetInfoRequestRate(const PTimeInterval & rate)
 {
+  if (m_infoRequestTime == rate)
+    return;
+
   m_infoRequestTime = rate;
+  m_endpoint.GetManager().GetKeepAliveScheduler().Add(m_infoRequestClient, rate);
 }
 
 
 void H323Gatekeeper::ClearInfoRequestRate()
 {
   // Only reset rate to zero (disabled) if no calls present
-  if (m_endpoint.GetConnectionCount())
+  if (m_endpoint.GetConnectionCount() && m_infoRequestTime != 0) {
     m_infoRequestTime = 0;
+    m_endpoint.GetManager().GetKeepAliveScheduler().Remove(m_infoRequestClient);
+  }
 }
 
 
@@ -2057,10 +2119,14 @@ PStringList H323Gatekeeper::GetAliases() const
 
 void H323Gatekeeper::ReRegisterNow()
 {
-  if (m_monitorRunning) {
+  m_monitorMutex.Wait();
+  bool running = m_monitorRunning;
+  m_monitorMutex.Signal();
+
+  if (running) {
     PTRACE(4, "Triggering re-register for " << *this);
     m_forceRegister = true;
-    m_monitorTickle.Signal();
+    QueueMonitorWork(true);
   }
 }
 
@@ -2155,41 +2221,75 @@ PBoolean H323Gatekeeper::MakeRequest(Request & request)
   if (PAssertNULL(m_transport) == NULL)
     return false;
 
-  // Set authenticators if not already set by caller
-  m_requestMutex.Wait();
+  unsigned tag = request.m_requestPDU.GetChoice().GetTag();
+  PTimeInterval startTick = PTimer::Tick();
+
+  bool ok = InternalMakeRequest(request);
+
+  PTimeInterval roundTrip = PTimer::Tick() - startTick;
+
+  PWaitAndSignal mutex(m_statisticsMutex);
+  RequestStatistics & stats = m_requestStatistics[tag];
+  if (!ok)
+    ++stats.m_failed;
+  else {
+    if (stats.m_count == 0 || stats.m_minimum > roundTrip)
+      stats.m_minimum = roundTrip;
+    if (stats.m_maximum < roundTrip)
+      stats.m_maximum = roundTrip;
+    stats.m_last = roundTrip;
+    stats.m_total += roundTrip;
+    ++stats.m_count;
+  }
+
+  return ok;
+}
+
+
+bool H323Gatekeeper::InternalMakeRequest(Request & request)
+{
+  /* Any number of requests, e.g. ARQs for different calls, may be
+     outstanding to the gatekeeper at once, so only a read lock is needed.
+     The write lock is to be sure that the H323 Cleaner, H225 Caller or
+     Monitor don't set the transport address of the alternate while the
+     other is in timeout. */
+  m_requestMutex.StartRead();
 
+  // Set authenticators if not already set by caller
   if (request.m_requestPDU.GetAuthenticators().IsEmpty())
     request.m_requestPDU.SetAuthenticators(m_authenticators);
 
-  /* To be sure that the H323 Cleaner, H225 Caller or Monitor don't set the
-     transport address of the alternate while the other is in timeout. We
-     have to block the function */
+  H323TransportAddress firstAddr = m_transport->GetRemoteAddress();
+  bool ok = H225_RAS::MakeRequest(request);
+
+  m_requestMutex.EndRead();
+
+  if (ok)
+    return true;
+
+  if (request.m_responseResult != Request::NoResponseReceived &&
+      request.m_responseResult != Request::TryAlternate)
+    return false;
+
+  m_requestMutex.StartWrite();
+
+  // Another request may have permanently moved to an alternate while we waited
+  if (m_transport->GetRemoteAddress() != firstAddr && H225_RAS::MakeRequest(request)) {
+    m_requestMutex.EndWrite();
+    return true;
+  }
 
   H323TransportAddress tempAddr = m_transport->GetRemoteAddress();
   PString tempIdentifier = gatekeeperIdentifier;
   
   AlternateList::iterator alt = m_alternates.begin();
   for (;;) {
-    if (H225_RAS::MakeRequest(request)) {
-      if (m_alternateTemporary && (m_transport->GetRemoteAddress() != tempAddr || gatekeeperIdentifier != tempIdentifier))
-        Connect(tempAddr, tempIdentifier);
-      m_requestMutex.Signal();
-      return true;
-    }
-    
-    if (request.m_responseResult != Request::NoResponseReceived &&
-        request.m_responseResult != Request::TryAlternate) {
-      // try alternate in those cases and see if it's successful
-      m_requestMutex.Signal();
-      return false;
-    }
-    
     AlternateInfo * altInfo;
     do {
       if (alt == m_alternates.end()) {
         if (m_alternateTemporary) 
           Connect(tempAddr, tempIdentifier);
-        m_requestMutex.Signal();
+        m_requestMutex.EndWrite();
         return false;
       }
       
@@ -2206,7 +2306,7 @@ PBoolean H323Gatekeeper::MakeRequest(Request & request)
       Request req(SetupGatekeeperRequest(pdu), pdu);
       
       if (H225_RAS::MakeRequest(req)) {
-        m_requestMutex.Signal(); // avoid deadlock...
+        m_requestMutex.EndWrite(); // avoid deadlock...
         if (RegistrationRequest(m_autoReregister)) {
           altInfo->registrationState = AlternateInfo::IsRegistered;
           // The wanted registration is done, we can return
@@ -2216,13 +2316,42 @@ PBoolean H323Gatekeeper::MakeRequest(Request & request)
             return true;
           }
         }
-        m_requestMutex.Wait();
+        m_requestMutex.StartWrite();
       }
     }
+
+    if (H225_RAS::MakeRequest(request)) {
+      if (m_alternateTemporary && (m_transport->GetRemoteAddress() != tempAddr || gatekeeperIdentifier != tempIdentifier))
+        Connect(tempAddr, tempIdentifier);
+      m_requestMutex.EndWrite();
+      return true;
+    }
+    
+    if (request.m_responseResult != Request::NoResponseReceived &&
+        request.m_responseResult != Request::TryAlternate) {
+      // try alternate in those cases and see if it's successful
+      m_requestMutex.EndWrite();
+      return false;
+    }
   }
 }
 
 
+H323Gatekeeper::RequestStatistics::RequestStatistics()
+  : m_count(0)
+  , m_failed(0)
+{
+}
+
+
+H323Gatekeeper::RequestStatistics H323Gatekeeper::GetRequestStatistics(unsigned requestTag)
+{
+  PWaitAndSignal mutex(m_statisticsMutex);
+  std::map<unsigned, RequestStatistics>::const_iterator it = m_requestStatistics.find(requestTag);
+  return it != m_requestStatistics.end() ? it->second : RequestStatistics();
+}
+
+
 H323Transport * H323Gatekeeper::CreateTransport(PIPSocket::Address binding, WORD port, PBoolean reuseAddr)
 {
   return new H323TransportUDP(m_endpoint, binding, port, reuseAddr);
@@ -3241,6 +3241,12 @@ H323GatekeeperRequest::Response H323GatekeeperServer::OnAdmission(H323Gatekeeper
       return H323GatekeeperRequest::Reject;
     }
 
+    if (!GetOwnerEndPoint().GetManager().GetAdmissionController()->CanAcceptCall()) {
+      PTRACE(2, "RAS\tNew call rejected by admission control");
+      info.SetRejectReason(H225_AdmissionRejectReason::e_resourceUnavailable);
+      return H323GatekeeperRequest::Reject;
+    }
+
     H323GatekeeperCall * newCall = CreateCall(id,
                             info.arq.m_answerCall ? H323GatekeeperCall::AnsweringCall
                                                   : H323GatekeeperCall::OriginatingCall);
@@ -41,6 +41,7 @@
 #include <h323/h323ep.h>
 #include <h323/h323neg.h>
 #include <h323/h323rtp.h>
+#include <h323/h323reactor.h>
 #include <h323/gkclient.h>
 
 #if OPAL_H450
@@ -478,43 +479,64 @@ void H323Connection::HandleSignallingChannel()
 
   while (m_signallingChannel->IsOpen()) {
     H323SignalPDU pdu;
-    if (pdu.Read(*m_signallingChannel)) {
-      if (!HandleSignalPDU(pdu)) {
-        Release(EndedByTransportFail);
-        break;
-      }
-    }
-    else if (m_signallingChannel->GetErrorCode() != PChannel::Timeout) {
-      if (m_controlChannel == NULL || !m_controlChannel->IsOpen())
-        Release(EndedByTransportFail);
+    if (!HandleReceivedSignalPDU(pdu.Read(*m_signallingChannel), pdu))
       break;
-    }
-    else {
-      // On way out already, just exit thread on timeout
-      if (IsReleased())
-        break;
+  }
 
-      switch (m_connectionState) {
-        case AwaitingSignalConnect :
-          // Had time out waiting for remote to send a CONNECT
-          ClearCall(EndedByNoAnswer);
-          break;
-        case HasExecutedSignalConnect :
-          // Have had minimum MonitorCallStartTime delay since CONNECT but
-          // still no media to move it to EstablishedConnection state. Must
-          // thus not have any common codecs to use!
-          PTRACE(1, "H225\tTook too long to negotiate media");
-          ClearCall(EndedByCapabilityExchange);
-          break;
-        default :
-          break;
-      }
+  EndHandleSignallingChannel();
+}
+
+
+PBoolean H323Connection::HandleReceivedSignalPDU(PBoolean readStatus, H323SignalPDU & pdu)
+{
+  return HandleReceivedSignalPDU(readStatus, m_signallingChannel->GetErrorCode(), pdu);
+}
+
+
+PBoolean H323Connection::HandleReceivedSignalPDU(PBoolean readStatus, PChannel::Errors readError, H323SignalPDU & pdu)
+{
+  if (readStatus) {
+    if (!HandleSignalPDU(pdu)) {
+      Release(EndedByTransportFail);
+      return false;
     }
+  }
+  else if (readError != PChannel::Timeout) {
+    if (m_controlChannel == NULL || !m_controlChannel->IsOpen())
+      Release(EndedByTransportFail);
+    return false;
+  }
+  else {
+    // On way out already, just exit thread on timeout
+    if (IsReleased())
+      return false;
 
-    if (m_controlChannel == NULL)
-      MonitorCallStatus();
+    switch (m_connectionState) {
+      case AwaitingSignalConnect :
+        // Had time out waiting for remote to send a CONNECT
+        ClearCall(EndedByNoAnswer);
+        break;
+      case HasExecutedSignalConnect :
+        // Have had minimum MonitorCallStartTime delay since CONNECT but
+        // still no media to move it to EstablishedConnection state. Must
+        // thus not have any common codecs to use!
+        PTRACE(1, "H225\tTook too long to negotiate media");
+        ClearCall(EndedByCapabilityExchange);
+        break;
+      default :
+        break;
+    }
   }
 
+  if (m_controlChannel == NULL)
+    MonitorCallStatus();
+
+  return true;
+}
+
+
+void H323Connection::EndHandleSignallingChannel()
+{
   // If we are the only link to the far end then indicate that we have
   // received endSession even if we hadn't, because we are now never going
   // to get one so there is no point in having CleanUpOnCallEnd wait.
@@ -1870,7 +1892,9 @@ PBoolean H323Connection::SetUpConnection()
     return false;
   }
 
-  m_signallingChannel->AttachThread(new PThread1Arg< PSafePtr<H323Connection> >(this, &StartHandleSignallingChannel, false, "H225 Caller"));
+  H323SignalReactor * reactor = m_endpoint.GetSignalReactor();
+  if (reactor == NULL || !reactor->AddChannel(*this, m_signallingChannel, H323SignalReactor::SignallingChannel))
+    m_signallingChannel->AttachThread(new PThread1Arg< PSafePtr<H323Connection> >(this, &StartHandleSignallingChannel, false, "H225 Caller"));
   return true;
 }
 
@@ -2843,7 +2867,11 @@ PBoolean H323Connection::CreateOutgoingControlChannel(const PASN_Sequence & encl
     return false;
   }
 
-  m_controlChannel->AttachThread(PThread::Create(PCREATE_NOTIFIER(NewOutgoingControlChannel), "H.245 Handler"));
+  H323SignalReactor * reactor = m_endpoint.GetSignalReactor();
+  if (reactor != NULL && reactor->CanMultiplex(*m_controlChannel))
+    reactor->QueueStartControlChannel(*this);
+  else
+    m_controlChannel->AttachThread(PThread::Create(PCREATE_NOTIFIER(NewOutgoingControlChannel), "H.245 Handler"));
   return true;
 }
 
@@ -2946,13 +2974,19 @@ PBoolean H323Connection::WriteControlPDU(const H323ControlPDU & pdu)
 
   H323TraceDumpPDU("H245", true, strm, pdu, pdu, 0);
 
+  return WriteEncodedControlPDU(strm);
+}
+
+
+bool H323Connection::WriteEncodedControlPDU(const PBYTEArray & encoded)
+{
   if (!m_h245Tunneling) {
     if (m_controlChannel == NULL) {
       PTRACE(1, "H245\tWrite PDU fail: no control channel.");
       return false;
     }
 
-    if (m_controlChannel->IsOpen() && m_controlChannel->WritePDU(strm))
+    if (m_controlChannel->IsOpen() && m_controlChannel->WritePDU(encoded))
       return true;
 
     PTRACE(1, "H245\tWrite PDU fail: " << m_controlChannel->GetErrorText(PChannel::LastWriteError));
@@ -2972,7 +3006,7 @@ PBoolean H323Connection::WriteControlPDU(const H323ControlPDU & pdu)
   tunnelPDU->m_h323_uu_pdu.IncludeOptionalField(H225_H323_UU_PDU::e_h245Control);
   PINDEX last = tunnelPDU->m_h323_uu_pdu.m_h245Control.GetSize();
   tunnelPDU->m_h323_uu_pdu.m_h245Control.SetSize(last+1);
-  tunnelPDU->m_h323_uu_pdu.m_h245Control[last] = strm;
+  tunnelPDU->m_h323_uu_pdu.m_h245Control[last] = encoded;
 
   if (m_h245TunnelTxPDU != NULL)
     return true;
@@ -3043,6 +3077,12 @@ PBoolean H323Connection::OnStartHandleControlChannel()
 
 
 PBoolean H323Connection::HandleReceivedControlPDU(PBoolean readStatus, PPER_Stream & strm)
+{
+  return HandleReceivedControlPDU(readStatus, m_controlChannel->GetErrorCode(), strm);
+}
+
+
+PBoolean H323Connection::HandleReceivedControlPDU(PBoolean readStatus, PChannel::Errors readError, PPER_Stream & strm)
 {
   if (readStatus) {
     // Lock while checking for shutting down.
@@ -3057,13 +3097,13 @@ PBoolean H323Connection::HandleReceivedControlPDU(PBoolean readStatus, PPER_Stre
   }
 
 
-  if (m_controlChannel->GetErrorCode() == PChannel::Timeout) {
+  if (readError == PChannel::Timeout) {
     PTRACE(4, "H245\tRead timeout");
     return true;
   }
 
-  PTRACE_IF(1, m_controlChannel->GetErrorCode() != PChannel::NotOpen,
-            "H245\tRead error: " << m_controlChannel->GetErrorText(PChannel::LastReadError));
+  PTRACE_IF(1, readError != PChannel::NotOpen,
+            "H245\tRead error: " << PChannel::GetErrorText(readError));
 
   // If the connection is already shutting down then don't overwrite the
   // call end reason.  This could happen if the remote end point misbehaves
@@ -3118,6 +3158,10 @@ void H323Connection::HandleControlChannel()
   if (!OnStartHandleControlChannel())
     return;
 
+  H323SignalReactor * reactor = m_endpoint.GetSignalReactor();
+  if (reactor != NULL && reactor->AddChannel(*this, m_controlChannel, H323SignalReactor::ControlChannel))
+    return;
+
   PBoolean ok = TRUE;
   while (ok) {
     MonitorCallStatus();
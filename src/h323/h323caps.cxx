@@ -419,6 +419,98 @@ PBoolean H323Capability::IsUsable(const H323Connection &) const
 }
 
 
+void H323Capability::AddToSignature(Signature & signature, const void * data, size_t size)
+{
+  const BYTE * ptr = (const BYTE *)data;
+  while (size-- > 0) {
+    signature ^= *ptr++;
+    signature *= PUInt64(0x100000001b3ULL);
+  }
+}
+
+
+void H323Capability::AddToSignature(Signature & signature, const PString & str)
+{
+  // Include length so adjacent strings cannot run into each other
+  AddToSignature(signature, (unsigned)str.GetLength());
+  AddToSignature(signature, (const char *)str, str.GetLength());
+}
+
+
+void H323Capability::AddToSignature(Signature & signature, unsigned value)
+{
+  AddToSignature(signature, &value, sizeof(value));
+}
+
+
+template <typename T> static bool AddOptionValueToSignature(H323Capability::Signature & signature, const OpalMediaOption & option)
+{
+  const OpalMediaOptionValue<T> * typed = dynamic_cast<const OpalMediaOptionValue<T> *>(&option);
+  if (typed == NULL)
+    return false;
+
+  T value = typed->GetValue();
+  H323Capability::AddToSignature(signature, &value, sizeof(value));
+  return true;
+}
+
+
+static void AddOptionToSignature(H323Capability::Signature & signature, const OpalMediaOption & option)
+{
+  H323Capability::AddToSignature(signature, option.GetName());
+
+  // Use the value directly for all the usual option types, only fall back to the string
+  if (AddOptionValueToSignature<unsigned>(signature, option) ||
+      AddOptionValueToSignature<int>(signature, option) ||
+      AddOptionValueToSignature<bool>(signature, option) ||
+      AddOptionValueToSignature<OpalMediaOptionRealValue>(signature, option))
+    return;
+
+  const OpalMediaOptionEnum * enumOption = dynamic_cast<const OpalMediaOptionEnum *>(&option);
+  if (enumOption != NULL) {
+    H323Capability::AddToSignature(signature, (unsigned)enumOption->GetValue());
+    return;
+  }
+
+  const OpalMediaOptionString * stringOption = dynamic_cast<const OpalMediaOptionString *>(&option);
+  if (stringOption != NULL) {
+    H323Capability::AddToSignature(signature, stringOption->GetValue());
+    return;
+  }
+
+  const OpalMediaOptionOctets * octetsOption = dynamic_cast<const OpalMediaOptionOctets *>(&option);
+  if (octetsOption != NULL) {
+    const PBYTEArray & octets = octetsOption->GetValue();
+    H323Capability::AddToSignature(signature, (unsigned)octets.GetSize());
+    H323Capability::AddToSignature(signature, (const BYTE *)octets, octets.GetSize());
+    return;
+  }
+
+  H323Capability::AddToSignature(signature, option.AsString());
+}
+
+
+void H323Capability::AddSignature(Signature & signature) const
+{
+  AddToSignature(signature, GetClass());
+  AddToSignature(signature, assignedCapabilityNumber);
+  AddToSignature(signature, (unsigned)capabilityDirection);
+  AddToSignature(signature, GetFormatName());
+
+  OpalMediaFormat mediaFormat = GetMediaFormat();
+  PINDEX count = mediaFormat.GetOptionCount();
+  AddToSignature(signature, (unsigned)count);
+  for (PINDEX i = 0; i < count; ++i)
+    AddOptionToSignature(signature, mediaFormat.GetOption(i));
+
+#if OPAL_H235_6 || OPAL_H235_8
+  const OpalMediaCryptoSuite * cryptoSuite = GetCryptoSuite();
+  if (cryptoSuite != NULL)
+    AddToSignature(signature, cryptoSuite->GetFactoryName());
+#endif
+}
+
+
 OpalMediaFormat H323Capability::GetMediaFormat() const
 {
   if (m_mediaFormat.IsValid())
@@ -1939,6 +2031,17 @@ bool H235SecurityCapability::PostTCS(const H323Connection & connection, const H3
 }
 
 
+void H235SecurityCapability::AddSignature(Signature & signature) const
+{
+  AddToSignature(signature, GetClass());
+  AddToSignature(signature, assignedCapabilityNumber);
+  AddToSignature(signature, m_mediaCapabilityNumber);
+  AddToSignature(signature, (unsigned)m_cryptoSuites.size());
+  for (OpalMediaCryptoSuite::List::const_iterator it = m_cryptoSuites.begin(); it != m_cryptoSuites.end(); ++it)
+    AddToSignature(signature, it->GetFactoryName());
+}
+
+
 void H235SecurityCapability::AddAllCapabilities(H323Capabilities & capabilities,
                                                 const PStringArray & cryptoSuiteNames,
                                                 const char * prefix)
@@ -3750,6 +3853,37 @@ void H323Capabilities::BuildPDU(const H323Connection & connection,
 }
 
 
+H323Capability::Signature H323Capabilities::GetPDUSignature(const H323Connection & connection) const
+{
+  H323Capability::Signature signature = PUInt64(0xcbf29ce484222325ULL); // FNV-1a offset basis
+
+  // Must match what BuildPDU() does, counts and markers keep the structure unambiguous
+  for (PINDEX i = 0; i < m_table.GetSize(); i++) {
+    H323Capability & capability = m_table[i];
+    if (capability.IsUsable(connection)) {
+      capability.GetWritableMediaFormat().ToCustomisedOptions();
+      capability.AddSignature(signature);
+    }
+  }
+
+  H323Capability::AddToSignature(signature, (unsigned)m_set.GetSize());
+  for (PINDEX outer = 0; outer < m_set.GetSize(); outer++) {
+    H323Capability::AddToSignature(signature, m_set[outer].m_capabilityDescriptorNumber);
+    H323Capability::AddToSignature(signature, (unsigned)m_set[outer].GetSize());
+    for (PINDEX middle = 0; middle < m_set[outer].GetSize(); middle++) {
+      H323Capability::AddToSignature(signature, UINT_MAX); // Alternatives marker
+      for (PINDEX inner = 0; inner < m_set[outer][middle].GetSize(); inner++) {
+        H323Capability & capability = m_set[outer][middle][inner];
+        if (capability.IsUsable(connection))
+          H323Capability::AddToSignature(signature, capability.GetCapabilityNumber());
+      }
+    }
+  }
+
+  return signature;
+}
+
+
 PBoolean H323Capabilities::Merge(const H323Capabilities & newCaps)
 {
   PTRACE_IF(4, !m_table.IsEmpty(), "H323\tCapability merge of:\n" << newCaps << "\nInto:\n" << *this);
@@ -3943,6 +4077,120 @@ OpalMediaFormatList H323Capabilities::GetMediaFormats() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+H323CapabilitySetCache::H323CapabilitySetCache(PINDEX maxEntries)
+  : m_maxEntries(maxEntries)
+  , m_hits(0)
+  , m_misses(0)
+{
+}
+
+
+static H245_TerminalCapabilitySet * GetTerminalCapabilitySet(H323ControlPDU & pdu)
+{
+  if (pdu.GetTag() != H245_MultimediaSystemControlMessage::e_request)
+    return NULL;
+
+  H245_RequestMessage & request = pdu;
+  if (request.GetTag() != H245_RequestMessage::e_terminalCapabilitySet)
+    return NULL;
+
+  return &(H245_TerminalCapabilitySet &)request;
+}
+
+
+bool H323CapabilitySetCache::GetCapabilitySet(H323Capability::Signature key, unsigned sequenceNumber, PBYTEArray & encoded)
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  EntryMap::iterator it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    ++m_misses;
+    return false;
+  }
+
+  encoded = it->second.m_encoded;
+  encoded.MakeUnique();
+  encoded[it->second.m_sequenceNumberOffset] = (BYTE)sequenceNumber;
+  ++m_hits;
+  return true;
+}
+
+
+void H323CapabilitySetCache::SetCapabilitySet(H323Capability::Signature key, const H323ControlPDU & pdu)
+{
+  H323ControlPDU other = pdu;
+  H245_TerminalCapabilitySet * tcs = GetTerminalCapabilitySet(other);
+  if (!PAssert(tcs != NULL, PInvalidParameter))
+    return;
+
+  unsigned sequenceNumber = tcs->m_sequenceNumber;
+
+  PPER_Stream strm1;
+  pdu.Encode(strm1);
+  strm1.CompleteEncoding();
+
+  // Encode again with a different sequence number, to find where it is
+  tcs->m_sequenceNumber = (tcs->m_sequenceNumber+1)%256;
+  PPER_Stream strm2;
+  other.Encode(strm2);
+  strm2.CompleteEncoding();
+
+  if (strm1.GetSize() != strm2.GetSize())
+    return;
+
+  PINDEX offset = P_MAX_INDEX;
+  for (PINDEX i = 0; i < strm1.GetSize(); ++i) {
+    if (strm1[i] != strm2[i]) {
+      if (offset != P_MAX_INDEX) {
+        PTRACE(2, "H323\tCannot cache TerminalCapabilitySet, sequence number not octet aligned");
+        return;
+      }
+      offset = i;
+    }
+  }
+
+  if (offset == P_MAX_INDEX)
+    return;
+
+  // The only difference must be the sequence number itself, or patching it would corrupt the PDU
+  if (!PAssert(strm1[offset] == (BYTE)sequenceNumber, PLogicError))
+    return;
+
+  PWaitAndSignal mutex(m_mutex);
+
+  if (m_maxEntries == 0)
+    return;
+
+  if ((PINDEX)m_entries.size() >= m_maxEntries) {
+    PTRACE(4, "H323\tCapability set cache full, flushing " << m_entries.size() << " entries");
+    m_entries.clear();
+  }
+
+  Entry & entry = m_entries[key];
+  entry.m_encoded = strm1;
+  entry.m_sequenceNumberOffset = offset;
+  PTRACE(4, "H323\tCached TerminalCapabilitySet of " << strm1.GetSize() << " bytes, entries=" << m_entries.size());
+}
+
+
+void H323CapabilitySetCache::RemoveAll()
+{
+  PWaitAndSignal mutex(m_mutex);
+  m_entries.clear();
+}
+
+
+void H323CapabilitySetCache::SetMaxEntries(PINDEX maxEntries)
+{
+  PWaitAndSignal mutex(m_mutex);
+  m_maxEntries = maxEntries;
+  if ((PINDEX)m_entries.size() > m_maxEntries)
+    m_entries.clear();
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 #ifndef PASN_NOPRINTON
@@ -44,6 +44,7 @@
 #include <h323/h323pdu.h>
 #include <h323/gkclient.h>
 #include <h323/h323rtp.h>
+#include <h323/h323reactor.h>
 #include <ptclib/url.h>
 #include <ptclib/enum.h>
 #include <ptclib/pils.h>
@@ -62,7 +63,7 @@ const OpalProductInfo & H323EndPoint::AvayaPhone()
 
 /////////////////////////////////////////////////////////////////////////////
 
-H323EndPoint::H323EndPoint(OpalManager & manager)
+H323EndPoint::H323EndPoint(OpalManager & manager, unsigned maxGatekeeperThreads)
   : OpalRTPEndPoint(manager, OPAL_PREFIX_H323, IsNetworkEndPoint | SupportsE164)
   , autoCallForward(true)
   , disableFastStart(false)
@@ -108,6 +109,7 @@ H323EndPoint::H323EndPoint(OpalManager & manager)
   , callIntrusionT4(0,30)                  // Seconds
   , callIntrusionT5(0,10)                  // Seconds
   , callIntrusionT6(0,10)                  // Seconds
+  , m_gatekeeperMonitorPool(maxGatekeeperThreads, 0, "GkMonitor")
   , m_gatekeeperAliasLimit(MaxGatekeeperAliasLimit)
   , m_gatekeeperSimulatePattern(false)
   , m_gatekeeperRasRedirect(true)
@@ -120,6 +122,8 @@ H323EndPoint::H323EndPoint(OpalManager & manager)
 #if OPAL_H460_NAT
   , m_H46019Server(NULL)
 #endif
+  , m_signalReactor(NULL)
+  , m_maxIncomingCalls(0)
 {
   m_localAliasNames[m_defaultLocalPartyName]; // Create entry
 
@@ -157,6 +161,8 @@ H323EndPoint::H323EndPoint(OpalManager & manager)
 
 H323EndPoint::~H323EndPoint()
 {
+  delete m_signalReactor;
+
 #if OPAL_H460
   delete m_features;
 #endif
@@ -180,6 +186,49 @@ void H323EndPoint::ShutDown()
   RemoveGatekeeper();
 
   OpalEndPoint::ShutDown();
+
+  if (m_signalReactor != NULL)
+    m_signalReactor->ShutDown();
+}
+
+
+bool H323EndPoint::SetSignalReactor(unsigned selectThreads, unsigned maxWorkers)
+{
+  if (m_signalReactor != NULL || selectThreads == 0) {
+    PTRACE(2, "H323\tCannot change signalling channel reactor");
+    return false;
+  }
+
+  H323SignalReactor * reactor = new H323SignalReactor(*this, selectThreads, maxWorkers);
+  if (!reactor->IsRunning()) {
+    delete reactor;
+    return false;
+  }
+
+  m_signalReactor = reactor;
+  return true;
+}
+
+
+unsigned H323EndPoint::GetPendingWorkCount() const
+{
+  return m_signalReactor != NULL ? m_signalReactor->GetPendingWorkCount() : 0;
+}
+
+
+H323EndPoint::PreParseStatistics::PreParseStatistics()
+  : m_parsed(0)
+  , m_discarded(0)
+  , m_rejected(0)
+  , m_decoded(0)
+{
+}
+
+
+H323EndPoint::PreParseStatistics H323EndPoint::GetPreParseStatistics()
+{
+  PWaitAndSignal lock(m_preParseMutex);
+  return m_preParseStatistics;
 }
 
 
@@ -840,6 +889,8 @@ void H323EndPoint::OnReleased(OpalConnection & connection)
   OpalTransportPtr signallingChannel = dynamic_cast<H323Connection &>(connection).GetSignallingChannel();
   if (signallingChannel != NULL && signallingChannel->IsOpen()) {
     PTRACE(3, "H323", "Maintaining TCP connection: " << *signallingChannel);
+    if (m_signalReactor != NULL)
+      m_signalReactor->RemoveChannel(*signallingChannel);
     m_reusableTransportMutex.Wait();
     m_reusableTransports.insert(signallingChannel);
     m_reusableTransportMutex.Signal();
@@ -858,6 +909,32 @@ void H323EndPoint::NewIncomingConnection(OpalListener &, const OpalTransportPtr
 }
 
 
+static void SendReleaseComplete(OpalTransport & transport,
+                                unsigned callReference,
+                                const H225_CallIdentifier * callIdentifier,
+                                Q931::CauseValues cause)
+{
+  H323SignalPDU releaseComplete;
+  Q931 &q931PDU = releaseComplete.GetQ931();
+  q931PDU.BuildReleaseComplete(callReference, true);
+  releaseComplete.m_h323_uu_pdu.m_h323_message_body.SetTag(H225_H323_UU_PDU_h323_message_body::e_releaseComplete);
+
+  H225_ReleaseComplete_UUIE &release = releaseComplete.m_h323_uu_pdu.m_h323_message_body;
+  release.m_protocolIdentifier.SetValue(psprintf("0.0.8.2250.0.%u", H225_PROTOCOL_VERSION));
+
+  if (callIdentifier != NULL) {
+    release.IncludeOptionalField(H225_ReleaseComplete_UUIE::e_callIdentifier);
+    release.m_callIdentifier = *callIdentifier;
+  }
+
+  // Set the cause value
+  q931PDU.SetCause(cause);
+
+  // Send the PDU
+  releaseComplete.Write(transport);
+}
+
+
 void H323EndPoint::InternalNewIncomingConnection(OpalTransportPtr transport, bool reused)
 {
   if (transport == NULL)
@@ -866,9 +943,24 @@ void H323EndPoint::InternalNewIncomingConnection(OpalTransportPtr transport, boo
   PTRACE(4, "H225\tAwaiting first PDU on " << (reused ? "reused" : "initial") << " connection " << *transport);
   transport->SetReadTimeout(GetFirstSignalPduTimeout());
 
-  H323SignalPDU pdu;
-  do {
-    if (!pdu.Read(*transport)) {
+  /* Only pre-parse until we get a Setup, so anything else, and any Setup
+     that is rejected, never gets the full decode. */
+  PBYTEArray rawData;
+  H323SignalPreParse preParse;
+  for (;;) {
+    bool ok = transport->ReadPDU(rawData);
+    if (!ok) {
+      PTRACE_IF(1, transport->GetErrorCode(PChannel::LastReadError) != PChannel::Timeout,
+                "H225\tRead error (" << transport->GetErrorNumber(PChannel::LastReadError)
+                << "): " << transport->GetErrorText(PChannel::LastReadError));
+    }
+    else if (!(ok = preParse.Parse(rawData))) {
+      PTRACE(1, "H225\tParse error of Q931 PDU:\n" << hex << setfill('0')
+                                                   << setprecision(2) << rawData
+                                                   << dec << setfill(' '));
+    }
+
+    if (!ok) {
       if (reused) {
         PTRACE(3, "H225\tReusable TCP connection not reused.");
         transport->Close();
@@ -878,12 +970,40 @@ void H323EndPoint::InternalNewIncomingConnection(OpalTransportPtr transport, boo
       PTRACE(2, "H225\tFailed to get initial Q.931 PDU, connection not started.");
       return;
     }
-  } while (pdu.GetQ931().GetMessageType() != Q931::SetupMsg);
 
-  unsigned callReference = pdu.GetQ931().GetCallReference();
+    PWaitAndSignal lock(m_preParseMutex);
+    ++m_preParseStatistics.m_parsed;
+    if (preParse.m_messageType == Q931::SetupMsg)
+      break;
+    ++m_preParseStatistics.m_discarded;
+  }
+
+  unsigned callReference = preParse.m_callReference;
   PTRACE(3, "H225\tIncoming call, first PDU: callReference=" << callReference
          << " on " << (reused ? "reused" : "initial") << " connection " << *transport);
 
+  Q931::CauseValues cause = OnIncomingSetupPreParse(*transport, preParse);
+  if (cause != Q931::ErrorInCauseIE) {
+    m_preParseMutex.Wait();
+    ++m_preParseStatistics.m_rejected;
+    m_preParseMutex.Signal();
+
+    PTRACE(2, "H225\tIncoming call rejected before decode, "
+              "sending release complete PDU: callRef=" << callReference << ", cause=" << cause);
+    SendReleaseComplete(*transport, callReference, NULL, cause);
+    return;
+  }
+
+  H323SignalPDU pdu;
+  if (!pdu.ProcessReadData(rawData)) {
+    PTRACE(2, "H225\tFailed to decode initial Q.931 PDU, connection not started.");
+    return;
+  }
+
+  m_preParseMutex.Wait();
+  ++m_preParseStatistics.m_decoded;
+  m_preParseMutex.Signal();
+
   // Get a new (or old) connection from the endpoint, calculate token
   PString token = transport->GetRemoteAddress();
   token.sprintf("/%u", callReference);
@@ -914,32 +1034,33 @@ void H323EndPoint::InternalNewIncomingConnection(OpalTransportPtr transport, boo
     m_connectionsByCallId.SetAt(connection->GetIdentifier(), connection);
     // All subsequent PDU's should wait forever
     transport->SetReadTimeout(PMaxTimeInterval);
-    connection->HandleSignallingChannel();
+    if (m_signalReactor == NULL || !m_signalReactor->AddChannel(*connection, transport, H323SignalReactor::SignallingChannel))
+      connection->HandleSignallingChannel();
     return;
   }
 
   PTRACE(1, "H225\tEndpoint could not create connection, "
             "sending release complete PDU: callRef=" << callReference);
 
-  H323SignalPDU releaseComplete;
-  Q931 &q931PDU = releaseComplete.GetQ931();
-  q931PDU.BuildReleaseComplete(callReference, true);
-  releaseComplete.m_h323_uu_pdu.m_h323_message_body.SetTag(H225_H323_UU_PDU_h323_message_body::e_releaseComplete);
+  const H225_Setup_UUIE &setup = pdu.m_h323_uu_pdu.m_h323_message_body;
+  SendReleaseComplete(*transport, callReference,
+                      setup.HasOptionalField(H225_Setup_UUIE::e_callIdentifier) ? &setup.m_callIdentifier : NULL,
+                      Q931::TemporaryFailure);
+}
 
-  H225_ReleaseComplete_UUIE &release = releaseComplete.m_h323_uu_pdu.m_h323_message_body;
-  release.m_protocolIdentifier.SetValue(psprintf("0.0.8.2250.0.%u", H225_PROTOCOL_VERSION));
 
-  H225_Setup_UUIE &setup = pdu.m_h323_uu_pdu.m_h323_message_body;
-  if (setup.HasOptionalField(H225_Setup_UUIE::e_callIdentifier)) {
-    release.IncludeOptionalField(H225_Setup_UUIE::e_callIdentifier);
-    release.m_callIdentifier = setup.m_callIdentifier;
+Q931::CauseValues H323EndPoint::OnIncomingSetupPreParse(const OpalTransport &, const H323SignalPreParse & preParse)
+{
+  PINDEX max = m_maxIncomingCalls;
+  if (max > 0 && GetConnectionCount() >= max) {
+    PTRACE(3, "H225\tAt limit of " << max << " connections, rejecting call from " << preParse.m_callingPartyNumber);
+    return Q931::Congestion;
   }
 
-  // Set the cause value
-  q931PDU.SetCause(Q931::TemporaryFailure);
+  if (!m_manager.GetAdmissionController()->CanAcceptCall())
+    return Q931::Congestion;
 
-  // Send the PDU
-  releaseComplete.Write(*transport);
+  return Q931::ErrorInCauseIE;
 }
 
 
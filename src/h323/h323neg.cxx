@@ -311,8 +311,24 @@ PBoolean H245NegTerminalCapabilitySet::Start(PBoolean renegotiate, PBoolean empt
 
   PTRACE(3, "H245\tSending TerminalCapabilitySet: outSeq=" << outSequenceNumber);
 
+  // Most calls offer the same capabilities, so try for an already encoded PDU
+  H323CapabilitySetCache & cache = endpoint.GetCapabilitySetCache();
+  bool useCache = !empty && cache.GetMaxEntries() > 0;
+  H323Capability::Signature cacheKey = 0;
+  if (useCache) {
+    cacheKey = connection.GetLocalCapabilities().GetPDUSignature(connection);
+    H323Capability::AddToSignature(cacheKey, connection.GetMaxAudioJitterDelay());
+    PBYTEArray encoded;
+    if (cache.GetCapabilitySet(cacheKey, outSequenceNumber, encoded)) {
+      PTRACE(4, "H245\tUsing cached TerminalCapabilitySet");
+      return connection.WriteEncodedControlPDU(encoded);
+    }
+  }
+
   H323ControlPDU pdu;
   connection.OnSendCapabilitySet(pdu.BuildTerminalCapabilitySet(connection, outSequenceNumber, empty));
+  if (useCache)
+    cache.SetCapabilitySet(cacheKey, pdu);
   return connection.WriteControlPDU(pdu);
 }
 
@@ -1138,6 +1138,12 @@ PBoolean H323SignalPDU::Read(H323Transport & transport)
     return false;
   }
 
+  return ProcessReadData(rawData);
+}
+
+
+PBoolean H323SignalPDU::ProcessReadData(const PBYTEArray & rawData)
+{
   if (!q931pdu.Decode(rawData)) {
     PTRACE(1, "H225\tParse error of Q931 PDU:\n" << hex << setfill('0')
                                                  << setprecision(2) << rawData
@@ -1417,6 +1423,144 @@ void H323SignalPDU::SetQ931Fields(const H323Connection & connection, bool insert
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+H323SignalPreParse::H323SignalPreParse()
+  : m_messageType(Q931::NationalEscapeMsg)
+  , m_callReference(0)
+  , m_fromDestination(false)
+  , m_bodyTag(UINT_MAX)
+  , m_conferenceID("")
+{
+}
+
+
+static PString GetPreParseNumber(const BYTE * ie, PINDEX len)
+{
+  // Skip octet 3, and the optional 3a and 3b, see Q931::GetCallingPartyNumber()
+  PINDEX offset = 0;
+  while (offset < len && offset < 3 && (ie[offset++] & 0x80) == 0)
+    ;
+  return PString((const char *)ie+offset, len-offset);
+}
+
+
+bool H323SignalPreParse::Parse(const PBYTEArray & rawData)
+{
+  m_callingPartyNumber.MakeEmpty();
+  m_calledPartyNumber.MakeEmpty();
+  m_bodyTag = UINT_MAX;
+  m_conferenceID = OpalGloballyUniqueID("");
+
+  // Same layout and checks as Q931::Decode(), without copying any of the IEs
+  const BYTE * data = rawData;
+  PINDEX size = rawData.GetSize();
+  if (size < 5 || data[1] != 2)
+    return false;
+
+  m_callReference = ((data[2]&0x7f) << 8) | data[3];
+  m_fromDestination = (data[2]&0x80) != 0;
+  m_messageType = (Q931::MsgTypes)data[4];
+
+  const BYTE * userUser = NULL;
+  PINDEX userUserLen = 0;
+
+  PINDEX offset = 5;
+  while (offset < size) {
+    BYTE discriminator = data[offset++];
+    if ((discriminator&0x80) != 0)
+      continue;
+
+    if (offset >= size)
+      return false;
+    PINDEX len = data[offset++];
+
+    if (discriminator == Q931::UserUserIE) {
+      if (offset+2 > size)
+        return false;
+      len = (len << 8) | data[offset++];
+      offset++; // Protocol discriminator
+      if (len == 0)
+        return false;
+      len--;
+    }
+
+    if (offset + len > size)
+      return false;
+
+    // First instance of each IE only, as for Q931::GetIE()
+    switch (discriminator) {
+      case Q931::CallingPartyNumberIE :
+        if (m_callingPartyNumber.IsEmpty())
+          m_callingPartyNumber = GetPreParseNumber(data+offset, len);
+        break;
+      case Q931::CalledPartyNumberIE :
+        if (m_calledPartyNumber.IsEmpty())
+          m_calledPartyNumber = GetPreParseNumber(data+offset, len);
+        break;
+      case Q931::UserUserIE :
+        if (userUser == NULL) {
+          userUser = data+offset;
+          userUserLen = len;
+        }
+        break;
+    }
+
+    offset += len;
+  }
+
+  if (userUser == NULL)
+    return true;
+
+  /* Decode only as far as the message body choice, using sequences with the
+     same optional field counts as H225_H323_UserInformation and
+     H225_H323_UU_PDU, so nothing after the body is touched. */
+  PPER_Stream strm(userUser, userUserLen);
+  PASN_Sequence userInformation(PASN_Object::UniversalSequence, PASN_Object::UniversalTagClass, 1, true);
+  PASN_Sequence uuPDU(PASN_Object::UniversalSequence, PASN_Object::UniversalTagClass, 1, true, 9);
+  if (!userInformation.PreambleDecode(strm) || !uuPDU.PreambleDecode(strm))
+    return true;
+
+  // Root alternatives are up to, but not including, progress
+  static const unsigned RootBodyChoices = H225_H323_UU_PDU_h323_message_body::e_progress;
+  unsigned tag;
+  if (strm.SingleBitDecode())
+    tag = strm.SmallUnsignedDecode() + RootBodyChoices;
+  else
+    tag = strm.MultiBitDecode(3);
+  if (tag > H225_H323_UU_PDU_h323_message_body::e_notify) // Includes -1 for no more bits
+    return true;
+  m_bodyTag = tag;
+
+  if (tag != H225_H323_UU_PDU_h323_message_body::e_setup)
+    return true;
+
+  // Decode the Setup fields before the conference ID, discarding them
+  PASN_Sequence setup(PASN_Object::UniversalSequence, PASN_Object::UniversalTagClass, H225_Setup_UUIE::e_callServices+1, true, 27);
+  H225_ProtocolIdentifier protocolIdentifier;
+  H225_TransportAddress address;
+  H225_ArrayOf_AliasAddress aliases;
+  H225_EndpointType sourceInfo;
+  H225_ArrayOf_CallReferenceValue crvs;
+  PASN_Boolean activeMC;
+  H225_ConferenceIdentifier conferenceID;
+  if (setup.PreambleDecode(strm) &&
+      protocolIdentifier.Decode(strm) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_h245Address) || address.Decode(strm)) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_sourceAddress) || aliases.Decode(strm)) &&
+      sourceInfo.Decode(strm) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_destinationAddress) || aliases.Decode(strm)) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_destCallSignalAddress) || address.Decode(strm)) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_destExtraCallInfo) || aliases.Decode(strm)) &&
+      (!setup.HasOptionalField(H225_Setup_UUIE::e_destExtraCRV) || crvs.Decode(strm)) &&
+      activeMC.Decode(strm) &&
+      conferenceID.Decode(strm))
+    m_conferenceID = conferenceID;
+
+  return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 H245_RequestMessage & H323ControlPDU::Build(H245_RequestMessage::Choices request)
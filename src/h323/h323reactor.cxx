@@ -0,0 +1,514 @@
+/*
+ * h323reactor.cxx
+ *
+ * H.323 signalling channel reactor
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#include <opal_config.h>
+
+#if OPAL_H323
+
+#ifdef __GNUC__
+#pragma implementation "h323reactor.h"
+#endif
+
+#include <h323/h323reactor.h>
+
+#include <h323/h323ep.h>
+#include <h323/h323con.h>
+#include <h323/h323pdu.h>
+
+
+#define new PNEW
+
+
+static const PINDEX TPKTHeaderSize = 4;
+static const PINDEX InitialBufferSize = 1024;
+static const PTimeInterval MaxSelectTime(0, 1);
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+struct H323SignalReactor::Channel : public PSmartObject
+{
+  Channel(H323Connection & connection, const OpalTransportPtr & transport, PTCPSocket & socket, ChannelType type)
+    : m_connection(&connection, PSafeReference)
+    , m_token(connection.GetToken())
+    , m_transport(transport)
+    , m_socket(socket)
+    , m_type(type)
+    , m_buffer(InitialBufferSize)
+    , m_buffered(0)
+    , m_lastActivity(PTimer::Tick())
+    , m_readEnded(false)
+    , m_handlerEnded(false)
+  {
+  }
+
+  PSafePtr<H323Connection> m_connection;
+  PString                  m_token;
+  OpalTransportPtr         m_transport;
+  PTCPSocket             & m_socket;
+  ChannelType              m_type;
+
+  // Only used by the select thread
+  PBYTEArray               m_buffer;
+  PINDEX                   m_buffered;
+  PTimeInterval            m_lastActivity;
+  bool                     m_readEnded;
+
+  // Only used by the work group for the connection
+  bool                     m_handlerEnded;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+class H323SignalReactor::SelectThread : public PObject
+{
+    PCLASSINFO(SelectThread, PObject);
+  public:
+    SelectThread(H323SignalReactor & reactor, unsigned index);
+    ~SelectThread();
+
+    bool IsRunning() const { return m_thread != NULL; }
+    void Add(const PSmartPointer & channel);
+    bool Remove(const OpalTransport & transport);
+    PINDEX GetCount();
+    void ShutDown();
+
+  protected:
+    void Main();
+    void Wake();
+    void ReadChannel(const PSmartPointer & ptr);
+    void QueueError(const PSmartPointer & ptr, PChannel::Errors error);
+
+    H323SignalReactor & m_reactor;
+    PUDPSocket          m_wakeSocket;
+    PThread           * m_thread;
+    atomic<bool>        m_running;
+
+    typedef std::map<PSocket *, PSmartPointer> ChannelMap;
+    ChannelMap          m_channels;
+    PDECLARE_MUTEX(     m_mutex);
+};
+
+
+H323SignalReactor::SelectThread::SelectThread(H323SignalReactor & reactor, unsigned index)
+  : m_reactor(reactor)
+  , m_thread(NULL)
+  , m_running(true)
+{
+  if (!m_wakeSocket.Listen(PIPSocket::GetLoopback())) {
+    PTRACE(1, "H323\tCould not open signal reactor wake up socket: " << m_wakeSocket.GetErrorText());
+    return;
+  }
+
+  m_thread = new PThreadObj<SelectThread>(*this, &SelectThread::Main, false, psprintf("H323 Select:%u", index), PThread::HighPriority);
+}
+
+
+H323SignalReactor::SelectThread::~SelectThread()
+{
+  ShutDown();
+}
+
+
+void H323SignalReactor::SelectThread::Add(const PSmartPointer & channel)
+{
+  m_mutex.Wait();
+  m_channels[&static_cast<Channel *>(channel.GetObject())->m_socket] = channel;
+  m_mutex.Signal();
+  Wake();
+}
+
+
+bool H323SignalReactor::SelectThread::Remove(const OpalTransport & transport)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  for (ChannelMap::iterator it = m_channels.begin(); it != m_channels.end(); ++it) {
+    if (&*static_cast<Channel *>(it->second.GetObject())->m_transport == &transport) {
+      m_channels.erase(it);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+PINDEX H323SignalReactor::SelectThread::GetCount()
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_channels.size();
+}
+
+
+void H323SignalReactor::SelectThread::ShutDown()
+{
+  if (m_thread == NULL)
+    return;
+
+  m_running = false;
+  Wake();
+  PThread::WaitAndDelete(m_thread);
+
+  m_mutex.Wait();
+  m_channels.clear();
+  m_mutex.Signal();
+}
+
+
+void H323SignalReactor::SelectThread::Wake()
+{
+  static const BYTE dummy = 0;
+  m_wakeSocket.WriteTo(&dummy, 1, PIPSocket::GetLoopback(), m_wakeSocket.GetPort());
+}
+
+
+void H323SignalReactor::SelectThread::Main()
+{
+  PTRACE(4, "H323\tSignal reactor select thread started");
+
+  m_wakeSocket.SetReadTimeout(0);
+
+  while (m_running) {
+    PIPSocket::SelectList sockets;
+    sockets += m_wakeSocket;
+
+    PTimeInterval selectTime = MaxSelectTime;
+    PTimeInterval now = PTimer::Tick();
+
+    m_mutex.Wait();
+    ChannelMap::iterator it = m_channels.begin();
+    while (it != m_channels.end()) {
+      Channel & channel = *static_cast<Channel *>(it->second.GetObject());
+
+      if (!channel.m_socket.IsOpen()) {
+        PTRACE(4, "H323\tChannel closed: " << *channel.m_transport);
+        if (!channel.m_readEnded)
+          QueueError(it->second, PChannel::NotOpen);
+        m_channels.erase(it++);
+        continue;
+      }
+
+      if (channel.m_readEnded) {
+        m_channels.erase(it++);
+        continue;
+      }
+
+      // Emulate the read timeout the blocking read would have had
+      PTimeInterval timeout = channel.m_socket.GetReadTimeout();
+      if (timeout != PMaxTimeInterval) {
+        PTimeInterval elapsed = now - channel.m_lastActivity;
+        if (elapsed >= timeout) {
+          channel.m_lastActivity = now;
+          QueueError(it->second, PChannel::Timeout);
+        }
+        else if (timeout - elapsed < selectTime)
+          selectTime = timeout - elapsed;
+      }
+
+      sockets += channel.m_socket;
+      ++it;
+    }
+    m_mutex.Signal();
+
+    PChannel::Errors status = PIPSocket::Select(sockets, selectTime);
+    if (status != PChannel::NoError) {
+      // A socket was closed under us, the next pass will clean it up
+      PTRACE_IF(2, status != PChannel::NotOpen, "H323\tSignal reactor select error: " << PChannel::GetErrorText(status));
+      if (status != PChannel::NotOpen)
+        PThread::Sleep(10);
+      continue;
+    }
+
+    for (PIPSocket::SelectList::iterator sock = sockets.begin(); sock != sockets.end(); ++sock) {
+      if (&*sock == &m_wakeSocket) {
+        BYTE dummy[16];
+        while (m_wakeSocket.Read(dummy, sizeof(dummy)))
+          ;
+        continue;
+      }
+
+      PSmartPointer channel;
+      m_mutex.Wait();
+      it = m_channels.find(&*sock);
+      if (it != m_channels.end()) {
+        channel = it->second;
+        ReadChannel(channel);
+      }
+      m_mutex.Signal();
+    }
+  }
+
+  PTRACE(4, "H323\tSignal reactor select thread ended");
+}
+
+
+void H323SignalReactor::SelectThread::ReadChannel(const PSmartPointer & ptr)
+{
+  Channel & channel = *static_cast<Channel *>(ptr.GetObject());
+  if (channel.m_readEnded)
+    return;
+
+  if (channel.m_buffer.GetSize() - channel.m_buffered < InitialBufferSize/4)
+    channel.m_buffer.SetSize(channel.m_buffer.GetSize()*2);
+
+  // Select says there is data (or EOF), so this returns what is there without blocking
+  bool ok = channel.m_socket.Read(channel.m_buffer.GetPointer() + channel.m_buffered,
+                                  channel.m_buffer.GetSize() - channel.m_buffered);
+  PChannel::Errors error = channel.m_socket.GetErrorCode(PChannel::LastReadError);
+
+  if (!ok) {
+    if (error == PChannel::Timeout)
+      return;
+    channel.m_readEnded = true;
+    QueueError(ptr, error != PChannel::NoError ? error : PChannel::NotOpen);
+    return;
+  }
+
+  channel.m_lastActivity = PTimer::Tick();
+  channel.m_buffered += channel.m_socket.GetLastReadCount();
+
+  PINDEX pos = 0;
+  while (channel.m_buffered - pos >= TPKTHeaderSize) {
+    const BYTE * tpkt = channel.m_buffer.GetPointer() + pos;
+    PINDEX length = (tpkt[2] << 8) | tpkt[3];
+    if (tpkt[0] != 3 || length < TPKTHeaderSize) {
+      PTRACE(1, "H323\tDwarf or invalid TPKT: version=" << (unsigned)tpkt[0] << " length=" << length);
+      channel.m_readEnded = true;
+      QueueError(ptr, PChannel::ProtocolFailure);
+      return;
+    }
+
+    if (channel.m_buffered - pos < length) {
+      if (length > channel.m_buffer.GetSize())
+        channel.m_buffer.SetSize(length);
+      break;
+    }
+
+    // Zero length TPKT is a keep alive, nothing to dispatch
+    if (length > TPKTHeaderSize)
+      m_reactor.QueueWork(new WorkItem(m_reactor, ptr, PChannel::NoError,
+                                       PBYTEArray(tpkt + TPKTHeaderSize, length - TPKTHeaderSize)),
+                          channel.m_token);
+    pos += length;
+  }
+
+  if (pos > 0) {
+    channel.m_buffered -= pos;
+    memmove(channel.m_buffer.GetPointer(), channel.m_buffer.GetPointer() + pos, channel.m_buffered);
+  }
+}
+
+
+void H323SignalReactor::SelectThread::QueueError(const PSmartPointer & ptr, PChannel::Errors error)
+{
+  Channel & channel = *static_cast<Channel *>(ptr.GetObject());
+  m_reactor.QueueWork(new WorkItem(m_reactor, ptr, error), channel.m_token);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+H323SignalReactor::WorkItem::WorkItem(H323SignalReactor & reactor,
+                                      const PSmartPointer & channel,
+                                      PChannel::Errors error,
+                                      const PBYTEArray & pdu)
+  : m_reactor(reactor)
+  , m_channel(channel)
+  , m_error(error)
+  , m_pdu(pdu)
+{
+  ++m_reactor.m_pendingWork;
+}
+
+
+H323SignalReactor::WorkItem::WorkItem(H323SignalReactor & reactor, H323Connection & connection)
+  : m_reactor(reactor)
+  , m_connection(&connection, PSafeReference)
+  , m_error(PChannel::NoError)
+{
+  ++m_reactor.m_pendingWork;
+}
+
+
+H323SignalReactor::WorkItem::~WorkItem()
+{
+  --m_reactor.m_pendingWork;
+}
+
+
+void H323SignalReactor::WorkItem::Work()
+{
+  if (m_connection != NULL) {
+    // A newly connected H.245 channel, does the initial negotiations
+    // then calls AddChannel() to have the reactor read it from now on.
+    m_connection->HandleControlChannel();
+  }
+  else
+    m_reactor.HandleChannel(*static_cast<Channel *>(m_channel.GetObject()), m_error, m_pdu);
+}
+
+
+void H323SignalReactor::HandleChannel(Channel & channel, PChannel::Errors error, const PBYTEArray & data)
+{
+  if (channel.m_handlerEnded)
+    return;
+
+  H323Connection & connection = *channel.m_connection;
+  PTRACE_CONTEXT_ID_PUSH_THREAD(connection);
+
+  /* The error is passed explicitly, setting it on the socket would race
+     with the select thread reading from it. */
+  bool keep;
+  if (channel.m_type == SignallingChannel) {
+    H323SignalPDU pdu;
+    keep = connection.HandleReceivedSignalPDU(error == PChannel::NoError && pdu.ProcessReadData(data), error, pdu);
+  }
+  else {
+    PPER_Stream strm(data);
+    keep = connection.HandleReceivedControlPDU(error == PChannel::NoError, error, strm);
+    if (keep)
+      connection.MonitorCallStatus();
+  }
+
+  if (keep)
+    return;
+
+  channel.m_handlerEnded = true;
+  RemoveChannel(*channel.m_transport);
+
+  if (channel.m_type == SignallingChannel)
+    connection.EndHandleSignallingChannel();
+  else {
+    connection.EndHandleControlChannel();
+    PTRACE(2, "H245\tControl channel closed.");
+  }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+H323SignalReactor::H323SignalReactor(H323EndPoint & endpoint, unsigned selectThreads, unsigned maxWorkers)
+  : m_endpoint(endpoint)
+  , m_pendingWork(0)
+  , m_workers(maxWorkers, 0, "H323 Signal", PThread::HighPriority)
+{
+  for (unsigned i = 0; i < selectThreads; ++i) {
+    SelectThread * thread = new SelectThread(*this, i+1);
+    if (!thread->IsRunning()) {
+      delete thread;
+      ShutDown();
+      return;
+    }
+    m_selectThreads.push_back(thread);
+  }
+
+  PTRACE(3, "H323\tSignal reactor started with " << selectThreads << " select threads and up to " << maxWorkers << " workers");
+}
+
+
+H323SignalReactor::~H323SignalReactor()
+{
+  ShutDown();
+}
+
+
+bool H323SignalReactor::CanMultiplex(const OpalTransport & transport) const
+{
+  // Only plain TCP, e.g. TLS has its own buffering so select() is not reliable
+  return !m_selectThreads.empty() && dynamic_cast<PTCPSocket *>(transport.GetChannel()) != NULL;
+}
+
+
+bool H323SignalReactor::AddChannel(H323Connection & connection, const OpalTransportPtr & transport, ChannelType type)
+{
+  if (transport == NULL || !CanMultiplex(*transport))
+    return false;
+
+  PTCPSocket & socket = *dynamic_cast<PTCPSocket *>(transport->GetChannel());
+
+  SelectThread * leastBusy = m_selectThreads.front();
+  PINDEX leastCount = leastBusy->GetCount();
+  for (size_t i = 1; i < m_selectThreads.size(); ++i) {
+    PINDEX count = m_selectThreads[i]->GetCount();
+    if (count < leastCount) {
+      leastBusy = m_selectThreads[i];
+      leastCount = count;
+    }
+  }
+
+  PTRACE(4, (type == SignallingChannel ? "H225" : "H245")
+            << "\tReading PDUs via reactor: " << *transport << " for " << connection);
+  leastBusy->Add(new Channel(connection, transport, socket, type));
+  return true;
+}
+
+
+void H323SignalReactor::RemoveChannel(const OpalTransport & transport)
+{
+  for (size_t i = 0; i < m_selectThreads.size(); ++i) {
+    if (m_selectThreads[i]->Remove(transport))
+      return;
+  }
+}
+
+
+void H323SignalReactor::QueueStartControlChannel(H323Connection & connection)
+{
+  QueueWork(new WorkItem(*this, connection), connection.GetToken());
+}
+
+
+void H323SignalReactor::ShutDown()
+{
+  for (size_t i = 0; i < m_selectThreads.size(); ++i)
+    delete m_selectThreads[i];
+  m_selectThreads.clear();
+}
+
+
+PINDEX H323SignalReactor::GetChannelCount()
+{
+  PINDEX count = 0;
+  for (size_t i = 0; i < m_selectThreads.size(); ++i)
+    count += m_selectThreads[i]->GetCount();
+  return count;
+}
+
+
+void H323SignalReactor::QueueWork(WorkItem * work, const PString & token)
+{
+  m_workers.AddWork(work, token);
+}
+
+
+#endif // OPAL_H323
+
+
+/////////////////////////////////////////////////////////////////////////////
@@ -109,6 +109,13 @@ PBoolean H323TransactionPDU::Read(H323Transport & transport)
 PBoolean H323TransactionPDU::Write(H323Transport & transport)
 {
   PPER_Stream strm;
+  Encode(strm);
+  return WriteEncoded(transport, strm);
+}
+
+
+void H323TransactionPDU::Encode(PPER_Stream & strm)
+{
   GetPDU().Encode(strm);
   strm.CompleteEncoding();
 
@@ -117,8 +124,12 @@ PBoolean H323TransactionPDU::Write(H323Transport & transport)
     iterAuth->Finalise(strm);
 
   H323TraceDumpPDU("Trans", true, strm, GetPDU(), GetChoice(), GetSequenceNumber());
+}
+
 
-  if (transport.WritePDU(strm))
+PBoolean H323TransactionPDU::WriteEncoded(H323Transport & transport, const PBYTEArray & encoded)
+{
+  if (transport.WritePDU(encoded))
     return true;
 
   PTRACE(1, GetProtocolName() << "\tWrite PDU failed ("
@@ -174,6 +185,8 @@ void H323Transactor::Construct()
   m_nextSequenceNumber = PRandom::Number()%65536;
   m_checkResponseCryptoTokens = true;
   m_lastRequest = NULL;
+  m_readPDU = NULL;
+  m_readPDUDetached = false;
 
   m_requests.DisallowDeleteObjects();
 }
@@ -257,6 +270,11 @@ void H323Transactor::HandleTransactions(PThread &, P_INT_PTR)
   while (ok) {
     PTRACE(5, "Trans\tReading PDU");
     H323TransactionPDU * response = CreateTransactionPDU();
+    m_readPDUMutex.Wait();
+    m_readPDU = response;
+    m_readPDUDetached = false;
+    m_readPDUMutex.Signal();
+
     if (response->Read(*m_transport)) {
       if (m_transport->GetInterface().IsEmpty())
         m_transport->SetInterface(m_transport->GetLastReceivedInterface());
@@ -292,7 +310,13 @@ void H323Transactor::HandleTransactions(PThread &, P_INT_PTR)
       }
     }
 
-    delete response;
+    // If an H323Transaction took it, it is now responsible for deleting it
+    m_readPDUMutex.Wait();
+    if (!m_readPDUDetached)
+      delete response;
+    m_readPDU = NULL;
+    m_readPDUMutex.Signal();
+
     AgeResponses();
   }
 
@@ -365,10 +389,38 @@ PBoolean H323Transactor::WritePDU(H323TransactionPDU & pdu)
 
   Response key(m_transport->GetLastReceivedAddress(), pdu.GetSequenceNumber());
   PINDEX idx = m_responses.GetValuesIndex(key);
-  if (idx != P_MAX_INDEX)
-    m_responses[idx].SetPDU(pdu);
+  if (idx == P_MAX_INDEX)
+    return pdu.Write(*m_transport);
+
+  // Cache the encoded reply rather than a copy of the PDU for retries
+  PPER_Stream strm;
+  pdu.Encode(strm);
+  m_responses[idx].SetPDU(strm, pdu.GetRequestInProgressDelay());
+  return pdu.WriteEncoded(*m_transport, strm);
+}
 
-  return pdu.Write(*m_transport);
+
+H323TransactionPDU * H323Transactor::DetachReadPDU(const H323TransactionPDU & pdu)
+{
+  PWaitAndSignal mutex(m_readPDUMutex);
+
+  if (&pdu != m_readPDU || m_readPDUDetached)
+    return pdu.ClonePDU();
+
+  m_readPDUDetached = true;
+  return m_readPDU;
+}
+
+
+void H323Transactor::ReleaseReadPDU(H323TransactionPDU * pdu)
+{
+  PWaitAndSignal mutex(m_readPDUMutex);
+
+  // Still being handled by HandleTransactions(), which will delete it
+  if (pdu == m_readPDU)
+    m_readPDUDetached = false;
+  else
+    delete pdu;
 }
 
 
@@ -615,27 +667,16 @@ H323Transactor::Response::Response(const H323TransportAddress & addr, unsigned s
     m_retirementAge(ResponseRetirementAge)
 {
   sprintf("#%u", seqNum);
-  m_replyPDU = NULL;
-}
-
-
-H323Transactor::Response::~Response()
-{
-  if (m_replyPDU != NULL)
-    m_replyPDU->DeletePDU();
 }
 
 
-void H323Transactor::Response::SetPDU(const H323TransactionPDU & pdu)
+void H323Transactor::Response::SetPDU(const PBYTEArray & encoded, unsigned delay)
 {
   PTRACE(4, "Trans\tAdding cached response: " << *this);
 
-  if (m_replyPDU != NULL)
-    m_replyPDU->DeletePDU();
-  m_replyPDU = pdu.ClonePDU();
+  m_replyPDU = encoded;
   m_lastUsedTime = PTime();
 
-  unsigned delay = pdu.GetRequestInProgressDelay();
   if (delay > 0)
     m_retirementAge = ResponseRetirementAge + delay;
 }
@@ -645,10 +686,10 @@ PBoolean H323Transactor::Response::SendCachedResponse(H323Transport & transport)
 {
   PTRACE(3, "Trans\tSending cached response: " << *this);
 
-  if (m_replyPDU != NULL) {
+  if (!m_replyPDU.IsEmpty()) {
     H323TransportAddress oldAddress = transport.GetRemoteAddress();
     transport.ConnectTo(Left(FindLast('#')));
-    m_replyPDU->Write(transport);
+    transport.WritePDU(m_replyPDU);
     transport.ConnectTo(oldAddress);
   }
   else {
@@ -668,7 +709,7 @@ H323Transaction::H323Transaction(H323Transactor & trans,
                                  H323TransactionPDU * rej)
   : m_transactor(trans),
     m_replyAddresses(trans.GetTransport().GetLastReceivedAddress()),
-    m_request(requestToCopy.ClonePDU())
+    m_request(trans.DetachReadPDU(requestToCopy))
 {
   m_confirm = conf;
   m_reject = rej;
@@ -681,7 +722,7 @@ H323Transaction::H323Transaction(H323Transactor & trans,
 
 H323Transaction::~H323Transaction()
 {
-  delete m_request;
+  m_transactor.ReleaseReadPDU(m_request);
   delete m_confirm;
   delete m_reject;
 }
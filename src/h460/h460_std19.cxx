@@ -437,15 +437,18 @@ H46019UDPSocket::H46019UDPSocket(PNatMethod::Component component, OpalRTPSession
   , m_session(session)
   , m_keepAlivePayloadType(RTP_DataFrame::IllegalPayloadType)
   , m_keepAliveSequence(0)
+  , P_DISABLE_MSVC_WARNINGS(4355, m_keepAliveClient(*this, component == PNatMethod::eComponent_RTP
+                                                             ? OpalKeepAliveScheduler::e_RTPKeepAlive
+                                                             : OpalKeepAliveScheduler::e_RTCPKeepAlive))
+  , m_keepAliveScheduler(session.GetConnection().GetEndPoint().GetManager().GetKeepAliveScheduler())
   , m_multiplexedTransmit(false)
 {
-  m_keepAliveTimer.SetNotifier(PCREATE_NOTIFIER(KeepAliveTimeout), "H460KeepAlive");
 }
 
 
 H46019UDPSocket::~H46019UDPSocket()
 {
-  m_keepAliveTimer.Stop();
+  m_keepAliveScheduler.Remove(m_keepAliveClient);
 }
 
 
@@ -479,6 +482,7 @@ void H46019UDPSocket::ActivateKeepAliveRTP(const H323TransportAddress & address,
 
   PTRACE(4, "Started RTP Keep Alive to " << m_keepAliveAddress << " every " << m_keepAliveTTL << " secs.");
   SendKeepAliveRTP(m_keepAliveAddress);
+  m_keepAliveScheduler.Add(m_keepAliveClient, m_keepAliveTTL);
 }
 
 
@@ -491,25 +495,26 @@ void H46019UDPSocket::ActivateKeepAliveRTCP(unsigned ttl)
 
   PTRACE(4, "Started RTCP Keep Alive reports every " << m_keepAliveTTL << " secs.");
   m_session.SendReport(0, true);
+  m_keepAliveScheduler.Add(m_keepAliveClient, m_keepAliveTTL);
 }
 
 
-void H46019UDPSocket::KeepAliveTimeout(PTimer &, P_INT_PTR)
+bool H46019UDPSocket::KeepAliveTimeout()
 {
   PTRACE(4, "Keep Alive timer fired for " << (m_component == PNatMethod::eComponent_RTP ? "RTP" : "RTCP"));
   if (m_component == PNatMethod::eComponent_RTCP)
-    m_session.SendReport(0, true);
+    return m_session.SendReport(0, true) != OpalRTPSession::e_AbortTransport;
   else
-    SendKeepAliveRTP(m_keepAliveAddress);
+    return SendKeepAliveRTP(m_keepAliveAddress);
 }
 
 
-void H46019UDPSocket::SendKeepAliveRTP(const PIPSocketAddressAndPort & ipAndPort)
+bool H46019UDPSocket::SendKeepAliveRTP(const PIPSocketAddressAndPort & ipAndPort)
 {
   RTP_DataFrame rtp;
   rtp.SetSequenceNumber(m_keepAliveSequence);
   rtp.SetPayloadType(m_keepAlivePayloadType);
-  m_session.WriteData(rtp, OpalRTPSession::e_RewriteSSRC, &ipAndPort);
+  return m_session.WriteData(rtp, OpalRTPSession::e_RewriteSSRC, &ipAndPort) != OpalRTPSession::e_AbortTransport;
 }
 
 
@@ -523,7 +528,7 @@ PBoolean H46019UDPSocket::InternalWriteTo(const Slice * slices, size_t sliceCoun
 
   // Sent something to keep alive, so reset timer
   if (m_component == PNatMethod::eComponent_RTCP || ipAndPort == m_keepAliveAddress)
-    m_keepAliveTimer = m_keepAliveTTL;
+    m_keepAliveClient.ResetKeepAlive();
 
   Slice * adjustedSlices;
   size_t adjustedCount;
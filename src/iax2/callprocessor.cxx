@@ -120,7 +120,7 @@ void IAX2CallProcessor::AssignConnection(IAX2Connection * _con)
 
   remote.SetSourceCallNumber(newCallNumber);
   
-  Resume();
+  Start();
 }
 
 void IAX2CallProcessor::PrintOn(ostream & strm) const
@@ -157,7 +157,7 @@ void IAX2CallProcessor::OnReleased()
 void IAX2CallProcessor::PutSoundPacketToNetwork(PBYTEArray *sound)
 {
   /*This thread does not send the audio frame. 
-    The IAX2CallProcessor thread sends the audio frame */
+    The IAX2CallProcessor work, in the thread pool, sends the audio frame */
   soundWaitingForTransmission.AddNewEntry(sound);
   
   CleanPendingLists();
@@ -195,7 +195,7 @@ void IAX2CallProcessor::Hangup(PString dieMessage)
   PTRACE(3, "Hangup request " << dieMessage);
   hangList.AppendString(dieMessage);   //send this text to remote endpoint 
   
-  activate.Signal();
+  Activate();
 }
 
 void IAX2CallProcessor::CheckForHangupMessages()
@@ -216,7 +216,6 @@ void IAX2CallProcessor::CheckForHangupMessages()
     f->AppendIe(new IAX2IeCause(hangList.GetFirstDeleteAll()));
     f->AppendIe(new IAX2IeCauseCode(IAX2IeCauseCode::NormalClearing));
     TransmitFrameToRemoteEndpoint(f);  
-    PThread::Sleep(2);
   } else {
     PTRACE(3, "hangup message required. Not sending, cause already have a hangup message in queue");
   }
@@ -484,14 +483,14 @@ void IAX2CallProcessor::SendDtmf(const PString & dtmfs)
 {
   PTRACE(4, "Activate the iax2 processeor, DTMF of  " << dtmfs << " to send");
   dtmfText += dtmfs;
-  activate.Signal();
+  Activate();
 }
 
 void IAX2CallProcessor::SendText(const PString & text)
 {
   PTRACE(4, "Activate the iax2 processeor, text of " << text << " to send");
   textList.AppendString(text);
-  activate.Signal();
+  Activate();
 }
 
 void IAX2CallProcessor::SendHold()
@@ -515,7 +514,7 @@ void IAX2CallProcessor::SendTransfer(
     transferCalledContext = calledContext;
   }
   
-  activate.Signal();
+  Activate();
 }
 
 
@@ -962,7 +961,18 @@ void IAX2CallProcessor::ProcessIaxCmdNew(IAX2FullFrameProtocol *src)
   }
 
   IAX2FullFrameProtocol * reply;
-    
+
+  if (!con->GetEndPoint().GetManager().GetAdmissionController()->CanAcceptCall()) {
+    PTRACE(3, "CallProc\tNew call rejected by admission control");
+    reply = new IAX2FullFrameProtocol(this, IAX2FullFrameProtocol::cmdReject, IAX2FullFrame::callIrrelevant);
+    reply->AppendIe(new IAX2IeCause("Service unavailable"));
+    reply->AppendIe(new IAX2IeCauseCode(IAX2IeCauseCode::SwitchCongestion));
+    TransmitFrameToRemoteEndpoint(reply);
+    con->ClearCall(OpalConnection::EndedByLocalCongestion);
+    delete src;
+    return;
+  }
+
   if (!RemoteSelectedCodecOk()) {
     PTRACE(3, "CallProc\tRemote node sected a bad codec, hangup call ");
     reply = new  IAX2FullFrameProtocol(this, IAX2FullFrameProtocol::cmdInval, src, IAX2FullFrame::callIrrelevant);
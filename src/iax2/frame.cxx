@@ -76,6 +76,8 @@ void IAX2Frame::ZeroAllValues()
   isFullFrame       = false;
   isVideo           = false;
   isAudio           = false;
+  isTrunk           = false;
+  isEncrypted       = false;
   
   currentReadIndex  = 0;
   currentWriteIndex = 0;
@@ -217,7 +219,15 @@ PBoolean IAX2Frame::ProcessNetworkPacket()
     remote.SetDestCallNumber(a & 0x7fff);
     return true;
   }
-  if (a == 0) {    //We have a mini frame here, of video type.
+  if (a == 0) {
+    if ((data[2] & 0x80) == 0) {
+      //We have a meta frame, which is split up by the receiver
+      isTrunk = data[2] == MetaTrunk;
+      PTRACE_IF(3, !isTrunk, "Frame\tUnknown meta command " << (unsigned)data[2]);
+      return isTrunk;
+    }
+
+    //We have a mini frame here, of video type.
     isVideo = true;
     PINDEX b = 0;
     Read2Bytes(b);
@@ -230,6 +240,70 @@ PBoolean IAX2Frame::ProcessNetworkPacket()
   return true;
 }
 
+void IAX2Frame::SplitTrunkFrame(IAX2FrameList & frames)
+{
+  /*The meta trunk header is 2 zero bytes, the meta command, the command
+    data and then a 4 byte timestamp. Each entry is then either
+    length, call number, timestamp and data (MetaTrunkMini), or
+    call number, length and data (MetaTrunkSuperMini) */
+  if (data.GetSize() < 8) {
+    PTRACE(3, "Frame\tTrunk frame too small " << IdString());
+    return;
+  }
+
+  const BYTE * ptr = data;
+  PBoolean withTimeStamps = (ptr[3] & MetaTrunkMini) != 0;
+  DWORD trunkTimeStamp = (ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
+  PINDEX headerSize = withTimeStamps ? 6 : 4;
+
+  PINDEX entries = 0;
+  PINDEX pos = 8;
+  while (pos + headerSize <= data.GetSize()) {
+    PINDEX length, callNumber;
+    WORD entryTimeStamp;
+    if (withTimeStamps) {
+      length         = (ptr[pos]   << 8) | ptr[pos+1];
+      callNumber     = ((ptr[pos+2] << 8) | ptr[pos+3]) & 0x7fff;
+      entryTimeStamp = (WORD)((ptr[pos+4] << 8) | ptr[pos+5]);
+    }
+    else {
+      callNumber     = ((ptr[pos]   << 8) | ptr[pos+1]) & 0x7fff;
+      length         = (ptr[pos+2] << 8) | ptr[pos+3];
+      entryTimeStamp = (WORD)trunkTimeStamp;
+    }
+    pos += headerSize;
+
+    if (pos + length > data.GetSize()) {
+      PTRACE(3, "Frame\tTrunk frame entry overruns frame " << IdString());
+      break;
+    }
+
+    if (callNumber != 0) {
+      /*Rebuild the mini frame, as if it had been sent on its own */
+      IAX2Frame * frame = new IAX2Frame(endpoint);
+      frame->remote = remote;
+      frame->data.SetSize(4 + length);
+      BYTE * mini = frame->data.GetPointer();
+      mini[0] = (BYTE)(callNumber >> 8);
+      mini[1] = (BYTE)callNumber;
+      mini[2] = (BYTE)(entryTimeStamp >> 8);
+      mini[3] = (BYTE)entryTimeStamp;
+      memcpy(mini + 4, ptr + pos, length);
+
+      if (frame->ProcessNetworkPacket()) {
+        frames.AddNewFrame(frame);
+        entries++;
+      }
+      else
+        delete frame;
+    }
+
+    pos += length;
+  }
+
+  PTRACE(6, "Frame\tTrunk frame " << IdString() << " split into " << entries << " mini frames");
+}
+
 void IAX2Frame::BuildConnectionToken()
 {
   connectionToken = remote.BuildConnectionToken();
@@ -384,6 +458,7 @@ PBoolean IAX2Frame::EncryptContents(IAX2Encryption &encryption)
   }
 
   data = result;
+  isEncrypted = true;
   return true;
 #else
   PTRACE(1, "Frame\tEncryption is Flagged on, but AES routines in openssl are not available");
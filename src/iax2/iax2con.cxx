@@ -90,10 +90,12 @@ IAX2Connection::IAX2Connection(OpalCall & call,               /* Owner call for
 
 IAX2Connection::~IAX2Connection()
 {
+  endpoint.RemoveFromCallNumberTable(*this);
   iax2Processor.Terminate();
-  iax2Processor.WaitForTermination(1000);
-  if (!iax2Processor.IsTerminated()) {
-    PAssertAlways("List rpocessor failed to terminate");
+
+  // Must not delete the processor while the worker is still using it
+  while (!iax2Processor.WaitForTermination(1000)) {
+    PTRACE(2, "IAX2Con\tProcessor slow to terminate, still waiting");
   }
   PTRACE(3, "connection has terminated");
 
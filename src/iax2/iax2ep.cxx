@@ -48,8 +48,9 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
-IAX2EndPoint::IAX2EndPoint(OpalManager & mgr)
+IAX2EndPoint::IAX2EndPoint(OpalManager & mgr, unsigned maxThreads)
   : OpalEndPoint(mgr, "iax2", IsNetworkEndPoint | SupportsE164)
+  , m_processorThreadPool(maxThreads)
   , m_callsEstablished(0)
 {
   m_localUserName = mgr.GetDefaultUserName();
@@ -67,6 +68,9 @@ IAX2EndPoint::IAX2EndPoint(OpalManager & mgr)
   //We handle the deletion of regProcessor objects.
   m_regProcessors.AllowDeleteObjects(false);
 
+  m_remoteCallNumbers.resize(MaxCallNumbers);
+  m_localCallNumbers.resize(MaxCallNumbers, NULL);
+
   Initialise();
   PTRACE(5, "Iax2Ep\tCreated endpoint.");
 }
@@ -225,6 +229,17 @@ PINDEX IAX2EndPoint::NextSrcCallNumber(IAX2Processor * /*processor*/)
 
 PBoolean IAX2EndPoint::ConnectionForFrameIsAlive(IAX2Frame *f)
 {
+  {
+    IAX2Remote & remote = f->GetRemoteInfo();
+    PINDEX callNumber = remote.SourceCallNumber();
+    if (callNumber > 1 && callNumber < MaxCallNumbers) {
+      PReadWaitAndSignal lock(m_mutexCallNumberTable);
+      IAX2CallProcessor * processor = m_localCallNumbers[callNumber];
+      if (processor != NULL && processor->GetRemoteInfo().RemoteAddress() == remote.RemoteAddress())
+        return true;
+    }
+  }
+
   PString frameToken = f->GetConnectionToken();
 
   // ReportStoredConnections();
@@ -365,6 +380,7 @@ void IAX2EndPoint::OnReleased(OpalConnection & opalCon)
   m_mutexTokenTable.StartWrite();
   m_tokenTable.RemoveAt(token);
   m_mutexTokenTable.EndWrite();
+  RemoveFromCallNumberTable(con);
   OpalEndPoint::OnReleased(opalCon);
 }
 
@@ -559,6 +575,8 @@ PBoolean IAX2EndPoint::ProcessFrameInConnection(IAX2Frame *f,
     (m_connectionsActive.FindWithLock(token));
   if (connection != NULL) {
     PTRACE(5, "Distribution\tHave a connection for " << f->GetRemoteInfo());
+    if (!connection->IsReleased())
+      AddToCallNumberTable(*connection, *f);
     connection->IncomingEthernetFrame(f);
     return true;
   }
@@ -568,6 +586,121 @@ PBoolean IAX2EndPoint::ProcessFrameInConnection(IAX2Frame *f,
   return false;
 }
 
+PBoolean IAX2EndPoint::ProcessInCallNumberTable(IAX2Frame *f)
+{
+  IAX2Remote & remote = f->GetRemoteInfo();
+  PINDEX callNumber = remote.SourceCallNumber();
+  if (callNumber <= 1 || callNumber >= MaxCallNumbers)
+    return false; // Not yet allocated by the remote, or a video mini frame
+
+  PIPSocket::Address address = remote.RemoteAddress();
+
+  PReadWaitAndSignal lock(m_mutexCallNumberTable);
+
+  IAX2CallProcessor * processor = NULL;
+  const CallNumberEntry & entry = m_remoteCallNumbers[callNumber];
+  if (entry.m_processor != NULL && entry.m_address == address)
+    processor = entry.m_processor;
+  else {
+    std::multimap<PINDEX, CallNumberEntry>::const_iterator it = m_callNumberOverflow.find(callNumber);
+    while (it != m_callNumberOverflow.end() && it->first == callNumber) {
+      if (it->second.m_address == address) {
+        processor = it->second.m_processor;
+        break;
+      }
+      ++it;
+    }
+  }
+
+  /* Frames arriving during termination may be acks for the hangup, these
+     need the transmitter, so leave them to the connection. */
+  if (processor == NULL || processor->IsCallTerminating())
+    return false;
+
+  PTRACE(6, "Distribution\tCall number table has processor for " << remote);
+  processor->IncomingEthernetFrame(f);
+  return true;
+}
+
+void IAX2EndPoint::AddToCallNumberTable(IAX2Connection & connection, IAX2Frame & frame)
+{
+  IAX2CallProcessor & processor = connection.GetCallProcessor();
+  PINDEX remoteCallNumber = frame.GetRemoteInfo().SourceCallNumber();
+  PINDEX localCallNumber = processor.GetRemoteInfo().SourceCallNumber();
+  if (remoteCallNumber <= 1 || remoteCallNumber >= MaxCallNumbers ||
+      localCallNumber <= 0 || localCallNumber >= MaxCallNumbers)
+    return;
+
+  PIPSocket::Address address = frame.GetRemoteInfo().RemoteAddress();
+
+  PWriteWaitAndSignal lock(m_mutexCallNumberTable);
+
+  if (m_callNumbersOfConnection.find(&connection) != m_callNumbersOfConnection.end())
+    return;
+
+  CallNumberEntry & entry = m_remoteCallNumbers[remoteCallNumber];
+  if (entry.m_processor == NULL) {
+    entry.m_address = address;
+    entry.m_processor = &processor;
+  }
+  else {
+    CallNumberEntry overflow;
+    overflow.m_address = address;
+    overflow.m_processor = &processor;
+    m_callNumberOverflow.insert(std::make_pair(remoteCallNumber, overflow));
+  }
+
+  if (m_localCallNumbers[localCallNumber] == NULL)
+    m_localCallNumbers[localCallNumber] = &processor;
+
+  m_callNumbersOfConnection[&connection] = std::make_pair(remoteCallNumber, localCallNumber);
+
+  PTRACE(4, "Iax2Ep\tAdded call numbers " << remoteCallNumber << '/' << localCallNumber
+         << " from " << address << " to table for " << connection);
+}
+
+void IAX2EndPoint::RemoveFromCallNumberTable(IAX2Connection & connection)
+{
+  PWriteWaitAndSignal lock(m_mutexCallNumberTable);
+
+  std::map<IAX2Connection *, std::pair<PINDEX, PINDEX> >::iterator it = m_callNumbersOfConnection.find(&connection);
+  if (it == m_callNumbersOfConnection.end())
+    return;
+
+  IAX2CallProcessor * processor = &connection.GetCallProcessor();
+  PINDEX remoteCallNumber = it->second.first;
+  PINDEX localCallNumber = it->second.second;
+  m_callNumbersOfConnection.erase(it);
+
+  CallNumberEntry & entry = m_remoteCallNumbers[remoteCallNumber];
+  if (entry.m_processor == processor) {
+    // Promote an overflow entry, if any, to the direct slot
+    std::multimap<PINDEX, CallNumberEntry>::iterator overflow = m_callNumberOverflow.find(remoteCallNumber);
+    if (overflow != m_callNumberOverflow.end()) {
+      entry = overflow->second;
+      m_callNumberOverflow.erase(overflow);
+    }
+    else
+      entry = CallNumberEntry();
+  }
+  else {
+    std::multimap<PINDEX, CallNumberEntry>::iterator overflow = m_callNumberOverflow.find(remoteCallNumber);
+    while (overflow != m_callNumberOverflow.end() && overflow->first == remoteCallNumber) {
+      if (overflow->second.m_processor == processor) {
+        m_callNumberOverflow.erase(overflow);
+        break;
+      }
+      ++overflow;
+    }
+  }
+
+  if (m_localCallNumbers[localCallNumber] == processor)
+    m_localCallNumbers[localCallNumber] = NULL;
+
+  PTRACE(4, "Iax2Ep\tRemoved call numbers " << remoteCallNumber << '/' << localCallNumber
+         << " from table for " << connection);
+}
+
 //The receiving thread has finished reading a frame, and has droppped it here.
 //At this stage, we do not know the frame type. We just know the frame is
 // of type  full or mini.
@@ -591,6 +724,9 @@ void IAX2EndPoint::ProcessReceivedEthernetFrames()
     
     PString idString = f->IdString();
     PTRACE(5, "Distribution\tNow try to find a home for " << idString);
+    if (ProcessInCallNumberTable(f))
+      continue;
+
     if (ProcessInMatchingConnection(f)) {
       continue;
     }
@@ -728,6 +864,29 @@ void IAX2EndPoint::SetLocalNumber(PString newValue)
   m_localNumber = newValue; 
 }
 
+PBoolean IAX2EndPoint::SetTrunkPeer(const PString & host, PBoolean enable)
+{
+  if (transmitter == NULL)
+    return false;
+
+  PStringArray res = DissectRemoteParty(host);
+  PIPSocket::Address ip;
+  if (!PIPSocket::GetHostAddress(res[addressIndex], ip)) {
+    PTRACE(2, "IAX2\tFailed to lookup trunk peer " << host);
+    return false;
+  }
+
+  WORD port = res[portIndex].IsEmpty() ? ListenPortNumber() : (WORD)res[portIndex].AsUnsigned();
+  transmitter->SetTrunkPeer(ip, port, enable);
+  return true;
+}
+
+void IAX2EndPoint::SetTrunkInterval(const PTimeInterval & interval)
+{
+  if (transmitter != NULL)
+    transmitter->SetTrunkInterval(interval);
+}
+
 void IAX2EndPoint::Register(
       const PString & host,
       const PString & username,
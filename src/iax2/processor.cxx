@@ -109,13 +109,25 @@ PString IAX2WaitingForAck::GetResponseAsString() const
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void IAX2ProcessorWork::Work()
+{
+  m_processor.ProcessWork();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 IAX2Processor::IAX2Processor(IAX2EndPoint &ep)
-  : PThread(1000, NoAutoDeleteThread, NormalPriority, "IAX2 Processor")
-  , endpoint(ep)
+  : endpoint(ep)
+  , started(false)
+  , workQueued(false)
+  , activatePending(false)
+  , noResponseTimedOut(false)
+  , endThread(false)
+  , terminated(false)
   , controlFramesSent(0)
   , controlFramesRcvd(0)
 {
-  endThread = false;
+  workGroup = psprintf("IAX2Proc%p", this);
   
   remote.SetDestCallNumber(0);
   remote.SetRemoteAddress(0);
@@ -135,17 +147,17 @@ IAX2Processor::~IAX2Processor()
 
   StopNoResponseTimer();
   
+  // Cannot be deleted while the worker may still be using us
   Terminate();
-  WaitForTermination(10000);
+  while (!WaitForTermination(10000)) {
+    PTRACE(1, "Processor\tStill waiting for termination");
+  }
 
   frameList.AllowDeleteObjects();
 }
 
 void IAX2Processor::SetCallToken(const PString & newToken) 
 {
-  if (!IsHandlingSpecialPackets())
-    SetThreadName("Proc" + newToken);
-
   callToken = newToken;
 } 
 
@@ -154,20 +166,36 @@ PString IAX2Processor::GetCallToken()
   return callToken;
 }
 
-void IAX2Processor::Main()
+void IAX2Processor::Start()
 {
-  PTRACE(3, "Processor\tStart of iax2 processing thread");
-  PString name = GetThreadName();
-  if (IsHandlingSpecialPackets())
-    SetThreadName("Special Iax packets");
-
-  while(endThread == false) {
-    activate.Wait();
-    ProcessLists();
+  PTRACE(3, "Processor\tStart of iax2 processing");
+
+  PWaitAndSignal m(activateMutex);
+  started = true;
+  if (activatePending || endThread) {
+    activatePending = false;
+    workQueued = true;
+    endpoint.GetProcessorThreadPool().AddWork(new IAX2ProcessorWork(*this), workGroup);
   }
+}
+
+void IAX2Processor::ProcessWork()
+{
+  activateMutex.Wait();
+  workQueued = false;
+  activateMutex.Signal();
+
+  if (noResponseTimedOut.exchange(false))
+    OnNoResponseTimeout();
+
   ProcessLists();
-    
-  PTRACE(3, "End of iax connection processing");
+
+  PWaitAndSignal m(activateMutex);
+  if (endThread && !workQueued && !terminated) {
+    PTRACE(3, "End of iax connection processing");
+    terminated = true;
+    terminatedSync.Signal();
+  }
 }
 
 PBoolean IAX2Processor::IsStatusQueryEthernetFrame(IAX2Frame *frame)
@@ -220,27 +248,58 @@ void IAX2Processor::StartNoResponseTimer(PINDEX msToWait)
 
 void IAX2Processor::OnNoResponseTimeoutStart(PTimer &, P_INT_PTR)
 {
-  //call sub class to alert that there was a timeout for a response from the server
-  OnNoResponseTimeout();
+  //call sub class, from the thread pool, to alert that there was a timeout for a response from the server
+  noResponseTimedOut = true;
+  Activate();
 }
 
 void IAX2Processor::Activate()
 {
-  activate.Signal();
+  PWaitAndSignal m(activateMutex);
+
+  if (terminated || workQueued)
+    return;
+
+  if (!started) {
+    activatePending = true;
+    return;
+  }
+
+  workQueued = true;
+  endpoint.GetProcessorThreadPool().AddWork(new IAX2ProcessorWork(*this), workGroup);
 }
 
 void IAX2Processor::Terminate()
 {
   endThread = true;
-  if (IsSuspended())
-    Resume();
 
   PTRACE(4, "Processor\tProcessor has been directed to end. " 
 	 << (IsTerminated() ? "Has already ended" : "So end now."));
-  
+
+  // A processor that was never started still needs to process what is pending
+  activateMutex.Wait();
+  started = true;
+  activateMutex.Signal();
+
   Activate();
 }
 
+PBoolean IAX2Processor::WaitForTermination(const PTimeInterval & maxWait)
+{
+  if (!terminated) {
+    if (!terminatedSync.Wait(maxWait) && !terminated)
+      return false;
+
+    // Let any other waiter know too
+    terminatedSync.Signal();
+  }
+
+  /* The worker sets terminated, and signals, with the mutex held, so once we
+     have the mutex it is no longer using this object, and it may be deleted. */
+  PWaitAndSignal m(activateMutex);
+  return terminated;
+}
+
 PBoolean IAX2Processor::ProcessOneIncomingEthernetFrame()
 {  
   IAX2Frame *frame = frameList.GetLastFrame();
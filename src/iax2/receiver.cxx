@@ -103,6 +103,13 @@ void IAX2Receiver::Main()
 void IAX2Receiver::AddNewReceivedFrame(IAX2Frame *newFrame)
 {
   /**This method may split a frame up (if it is trunked) */
+  if (newFrame->IsTrunkFrame()) {
+    PTRACE(6, "IAX2 Rx\tSplit trunk frame into list of received frames " << newFrame->IdString());
+    newFrame->SplitTrunkFrame(fromNetworkFrames);
+    delete newFrame;
+    return;
+  }
+
   PTRACE(6, "IAX2 Rx\tAdd frame to list of received frames " << newFrame->IdString());
   fromNetworkFrames.AddNewFrame(newFrame);
 }
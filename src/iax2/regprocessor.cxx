@@ -73,7 +73,7 @@ IAX2RegProcessor::IAX2RegProcessor(
   remote.SetRemoteAddress(ip);
   
   Activate();
-  Resume();
+  Start();
 }
 
 IAX2RegProcessor::~IAX2RegProcessor()
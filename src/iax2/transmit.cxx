@@ -39,10 +39,28 @@
 
 #define new PNEW
 
+/**Keep trunk frames within a typical ethernet MTU */
+static const PINDEX MaxTrunkFrameSize = 1400;
+
+/**Meta trunk header, and the header of each trunk entry with timestamps */
+static const PINDEX TrunkHeaderSize = 8;
+static const PINDEX TrunkEntryHeaderSize = 6;
+
+IAX2Transmit::TrunkPeer::TrunkPeer(const PIPSocket::Address & addr, WORD _port)
+  : address(addr)
+  , port(_port)
+  , startTick(PTimer::Tick())
+  , data(MaxTrunkFrameSize)
+  , size(0)
+{
+}
+
 IAX2Transmit::IAX2Transmit(IAX2EndPoint & _newEndpoint, PUDPSocket & _newSocket)
   : PThread(1000, NoAutoDeleteThread, NormalPriority, "IAX2 Transmitter"),
      ep(_newEndpoint),
-     sock(_newSocket)
+     sock(_newSocket),
+     trunking(false),
+     trunkInterval(20)
 {
   sendNowFrames.Initialise();
   ackingFrames.Initialise();
@@ -93,14 +111,45 @@ void IAX2Transmit::SendVnakRequestedFrames(IAX2FullFrameProtocol &src)
   ackingFrames.SendVnakRequestedFrames(src);
 }
 
+void IAX2Transmit::SetTrunkPeer(const PIPSocket::Address & address, WORD port, bool enable)
+{
+  TrunkPeerKey key(address, port);
+
+  PWaitAndSignal m(trunkMutex);
+  TrunkPeerMap::iterator it = trunkPeers.find(key);
+  if (enable) {
+    if (it == trunkPeers.end()) {
+      PTRACE(3, "IAX2Transmit\tEnable trunking to " << address << ':' << port);
+      trunkPeers.insert(TrunkPeerMap::value_type(key, TrunkPeer(address, port)));
+    }
+  }
+  else if (it != trunkPeers.end()) {
+    PTRACE(3, "IAX2Transmit\tDisable trunking to " << address << ':' << port);
+    if (it->second.size > 0)
+      sock.WriteTo(it->second.data, it->second.size, it->second.address, it->second.port);
+    trunkPeers.erase(it);
+  }
+  trunking = !trunkPeers.empty();
+}
+
+void IAX2Transmit::SetTrunkInterval(const PTimeInterval & interval)
+{
+  trunkMutex.Wait();
+  trunkInterval = interval > 0 ? interval : PTimeInterval(20);
+  trunkMutex.Signal();
+
+  activate.Signal();
+}
+
 void IAX2Transmit::Main()
 {
   SetThreadName("IAX2Transmit");
+  PTimeInterval waitTime = PMaxTimeInterval;
   while(keepGoing) {
     if (!keepGoing)
       break;
 
-    activate.Wait();
+    activate.Wait(waitTime);
     
     if (!keepGoing)
       break;
@@ -108,7 +157,13 @@ void IAX2Transmit::Main()
     ProcessAckingList();
     
     ProcessSendList();
+
+    waitTime = ProcessTrunks();
   }
+
+  // Send any partly built trunk frames rather than lose the media in them
+  ProcessTrunks(true);
+
   PTRACE(6, "IAX2Transmit\tEnd of the Transmit thread.");  
 }
 
@@ -150,6 +205,11 @@ void IAX2Transmit::ProcessSendList()
     if (active == NULL) 
       break;
     
+    if (AddToTrunk(active)) {
+      delete active;
+      continue;
+    }
+
     PBoolean isFullFrame = false;
     if (PIsDescendant(active, IAX2FullFrame)) {
       isFullFrame = true;
@@ -192,6 +252,91 @@ void IAX2Transmit::ProcessSendList()
   }
 }
 
+bool IAX2Transmit::AddToTrunk(IAX2Frame * frame)
+{
+  /*Only unencrypted audio mini frames are trunked, the entry timestamp
+    must be readable by the remote peer */
+  if (!trunking || frame->IsFullFrame() || !frame->IsAudio() || frame->IsEncrypted())
+    return false;
+
+  IAX2Remote & remote = frame->GetRemoteInfo();
+
+  PWaitAndSignal m(trunkMutex);
+
+  TrunkPeerMap::iterator it = trunkPeers.find(TrunkPeerKey(remote.RemoteAddress(), (WORD)remote.RemotePort()));
+  if (it == trunkPeers.end())
+    return false;
+
+  if (frame->CallMustBeActive() && !ep.ConnectionForFrameIsAlive(frame))
+    return false;  //Let the normal transmit path discard it
+
+  TrunkPeer & peer = it->second;
+  PINDEX mediaSize = frame->GetMediaDataSize();
+  if (TrunkHeaderSize + TrunkEntryHeaderSize + mediaSize > MaxTrunkFrameSize)
+    return false;
+
+  if (peer.size + TrunkEntryHeaderSize + mediaSize > MaxTrunkFrameSize) {
+    sock.WriteTo(peer.data, peer.size, peer.address, peer.port);
+    peer.size = 0;
+  }
+
+  BYTE * ptr = peer.data.GetPointer();
+  if (peer.size == 0) {
+    DWORD trunkTimeStamp = IAX2Frame::CalcTimeStamp(peer.startTick);
+    ptr[0] = 0;
+    ptr[1] = 0;
+    ptr[2] = IAX2Frame::MetaTrunk;
+    ptr[3] = IAX2Frame::MetaTrunkMini;
+    ptr[4] = (BYTE)(trunkTimeStamp >> 24);
+    ptr[5] = (BYTE)(trunkTimeStamp >> 16);
+    ptr[6] = (BYTE)(trunkTimeStamp >> 8);
+    ptr[7] = (BYTE)trunkTimeStamp;
+    peer.size = TrunkHeaderSize;
+    peer.firstTick = PTimer::Tick();
+  }
+
+  ptr += peer.size;
+  PINDEX callNumber = remote.SourceCallNumber() & 0x7fff;
+  DWORD timeStamp = frame->GetTimeStamp();
+  ptr[0] = (BYTE)(mediaSize >> 8);
+  ptr[1] = (BYTE)mediaSize;
+  ptr[2] = (BYTE)(callNumber >> 8);
+  ptr[3] = (BYTE)callNumber;
+  ptr[4] = (BYTE)(timeStamp >> 8);
+  ptr[5] = (BYTE)timeStamp;
+  memcpy(ptr + TrunkEntryHeaderSize, frame->GetMediaDataPointer(), mediaSize);
+  peer.size += TrunkEntryHeaderSize + mediaSize;
+
+  PTRACE(6, "IAX2Transmit\tAdded " << frame->IdString() << " to trunk frame for " << key);
+  return true;
+}
+
+PTimeInterval IAX2Transmit::ProcessTrunks(bool force)
+{
+  PTimeInterval waitTime = PMaxTimeInterval;
+  PTimeInterval now = PTimer::Tick();
+
+  PWaitAndSignal m(trunkMutex);
+
+  for (TrunkPeerMap::iterator it = trunkPeers.begin(); it != trunkPeers.end(); ++it) {
+    TrunkPeer & peer = it->second;
+    if (peer.size == 0)
+      continue;
+
+    PTimeInterval elapsed = now - peer.firstTick;
+    if (force || elapsed >= trunkInterval) {
+      if (!sock.WriteTo(peer.data, peer.size, peer.address, peer.port)) {
+        PTRACE(4, "IAX2Transmit\tTrunk frame to " << it->second.address << ':' << it->second.port << " failed: " << sock.GetErrorText());
+      }
+      peer.size = 0;
+    }
+    else if (trunkInterval - elapsed < waitTime)
+      waitTime = trunkInterval - elapsed;
+  }
+
+  return waitTime;
+}
+
 
 #endif // OPAL_IAX2
 
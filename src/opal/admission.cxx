@@ -0,0 +1,236 @@
+/*
+ * admission.cxx
+ *
+ * Call admission control and overload protection
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "admission.h"
+#endif
+
+#include <opal_config.h>
+
+#include <opal/admission.h>
+#include <opal/manager.h>
+#include <opal/endpoint.h>
+
+
+#define PTraceModule() "Admission"
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+OpalAdmissionController::Params::Params()
+  : m_callsPerSecond(0)
+  , m_callBurst(0)
+  , m_maxMediaCPU(0)
+  , m_maxMediaThrottles(0)
+  , m_maxMediaLag(0)
+  , m_maxJitterUnderruns(0)
+  , m_maxQueueDepth(0)
+  , m_sampleInterval(0, 5)
+  , m_retryAfter(0, 10)
+{
+}
+
+
+OpalAdmissionController::Sample::Sample()
+  : m_mediaCPU(0)
+  , m_mediaThrottles(0)
+  , m_jitterUnderruns(0)
+  , m_queueDepth(0)
+{
+}
+
+
+OpalAdmissionController::Statistics::Statistics()
+  : m_accepted(0)
+  , m_rejectedOverload(0)
+  , m_rejectedRate(0)
+  , m_overloaded(false)
+{
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+OpalAdmissionController::OpalAdmissionController(OpalManager & manager, const Params & params)
+  : m_manager(manager)
+  , m_params(params)
+  , m_sampleTimer(params.m_sampleInterval)
+  , m_tokens(params.m_callBurst)
+  , m_lastRefill(PTimer::Tick().GetMilliSeconds())
+{
+}
+
+
+void OpalAdmissionController::SetParams(const Params & params)
+{
+  PWaitAndSignal lock(m_mutex);
+  m_params = params;
+  m_tokens = std::min(m_tokens, (double)std::max(params.m_callBurst, 1U));
+  m_sampleTimer = params.m_sampleInterval;
+}
+
+
+OpalAdmissionController::Params OpalAdmissionController::GetParams()
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_params;
+}
+
+
+bool OpalAdmissionController::CanAcceptCall()
+{
+  PWaitAndSignal lock(m_mutex);
+
+  if (m_statistics.m_overloaded) {
+    ++m_statistics.m_rejectedOverload;
+    PTRACE(3, "Call rejected, system overloaded");
+    return false;
+  }
+
+  if (m_params.m_callsPerSecond > 0) {
+    // Token bucket, refilled at the call rate up to the burst size
+    PInt64 now = PTimer::Tick().GetMilliSeconds();
+    m_tokens += (now - m_lastRefill)*m_params.m_callsPerSecond/1000.0;
+    m_tokens = std::min(m_tokens, (double)std::max(m_params.m_callBurst, 1U));
+    m_lastRefill = now;
+
+    if (m_tokens < 1) {
+      ++m_statistics.m_rejectedRate;
+      PTRACE(3, "Call rejected, more than " << m_params.m_callsPerSecond << " calls per second");
+      return false;
+    }
+
+    m_tokens -= 1;
+  }
+
+  ++m_statistics.m_accepted;
+  return true;
+}
+
+
+PTimeInterval OpalAdmissionController::GetRetryAfter()
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_params.m_retryAfter;
+}
+
+
+OpalAdmissionController::Statistics OpalAdmissionController::GetStatistics()
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_statistics;
+}
+
+
+void OpalAdmissionController::OnMediaCPU(unsigned percentage, bool throttled)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  if (m_current.m_mediaCPU < percentage)
+    m_current.m_mediaCPU = percentage;
+
+  if (throttled)
+    ++m_current.m_mediaThrottles;
+}
+
+
+void OpalAdmissionController::OnMediaLag(const PTimeInterval & lag)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  if (m_current.m_mediaLag < lag)
+    m_current.m_mediaLag = lag;
+}
+
+
+void OpalAdmissionController::OnJitterUnderruns(unsigned count)
+{
+  PWaitAndSignal lock(m_mutex);
+  m_current.m_jitterUnderruns += count;
+}
+
+
+void OpalAdmissionController::Update()
+{
+  m_mutex.Wait();
+  bool expired = m_sampleTimer.HasExpired();
+  if (expired)
+    m_sampleTimer = m_params.m_sampleInterval;
+  m_mutex.Signal();
+
+  if (!expired)
+    return;
+
+  // Endpoints are asked outside our mutex, as they have their own locks
+  unsigned queueDepth = 0;
+  PList<OpalEndPoint> endpoints = m_manager.GetEndPoints();
+  for (PList<OpalEndPoint>::iterator ep = endpoints.begin(); ep != endpoints.end(); ++ep)
+    queueDepth += ep->GetPendingWorkCount();
+
+  PWaitAndSignal lock(m_mutex);
+
+  Sample sample = m_current;
+  sample.m_queueDepth = queueDepth;
+  m_current = Sample();
+
+  bool overloaded = CheckOverload(sample);
+  PTRACE_IF(overloaded ? 2 : 3, overloaded != m_statistics.m_overloaded,
+            (overloaded ? "Overloaded" : "No longer overloaded") << ":"
+            " media CPU=" << sample.m_mediaCPU << "%,"
+            " throttles=" << sample.m_mediaThrottles << ","
+            " lag=" << sample.m_mediaLag << ","
+            " underruns=" << sample.m_jitterUnderruns << ","
+            " queued=" << sample.m_queueDepth);
+
+  m_statistics.m_lastSample = sample;
+  m_statistics.m_overloaded = overloaded;
+}
+
+
+bool OpalAdmissionController::CheckOverload(const Sample & sample)
+{
+  if (m_params.m_maxMediaCPU > 0 && sample.m_mediaCPU >= m_params.m_maxMediaCPU)
+    return true;
+
+  if (m_params.m_maxMediaThrottles > 0 && sample.m_mediaThrottles >= m_params.m_maxMediaThrottles)
+    return true;
+
+  if (m_params.m_maxMediaLag > 0 && sample.m_mediaLag >= m_params.m_maxMediaLag)
+    return true;
+
+  if (m_params.m_maxJitterUnderruns > 0 && sample.m_jitterUnderruns >= m_params.m_maxJitterUnderruns)
+    return true;
+
+  if (m_params.m_maxQueueDepth > 0 && sample.m_queueDepth >= m_params.m_maxQueueDepth)
+    return true;
+
+  return false;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
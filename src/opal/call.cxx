@@ -881,6 +881,13 @@ bool OpalCall::IsRecording() const
 }
 
 
+bool OpalCall::IsRecordingEncoded() const
+{
+  PSafeLockReadOnly lock(*this);
+  return lock.IsLocked() && m_recordManager != NULL && m_recordManager->IsEncodedRecording();
+}
+
+
 bool OpalCall::StopRecording()
 {
   PSafeLockReadWrite lock(*this);
@@ -135,6 +135,7 @@ OpalConnection::OpalConnection(OpalCall & call,
   , m_jitterParams(m_endpoint.GetManager().GetJitterParameters())
   , m_rxBandwidthAvailable(m_endpoint.GetInitialBandwidth(OpalBandwidth::Rx))
   , m_txBandwidthAvailable(m_endpoint.GetInitialBandwidth(OpalBandwidth::Tx))
+  , P_DISABLE_MSVC_WARNINGS(4355, m_dtmfDetector(*this))
   , m_dtmfScaleMultiplier(1)
   , m_dtmfScaleDivisor(1)
   , m_dtmfDetectNotifier(PCREATE_NOTIFIER(OnDetectInBandDTMF))
@@ -234,6 +235,11 @@ OpalConnection::~OpalConnection()
   }
 #endif
 
+#if OPAL_PTLIB_DTMF
+  if (m_dtmfDetector.IsAttached())
+    m_endpoint.GetManager().GetToneDetector().Detach(m_dtmfDetector);
+#endif
+
   delete m_silenceDetector;
 #if OPAL_AEC
   delete m_echoCanceler;
@@ -971,6 +977,7 @@ void OpalConnection::OnClosedMediaStream(const OpalMediaStream & stream)
 
 #if OPAL_PTLIB_DTMF
     if (patch->RemoveFilter(m_dtmfDetectNotifier, OpalPCM16)) {
+      m_endpoint.GetManager().GetToneDetector().Detach(m_dtmfDetector);
       PTRACE(4, "Removed detect DTMF filter on connection " << *this << ", patch " << patch);
     }
     if (!m_dtmfSendFormat.IsEmpty() && patch->RemoveFilter(m_dtmfSendNotifier, m_dtmfSendFormat)) {
@@ -1007,10 +1014,22 @@ void OpalConnection::OnStartRecording(OpalMediaPatch * patch)
     return;
   }
 
-  patch->AddFilter(m_recordAudioNotifier, OpalPCM16);
+  if (m_ownerCall.IsRecordingEncoded()) {
+    // Record the packets as they are at the source, before any transcoding
+    OpalMediaFormat sourceFormat = patch->GetSource().GetMediaFormat();
+    if (sourceFormat.GetMediaType() == OpalMediaType::Audio())
+      patch->AddFilter(m_recordAudioNotifier, sourceFormat);
+#if OPAL_VIDEO
+    else if (sourceFormat.GetMediaType() == OpalMediaType::Video())
+      patch->AddFilter(m_recordVideoNotifier, sourceFormat);
+#endif
+  }
+  else {
+    patch->AddFilter(m_recordAudioNotifier, OpalPCM16);
 #if OPAL_VIDEO
-  patch->AddFilter(m_recordVideoNotifier, OPAL_YUV420P);
+    patch->AddFilter(m_recordVideoNotifier, OPAL_YUV420P);
 #endif
+  }
 
   PTRACE(4, "Added record filter on connection " << *this << ", patch " << *patch);
 }
@@ -1023,9 +1042,16 @@ void OpalConnection::OnStopRecording(OpalMediaPatch * patch)
 
   m_ownerCall.OnStopRecording(MakeRecordingKey(*patch));
 
-  patch->RemoveFilter(m_recordAudioNotifier, OpalPCM16);
+  OpalMediaFormat sourceFormat = patch->GetSource().GetMediaFormat();
+  if (sourceFormat.GetMediaType() == OpalMediaType::Audio()) {
+    if (!patch->RemoveFilter(m_recordAudioNotifier, OpalPCM16))
+      patch->RemoveFilter(m_recordAudioNotifier, sourceFormat);
+  }
 #if OPAL_VIDEO
-  patch->RemoveFilter(m_recordVideoNotifier, OPAL_YUV420P);
+  else if (sourceFormat.GetMediaType() == OpalMediaType::Video()) {
+    if (!patch->RemoveFilter(m_recordVideoNotifier, OPAL_YUV420P))
+      patch->RemoveFilter(m_recordVideoNotifier, sourceFormat);
+  }
 #endif
 
   PTRACE(4, "Removed record filter on " << *patch);
@@ -1060,6 +1086,8 @@ void OpalConnection::OnPatchMediaStream(PBoolean isSource, OpalMediaPatch & patc
 
 #if OPAL_PTLIB_DTMF
     if (m_detectInBandDTMF && isSource) {
+      m_dtmfDetector.SetScale(m_dtmfScaleMultiplier, m_dtmfScaleDivisor);
+      m_endpoint.GetManager().GetToneDetector().Attach(m_dtmfDetector);
       patch.AddFilter(m_dtmfDetectNotifier, OpalPCM16);
       PTRACE(4, "Added detect DTMF filter on connection " << *this << ", patch " << patch);
     }
@@ -1123,6 +1151,7 @@ void OpalConnection::OnRecordAudio(RTP_DataFrame & frame, P_INT_PTR param)
 
   const OpalMediaPatch * patch = (const OpalMediaPatch *)param;
   std::auto_ptr<RTP_DataFrame> copyFrame(new RTP_DataFrame(frame.GetPointer(), frame.GetPacketSize()));
+  copyFrame->SetMetaData(frame.GetMetaData()); // Keep arrival time
   GetEndPoint().GetManager().QueueDecoupledEvent(new PSafeWorkArg2<OpalConnection, PString, std::auto_ptr<RTP_DataFrame> >(
                    this, MakeRecordingKey(*patch), copyFrame, &OpalConnection::InternalOnRecordAudio), psprintf("%p", this));
 }
@@ -1140,6 +1169,7 @@ void OpalConnection::OnRecordVideo(RTP_DataFrame & frame, P_INT_PTR param)
 {
   const OpalMediaPatch * patch = (const OpalMediaPatch *)param;
   std::auto_ptr<RTP_DataFrame> copyFrame(new RTP_DataFrame(frame.GetPointer(), frame.GetPacketSize()));
+  copyFrame->SetMetaData(frame.GetMetaData()); // Keep arrival time
   GetEndPoint().GetManager().QueueDecoupledEvent(new PSafeWorkArg2<OpalConnection, PString, std::auto_ptr<RTP_DataFrame> >(
                    this, MakeRecordingKey(*patch), copyFrame, &OpalConnection::InternalOnRecordVideo), psprintf("%p", this));
 }
@@ -1454,17 +1484,18 @@ void OpalConnection::OnDetectInBandDTMF(RTP_DataFrame & frame, P_INT_PTR)
   // This allows us to access the 16 bit PCM audio (at 8Khz sample rate)
   // before the audio is passed on to the sound card (or other output device)
 
-  // Pass the 16 bit PCM audio through the DTMF decoder
-  PString tones = m_dtmfDecoder.Decode((const short *)frame.GetPayloadPtr(),
-                                       frame.GetPayloadSize()/sizeof(short),
-                                       m_dtmfScaleMultiplier,
-                                       m_dtmfScaleDivisor);
-  if (!tones.IsEmpty()) {
-    PTRACE(3, "DTMF detected: \"" << tones << '"');
-    for (PINDEX i = 0; i < tones.GetLength(); i++)
-      GetEndPoint().GetManager().QueueDecoupledEvent(new PSafeWorkArg2<OpalConnection, char, unsigned>(
-                            this, tones[i], PDTMFDecoder::DetectTime, &OpalConnection::OnUserInputTone));
-  }
+  // Pass the 16 bit PCM audio to the shared detector, result is via InBandDTMFDetector::OnTone()
+  m_endpoint.GetManager().GetToneDetector().Write(m_dtmfDetector,
+                                                  (const short *)frame.GetPayloadPtr(),
+                                                  frame.GetPayloadSize()/sizeof(short));
+}
+
+
+void OpalConnection::InBandDTMFDetector::OnTone(char tone, unsigned duration)
+{
+  PTRACE(3, "DTMF detected: '" << tone << "' on " << m_connection);
+  m_connection.GetEndPoint().GetManager().QueueDecoupledEvent(new PSafeWorkArg2<OpalConnection, char, unsigned>(
+                      &m_connection, tone, duration, &OpalConnection::OnUserInputTone));
 }
 
 void OpalConnection::OnSendInBandDTMF(RTP_DataFrame & frame, P_INT_PTR)
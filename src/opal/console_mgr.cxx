@@ -434,7 +434,10 @@ void H323ConsoleEndPoint::GetArgumentSpec(ostream & strm) const
           "-no-tunnel.         H.245 tunnel disabled.\n"
           "-no-h245-setup.     H.245 tunnel during SETUP disabled.\n"
           "-h239-control.      H.239 control capability.\n"
-          "-h323-term-type:    Terminal type value (1..255, default 50).\n";
+          "-h323-term-type:    Terminal type value (1..255, default 50).\n"
+          "-h323-tcs-cache:    Capability set cache size, 0 disables (default 0).\n"
+          "-h323-reactor:      Multiplex H.225/H.245 TCP channels on N threads,\n"
+          "                    0 uses a thread per channel (default 0).\n";
 }
 
 
@@ -478,6 +481,15 @@ bool H323ConsoleEndPoint::Initialise(PArgList & args, bool verbose, const PStrin
       output << "H.323 terminal type: " << GetTerminalType() << '\n';
   }
 
+  if (args.HasOption("h323-tcs-cache"))
+    GetCapabilitySetCache().SetMaxEntries(args.GetOptionAs<PINDEX>("h323-tcs-cache"));
+
+  unsigned reactorThreads = args.GetOptionAs<unsigned>("h323-reactor");
+  if (reactorThreads > 0 && GetSignalReactor() == NULL && !SetSignalReactor(reactorThreads, reactorThreads*10)) {
+    output << "Could not start H.323 signalling reactor." << endl;
+    return false;
+  }
+
   AddAliasNames(args.GetOptionString("alias").Lines());
   AddAliasNamePatterns(args.GetOptionString("alias-pattern").Lines());
 
@@ -1931,10 +1943,13 @@ PString OpalManagerConsole::GetArgumentSpec() const
          "O-option:          Set options for media format, argument is of form fmt:opt=val or @type:opt=val.\n"
          "-auto-start:       Set auto-start option for media type, e.g audio:sendrecv or video:sendonly.\n"
          "-tel:              Protocol to use for tel: URI, e.g. sip\n"
+         "-transcoder-pool:  Set idle transcoder pool size (per-format[,total] default 4,64, 0 disables)\n"
+         "-admission:        Set incoming call admission limits, 0 disables each (default all 0), of form\n"
+         "                    calls-per-sec[,burst[,media-throttles[,media-lag-ms[,queue-depth]]]]\n"
 
          "[Audio options:]"
          "-jitter:           Set audio jitter buffer size (min[,max] default 50,250)\n"
-         "-silence-detect:   Set audio silence detect mode (\"none\", \"fixed\" or default \"adaptive\")\n"
+         "-silence-detect:   Set audio silence detect mode (\"none\", \"fixed\", \"spectral\" or default \"adaptive\")\n"
          "-no-inband-detect. Disable detection of in-band tones.\n";
 
 #if OPAL_VIDEO
@@ -2155,6 +2170,8 @@ bool OpalManagerConsole::Initialise(PArgList & args, bool verbose, const PString
       params.m_mode = OpalSilenceDetector::AdaptiveSilenceDetection;
     else if (arg.NumCompare("fixed") == EqualTo)
       params.m_mode = OpalSilenceDetector::FixedSilenceDetection;
+    else if (arg.NumCompare("spectral") == EqualTo)
+      params.m_mode = OpalSilenceDetector::SpectralSilenceDetection;
     else
       params.m_mode = OpalSilenceDetector::NoSilenceDetection;
     SetSilenceDetectParams(params);
@@ -2163,6 +2180,29 @@ bool OpalManagerConsole::Initialise(PArgList & args, bool verbose, const PString
   if (args.HasOption("no-inband-detect"))
     DisableDetectInBandDTMF(true);
 
+  if (args.HasOption("transcoder-pool")) {
+    PStringArray params = args.GetOptionString("transcoder-pool").Tokenise(",", false);
+    PINDEX maxPerKey = params[0].AsUnsigned();
+    PINDEX maxTotal = params.GetSize() > 1 ? params[1].AsUnsigned() : GetTranscoderPool().GetMaxTotal();
+    GetTranscoderPool().SetSizes(maxPerKey, maxTotal);
+  }
+
+  if (args.HasOption("admission")) {
+    PStringArray limits = args.GetOptionString("admission").Tokenise(",", false);
+    OpalAdmissionControllerPtr admission = GetAdmissionController();
+    OpalAdmissionController::Params params = admission->GetParams();
+    params.m_callsPerSecond = limits[0].AsUnsigned();
+    if (limits.GetSize() > 1)
+      params.m_callBurst = limits[1].AsUnsigned();
+    if (limits.GetSize() > 2)
+      params.m_maxMediaThrottles = limits[2].AsUnsigned();
+    if (limits.GetSize() > 3)
+      params.m_maxMediaLag = limits[3].AsUnsigned();
+    if (limits.GetSize() > 4)
+      params.m_maxQueueDepth = limits[4].AsUnsigned();
+    admission->SetParams(params);
+  }
+
 #if OPAL_PTLIB_SSL
   SetSSLCertificateAuthorityFiles(args.GetOptionString("ssl-ca", GetSSLCertificateAuthorityFiles()));
   SetSSLCertificateFile(args.GetOptionString("ssl-cert", GetSSLCertificateFile()));
@@ -2986,7 +3026,7 @@ bool OpalManagerCLI::Initialise(PArgList & args, bool verbose, const PString & d
 #endif // OPAL_HAS_MIXER
 
   m_cli->SetCommand("audio vad", PCREATE_NOTIFIER(CmdSilenceDetect),
-                    "Voice Activity Detection (aka Silence Detection)", "\"on\" | \"adaptive\" | <level>");
+                    "Voice Activity Detection (aka Silence Detection)", "\"off\" | \"adaptive\" | \"spectral\" | <level>");
   m_cli->SetCommand("audio in-band-dtmf-disable", m_disableDetectInBandDTMF, "In-band (digital filter) DTMF detection");
 
   m_cli->SetCommand("auto-start", PCREATE_NOTIFIER(CmdAutoStart),
@@ -3004,6 +3044,9 @@ bool OpalManagerCLI::Initialise(PArgList & args, bool verbose, const PString & d
   m_cli->SetCommand("codec option", PCREATE_NOTIFIER(CmdCodecOption),
                     "Get/Set codec option value. The format may be @type (e.g. @video) and all codecs of that type are set.",
                     "<format> [ <name> [ <value> ] ]");
+  m_cli->SetCommand("codec pool", PCREATE_NOTIFIER(CmdCodecPool),
+                    "Show transcoder pool statistics, or set the pool sizes, zero disables the pool.",
+                    "[ <per-format> [ <total> ] ]");
 
   m_cli->SetCommand("show calls", PCREATE_NOTIFIER(CmdShowCalls), "Show all active calls");
   m_cli->SetCommand("send input", PCREATE_NOTIFIER(CmdSendUserInput), "Send user input indication",
@@ -3477,6 +3520,17 @@ static void ChangeMediaCodec(OpalManagerCLI & manager, PCLI::Arguments & args, c
 }
 
 
+void OpalManagerCLI::CmdCodecPool(PCLI::Arguments & args, P_INT_PTR)
+{
+  OpalTranscoderPool & pool = GetTranscoderPool();
+  if (args.GetCount() > 0)
+    pool.SetSizes(args[0].AsUnsigned(), args.GetCount() > 1 ? args[1].AsUnsigned() : pool.GetMaxTotal());
+
+  args.GetContext() << "Transcoder pool: per-format=" << pool.GetMaxPerKey()
+                    << " total=" << pool.GetMaxTotal() << ' ' << pool << endl;
+}
+
+
 void OpalManagerCLI::CmdAudioCodec(PCLI::Arguments & args, P_INT_PTR)
 {
   ChangeMediaCodec(*this, args, OpalMediaType::Audio());
@@ -3652,6 +3706,8 @@ void OpalManagerCLI::CmdSilenceDetect(PCLI::Arguments & args, P_INT_PTR)
       params.m_mode = OpalSilenceDetector::NoSilenceDetection;
     else if (PConstCaselessString("adaptive").NumCompare(args[0]) == EqualTo)
       params.m_mode = OpalSilenceDetector::AdaptiveSilenceDetection;
+    else if (PConstCaselessString("spectral").NumCompare(args[0]) == EqualTo)
+      params.m_mode = OpalSilenceDetector::SpectralSilenceDetection;
     else if (args[0].FindSpan("0123456789") == P_MAX_INDEX) {
       params.m_mode = OpalSilenceDetector::FixedSilenceDetection;
       params.m_threshold = args[0].AsUnsigned();
@@ -3671,7 +3727,8 @@ void OpalManagerCLI::CmdSilenceDetect(PCLI::Arguments & args, P_INT_PTR)
       break;
 
     case OpalSilenceDetector::AdaptiveSilenceDetection:
-      out << "ADAPTIVE, "
+    case OpalSilenceDetector::SpectralSilenceDetection:
+      out << (params.m_mode == OpalSilenceDetector::SpectralSilenceDetection ? "SPECTRAL, " : "ADAPTIVE, ")
              "period=" << params.m_adaptivePeriod << ", "
              "signal deadband=" << params.m_signalDeadband << ", "
              "silence deadband=" << params.m_silenceDeadband;
@@ -0,0 +1,282 @@
+/*
+ * keepalive.cxx
+ *
+ * Shared NAT keep alive scheduler
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "keepalive.h"
+#endif
+
+#include <opal_config.h>
+
+#include <opal/keepalive.h>
+
+#include <ptclib/random.h>
+
+
+#define PTraceModule() "KeepAlive"
+
+
+static PInt64 GetNow()
+{
+  return PTimer::Tick().GetMilliSeconds();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+OpalKeepAliveScheduler::Client::Client(Types type)
+  : m_type(type)
+  , m_lastActivity(0)
+  , m_scheduledActivity(0)
+  , m_bucket(-1)
+{
+}
+
+
+OpalKeepAliveScheduler::Client::~Client()
+{
+  PAssert(m_bucket < 0 && m_interval == 0, "Keep alive client not removed from scheduler");
+}
+
+
+void OpalKeepAliveScheduler::Client::ResetKeepAlive()
+{
+  m_lastActivity = (uint32_t)GetNow();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+
+OpalKeepAliveScheduler::Statistics::Statistics()
+  : m_clients(0)
+  , m_sent(0)
+  , m_skipped(0)
+  , m_failed(0)
+{
+}
+
+
+OpalKeepAliveScheduler::OpalKeepAliveScheduler(const PTimeInterval & granularity, unsigned jitterPercent)
+  : m_granularity(std::max(granularity.GetMilliSeconds(), (PInt64)10))
+  , m_jitterPercent(std::min(jitterPercent, 50U))
+  , m_currentClient(NULL)
+  , m_removeWaiters(0)
+  , m_thread(NULL)
+  , m_running(true)
+{
+}
+
+
+OpalKeepAliveScheduler::~OpalKeepAliveScheduler()
+{
+  ShutDown();
+}
+
+
+void OpalKeepAliveScheduler::Add(Client & client, const PTimeInterval & interval)
+{
+  if (interval <= 0) {
+    Remove(client, false);
+    return;
+  }
+
+  PWaitAndSignal lock(m_mutex);
+
+  if (client.m_interval == 0)
+    ++m_statistics[client.m_type].m_clients;
+  client.m_interval = interval;
+
+  Unschedule(client);
+
+  PInt64 now = GetNow();
+  client.m_lastActivity = (uint32_t)now;
+
+  // If it is sending now, it is rescheduled when it finishes
+  if (m_currentClient != &client)
+    Schedule(client, now);
+
+  if (m_thread == NULL && m_running)
+    m_thread = new PThreadObj<OpalKeepAliveScheduler>(*this, &OpalKeepAliveScheduler::ThreadMain, false, "KeepAlive");
+
+  PTRACE(4, "Added " << client.m_type << " keep alive every " << interval << " seconds");
+}
+
+
+void OpalKeepAliveScheduler::Remove(Client & client, bool wait)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  if (client.m_interval > 0) {
+    --m_statistics[client.m_type].m_clients;
+    client.m_interval = 0;
+  }
+
+  Unschedule(client);
+
+  if (!wait || PThread::Current() == m_thread)
+    return;
+
+  while (m_currentClient == &client) {
+    ++m_removeWaiters;
+    m_mutex.Signal();
+    m_currentFinished.Wait();
+    m_mutex.Wait();
+    --m_removeWaiters;
+  }
+
+  // Pass it on, another remove may be waiting
+  if (m_removeWaiters > 0)
+    m_currentFinished.Signal();
+}
+
+
+void OpalKeepAliveScheduler::ShutDown()
+{
+  m_mutex.Wait();
+  m_running = false;
+  PThread * thread = m_thread;
+  m_thread = NULL;
+  m_mutex.Signal();
+
+  if (thread != NULL) {
+    m_wakeUp.Signal();
+    PThread::WaitAndDelete(thread);
+  }
+}
+
+
+OpalKeepAliveScheduler::Statistics OpalKeepAliveScheduler::GetStatistics(Types type)
+{
+  PWaitAndSignal lock(m_mutex);
+  return type < NumTypes ? m_statistics[type] : Statistics();
+}
+
+
+void OpalKeepAliveScheduler::Schedule(Client & client, PInt64 lastActivity)
+{
+  client.m_scheduledActivity = (uint32_t)lastActivity;
+
+  PInt64 interval = client.m_interval.GetMilliSeconds();
+  PInt64 jitter = interval*m_jitterPercent/100;
+  PInt64 dueTime = lastActivity + interval;
+  if (jitter > 0)
+    dueTime -= PRandom::Number() % jitter;
+
+  // Never go in a bucket already being processed
+  client.m_bucket = std::max(dueTime/m_granularity, GetNow()/m_granularity + 1);
+
+  BucketMap::iterator it = m_buckets.find(client.m_bucket);
+  bool newFirst = it == m_buckets.end() && (m_buckets.empty() || m_buckets.begin()->first > client.m_bucket);
+  m_buckets[client.m_bucket].insert(&client);
+
+  if (newFirst)
+    m_wakeUp.Signal();
+}
+
+
+void OpalKeepAliveScheduler::Unschedule(Client & client)
+{
+  if (client.m_bucket < 0)
+    return;
+
+  BucketMap::iterator it = m_buckets.find(client.m_bucket);
+  if (it != m_buckets.end()) {
+    it->second.erase(&client);
+    if (it->second.empty())
+      m_buckets.erase(it);
+  }
+
+  client.m_bucket = -1;
+}
+
+
+void OpalKeepAliveScheduler::ThreadMain()
+{
+  PTRACE(4, "Started thread");
+
+  m_mutex.Wait();
+
+  while (m_running) {
+    PInt64 now = GetNow();
+
+    BucketMap::iterator it = m_buckets.begin();
+    if (it == m_buckets.end() || it->first*m_granularity > now) {
+      PTimeInterval timeout = it == m_buckets.end() ? PMaxTimeInterval : PTimeInterval(it->first*m_granularity - now);
+      m_mutex.Signal();
+      m_wakeUp.Wait(timeout);
+      m_mutex.Wait();
+      continue;
+    }
+
+    /* Take one client at a time from the bucket, as the mutex is released
+       while it sends, and other clients in the bucket may be removed. */
+    Client & client = **it->second.begin();
+    it->second.erase(it->second.begin());
+    if (it->second.empty())
+      m_buckets.erase(it);
+    client.m_bucket = -1;
+
+    Statistics & stats = m_statistics[client.m_type];
+
+    /* If there was traffic since it was scheduled, it is not needed yet.
+       Note the difference is wrap safe, as unsigned. */
+    uint32_t lastActivity = client.m_lastActivity;
+    if (lastActivity != client.m_scheduledActivity) {
+      ++stats.m_skipped;
+      Schedule(client, now - (uint32_t)((uint32_t)now - lastActivity));
+      continue;
+    }
+
+    m_currentClient = &client;
+    m_mutex.Signal();
+
+    bool ok = client.OnKeepAlive();
+
+    m_mutex.Wait();
+    m_currentClient = NULL;
+    if (m_removeWaiters > 0)
+      m_currentFinished.Signal();
+
+    if (ok)
+      ++stats.m_sent;
+    else
+      ++stats.m_failed;
+
+    // Reschedule unless removed, or added again, while sending
+    if (client.m_interval > 0 && client.m_bucket < 0) {
+      client.m_lastActivity = (uint32_t)now;
+      Schedule(client, now);
+    }
+  }
+
+  m_mutex.Signal();
+
+  PTRACE(4, "Ended thread");
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
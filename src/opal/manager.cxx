@@ -40,6 +40,7 @@
 #include <opal/patch.h>
 #include <opal/mediastrm.h>
 #include <codec/g711codec.h>
+#include <codec/resampler.h>
 #include <codec/vidcodec.h>
 #include <codec/rfc4175.h>
 #include <codec/rfc2435.h>
@@ -120,6 +121,9 @@ static const char * const DefaultMediaFormatMask[] = {
 // Linux it would not get loaded due to static initialisation optimisation
 OPAL_REGISTER_G711();
 
+// Same deal for sample rate conversion between PCM-16 formats
+OPAL_REGISTER_PCM16_RESAMPLERS();
+
 // Same deal for RC4175 video
 #if OPAL_RFC4175
 OPAL_REGISTER_RFC4175();
@@ -308,11 +312,16 @@ OpalManager::OpalManager()
   , m_mediaFormatOrder(PARRAYSIZE(DefaultMediaFormatOrder), DefaultMediaFormatOrder)
   , m_mediaFormatMask(PARRAYSIZE(DefaultMediaFormatMask), DefaultMediaFormatMask)
   , m_disableDetectInBandDTMF(false)
+#if OPAL_PTLIB_DTMF
+  , m_toneDetectorThreads(OpalToneDetector::GetDefaultThreadCount())
+  , m_toneDetector(NULL)
+#endif
   , m_noMediaTimeout(0, 0, 5)     // Minutes
   , m_txMediaTimeout(0, 10)       // Seconds
   , m_signalingTimeout(0, 10)     // Seconds
   , m_transportIdleTime(0, 0, 1)  // Minute
   , m_natKeepAliveTime(0, 30)     // Seconds
+  , P_DISABLE_MSVC_WARNINGS(4355, m_admissionController(new OpalAdmissionController(*this)))
 #if OPAL_ICE
   , m_iceTimeout(0, 15)           // Seconds, as per RFC 5245
 #endif
@@ -399,6 +408,7 @@ OpalManager::OpalManager()
 OpalManager::~OpalManager()
 {
   ShutDownEndpoints();
+  m_keepAliveScheduler.ShutDown();
 
 #if OPAL_SCRIPT
   delete m_script;
@@ -411,15 +421,31 @@ OpalManager::~OpalManager()
   // Clean up any calls that the cleaner thread missed on the way out
   GarbageCollection();
 
+#if OPAL_PTLIB_DTMF
+  delete m_toneDetector;
+#endif
+
 #if OPAL_PTLIB_NAT
   PInterfaceMonitor::GetInstance().RemoveNotifier(m_onInterfaceChange);
   delete m_natMethods;
 #endif
 
+  m_admissionController.SetNULL();
+
   PTRACE(4, "Deleted manager.");
 }
 
 
+void OpalManager::SetAdmissionController(OpalAdmissionController * controller)
+{
+  if (PAssertNULL(controller) == NULL || controller == m_admissionController)
+    return;
+
+  // Old one is deleted when the last reference, e.g. in Update(), is released
+  m_admissionController = controller;
+}
+
+
 PList<OpalEndPoint> OpalManager::GetEndPoints() const
 {
   PList<OpalEndPoint> list;
@@ -2171,6 +2197,17 @@ void OpalManager::SetAudioJitterDelay(unsigned minDelay, unsigned maxDelay)
 }
 
 
+#if OPAL_PTLIB_DTMF
+OpalToneDetector & OpalManager::GetToneDetector()
+{
+  PWaitAndSignal mutex(m_toneDetectorMutex);
+  if (m_toneDetector == NULL)
+    m_toneDetector = new OpalToneDetector(m_toneDetectorThreads);
+  return *m_toneDetector;
+}
+#endif
+
+
 void OpalManager::SetMediaFormatOrder(const PStringArray & order)
 {
   m_mediaFormatOrder = order;
@@ -2226,6 +2263,8 @@ void OpalManager::GarbageCollection()
 
   m_endpointsMutex.EndRead();
 
+  GetAdmissionController()->Update();
+
   if (allCleared && m_clearingAllCallsCount != 0)
     m_allCallsCleared.Signal();
 }
@@ -50,6 +50,158 @@
 #define new PNEW
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+#if OPAL_STATISTICS
+
+OpalMediaPatchStatistics::Counters::Counters()
+  : m_ssrc(0)
+  , m_hasAudio(false)
+  , m_silent(0)
+  , m_FEC(0)
+#if OPAL_VIDEO
+  , m_hasVideo(false)
+  , m_totalFrames(0)
+  , m_keyFrames(0)
+  , m_fullUpdateRequests(0)
+  , m_pictureLossRequests(0)
+  , m_lastKeyFrameTime(0)
+  , m_lastUpdateRequestTime(0)
+  , m_updateResponseTime(0)
+#endif
+{
+}
+
+
+OpalMediaPatchStatistics::OpalMediaPatchStatistics()
+{
+}
+
+
+const OpalMediaPatchStatistics::Counters * OpalMediaPatchStatistics::Find(RTP_SyncSourceId ssrc) const
+{
+  if (ssrc == 0)
+    return &m_counters[0];
+
+  for (PINDEX i = 1; i < MaxSyncSources; ++i) {
+    if (m_counters[i].m_ssrc == ssrc)
+      return &m_counters[i];
+  }
+
+  return NULL;
+}
+
+
+OpalMediaPatchStatistics::Counters * OpalMediaPatchStatistics::Get(RTP_SyncSourceId ssrc)
+{
+  Counters * counters = const_cast<Counters *>(Find(ssrc));
+  if (counters != NULL)
+    return counters;
+
+  // Only claiming a new slot takes the lock, which is once per SSRC
+  PWaitAndSignal mutex(m_claimMutex);
+  for (PINDEX i = 1; i < MaxSyncSources; ++i) {
+    RTP_SyncSourceId id = m_counters[i].m_ssrc;
+    if (id == ssrc)
+      return &m_counters[i];
+    if (id == 0) {
+      m_counters[i].m_ssrc = ssrc;
+      return &m_counters[i];
+    }
+  }
+
+  PTRACE(4, "Too many SSRCs for statistics, " << RTP_TRACE_SRC(ssrc) << " only counted in total");
+  return NULL;
+}
+
+
+void OpalMediaPatchStatistics::IncrementAudio(RTP_SyncSourceId ssrc, OpalAudioFormat::FrameType type)
+{
+  Counters * counters[2] = { &m_counters[0], ssrc != 0 ? Get(ssrc) : NULL };
+  for (PINDEX i = 0; i < 2; ++i) {
+    if (counters[i] != NULL) {
+      counters[i]->m_hasAudio = true;
+      if (type&OpalAudioFormat::e_SilenceFrame)
+        ++counters[i]->m_silent;
+      if (type&OpalAudioFormat::e_FECFrame)
+        ++counters[i]->m_FEC;
+    }
+  }
+}
+
+
+#if OPAL_VIDEO
+void OpalMediaPatchStatistics::IncrementFrames(RTP_SyncSourceId ssrc, bool key)
+{
+  Counters * counters[2] = { &m_counters[0], ssrc != 0 ? Get(ssrc) : NULL };
+  for (PINDEX i = 0; i < 2; ++i) {
+    if (counters[i] != NULL) {
+      counters[i]->m_hasVideo = true;
+      ++counters[i]->m_totalFrames;
+      if (key) {
+        ++counters[i]->m_keyFrames;
+        int64_t now = PTime().GetTimestamp();
+        counters[i]->m_lastKeyFrameTime = now;
+        int64_t request = counters[i]->m_lastUpdateRequestTime;
+        if (counters[i]->m_updateResponseTime == 0 && request != 0)
+          counters[i]->m_updateResponseTime = (now - request)/1000;
+      }
+    }
+  }
+}
+
+
+void OpalMediaPatchStatistics::IncrementUpdateCount(RTP_SyncSourceId ssrc, bool full)
+{
+  Counters * counters[2] = { &m_counters[0], ssrc != 0 ? Get(ssrc) : NULL };
+  for (PINDEX i = 0; i < 2; ++i) {
+    if (counters[i] != NULL) {
+      counters[i]->m_hasVideo = true;
+      if (full)
+        ++counters[i]->m_fullUpdateRequests;
+      else
+        ++counters[i]->m_pictureLossRequests;
+      counters[i]->m_lastUpdateRequestTime = PTime().GetTimestamp();
+      counters[i]->m_updateResponseTime = 0;
+    }
+  }
+}
+
+
+static PTime MicroSecondsToTime(int64_t usecs)
+{
+  return usecs != 0 ? PTime((time_t)(usecs/1000000), usecs%1000000) : PTime(0);
+}
+#endif // OPAL_VIDEO
+
+
+void OpalMediaPatchStatistics::GetStatistics(OpalMediaStatistics & statistics) const
+{
+  const Counters * counters = Find(statistics.m_SSRC);
+  if (counters == NULL)
+    return;
+
+  if (counters->m_hasAudio)
+    statistics.m_FEC = counters->m_FEC;
+
+#if OPAL_VIDEO
+  if (counters->m_hasVideo) {
+    OpalVideoStatistics video;
+    video.m_totalFrames = counters->m_totalFrames;
+    video.m_keyFrames = counters->m_keyFrames;
+    video.m_lastKeyFrameTime = MicroSecondsToTime(counters->m_lastKeyFrameTime);
+    video.m_fullUpdateRequests = counters->m_fullUpdateRequests;
+    video.m_pictureLossRequests = counters->m_pictureLossRequests;
+    video.m_lastUpdateRequestTime = MicroSecondsToTime(counters->m_lastUpdateRequestTime);
+    video.m_updateResponseTime = PTimeInterval((PInt64)counters->m_updateResponseTime);
+    statistics.OpalVideoStatistics::operator=(video);
+  }
+#endif
+}
+
+#endif // OPAL_STATISTICS
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 OpalMediaPatch::OpalMediaPatch(OpalMediaStream & src)
@@ -266,11 +418,20 @@ static bool SetStreamDataSize(OpalMediaStream & stream, OpalTranscoder & codec)
 }
 
 
+static OpalTranscoderPool & GetTranscoderPool(const OpalMediaPatch & patch)
+{
+  return patch.GetSource().GetConnection().GetEndPoint().GetManager().GetTranscoderPool();
+}
+
+
 bool OpalMediaPatch::Sink::CreateTranscoders()
 {
-  delete m_primaryCodec;
+  OpalTranscoderPool & pool = GetTranscoderPool(m_patch);
+  pool.Release(m_primaryCodec);
   m_primaryCodec = NULL;
-  delete m_secondaryCodec;
+  pool.Release(m_resampler);
+  m_resampler = NULL;
+  pool.Release(m_secondaryCodec);
   m_secondaryCodec = NULL;
 
   // Find the media formats than can be used to get from source to sink
@@ -301,7 +462,7 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
   }
 
   PString id = m_stream->GetID();
-  m_primaryCodec = OpalTranscoder::Create(sourceFormat, destinationFormat, (const BYTE *)id, id.GetLength());
+  m_primaryCodec = pool.Acquire(sourceFormat, destinationFormat, (const BYTE *)id, id.GetLength());
   if (m_primaryCodec != NULL) {
     PTRACE_CONTEXT_ID_TO(m_primaryCodec);
     PTRACE(4, "Created primary codec " << sourceFormat << "->" << destinationFormat << " with ID " << id);
@@ -323,42 +484,74 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
   }
 
   PTRACE(4, "Creating two stage transcoders for " << sourceFormat << "->" << destinationFormat << " with ID " << id);
-  OpalMediaFormat intermediateFormat;
+  OpalMediaFormat intermediateFormat, resampledFormat;
   if (!OpalTranscoder::FindIntermediateFormat(sourceFormat, destinationFormat, intermediateFormat)) {
-    PTRACE(1, "Could find compatible media format for " << *m_stream);
-    return false;
+    // Last resort, e.g. Opus-48 to G.711, decode, change the sample rate, then encode
+    if (!OpalTranscoder::FindIntermediateFormats(sourceFormat, destinationFormat, intermediateFormat, resampledFormat)) {
+      PTRACE(1, "Could find compatible media format for " << *m_stream);
+      return false;
+    }
+    PTRACE(4, "Using three stage transcoders via " << intermediateFormat << " and " << resampledFormat);
   }
 
-  if (intermediateFormat.GetMediaType() == OpalMediaType::Audio()) {
+  // The format given to the secondary codec
+  OpalMediaFormat & secondaryFormat = resampledFormat.IsValid() ? resampledFormat : intermediateFormat;
+
+  if (secondaryFormat.GetMediaType() == OpalMediaType::Audio()) {
     // try prepare intermediateFormat for correct frames to frames transcoding
     // so we need make sure that tx frames time of destinationFormat be equal 
     // to tx frames time of intermediateFormat (all this does not produce during
     // Merge phase in FindIntermediateFormat)
     int destinationPacketTime = destinationFormat.GetFrameTime()*destinationFormat.GetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption(), 1);
-    if ((destinationPacketTime % intermediateFormat.GetFrameTime()) != 0) {
+    if ((destinationPacketTime % secondaryFormat.GetFrameTime()) != 0) {
       PTRACE(1, "Could produce without buffered media format converting (which not implemented yet) for " << *m_stream);
       return false;
     }
-    intermediateFormat.AddOption(new OpalMediaOptionUnsigned(OpalAudioFormat::TxFramesPerPacketOption(),
-                                                              true,
-                                                              OpalMediaOption::NoMerge,
-                                                              destinationPacketTime/intermediateFormat.GetFrameTime()),
-                                  true);
+    secondaryFormat.AddOption(new OpalMediaOptionUnsigned(OpalAudioFormat::TxFramesPerPacketOption(),
+                                                           true,
+                                                           OpalMediaOption::NoMerge,
+                                                           destinationPacketTime/secondaryFormat.GetFrameTime()),
+                               true);
+
+    if (resampledFormat.IsValid()) {
+      // Same duration of audio before the resampler, at its clock rate
+      int decodedPacketTime = (int)((PInt64)destinationPacketTime*intermediateFormat.GetClockRate()/destinationFormat.GetClockRate());
+      intermediateFormat.AddOption(new OpalMediaOptionUnsigned(OpalAudioFormat::TxFramesPerPacketOption(),
+                                                                true,
+                                                                OpalMediaOption::NoMerge,
+                                                                std::max(decodedPacketTime/intermediateFormat.GetFrameTime(), 1)),
+                                    true);
+    }
   }
 
-  m_primaryCodec = OpalTranscoder::Create(sourceFormat, intermediateFormat, (const BYTE *)id, id.GetLength());
-  m_secondaryCodec = OpalTranscoder::Create(intermediateFormat, destinationFormat, (const BYTE *)id, id.GetLength());
-  if (m_primaryCodec == NULL || m_secondaryCodec == NULL)
+  m_primaryCodec = pool.Acquire(sourceFormat, intermediateFormat, (const BYTE *)id, id.GetLength());
+  if (resampledFormat.IsValid())
+    m_resampler = pool.Acquire(intermediateFormat, resampledFormat, (const BYTE *)id, id.GetLength());
+  m_secondaryCodec = pool.Acquire(secondaryFormat, destinationFormat, (const BYTE *)id, id.GetLength());
+  if (m_primaryCodec == NULL || m_secondaryCodec == NULL || (resampledFormat.IsValid() && m_resampler == NULL))
     return false;
 
   PTRACE_CONTEXT_ID_TO(m_primaryCodec);
   PTRACE_CONTEXT_ID_TO(m_secondaryCodec);
-  PTRACE(3, "Created two stage codec " << sourceFormat << "/" << intermediateFormat << "/" << destinationFormat << " with ID " << id);
 
-  m_primaryCodec->SetMaxOutputSize(m_secondaryCodec->GetOptimalDataFrameSize(true));
+  PINDEX secondaryInputSize = m_secondaryCodec->GetOptimalDataFrameSize(true);
+
+  if (m_resampler == NULL) {
+    PTRACE(3, "Created two stage codec " << sourceFormat << "/" << intermediateFormat << "/" << destinationFormat << " with ID " << id);
+    m_primaryCodec->SetMaxOutputSize(secondaryInputSize);
+    m_primaryCodec->UpdateMediaFormats(OpalMediaFormat(), m_secondaryCodec->GetInputFormat());
+  }
+  else {
+    PTRACE_CONTEXT_ID_TO(m_resampler);
+    PTRACE(3, "Created three stage codec " << sourceFormat << "/" << intermediateFormat << "/"
+           << resampledFormat << "/" << destinationFormat << " with ID " << id);
+    m_primaryCodec->SetMaxOutputSize((PINDEX)((PInt64)secondaryInputSize*intermediateFormat.GetClockRate()/resampledFormat.GetClockRate()) + 4);
+    m_resampler->SetMaxOutputSize(secondaryInputSize + 4); // Can vary by a sample per channel
+    m_resampler->SetSessionID(m_patch.m_source.GetSessionID());
+  }
+
   m_primaryCodec->SetSessionID(m_patch.m_source.GetSessionID());
   m_primaryCodec->SetCommandNotifier(PCREATE_NOTIFIER_EXT(&m_patch, OpalMediaPatch, InternalOnMediaCommand1));
-  m_primaryCodec->UpdateMediaFormats(OpalMediaFormat(), m_secondaryCodec->GetInputFormat());
 
   if (!SetStreamDataSize(*m_stream, *m_secondaryCodec))
     return false;
@@ -478,24 +671,14 @@ void OpalMediaPatch::Sink::GetStatistics(OpalMediaStatistics & statistics, bool
   if (fromSource)
     m_stream->GetStatistics(statistics, true);
 
-  {
-    PWaitAndSignal mutex(m_statsMutex);
-    AudioStatsMap::const_iterator itAud = m_audioStatistics.find(statistics.m_SSRC);
-    if (itAud != m_audioStatistics.end()) {
-      //statistics.m_silent = itAud->second.m_silent;
-      statistics.m_FEC = itAud->second.m_FEC;
-    }
-
-#if OPAL_VIDEO
-    VideoStatsMap::const_iterator itVid = m_videoStatistics.find(statistics.m_SSRC);
-    if (itVid != m_videoStatistics.end())
-      statistics.OpalVideoStatistics::operator=(itVid->second);
-#endif
-  }
+  m_statistics.GetStatistics(statistics);
 
   if (m_primaryCodec != NULL)
     m_primaryCodec->GetStatistics(statistics);
 
+  if (m_resampler != NULL)
+    m_resampler->GetStatistics(statistics);
+
   if (m_secondaryCodec != NULL)
     m_secondaryCodec->GetStatistics(statistics);
 }
@@ -506,6 +689,7 @@ OpalMediaPatch::Sink::Sink(OpalMediaPatch & p, const OpalMediaStreamPtr & s)
   : m_patch(p)
   , m_stream(s)
   , m_primaryCodec(NULL)
+  , m_resampler(NULL)
   , m_secondaryCodec(NULL)
 {
   PTRACE_CONTEXT_ID_FROM(p);
@@ -516,8 +700,10 @@ OpalMediaPatch::Sink::Sink(OpalMediaPatch & p, const OpalMediaStreamPtr & s)
 
 OpalMediaPatch::Sink::~Sink()
 {
-  delete m_primaryCodec;
-  delete m_secondaryCodec;
+  OpalTranscoderPool & pool = GetTranscoderPool(m_patch);
+  pool.Release(m_primaryCodec);
+  pool.Release(m_resampler);
+  pool.Release(m_secondaryCodec);
 }
 
 
@@ -766,6 +952,7 @@ void OpalMediaPatch::Main()
        for X/10 ms so can not use more than about 90% of CPU. */
     int percentage = PThread::GetPercentageCPU(lastThreadTimes, CheckCPUTimeMS);
     if (percentage >= 0) {
+      m_source.GetConnection().GetEndPoint().GetManager().GetAdmissionController()->OnMediaCPU(percentage, percentage >= ThresholdPercent);
       if (percentage < ThresholdPercent)
         PTRACE(ThrottleCPU, "CPU for " << *this << " since start is " << lastThreadTimes);
       else {
@@ -904,10 +1091,14 @@ bool OpalMediaPatch::Sink::UpdateMediaFormat(const OpalMediaFormat & mediaFormat
   else if (m_secondaryCodec == NULL)
     ok = m_primaryCodec->UpdateMediaFormats(mediaFormat, mediaFormat) &&
          m_stream->InternalUpdateMediaFormat(m_primaryCodec->GetOutputFormat());
-  else
-    ok = m_primaryCodec->UpdateMediaFormats(mediaFormat, mediaFormat) &&
-         m_secondaryCodec->UpdateMediaFormats(m_primaryCodec->GetOutputFormat(), m_primaryCodec->GetOutputFormat()) &&
-         m_stream->InternalUpdateMediaFormat(m_secondaryCodec->GetOutputFormat());
+  else {
+    ok = m_primaryCodec->UpdateMediaFormats(mediaFormat, mediaFormat);
+    if (ok && m_resampler != NULL)
+      ok = m_resampler->UpdateMediaFormats(m_primaryCodec->GetOutputFormat(), OpalMediaFormat());
+    const OpalMediaFormat & secondaryInput = m_resampler != NULL ? m_resampler->GetOutputFormat() : m_primaryCodec->GetOutputFormat();
+    ok = ok && m_secondaryCodec->UpdateMediaFormats(secondaryInput, secondaryInput) &&
+               m_stream->InternalUpdateMediaFormat(m_secondaryCodec->GetOutputFormat());
+  }
 
   PTRACE(3, "Updated Sink: format=" << mediaFormat << " ok=" << ok);
   return ok;
@@ -929,10 +1120,7 @@ bool OpalMediaPatch::Sink::ExecuteCommand(const OpalMediaCommand & command, bool
     const OpalVideoUpdatePicture * update = dynamic_cast<const OpalVideoUpdatePicture *>(&command);
     if (update != NULL) {
       bool full = dynamic_cast<const OpalVideoPictureLoss *>(&command) == NULL;
-      PWaitAndSignal mutex(m_statsMutex);
-      m_videoStatistics[0].IncrementUpdateCount(full);
-      if (update->GetSyncSource() != 0)
-        m_videoStatistics[update->GetSyncSource()].IncrementUpdateCount(full);
+      m_statistics.IncrementUpdateCount(update->GetSyncSource(), full);
     }
   }
 #endif
@@ -966,49 +1154,21 @@ bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassin
       return false;
 
 #if OPAL_STATISTICS
-    RTP_SyncSourceId ssrc;
-    if (audioFrameType != OpalAudioFormat::e_UnknownFrameType) {
-      PWaitAndSignal mutex(m_statsMutex);
-
-      AudioStats & allStats = m_audioStatistics[0];
-      AudioStats * ssrcStats = (ssrc = sourceFrame.GetSyncSource()) != 0 ? &m_audioStatistics[ssrc] : NULL;
-
-      if (audioFrameType&OpalAudioFormat::e_SilenceFrame) {
-        ++allStats.m_silent;
-        if (ssrcStats)
-          ++ssrcStats->m_silent;
-      }
-
-      if (audioFrameType&OpalAudioFormat::e_FECFrame) {
-        ++allStats.m_FEC;
-        if (ssrcStats)
-          ++ssrcStats->m_FEC;
-      }
-    }
+    if (audioFrameType != OpalAudioFormat::e_UnknownFrameType)
+      m_statistics.IncrementAudio(sourceFrame.GetSyncSource(), audioFrameType);
 
 #if OPAL_VIDEO
     switch (videoFrameType) {
       case OpalVideoFormat::e_IntraFrame :
-        m_statsMutex.Wait();
-        m_videoStatistics[0].IncrementFrames(true);
-        if ((ssrc = sourceFrame.GetSyncSource()) != 0)
-          m_videoStatistics[ssrc].IncrementFrames(true);
-        PTRACE(4, "I-Frame detected: SSRC=" << RTP_TRACE_SRC(ssrc)
-                << ", ts=" << sourceFrame.GetTimestamp() << ", total=" << m_videoStatistics[ssrc].m_totalFrames
-                << ", key=" << m_videoStatistics[ssrc].m_keyFrames
-                << ", req=" << m_videoStatistics[ssrc].m_lastUpdateRequestTime << ", on " << m_patch);
-        m_statsMutex.Signal();
+        m_statistics.IncrementFrames(sourceFrame.GetSyncSource(), true);
+        PTRACE(4, "I-Frame detected: SSRC=" << RTP_TRACE_SRC(sourceFrame.GetSyncSource())
+                << ", ts=" << sourceFrame.GetTimestamp() << ", on " << m_patch);
         break;
 
       case OpalVideoFormat::e_InterFrame :
-        m_statsMutex.Wait();
-        m_videoStatistics[0].IncrementFrames(false);
-        if ((ssrc = sourceFrame.GetSyncSource()) != 0)
-          m_videoStatistics[ssrc].IncrementFrames(false);
-        PTRACE(5, "P-Frame detected: SSRC=" << RTP_TRACE_SRC(ssrc)
-                << ", ts=" << sourceFrame.GetTimestamp() << ", total=" << m_videoStatistics[ssrc].m_totalFrames
-                << ", key=" << m_videoStatistics[ssrc].m_keyFrames << ", on " << m_patch);
-        m_statsMutex.Signal();
+        m_statistics.IncrementFrames(sourceFrame.GetSyncSource(), false);
+        PTRACE(5, "P-Frame detected: SSRC=" << RTP_TRACE_SRC(sourceFrame.GetSyncSource())
+                << ", ts=" << sourceFrame.GetTimestamp() << ", on " << m_patch);
         break;
 
       default :
@@ -1038,33 +1198,58 @@ bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassin
       continue;
     }
 
-    if (!m_secondaryCodec->ConvertFrames(*interFrame, m_finalFrames)) {
-      PTRACE(1, "Media conversion (secondary) failed");
+    if (m_resampler == NULL) {
+      if (!WriteSecondary(sourceFrame, *interFrame))
+        return false;
+      if (m_secondaryCodec == NULL)
+        return true;
+      continue;
+    }
+
+    if (!m_resampler->ConvertFrames(*interFrame, m_resampledFrames)) {
+      PTRACE(1, "Media conversion (resampler) failed");
       return false;
     }
 
-    for (RTP_DataFrameList::iterator finalFrame = m_finalFrames.begin(); finalFrame != m_finalFrames.end(); ++finalFrame) {
-      m_patch.FilterFrame(*finalFrame, m_secondaryCodec->GetOutputFormat());
-      if (!m_stream->WritePacket(*finalFrame))
+    for (RTP_DataFrameList::iterator resampledFrame = m_resampledFrames.begin(); resampledFrame != m_resampledFrames.end(); ++resampledFrame) {
+      if (!WriteSecondary(sourceFrame, *resampledFrame))
         return false;
-      if (m_secondaryCodec == NULL)
+      if (m_secondaryCodec == NULL || m_resampler == NULL)
         return true;
-      m_secondaryCodec->CopyTimestamp(sourceFrame, *finalFrame, false);
+      m_resampler->CopyTimestamp(sourceFrame, sourceFrame, false);
     }
   }
 
 #if OPAL_VIDEO && OPAL_STATISTICS
   OpalVideoTranscoder * videoCodec = dynamic_cast<OpalVideoTranscoder *>(m_primaryCodec);
-  if (videoCodec != NULL && !m_intermediateFrames.IsEmpty()) {
-    PWaitAndSignal mutex(m_statsMutex);
-    m_videoStatistics[0].IncrementFrames(videoCodec->WasLastFrameIFrame());
-  }
+  if (videoCodec != NULL && !m_intermediateFrames.IsEmpty())
+    m_statistics.IncrementFrames(0, videoCodec->WasLastFrameIFrame());
 #endif // OPAL_VIDEO && OPAL_STATISTICS
 
   return true;
 }
 
 
+bool OpalMediaPatch::Sink::WriteSecondary(RTP_DataFrame & sourceFrame, RTP_DataFrame & interFrame)
+{
+  if (!m_secondaryCodec->ConvertFrames(interFrame, m_finalFrames)) {
+    PTRACE(1, "Media conversion (secondary) failed");
+    return false;
+  }
+
+  for (RTP_DataFrameList::iterator finalFrame = m_finalFrames.begin(); finalFrame != m_finalFrames.end(); ++finalFrame) {
+    m_patch.FilterFrame(*finalFrame, m_secondaryCodec->GetOutputFormat());
+    if (!m_stream->WritePacket(*finalFrame))
+      return false;
+    if (m_secondaryCodec == NULL)
+      return true;
+    m_secondaryCodec->CopyTimestamp(sourceFrame, *finalFrame, false);
+  }
+
+  return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 OpalPassiveMediaPatch::OpalPassiveMediaPatch(OpalMediaStream & source)
@@ -35,6 +35,8 @@
 #include <opal/recording.h>
 
 #include <ep/opalmixer.h>
+#include <opal/transcoders.h>
+#include <codec/resampler.h>
 #include <ptclib/mediafile.h>
 
 
@@ -113,6 +115,11 @@ class OpalMediaFileRecordManager : public OpalRecordManager
     } * m_audioMixer;
     unsigned m_audioTrack;
 
+    // Streams not at the mixer sample rate
+    typedef std::map<PString, OpalPCM16Resampler *> ResamplerMap;
+    ResamplerMap m_audioResamplers;
+    RTP_DataFrameList m_resampledAudio;
+
 #if OPAL_VIDEO
     virtual bool WriteVideo(const PString & strmId, const RTP_DataFrame & rtp);
     virtual bool OnPushVideo();
@@ -256,8 +263,14 @@ bool OpalMediaFileRecordManager::Close()
   delete m_file;
   m_file = NULL;
 
+  ResamplerMap audioResamplers;
+  audioResamplers.swap(m_audioResamplers);
+
   m_mutex.Signal();
 
+  for (ResamplerMap::iterator it = audioResamplers.begin(); it != audioResamplers.end(); ++it)
+    delete it->second;
+
   delete audioMixer;
 #if OPAL_VIDEO
   delete videoMixer;
@@ -290,6 +303,12 @@ bool OpalMediaFileRecordManager::CloseStream(const PString & streamId)
   if (m_audioMixer != NULL)
     m_audioMixer->RemoveStream(streamId);
 
+  ResamplerMap::iterator resampler = m_audioResamplers.find(streamId);
+  if (resampler != m_audioResamplers.end()) {
+    delete resampler->second;
+    m_audioResamplers.erase(resampler);
+  }
+
 #if OPAL_VIDEO
   if (m_videoMixer != NULL)
     m_videoMixer->RemoveStream(streamId);
@@ -319,7 +338,19 @@ unsigned OpalMediaFileRecordManager::GetPushAudioPeriodMS() const
 bool OpalMediaFileRecordManager::WriteAudio(const PString & strmId, const RTP_DataFrame & rtp)
 {
   PWaitAndSignal mutex(m_mutex);
-  return m_audioMixer != NULL && m_audioMixer->WriteStream(strmId, rtp);
+
+  if (m_audioMixer == NULL)
+    return false;
+
+  ResamplerMap::iterator resampler = m_audioResamplers.find(strmId);
+  if (resampler == m_audioResamplers.end())
+    return m_audioMixer->WriteStream(strmId, rtp);
+
+  // Also scales the timestamp to the mixer sample rate
+  if (!resampler->second->ConvertFrames(rtp, m_resampledAudio))
+    return false;
+
+  return m_audioMixer->WriteStream(strmId, m_resampledAudio.front());
 }
 
 
@@ -329,8 +360,13 @@ bool OpalMediaFileRecordManager::OpenAudio(const PString & strmId, const OpalMed
   if (m_audioMixer == NULL)
     return false;
 
-  if (!m_audioMixer->SetSampleRate(format.GetClockRate()))
-    return false;
+  unsigned sampleRate = format.GetClockRate();
+  if (!m_audioMixer->SetSampleRate(sampleRate)) {
+    // Already mixing at a different rate, convert this stream to it
+    OpalPCM16Resampler * & resampler = m_audioResamplers[strmId];
+    delete resampler;
+    resampler = new OpalPCM16Resampler(sampleRate, m_audioMixer->GetSampleRate());
+  }
 
   if (m_audioTrack < m_file->GetTrackCount())
     return m_audioMixer->AddStream(strmId);
@@ -350,7 +386,7 @@ bool OpalMediaFileRecordManager::OpenAudio(const PString & strmId, const OpalMed
 
   PMediaFile::TrackInfo & track = tracks[m_audioTrack];
   track.m_channels = m_options.m_stereo ? 2 : 1;
-  track.m_rate = format.GetClockRate();
+  track.m_rate = m_audioMixer->GetSampleRate();
   track.m_size = track.m_channels * sizeof(short);
 
   if (!m_file->SetTracks(tracks))
@@ -480,6 +516,558 @@ OpalRecordManager * OpalMediaFileRecordManager::FactoryInitialiser::Create(OpalR
 static OpalMediaFileRecordManager::FactoryInitialiser OpalMediaFileRecordManager_FactoryInitialiser_instance;
 
 
+//////////////////////////////////////////////////////////////////////////////
+
+static const char SpoolMagic[8] = { 'O', 'P', 'A', 'L', 'S', 'P', 'L', '\0' };
+static const unsigned SpoolVersion = 1;
+static const PINDEX SpoolAlignment = 8;
+static const PINDEX SpoolMaxRecordLength = 65536; // Larger than any RTP packet
+
+static PINDEX SpoolPadding(PINDEX length)
+{
+  return (SpoolAlignment - (length % SpoolAlignment)) % SpoolAlignment;
+}
+
+
+OpalRecordSpoolFile::OpalRecordSpoolFile(PINDEX bufferSize)
+  : m_buffer(bufferSize)
+  , m_bufferUsed(0)
+{
+}
+
+
+OpalRecordSpoolFile::~OpalRecordSpoolFile()
+{
+  Close();
+}
+
+
+bool OpalRecordSpoolFile::InternalOpen(OpenMode mode, OpenOptions opts, PFileInfo::Permissions permissions)
+{
+  PAssert(mode != PFile::ReadWrite, PInvalidParameter);
+
+  PWaitAndSignal mutex(m_bufferMutex);
+
+  m_bufferUsed = 0;
+
+  if (!PFile::InternalOpen(mode, opts, permissions))
+    return false;
+
+  FileHeader header;
+  if (mode == PFile::WriteOnly) {
+    memcpy(header.m_magic, SpoolMagic, sizeof(header.m_magic));
+    header.m_version = SpoolVersion;
+    header.m_reserved = 0;
+    if (Write(&header, sizeof(header)))
+      return true;
+    PTRACE(1, "Could not write header to \"" << GetFilePath() << '"');
+    return false;
+  }
+
+  if (!Read(&header, sizeof(header))) {
+    PTRACE(1, "Could not read header from \"" << GetFilePath() << '"');
+    return false;
+  }
+
+  if (memcmp(header.m_magic, SpoolMagic, sizeof(header.m_magic)) != 0) {
+    PTRACE(1, "File \"" << GetFilePath() << "\" is not a packet spool file, bad magic number.");
+    return false;
+  }
+
+  if (header.m_version != SpoolVersion) {
+    PTRACE(1, "File \"" << GetFilePath() << "\" is unsupported packet spool version " << header.m_version);
+    return false;
+  }
+
+  return true;
+}
+
+
+PBoolean OpalRecordSpoolFile::Close()
+{
+  if (!IsOpen())
+    return true;
+
+  bool ok = FlushRecords();
+  return PFile::Close() && ok;
+}
+
+
+bool OpalRecordSpoolFile::FlushRecords()
+{
+  PWaitAndSignal mutex(m_bufferMutex);
+
+  if (m_bufferUsed == 0)
+    return true;
+
+  PINDEX length = m_bufferUsed;
+  m_bufferUsed = 0;
+  if (Write(m_buffer, length))
+    return true;
+
+  PTRACE(1, "Could not write to \"" << GetFilePath() << "\": " << GetErrorText());
+  return false;
+}
+
+
+bool OpalRecordSpoolFile::InternalWriteRecord(RecordTypes type, unsigned stream, const PTime & when, const void * data, PINDEX length)
+{
+  if (length > SpoolMaxRecordLength) {
+    PTRACE(2, "Record of " << length << " bytes too large for \"" << GetFilePath() << '"');
+    return false;
+  }
+
+  RecordHeader header;
+  header.m_type = (uint16_t)type;
+  header.m_stream = (uint16_t)stream;
+  header.m_length = length;
+  header.m_time = when.GetTimestamp();
+
+  PINDEX padding = SpoolPadding(length);
+  PINDEX total = sizeof(header) + length + padding;
+
+  PWaitAndSignal mutex(m_bufferMutex);
+
+  if (m_bufferUsed + total > m_buffer.GetSize()) {
+    PINDEX used = m_bufferUsed;
+    m_bufferUsed = 0;
+    if (used > 0 && !Write(m_buffer, used)) {
+      PTRACE(1, "Could not write to \"" << GetFilePath() << "\": " << GetErrorText());
+      return false;
+    }
+
+    // Too big for buffer at all, so write it directly
+    if (total > m_buffer.GetSize()) {
+      static const BYTE zeros[SpoolAlignment] = { 0 };
+      return Write(&header, sizeof(header)) && Write(data, length) && Write(zeros, padding);
+    }
+  }
+
+  BYTE * ptr = m_buffer.GetPointer() + m_bufferUsed;
+  memcpy(ptr, &header, sizeof(header));
+  memcpy(ptr + sizeof(header), data, length);
+  memset(ptr + sizeof(header) + length, 0, padding);
+  m_bufferUsed += total;
+  return true;
+}
+
+
+bool OpalRecordSpoolFile::WriteStreamOpen(unsigned stream, const OpalMediaFormat & format, const PString & id, const PTime & when)
+{
+  PString name = format.GetName();
+  PBYTEArray data(name.GetLength() + id.GetLength() + 2);
+  memcpy(data.GetPointer(), (const char *)name, name.GetLength() + 1);
+  memcpy(data.GetPointer() + name.GetLength() + 1, (const char *)id, id.GetLength() + 1);
+  return InternalWriteRecord(e_StreamOpen, stream, when, data, data.GetSize());
+}
+
+
+bool OpalRecordSpoolFile::WritePacket(unsigned stream, const RTP_DataFrame & rtp, const PTime & when)
+{
+  if (when.IsValid())
+    return InternalWriteRecord(e_Packet, stream, when, rtp.GetPointer(), rtp.GetPacketSize());
+
+  const PTime & received = rtp.GetMetaData().m_receivedTime;
+  return InternalWriteRecord(e_Packet, stream, received.IsValid() ? received : PTime(), rtp.GetPointer(), rtp.GetPacketSize());
+}
+
+
+bool OpalRecordSpoolFile::WriteStreamClose(unsigned stream, const PTime & when)
+{
+  return InternalWriteRecord(e_StreamClose, stream, when, NULL, 0);
+}
+
+
+bool OpalRecordSpoolFile::ReadRecord(Record & record)
+{
+  RecordHeader header;
+  if (!Read(&header, sizeof(header)))
+    return false;
+
+  if (GetLastReadCount() != sizeof(header)) {
+    PTRACE(2, "Truncated record header in \"" << GetFilePath() << '"');
+    return false;
+  }
+
+  switch (header.m_type) {
+    case e_StreamOpen :
+    case e_Packet :
+    case e_StreamClose :
+      break;
+    default :
+      PTRACE(2, "Unknown record type " << header.m_type << " in \"" << GetFilePath() << '"');
+      return false;
+  }
+
+  record.m_type = (RecordTypes)(unsigned)header.m_type;
+  record.m_stream = header.m_stream;
+  uint64_t timestamp = header.m_time;
+  record.m_time.SetTimestamp((time_t)(timestamp/1000000), (int64_t)(timestamp%1000000));
+
+  // Do not trust the length from the file for the allocation size
+  if (header.m_length > (uint32_t)SpoolMaxRecordLength) {
+    PTRACE(2, "Record length " << header.m_length << " too large in \"" << GetFilePath() << '"');
+    return false;
+  }
+
+  PINDEX length = header.m_length;
+  PINDEX total = length + SpoolPadding(length);
+  if (total > 0 && (!Read(record.m_data.GetPointer(total), total) || GetLastReadCount() != total)) {
+    PTRACE(2, "Truncated record in \"" << GetFilePath() << '"');
+    return false;
+  }
+  record.m_data.SetSize(length);
+  return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+/** This class records calls by spooling the encoded packets to a file, for
+    rendering later with OpalRecordSpoolRenderer.
+  */
+class OpalRecordSpoolManager : public OpalRecordManager
+{
+  public:
+    OpalRecordSpoolManager()
+      : m_nextStream(0)
+    {
+    }
+
+    ~OpalRecordSpoolManager()
+    {
+      Close();
+    }
+
+    virtual bool OpenFile(const PFilePath & fn)
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      if (m_file.IsOpen()) {
+        PTRACE(2, "Cannot open spool file after it has started.");
+        return false;
+      }
+
+      if (!m_file.Open(fn, PFile::WriteOnly)) {
+        PTRACE(2, "Cannot open spool file for writing: " << m_file.GetErrorText());
+        return false;
+      }
+
+      PTRACE(4, "Spooling packets to file \"" << fn << '"');
+      return true;
+    }
+
+    virtual bool IsOpen() const
+    {
+      return m_file.IsOpen();
+    }
+
+    virtual bool Close()
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      for (StreamMap::iterator it = m_streams.begin(); it != m_streams.end(); ++it)
+        m_file.WriteStreamClose(it->second);
+      m_streams.clear();
+
+      return m_file.Close();
+    }
+
+    virtual bool OpenStream(const PString & strmId, const OpalMediaFormat & format)
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      if (!m_file.IsOpen() || m_streams.find(strmId) != m_streams.end())
+        return false;
+
+      unsigned stream = m_nextStream++;
+      if (!m_file.WriteStreamOpen(stream, format, strmId))
+        return false;
+
+      m_streams[strmId] = stream;
+      PTRACE(4, "Opened spool stream " << stream << " for " << strmId << " format " << format);
+      return true;
+    }
+
+    virtual bool CloseStream(const PString & strmId)
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      StreamMap::iterator it = m_streams.find(strmId);
+      if (it == m_streams.end())
+        return false;
+
+      m_file.WriteStreamClose(it->second);
+      m_streams.erase(it);
+      PTRACE(4, "Closed stream " << strmId);
+      return true;
+    }
+
+    virtual bool IsEncodedRecording() const
+    {
+      return true;
+    }
+
+    virtual bool OnPushAudio()
+    {
+      return true; // Nothing to mix in real time
+    }
+
+    virtual unsigned GetPushAudioPeriodMS() const
+    {
+      return 0;
+    }
+
+    virtual bool WriteAudio(const PString & strmId, const RTP_DataFrame & rtp)
+    {
+      return WritePacket(strmId, rtp);
+    }
+
+#if OPAL_VIDEO
+    virtual bool OnPushVideo()
+    {
+      return true; // Nothing to mix in real time
+    }
+
+    virtual unsigned GetPushVideoPeriodMS() const
+    {
+      return 0;
+    }
+
+    virtual bool WriteVideo(const PString & strmId, const RTP_DataFrame & rtp)
+    {
+      return WritePacket(strmId, rtp);
+    }
+#endif
+
+  protected:
+    bool WritePacket(const PString & strmId, const RTP_DataFrame & rtp)
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      StreamMap::iterator it = m_streams.find(strmId);
+      return it != m_streams.end() && m_file.WritePacket(it->second, rtp);
+    }
+
+    PDECLARE_MUTEX(m_mutex);
+    OpalRecordSpoolFile m_file;
+    typedef std::map<PString, unsigned> StreamMap;
+    StreamMap m_streams;
+    unsigned  m_nextStream;
+};
+
+PFACTORY_CREATE(OpalRecordManager::Factory, OpalRecordSpoolManager, OPAL_RECORD_SPOOL_FILE_TYPE);
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+OpalRecordSpoolRenderer::OpalRecordSpoolRenderer()
+  : m_alignmentDelay(100)
+  , m_nextAudioPush(0)
+#if OPAL_VIDEO
+  , m_nextVideoPush(0)
+#endif
+  , m_packetCount(0)
+  , m_decodeErrors(0)
+{
+}
+
+
+OpalRecordSpoolRenderer::~OpalRecordSpoolRenderer()
+{
+  for (StreamMap::iterator it = m_streams.begin(); it != m_streams.end(); ++it)
+    delete it->second.m_decoder;
+}
+
+
+bool OpalRecordSpoolRenderer::Render(const PFilePath & spoolFile,
+                                     const PFilePath & outputFile,
+                                     const OpalRecordManager::Options & options)
+{
+  OpalRecordSpoolFile spool;
+  if (!spool.Open(spoolFile, PFile::ReadOnly))
+    return false;
+
+  std::auto_ptr<OpalRecordManager> output(OpalRecordManager::Factory::CreateInstance(outputFile.GetType()));
+  if (output.get() == NULL) {
+    PTRACE(2, "Cannot render to file type " << outputFile);
+    return false;
+  }
+
+  if (output->IsEncodedRecording()) {
+    PTRACE(2, "Cannot render to another spool file " << outputFile);
+    return false;
+  }
+
+  // We drive the mixers from the packet arrival times, not real time
+  OpalRecordManager::Options mixOptions = options;
+  mixOptions.m_pushThreads = false;
+  if (!output->Open(outputFile, mixOptions))
+    return false;
+
+  PTRACE(3, "Rendering \"" << spoolFile << "\" to \"" << outputFile << '"');
+
+  m_packetCount = 0;
+  m_decodeErrors = 0;
+  m_nextAudioPush = 0;
+#if OPAL_VIDEO
+  m_nextVideoPush = 0;
+#endif
+
+  OpalRecordSpoolFile::Record record;
+  RTP_DataFrame rtp;
+  PTime lastTime(0);
+  while (spool.ReadRecord(record)) {
+    PushUntil(*output, record.m_time - m_alignmentDelay);
+    if (record.m_time > lastTime)
+      lastTime = record.m_time;
+
+    Stream & stream = m_streams[record.m_stream];
+    switch (record.m_type) {
+      case OpalRecordSpoolFile::e_StreamOpen :
+        if (!OpenStream(*output, stream, record.m_data))
+          m_streams.erase(record.m_stream);
+        break;
+
+      case OpalRecordSpoolFile::e_Packet :
+        ++m_packetCount;
+        if (stream.m_id.IsEmpty())
+          m_streams.erase(record.m_stream); // Stream not opened
+        else {
+          rtp = RTP_DataFrame(record.m_data, record.m_data.GetSize());
+          if (!WritePacket(*output, stream, rtp))
+            ++m_decodeErrors;
+        }
+        break;
+
+      case OpalRecordSpoolFile::e_StreamClose :
+        CloseStream(*output, stream);
+        m_streams.erase(record.m_stream);
+        break;
+    }
+  }
+
+  // Drain what is left in the mixers
+  PushUntil(*output, lastTime + m_alignmentDelay);
+
+  for (StreamMap::iterator it = m_streams.begin(); it != m_streams.end(); ++it)
+    CloseStream(*output, it->second);
+  m_streams.clear();
+
+  PTRACE(3, "Rendered " << m_packetCount << " packets, " << m_decodeErrors << " decode errors, to \"" << outputFile << '"');
+  return output->Close();
+}
+
+
+bool OpalRecordSpoolRenderer::OpenStream(OpalRecordManager & output, Stream & stream, const PBYTEArray & data)
+{
+  // Data is format name and stream id, both NUL terminated
+  const char * name = (const char *)(const BYTE *)data;
+  PINDEX nameLen = strlen(name);
+  if (nameLen + 1 >= data.GetSize()) {
+    PTRACE(2, "Invalid stream open record");
+    return false;
+  }
+
+  OpalMediaFormat format(name);
+  if (!format.IsValid()) {
+    PTRACE(2, "Unknown media format \"" << name << "\" in spool file");
+    return false;
+  }
+
+  stream.m_id = PString(name + nameLen + 1);
+  stream.m_isAudio = format.GetMediaType() == OpalMediaType::Audio();
+
+  OpalMediaFormat raw;
+  if (stream.m_isAudio)
+    raw = GetOpalPCM16(format.GetClockRate());
+#if OPAL_VIDEO
+  else if (format.GetMediaType() == OpalMediaType::Video())
+    raw = OPAL_YUV420P;
+#endif
+  else {
+    PTRACE(3, "Ignoring " << format.GetMediaType() << " stream " << stream.m_id);
+    return false;
+  }
+
+  if (format != raw) {
+    stream.m_decoder = OpalTranscoder::Create(format, raw);
+    if (stream.m_decoder == NULL) {
+      PTRACE(2, "Could not create decoder for " << format << " to " << raw);
+      return false;
+    }
+  }
+
+  if (!output.OpenStream(stream.m_id, format)) {
+    PTRACE(2, "Could not open output stream for " << stream.m_id);
+    delete stream.m_decoder;
+    stream.m_decoder = NULL;
+    return false;
+  }
+
+  PTRACE(4, "Opened stream " << stream.m_id << " format " << format);
+  return true;
+}
+
+
+void OpalRecordSpoolRenderer::CloseStream(OpalRecordManager & output, Stream & stream)
+{
+  if (stream.m_id.IsEmpty())
+    return;
+
+  output.CloseStream(stream.m_id);
+  delete stream.m_decoder;
+  stream.m_decoder = NULL;
+}
+
+
+bool OpalRecordSpoolRenderer::WritePacket(OpalRecordManager & output, Stream & stream, RTP_DataFrame & rtp)
+{
+  RTP_DataFrameList decoded;
+  if (stream.m_decoder == NULL)
+    decoded.Append(new RTP_DataFrame(rtp));
+  else if (!stream.m_decoder->ConvertFrames(rtp, decoded))
+    return false;
+
+  for (RTP_DataFrameList::iterator it = decoded.begin(); it != decoded.end(); ++it) {
+    if (stream.m_isAudio)
+      output.WriteAudio(stream.m_id, *it);
+#if OPAL_VIDEO
+    else if (it->GetPayloadSize() > 0)
+      output.WriteVideo(stream.m_id, *it);
+#endif
+  }
+
+  return true;
+}
+
+
+void OpalRecordSpoolRenderer::PushUntil(OpalRecordManager & output, const PTime & when)
+{
+  unsigned period = output.GetPushAudioPeriodMS();
+  if (period > 0) {
+    if (!m_nextAudioPush.IsValid())
+      m_nextAudioPush = when;
+    while (m_nextAudioPush <= when) {
+      output.OnPushAudio();
+      m_nextAudioPush += period;
+    }
+  }
+
+#if OPAL_VIDEO
+  period = output.GetPushVideoPeriodMS();
+  if (period > 0) {
+    if (!m_nextVideoPush.IsValid())
+      m_nextVideoPush = when;
+    while (m_nextVideoPush <= when) {
+      output.OnPushVideo();
+      m_nextVideoPush += period;
+    }
+  }
+#endif
+}
+
+
 #endif // OPAL_HAS_MIXER
 
 
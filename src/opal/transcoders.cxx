@@ -35,6 +35,9 @@
 
 #include <opal/transcoders.h>
 
+#include <set>
+#include <algorithm>
+
 
 #define new PNEW
 #define PTraceModule() "Transcoder"
@@ -83,6 +86,7 @@ OpalTranscoder::OpalTranscoder(const OpalMediaFormat & inputMediaFormat,
   , m_outClockRate(outputMediaFormat.GetClockRate())
   , m_lastPayloadType(RTP_DataFrame::IllegalPayloadType)
   , m_consecutivePayloadTypeMismatches(0)
+  , m_outputFrameAllocations(0)
 {
 }
 
@@ -119,6 +123,20 @@ PBoolean OpalTranscoder::ExecuteCommand(const OpalMediaCommand & command)
 }
 
 
+bool OpalTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  maxOutputSize = 32768;
+  commandNotifier = PNotifier();
+  m_sessionID = 0;
+  m_lastPayloadType = RTP_DataFrame::IllegalPayloadType;
+  m_consecutivePayloadTypeMismatches = 0;
+  m_outputFrameAllocations = 0;
+  return false;
+}
+
+
 void OpalTranscoder::SetMaxOutputSize(PINDEX size)
 {
   maxOutputSize = size;
@@ -176,16 +194,10 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 {
   PWaitAndSignal mutex(updateMutex);
 
-  // make sure there is at least one output frame available
-  if (output.IsEmpty())
-    output.Append(new RTP_DataFrame((PINDEX)0, maxOutputSize));
-  else {
-    while (output.GetSize() > 1)
-      output.RemoveTail();
-  }
+  // make sure there is exactly one output frame available
+  RTP_DataFrame & outframe = GetOutputFrame(output, 0, maxOutputSize);
+  TrimOutputFrames(output, 1);
 
-  RTP_DataFrame & outframe = output.front();
-  outframe.SetPayloadSize(0);
   outframe.CopyHeader(input);
 
   // set the output timestamp and marker bit
@@ -231,6 +243,107 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 }
 
 
+void OpalTranscoder::ConvertBatch(BatchEntries & entries)
+{
+  size_t count = entries.size();
+
+  /* Lock every transcoder, as ConvertFrames() does, for the whole batch as a
+     group may convert frames for many of them in one call. Lock in address
+     order so concurrent batches with common transcoders cannot deadlock. */
+  std::vector<OpalTranscoder *> locked(count);
+  for (size_t i = 0; i < count; ++i)
+    locked[i] = entries[i].m_transcoder;
+  std::sort(locked.begin(), locked.end());
+  locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+  for (size_t i = 0; i < locked.size(); ++i)
+    locked[i]->updateMutex.Wait();
+
+  std::vector<const void *> keys(count);
+  for (size_t i = 0; i < count; ++i)
+    keys[i] = entries[i].m_transcoder->GetBatchKey();
+
+  std::vector<bool> done(count);
+  std::vector<BatchEntry *> group;
+  group.reserve(count);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (done[i])
+      continue;
+
+    const void * key = keys[i];
+    if (key == NULL) {
+      entries[i].m_result = entries[i].m_transcoder->Convert(*entries[i].m_input, *entries[i].m_output);
+      continue;
+    }
+
+    group.clear();
+    for (size_t j = i; j < count; ++j) {
+      if (!done[j] && keys[j] == key) {
+        group.push_back(&entries[j]);
+        done[j] = true;
+      }
+    }
+
+    entries[i].m_transcoder->ConvertBatchGroup(&group[0], group.size());
+  }
+
+  for (size_t i = locked.size(); i > 0; --i)
+    locked[i-1]->updateMutex.Signal();
+}
+
+
+const void * OpalTranscoder::GetBatchKey() const
+{
+  return NULL;
+}
+
+
+void OpalTranscoder::ConvertBatchGroup(BatchEntry * const * entries, PINDEX count)
+{
+  // Note updateMutex of all the transcoders should already be locked at this point.
+
+  for (PINDEX i = 0; i < count; ++i)
+    entries[i]->m_result = entries[i]->m_transcoder->Convert(*entries[i]->m_input, *entries[i]->m_output);
+}
+
+
+RTP_DataFrame & OpalTranscoder::GetOutputFrame(RTP_DataFrameList & output, PINDEX index, PINDEX size)
+{
+  if (index >= output.GetSize()) {
+    output.Append(new RTP_DataFrame((PINDEX)0, size));
+    ++m_outputFrameAllocations;
+    return output.back();
+  }
+
+  RTP_DataFrame & frame = output[index];
+
+  /* If someone downstream still has a reference to the buffer, we must not
+     write over it, so give this frame a new one. Otherwise, just make sure
+     the buffer is big enough and reset it to an empty packet. */
+  if (!frame.IsUnique()) {
+    frame = RTP_DataFrame((PINDEX)0, size);
+    ++m_outputFrameAllocations;
+  }
+  else {
+    if (frame.GetSize() < size) {
+      frame.SetMinSize(size);
+      ++m_outputFrameAllocations;
+    }
+    frame.SetPayloadSize(0);
+    frame.SetPaddingSize(0);
+  }
+
+  return frame;
+}
+
+
+void OpalTranscoder::TrimOutputFrames(RTP_DataFrameList & output, PINDEX count)
+{
+  while (output.GetSize() > count)
+    output.RemoveTail();
+}
+
+
 OpalTranscoder * OpalTranscoder::Create(const OpalMediaFormat & srcFormat,
                                         const OpalMediaFormat & destFormat,
                                                    const BYTE * instance,
@@ -406,6 +519,18 @@ bool OpalTranscoder::SelectFormats(const OpalMediaType & mediaType,
     }
   }
 
+  // Really last gasp search for three transcoders, e.g. via a resampler
+  for (d = dstFormats.begin(); d != dstFormats.end(); ++d) {
+    for (s = srcFormats.begin(); s != srcFormats.end(); ++s) {
+      if (s->GetMediaType() == mediaType || d->GetMediaType() == mediaType) {
+        OpalMediaFormat decodedFormat, resampledFormat;
+        if (FindIntermediateFormats(*s, *d, decodedFormat, resampledFormat) &&
+            MergeFormats(masterFormats, *s, *d, srcFormat, dstFormat))
+          return true;
+      }
+    }
+  }
+
   return false;
 }
 
@@ -437,6 +562,46 @@ bool OpalTranscoder::FindIntermediateFormat(const OpalMediaFormat & srcFormat,
 }
 
 
+bool OpalTranscoder::FindIntermediateFormats(const OpalMediaFormat & srcFormat,
+                                             const OpalMediaFormat & dstFormat,
+                                             OpalMediaFormat & decodedFormat,
+                                             OpalMediaFormat & resampledFormat)
+{
+  decodedFormat = resampledFormat = OpalMediaFormat();
+
+  // Collect what the source can go to, and what can get to the destination
+  OpalMediaFormatList decoded, resampled;
+  OpalTranscoderList availableTranscoders = OpalTranscoderFactory::GetKeyList();
+  for (OpalTranscoderIterator find = availableTranscoders.begin(); find != availableTranscoders.end(); ++find) {
+    if (find->first == srcFormat)
+      decoded += find->second;
+    if (find->second == dstFormat)
+      resampled += find->first;
+  }
+
+  if (decoded.IsEmpty() || resampled.IsEmpty())
+    return false;
+
+  // Then look for something to go between them
+  std::set<OpalTranscoderKey> keys(availableTranscoders.begin(), availableTranscoders.end());
+  for (OpalMediaFormatList::iterator first = decoded.begin(); first != decoded.end(); ++first) {
+    for (OpalMediaFormatList::iterator last = resampled.begin(); last != resampled.end(); ++last) {
+      if (*first != *last && keys.find(MakeOpalTranscoderKey(*first, *last)) != keys.end()) {
+        OpalMediaFormat probableDecoded = *first;
+        OpalMediaFormat probableResampled = *last;
+        if (probableDecoded.Merge(srcFormat) && probableResampled.Merge(dstFormat)) {
+          decodedFormat = probableDecoded;
+          resampledFormat = probableResampled;
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+
 OpalMediaFormatList OpalTranscoder::GetDestinationFormats(const OpalMediaFormat & srcFormat)
 {
   OpalMediaFormatList list;
@@ -498,6 +663,7 @@ OpalMediaFormatList OpalTranscoder::GetPossibleFormats(const OpalMediaFormatList
 OpalFramedTranscoder::OpalFramedTranscoder(const OpalMediaFormat & inputMediaFormat,
                                            const OpalMediaFormat & outputMediaFormat)
   : OpalTranscoder(inputMediaFormat, outputMediaFormat)
+  , m_rawInput(false)
   , m_emptyPayloadState(AwaitingFirstNonEmptyPayload)
   , m_lastEmptyPayloadTimestamp(0)
 {
@@ -521,6 +687,16 @@ bool OpalFramedTranscoder::UpdateMediaFormats(const OpalMediaFormat & input, con
 }
 
 
+bool OpalFramedTranscoder::Reset()
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  m_emptyPayloadState = AwaitingFirstNonEmptyPayload;
+  m_lastEmptyPayloadTimestamp = 0;
+  return OpalTranscoder::Reset();
+}
+
+
 void OpalFramedTranscoder::CalculateSizes()
 {
   unsigned framesPerPacket = outputMediaFormat.GetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption(),
@@ -537,6 +713,9 @@ void OpalFramedTranscoder::CalculateSizes()
   unsigned inMaxTimePerFrame  = inFrameTime*inputMediaFormat.GetOptionInteger(OpalAudioFormat::MaxFramesPerPacketOption(), 1);
   unsigned outMaxTimePerFrame = outFrameTime*outputMediaFormat.GetOptionInteger(OpalAudioFormat::MaxFramesPerPacketOption(), 1);
   maxOutputDataSize = outputBytesPerFrame*std::max(inMaxTimePerFrame, outMaxTimePerFrame)/outFrameTime;
+
+  // Raw audio may be split into frames for batch conversion, encoded data may be variable sized
+  m_rawInput = inputMediaFormat.GetName().NumCompare(OPAL_PCM16) == EqualTo;
 }
 
 
@@ -622,26 +801,46 @@ PBoolean OpalFramedTranscoder::Convert(const RTP_DataFrame & input, RTP_DataFram
       outLen = outputBytesPerFrame;
     }
   }
-  else {
-    while (inputLength > 0 && outLen < maxOutputDataSize) {
+  else if (inputLength > inputBytesPerFrame && GetBatchFrameCount(input) > 1) {
+    // Several frames in packet, so convert them with one call into codec
+    BatchEntry entry(this, &input, &output);
+    BatchEntry * entryPtr = &entry;
+    ConvertBatchGroup(&entryPtr, 1);
+    return entry.m_result;
+  }
+  else if (!ConvertFrameLoop(inputPtr, inputLength, outputPtr, outLen))
+    return false;
+
+  CompleteConvert(output, outLen);
+  return true;
+}
 
-      PINDEX consumed = inputLength;
-      PINDEX created = maxOutputDataSize - outLen;
 
-      if (!ConvertFrame(inputPtr, consumed, outputPtr, created))
-        return false;
+bool OpalFramedTranscoder::ConvertFrameLoop(const BYTE * inputPtr, PINDEX inputLength, BYTE * outputPtr, PINDEX & outLen)
+{
+  while (inputLength > 0 && outLen < maxOutputDataSize) {
 
-      // If did not consume or produce any data, codec has gone wrong, abort!
-      if (consumed == 0 && created == 0)
-        break;
+    PINDEX consumed = inputLength;
+    PINDEX created = maxOutputDataSize - outLen;
 
-      outputPtr += created;
-      outLen += created;
-      inputPtr += consumed;
-      inputLength -= consumed;
-    }
+    if (!ConvertFrame(inputPtr, consumed, outputPtr + outLen, created))
+      return false;
+
+    // If did not consume or produce any data, codec has gone wrong, abort!
+    if (consumed == 0 && created == 0)
+      break;
+
+    outLen += created;
+    inputPtr += consumed;
+    inputLength -= consumed;
   }
 
+  return true;
+}
+
+
+void OpalFramedTranscoder::CompleteConvert(RTP_DataFrame & output, PINDEX outLen)
+{
   // We have delayed output from codec, so use timestamp from original sample
   if (outLen > 0) {
     if (m_emptyPayloadState == DelayedDecodeEmptyPayload) {
@@ -653,8 +852,124 @@ PBoolean OpalFramedTranscoder::Convert(const RTP_DataFrame & input, RTP_DataFram
 
   // set actual output payload size
   output.SetPayloadSize(outLen);
+}
 
-  return true;
+
+PINDEX OpalFramedTranscoder::GetBatchFrameCount(const RTP_DataFrame & input) const
+{
+  if (inputIsRTP || outputIsRTP || GetBatchKey() == NULL)
+    return 0;
+
+  PINDEX inputLength = input.GetPayloadSize();
+  if (inputLength == 0)
+    return 0;
+
+  // Encoded data is passed whole, any remainder is done by ConvertFrameLoop()
+  if (!m_rawInput || inputBytesPerFrame == 0)
+    return 1;
+
+  if (inputLength % inputBytesPerFrame != 0)
+    return 1;
+
+  PINDEX frames = inputLength/inputBytesPerFrame;
+  return frames*outputBytesPerFrame <= maxOutputDataSize ? frames : 1;
+}
+
+
+void OpalFramedTranscoder::ConvertBatchGroup(BatchEntry * const * entries, PINDEX count)
+{
+  // Note updateMutex of all the transcoders should already be locked at this point.
+
+  std::vector<BatchFrame> frames;
+  std::vector<size_t> firstFrame(count+1);
+
+  for (PINDEX i = 0; i < count; ++i) {
+    BatchEntry & entry = *entries[i];
+    OpalFramedTranscoder & transcoder = *dynamic_cast<OpalFramedTranscoder *>(entry.m_transcoder);
+
+    firstFrame[i] = frames.size();
+
+    PINDEX frameCount = transcoder.GetBatchFrameCount(*entry.m_input);
+    if (frameCount == 0 || !entry.m_output->SetPayloadSize(transcoder.maxOutputDataSize)) {
+      entry.m_result = transcoder.Convert(*entry.m_input, *entry.m_output);
+      continue;
+    }
+
+    BatchFrame frame;
+    frame.m_transcoder = &transcoder;
+    frame.m_input = entry.m_input->GetPayloadPtr();
+    frame.m_consumed = entry.m_input->GetPayloadSize()/frameCount;
+    frame.m_output = entry.m_output->GetPayloadPtr();
+    frame.m_created = frameCount > 1 ? transcoder.outputBytesPerFrame : transcoder.maxOutputDataSize;
+    frame.m_result = false;
+
+    PINDEX inputStride = frame.m_consumed;
+    PINDEX outputStride = frame.m_created;
+    while (frameCount-- > 0) {
+      frames.push_back(frame);
+      frame.m_input += inputStride;
+      frame.m_output += outputStride;
+    }
+  }
+  firstFrame[count] = frames.size();
+
+  if (frames.empty())
+    return;
+
+  ConvertFrameBatch(&frames[0], frames.size());
+
+  for (PINDEX i = 0; i < count; ++i) {
+    size_t first = firstFrame[i];
+    size_t last = firstFrame[i+1];
+    if (first == last)
+      continue; // Was converted individually
+
+    BatchEntry & entry = *entries[i];
+    OpalFramedTranscoder & transcoder = *frames[first].m_transcoder;
+
+    // Pack the frame outputs together
+    BYTE * outputPtr = entry.m_output->GetPayloadPtr();
+    PINDEX outLen = 0;
+    entry.m_result = true;
+    for (size_t f = first; f < last; ++f) {
+      if (!frames[f].m_result) {
+        entry.m_result = false;
+        break;
+      }
+      /* All frames were given to the codec in one go, so if it left some of
+         one that is not the last, it cannot be carried into the next frame
+         and the conversion fails rather than silently dropping audio. */
+      if (f+1 < last && frames[f].m_input + frames[f].m_consumed != frames[f+1].m_input) {
+        PTRACE(2, "Codec consumed " << frames[f].m_consumed << " of "
+               << (frames[f+1].m_input - frames[f].m_input) << " bytes of batch frame " << (f - first));
+        entry.m_result = false;
+        break;
+      }
+      if (frames[f].m_output != outputPtr + outLen)
+        memmove(outputPtr + outLen, frames[f].m_output, frames[f].m_created);
+      outLen += frames[f].m_created;
+    }
+
+    if (!entry.m_result)
+      continue;
+
+    // Codec may not have consumed everything, do remainder the usual way
+    const BYTE * inputPtr = frames[last-1].m_input + frames[last-1].m_consumed;
+    PINDEX remaining = entry.m_input->GetPayloadPtr() + entry.m_input->GetPayloadSize() - inputPtr;
+    if (remaining > 0 && (frames[last-1].m_consumed > 0 || frames[last-1].m_created > 0))
+      entry.m_result = transcoder.ConvertFrameLoop(inputPtr, remaining, outputPtr, outLen);
+
+    if (entry.m_result)
+      transcoder.CompleteConvert(*entry.m_output, outLen);
+  }
+}
+
+
+void OpalFramedTranscoder::ConvertFrameBatch(BatchFrame * frames, PINDEX count)
+{
+  for (PINDEX i = 0; i < count; ++i)
+    frames[i].m_result = frames[i].m_transcoder->ConvertFrame(frames[i].m_input, frames[i].m_consumed,
+                                                              frames[i].m_output, frames[i].m_created);
 }
 
 PBoolean OpalFramedTranscoder::ConvertFrame(const BYTE * inputPtr, PINDEX & /*consumed*/, BYTE * outputPtr, PINDEX & /*created*/)
@@ -884,6 +1199,245 @@ PBoolean OpalStreamedTranscoder::Convert(const RTP_DataFrame & input,
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+OpalTranscoderPool::Statistics::Statistics()
+  : m_acquired(0)
+  , m_reused(0)
+  , m_created(0)
+  , m_retained(0)
+  , m_discarded(0)
+{
+}
+
+
+double OpalTranscoderPool::Statistics::GetReuseRate() const
+{
+  return m_acquired > 0 ? (double)m_reused/m_acquired : 0.0;
+}
+
+
+PTimeInterval OpalTranscoderPool::Statistics::GetTimeSaved() const
+{
+  if (m_created == 0 || m_reused == 0)
+    return 0;
+
+  // Estimate what the reused instances would have cost to create
+  int64_t averageMicroseconds = m_createTime.GetMicroSeconds()/m_created;
+  int64_t savedMicroseconds = averageMicroseconds*m_reused - m_reuseTime.GetMicroSeconds();
+  return savedMicroseconds > 0 ? PTimeInterval(savedMicroseconds/1000) : PTimeInterval(0);
+}
+
+
+OpalTranscoderPool::OpalTranscoderPool(PINDEX maxPerKey, PINDEX maxTotal)
+  : m_maxPerKey(maxPerKey)
+  , m_maxTotal(maxTotal)
+  , m_idleCount(0)
+{
+}
+
+
+OpalTranscoderPool::~OpalTranscoderPool()
+{
+  Flush();
+}
+
+
+void OpalTranscoderPool::PrintOn(ostream & strm) const
+{
+  Statistics stats = GetStatistics();
+  strm << "acquired=" << stats.m_acquired
+       << " reused=" << stats.m_reused
+       << " (" << (unsigned)(stats.GetReuseRate()*100.0 + 0.5) << "%)"
+       << " created=" << stats.m_created
+       << " retained=" << stats.m_retained
+       << " discarded=" << stats.m_discarded
+       << " idle=" << GetIdleCount()
+       << " saved=" << stats.GetTimeSaved().GetMilliSeconds() << "ms";
+}
+
+
+static uint32_t HashTranscoderOptions(const OpalMediaFormat & format)
+{
+  /* Options are combined with an order independent sum, so the order of
+     iteration through the dictionary does not matter. Each option itself
+     is a FNV-1a hash of the name and value. */
+  uint32_t sum = 0;
+  PStringToString options = format.GetOptions();
+  for (PStringToString::const_iterator it = options.begin(); it != options.end(); ++it) {
+    uint32_t hash = 2166136261U;
+    for (const char * ptr = it->first; *ptr != '\0'; ++ptr)
+      hash = (hash ^ (BYTE)*ptr) * 16777619U;
+    hash = (hash ^ '=') * 16777619U;
+    for (const char * ptr = it->second; *ptr != '\0'; ++ptr)
+      hash = (hash ^ (BYTE)*ptr) * 16777619U;
+    sum += hash;
+  }
+  return sum;
+}
+
+
+PString OpalTranscoderPool::MakeKey(const OpalMediaFormat & srcFormat, const OpalMediaFormat & dstFormat) const
+{
+  return psprintf("%s\t%s\t%08x\t%08x",
+                  (const char *)srcFormat.GetName(), (const char *)dstFormat.GetName(),
+                  HashTranscoderOptions(srcFormat), HashTranscoderOptions(dstFormat));
+}
+
+
+OpalTranscoder * OpalTranscoderPool::Acquire(const OpalMediaFormat & srcFormat,
+                                             const OpalMediaFormat & dstFormat,
+                                             const BYTE * instance,
+                                             unsigned instanceLen)
+{
+  PTime start;
+
+  if (m_maxPerKey == 0) {
+    OpalTranscoder * transcoder = OpalTranscoder::Create(srcFormat, dstFormat, instance, instanceLen);
+    PWaitAndSignal mutex(m_mutex);
+    ++m_statistics.m_acquired;
+    if (transcoder != NULL) {
+      ++m_statistics.m_created;
+      m_statistics.m_createTime += PTime() - start;
+    }
+    return transcoder;
+  }
+
+  PString key = MakeKey(srcFormat, dstFormat);
+
+  for (;;) {
+    OpalTranscoder * transcoder = NULL;
+    {
+      PWaitAndSignal mutex(m_mutex);
+      IdleMap::iterator it = m_idle.find(key);
+      if (it != m_idle.end()) {
+        transcoder = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty())
+          m_idle.erase(it);
+        --m_idleCount;
+      }
+    }
+
+    if (transcoder == NULL)
+      break;
+
+    // Same sequence as OpalTranscoder::Create(), but without the construction
+    transcoder->SetInstanceID(instance, instanceLen);
+    transcoder->inputMediaFormat = srcFormat;
+    transcoder->outputMediaFormat = dstFormat;
+    if (transcoder->UpdateMediaFormats(srcFormat, dstFormat)) {
+      PWaitAndSignal mutex(m_mutex);
+      ++m_statistics.m_acquired;
+      ++m_statistics.m_reused;
+      m_statistics.m_reuseTime += PTime() - start;
+      m_active[transcoder] = key;
+      PTRACE(4, "Reused pooled transcoder " << *transcoder);
+      return transcoder;
+    }
+
+    PTRACE(2, "Could not reapply formats to pooled transcoder " << *transcoder);
+    delete transcoder;
+
+    PWaitAndSignal mutex(m_mutex);
+    ++m_statistics.m_discarded;
+  }
+
+  OpalTranscoder * transcoder = OpalTranscoder::Create(srcFormat, dstFormat, instance, instanceLen);
+
+  PWaitAndSignal mutex(m_mutex);
+  ++m_statistics.m_acquired;
+  if (transcoder != NULL) {
+    ++m_statistics.m_created;
+    m_statistics.m_createTime += PTime() - start;
+    m_active[transcoder] = key;
+  }
+  return transcoder;
+}
+
+
+void OpalTranscoderPool::Release(OpalTranscoder * transcoder)
+{
+  if (transcoder == NULL)
+    return;
+
+  PString key;
+  {
+    PWaitAndSignal mutex(m_mutex);
+    ActiveMap::iterator it = m_active.find(transcoder);
+    if (it != m_active.end()) {
+      key = it->second;
+      m_active.erase(it);
+    }
+  }
+
+  // Reset outside of lock, as it may take a while for some codecs
+  if (!key.IsEmpty() && transcoder->Reset()) {
+    PWaitAndSignal mutex(m_mutex);
+    Instances & instances = m_idle[key];
+    if ((PINDEX)instances.size() < m_maxPerKey && m_idleCount < m_maxTotal) {
+      instances.push_back(transcoder);
+      ++m_idleCount;
+      ++m_statistics.m_retained;
+      return;
+    }
+    if (instances.empty())
+      m_idle.erase(key);
+  }
+
+  PTRACE(5, "Deleting transcoder " << *transcoder << (key.IsEmpty() ? ", not pooled" : ", not retained"));
+  delete transcoder;
+
+  if (!key.IsEmpty()) {
+    PWaitAndSignal mutex(m_mutex);
+    ++m_statistics.m_discarded;
+  }
+}
+
+
+void OpalTranscoderPool::Flush()
+{
+  IdleMap idle;
+  {
+    PWaitAndSignal mutex(m_mutex);
+    idle.swap(m_idle);
+    m_idleCount = 0;
+  }
+
+  for (IdleMap::iterator it = idle.begin(); it != idle.end(); ++it) {
+    for (Instances::iterator inst = it->second.begin(); inst != it->second.end(); ++inst)
+      delete *inst;
+  }
+}
+
+
+void OpalTranscoderPool::SetSizes(PINDEX maxPerKey, PINDEX maxTotal)
+{
+  {
+    PWaitAndSignal mutex(m_mutex);
+    m_maxPerKey = maxPerKey;
+    m_maxTotal = maxTotal;
+  }
+
+  // Simplest to start again rather than trim each key
+  Flush();
+}
+
+
+PINDEX OpalTranscoderPool::GetIdleCount() const
+{
+  PWaitAndSignal mutex(m_mutex);
+  return m_idleCount;
+}
+
+
+OpalTranscoderPool::Statistics OpalTranscoderPool::GetStatistics() const
+{
+  PWaitAndSignal mutex(m_mutex);
+  return m_statistics;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 Opal_Linear16Mono_PCM::Opal_Linear16Mono_PCM()
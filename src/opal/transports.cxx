@@ -1011,10 +1011,10 @@ OpalTransport::OpalTransport(OpalEndPoint & end, PChannel * channel)
   : m_endpoint(end)
   , m_channel(channel)
   , m_thread(NULL)
+  , P_DISABLE_MSVC_WARNINGS(4355, m_keepAliveClient(*this))
   , m_idleTimer(m_endpoint.GetManager().GetTransportIdleTime())
   , m_referenceCount(0)
 {
-  m_keepAliveTimer.SetNotifier(PCREATE_NOTIFIER(KeepAlive), "OpalTransKeepAlive");
   PTRACE(5, "Transport constructed: this=" << this << ", channel=" << m_channel << ", ep=" << m_endpoint);
 }
 
@@ -1023,6 +1023,7 @@ OpalTransport::~OpalTransport()
 {
   PTRACE(5, "Transport destroyed: " << m_channel);
   PAssert(m_thread == NULL, PLogicError);
+  m_endpoint.GetManager().GetKeepAliveScheduler().Remove(m_keepAliveClient);
   delete m_channel;
 }
 
@@ -1072,7 +1073,7 @@ void OpalTransport::CloseWait()
   m_thread = NULL;
   UnlockReadWrite();
 
-  m_keepAliveTimer.Stop();
+  m_endpoint.GetManager().GetKeepAliveScheduler().Remove(m_keepAliveClient);
 
   PThread::WaitAndDelete(exitingThread, m_endpoint.GetManager().GetSignalingTimeout()+2000);
 }
@@ -1185,40 +1186,43 @@ void OpalTransport::SetKeepAlive(const PTimeInterval & timeout, const PBYTEArray
     PTRACE(1, "SetOption(SO_KEEPALIVE) failed: " << socket->GetErrorText());
   }
 
+  OpalKeepAliveScheduler & scheduler = m_endpoint.GetManager().GetKeepAliveScheduler();
   if (timeout <= 0 || data.IsEmpty()) {
-    m_keepAliveTimer.Stop(false);
+    scheduler.Remove(m_keepAliveClient, false); // Do not wait, may be called with locks held
     PTRACE(4, "Transport keep alive disabled on " << *this);
   }
   else {
     static const PTimeInterval MinKeepAlive(0, 10);
     if (timeout < MinKeepAlive) {
       PTRACE(4, "Transport keep alive (" << data.GetSize() << " bytes) set for minimum " << MinKeepAlive << " seconds on " << *this);
-      m_keepAliveTimer.RunContinuous(MinKeepAlive);
+      scheduler.Add(m_keepAliveClient, MinKeepAlive);
     }
     else {
       PTRACE(4, "Transport keep alive (" << data.GetSize() << " bytes) set for " << timeout << " seconds on " << *this);
-      m_keepAliveTimer.RunContinuous(timeout);
+      scheduler.Add(m_keepAliveClient, timeout);
     }
   }
 }
 
 
-void OpalTransport::KeepAlive(PTimer &, P_INT_PTR)
+bool OpalTransport::KeepAlive()
 {
   if (!IsOpen()) {
     PTRACE(4, "Keep alive attempt while not open on " << *this);
-    return;
+    return false;
   }
 
   PTRACE(5, "Sending keep alive (" << m_channel->GetLastWriteCount() << " bytes) on " << *this);
   if (!LockReadOnly())
-    return;
+    return false;
 
-  if (!Write(m_keepAliveData, m_keepAliveData.GetSize())) {
+  bool ok = Write(m_keepAliveData, m_keepAliveData.GetSize());
+  if (!ok) {
     PTRACE(2, "Transport keep alive failed on " << *this << ": " << m_channel->GetErrorText(PChannel::LastWriteError));
   }
 
   UnlockReadOnly();
+  return ok;
 }
 
 
@@ -1228,7 +1232,7 @@ PBoolean OpalTransport::Write(const void * buf, PINDEX len)
     return false;
 
   ResetIdle();
-  m_keepAliveTimer.Reset();
+  m_keepAliveClient.ResetKeepAlive();
   return m_channel->Write(buf, len);
 }
 
@@ -58,6 +58,8 @@ static struct ProfileInfo
   { "SRTP_AES128_CM_SHA1_32", "AES_CM_128_HMAC_SHA1_32" },
   { "SRTP_AES256_CM_SHA1_80", "AES_CM_256_HMAC_SHA1_80" },
   { "SRTP_AES256_CM_SHA1_32", "AES_CM_256_HMAC_SHA1_32" },
+  { "SRTP_AEAD_AES_128_GCM",  "AEAD_AES_128_GCM"        },
+  { "SRTP_AEAD_AES_256_GCM",  "AEAD_AES_256_GCM"        },
 };
 
 
@@ -83,8 +85,9 @@ class OpalDTLSContext : public PSSLContext
 
       PStringStream ext;
       for (PINDEX i = 0; i < PARRAYSIZE(ProfileNames); ++i) {
-        const OpalMediaCryptoSuite* cryptoSuite = OpalMediaCryptoSuiteFactory::CreateInstance(ProfileNames[i].m_opalName);
-        if (cryptoSuite)
+        const OpalSRTPCryptoSuite* cryptoSuite = dynamic_cast<const OpalSRTPCryptoSuite *>(
+                              OpalMediaCryptoSuiteFactory::CreateInstance(ProfileNames[i].m_opalName));
+        if (cryptoSuite && cryptoSuite->IsAvailable())
         {
           if (!ext.IsEmpty())
             ext << ':';
@@ -315,7 +318,7 @@ bool OpalDTLSMediaTransport::PerformHandshake(DTLSChannel & channel)
   }
 
   PINDEX keyLength = cryptoSuite->GetCipherKeyBytes();
-  PINDEX saltLength = std::max(cryptoSuite->GetAuthSaltBytes(), (PINDEX)14); // Weird, but 32 bit salt still needs 14 bytes,
+  PINDEX saltLength = cryptoSuite->GetAuthSaltBytes(); // 14 bytes for AES-CM, even with 32 bit auth tag, 12 for AEAD
 
   PBYTEArray keyMaterial = channel.GetKeyMaterial((saltLength + keyLength)*2, "EXTRACTOR-dtls_srtp");
   if (keyMaterial.IsEmpty()) {
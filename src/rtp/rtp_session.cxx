@@ -52,6 +52,10 @@
 
 static const uint16_t SequenceReorderThreshold = (1<<16)-100;  // As per RFC3550 RTP_SEQ_MOD - MAX_MISORDER
 static const uint16_t SequenceRestartThreshold = 3000;         // As per RFC3550 MAX_DROPOUT
+static const size_t   MinPendingRingSize = 64;
+static const size_t   MaxPendingRingSize = 4096;                 // Power of two above SequenceRestartThreshold
+static const PTimeInterval RetransmitWaitMargin(20);
+static const PTimeInterval MaxRetransmitWait(0, 1);
 
 
 enum { JitterRoundingGuardBits = 4 };
@@ -184,6 +188,7 @@ RTP_SyncSourceId OpalRTPSession::AddSyncSource(RTP_SyncSourceId id, Direction di
   }
 
   m_SSRC[id] = CreateSyncSource(id, dir, cname);
+  m_syncSourceIndex.Rebuild(m_SSRC);
   return id;
 }
 
@@ -212,21 +217,84 @@ bool OpalRTPSession::RemoveSyncSource(RTP_SyncSourceId ssrc PTRACE_PARAM(, const
   }
 
   PTRACE(3, *this << "removed " << it->second->m_direction << " SSRC=" << RTP_TRACE_SRC(ssrc) << ": " << reason);
-  delete it->second;
-  m_SSRC.erase(it);
+  InternalRemoveSyncSource(it);
   return true;
 }
 
 
+void OpalRTPSession::InternalRemoveSyncSource(SyncSourceMap::iterator it)
+{
+  // Should always be already write locked by caller
+
+  SyncSource * source = it->second;
+  m_SSRC.erase(it);
+  m_syncSourceIndex.Rebuild(m_SSRC);
+
+  if (source->m_pendingQueued)
+    m_pendingSyncSources.erase(std::find(m_pendingSyncSources.begin(), m_pendingSyncSources.end(), source));
+
+  delete source;
+}
+
+
+static __inline unsigned HashSyncSourceId(RTP_SyncSourceId ssrc)
+{
+  ssrc ^= ssrc >> 16;
+  ssrc *= 0x45d9f3b;
+  ssrc ^= ssrc >> 16;
+  return ssrc;
+}
+
+
+void OpalRTPSession::SyncSourceIndex::Rebuild(const SyncSourceMap & ssrcs)
+{
+  // Keep load factor at or below 50% so probe sequences stay short
+  size_t size = 8;
+  while (size < ssrcs.size()*2)
+    size <<= 1;
+
+  m_table.assign(size, Entry());
+  m_mask = (unsigned)size - 1;
+
+  for (SyncSourceMap::const_iterator it = ssrcs.begin(); it != ssrcs.end(); ++it) {
+    unsigned index = HashSyncSourceId(it->first) & m_mask;
+    while (m_table[index].m_source != NULL)
+      index = (index + 1) & m_mask;
+    m_table[index].m_ssrc = it->first;
+    m_table[index].m_source = it->second;
+  }
+}
+
+
+OpalRTPSession::SyncSource * OpalRTPSession::SyncSourceIndex::Find(RTP_SyncSourceId ssrc) const
+{
+  if (m_table.empty())
+    return NULL;
+
+  unsigned index = HashSyncSourceId(ssrc) & m_mask;
+  for (;;) {
+    const Entry & entry = m_table[index];
+    if (entry.m_source == NULL)
+      return NULL;
+    if (entry.m_ssrc == ssrc)
+      return entry.m_source;
+    index = (index + 1) & m_mask;
+  }
+}
+
+
 OpalRTPSession::SyncSource * OpalRTPSession::UseSyncSource(RTP_SyncSourceId ssrc, Direction dir, bool force)
 {
-  SyncSourceMap::iterator it = m_SSRC.find(ssrc);
-  if (it != m_SSRC.end())
-    return it->second;
+  SyncSource * source = m_syncSourceIndex.Find(ssrc);
+  if (source != NULL)
+    return source;
 
+  /* Adding upgrades the callers read lock to a write lock, which may let a
+     writer in, so must never be called while holding a SyncSource::m_mutex,
+     and the new entry is looked up again after the upgrade. */
   if ((force || m_allowAnySyncSource) && AddSyncSource(ssrc, dir) == ssrc) {
     PTRACE(4, *this << "automatically added " << GetMediaType() << ' ' << dir << " SSRC=" << RTP_TRACE_SRC(ssrc));
-    return m_SSRC.find(ssrc)->second;
+    return m_syncSourceIndex.Find(ssrc);
   }
 
 #if PTRACING
@@ -428,6 +496,8 @@ OpalRTPSession::SyncSource::SyncSource(OpalRTPSession & session, RTP_SyncSourceI
   , m_lateOutOfOrderAdaptMax(2)
   , m_lateOutOfOrderAdaptBoost(10)
   , m_lateOutOfOrderAdaptPeriod(0, 1)
+  , m_lateOutOfOrderAdaptTotal(0)
+  , m_pendingQueued(false)
   , m_reportTimestamp(0)
   , m_reportAbsoluteTime(0)
   , m_synthesizeAbsTime(true)
@@ -705,11 +775,14 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnReceiveData(RTP_
   RTP_SequenceNumber expectedSequenceNumber = m_lastSequenceNumber + 1;
   RTP_SequenceNumber sequenceDelta = sequenceNumber - expectedSequenceNumber;
 
-  if (rxType == e_RxFromNetwork && !m_pendingPackets.empty() && sequenceNumber == expectedSequenceNumber) {
+  if (rxType == e_RxFromNetwork && !m_pendingPackets.IsEmpty() && sequenceNumber == expectedSequenceNumber) {
     PTRACE(5, &m_session, *this << "received out of order packet " << sequenceNumber);
     ++m_packetsOutOfOrder; // it arrived after all!
   }
 
+  if (rxType == e_RxRetransmission)
+    m_retransmitRequested.erase(sequenceNumber);
+
   // Check packet sequence numbers
   if (m_packets == 0) {
     m_firstPacketTime.SetCurrentTime();
@@ -740,8 +813,10 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnReceiveData(RTP_
       // If get multiple late out of order packet inside a period of time
       bool running = m_lateOutOfOrderAdaptTimer.IsRunning();
       if (running && ++m_lateOutOfOrderAdaptCount >= m_lateOutOfOrderAdaptMax) {
-        PTimeInterval timeout = m_session.GetOutOfOrderWaitTime() + m_lateOutOfOrderAdaptBoost;
-        m_session.SetOutOfOrderWaitTime(timeout);
+        /* Only under session read lock and this SSRC's lock, so adapt the
+           wait for this SSRC rather than altering the session wide value. */
+        m_lateOutOfOrderAdaptTotal += m_lateOutOfOrderAdaptBoost;
+        PTimeInterval timeout = m_session.GetOutOfOrderWaitTime() + m_lateOutOfOrderAdaptTotal;
         PTRACE(2, &m_session, *this << "late out of order, or duplicate, packet:"
                " got " << sequenceNumber << ", expected " << expectedSequenceNumber << ","
                " increased timeout to " << setprecision(2) << timeout);
@@ -871,6 +946,7 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnReceiveData(RTP_
     frame.SetSequenceNumber(rtxSN);
     frame.SetPayloadType(m_rtxPT);
 
+    PWaitAndSignal lock(primary->m_mutex);
     return primary->OnReceiveData(frame, e_RxRetransmission);
   }
 
@@ -913,9 +989,46 @@ void OpalRTPSession::SyncSource::OnRxNACK(const RTP_ControlFrame::LostPacketMask
 }
 
 
-bool OpalRTPSession::SyncSource::IsExpectingRetransmit(RTP_SequenceNumber /*sequenceNumber*/)
+bool OpalRTPSession::SyncSource::IsExpectingRetransmit(RTP_SequenceNumber sequenceNumber)
 {
-  return false;
+  PWaitAndSignal lock(m_mutex);
+
+  // Must still be ahead of what we have processed, or we gave up on it
+  return m_retransmitRequested.find(sequenceNumber) != m_retransmitRequested.end() &&
+         (RTP_SequenceNumber)(sequenceNumber - m_lastSequenceNumber - 1) < SequenceRestartThreshold;
+}
+
+
+void OpalRTPSession::SyncSource::RequestRetransmit(RTP_SequenceNumber from, RTP_SequenceNumber to)
+{
+  if (!(m_session.m_feedback&OpalMediaFormat::e_NACK))
+    return;
+
+  // A gap this large will be given up on before any retransmission could arrive
+  if ((RTP_SequenceNumber)(to - from) > m_session.GetMaxOutOfOrderPackets())
+    return;
+
+  for (RTP_SequenceNumber sn = from; sn != to; ++sn) {
+    if (!m_pendingPackets.Contains(sn) && m_retransmitRequested.insert(sn).second)
+      m_retransmitToSend.insert(sn);
+  }
+}
+
+
+PTimeInterval OpalRTPSession::SyncSource::GetOutOfOrderWaitTime() const
+{
+  PTimeInterval wait = m_session.GetOutOfOrderWaitTime() + m_lateOutOfOrderAdaptTotal;
+
+  /* If we have asked for retransmission, allow for the round trip, which on
+     a WAN link can be a lot longer than the wait for simple reordering. */
+  int rtt = m_session.m_roundTripTime;
+  if (!m_retransmitRequested.empty() && rtt > 0) {
+    PTimeInterval retransmitWait = PTimeInterval(rtt*3/2) + RetransmitWaitMargin;
+    if (wait < retransmitWait)
+      wait = std::min(retransmitWait, MaxRetransmitWait);
+  }
+
+  return wait;
 }
 
 
@@ -924,13 +1037,35 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnOutOfOrderPacket
   RTP_SequenceNumber sequenceNumber = frame.GetSequenceNumber();
   RTP_SequenceNumber expectedSequenceNumber = m_lastSequenceNumber + 1;
 
+  bool first = m_pendingPackets.IsEmpty();
+
+  /* The ring shares the frame buffer rather than copying it, the caller
+     does not use the frame again when told to ignore it. */
+  switch (m_pendingPackets.Insert(frame, expectedSequenceNumber)) {
+    case PendingRing::e_Inserted :
+      break;
+
+    case PendingRing::e_Duplicate :
+      PTRACE(4, &m_session, *this << "duplicate out of order packet " << sequenceNumber);
+      return e_IgnorePacket;
+
+    case PendingRing::e_Overflow :
+      PTRACE(2, &m_session, *this << "out of order packet " << sequenceNumber << " ignored, too far ahead of"
+             " expected " << expectedSequenceNumber << ", pending=" << m_pendingPackets.GetSize());
+      return e_IgnorePacket;
+  }
+
+  RequestRetransmit(expectedSequenceNumber, sequenceNumber);
+
   bool waiting = true;
-  if (m_pendingPackets.empty()) {
-    m_waitOutOfOrderTimer = m_session.GetOutOfOrderWaitTime();
+  if (first) {
+    PTimeInterval wait = GetOutOfOrderWaitTime();
+    m_waitOutOfOrderTimer = wait;
     PTRACE(3, &m_session, *this << "first out of order packet, got " << sequenceNumber
-           << " expected " << expectedSequenceNumber << ", waiting " << m_session.GetOutOfOrderWaitTime() << 's');
+           << " expected " << expectedSequenceNumber << ", waiting " << wait << 's'
+           << (m_retransmitRequested.empty() ? "" : " for retransmission"));
   }
-  else if (m_pendingPackets.GetSize() > m_session.GetMaxOutOfOrderPackets() || m_waitOutOfOrderTimer.HasExpired()) {
+  else if (m_pendingPackets.GetSize() > (size_t)m_session.GetMaxOutOfOrderPackets() || m_waitOutOfOrderTimer.HasExpired()) {
     waiting = false;
     PTRACE(4, &m_session, *this << "last out of order packet, got " << sequenceNumber
            << " expected " << expectedSequenceNumber << ", waited " << m_waitOutOfOrderTimer.GetElapsed() << 's');
@@ -940,69 +1075,151 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnOutOfOrderPacket
            << " expected " << expectedSequenceNumber);
   }
 
-  RTP_DataFrameList::iterator it;
-  for (it = m_pendingPackets.begin(); it != m_pendingPackets.end(); ++it) {
-    if (sequenceNumber > it->GetSequenceNumber())
-      break;
+  if (!m_pendingQueued) {
+    m_session.m_pendingSyncSources.push_back(this);
+    m_pendingQueued = true;
   }
 
-  m_pendingPackets.insert(it, frame);
-  frame.MakeUnique();
-
   if (waiting)
     return e_IgnorePacket;
 
-  // Give up on the packet, probably never coming in. Save current and switch in
-  // the lowest numbered packet.
-
-  while (!m_pendingPackets.empty()) {
-    frame = m_pendingPackets.back();
-    m_pendingPackets.pop_back();
-
-    sequenceNumber = frame.GetSequenceNumber();
-    if (sequenceNumber >= expectedSequenceNumber)
-      return e_ProcessPacket;
-
-    PTRACE(2, &m_session, *this << "incorrect out of order packet, got " << sequenceNumber << " expected " << expectedSequenceNumber);
-  }
-
-  return e_ProcessPacket;
+  // Give up on the missing packet(s), probably never coming in. Switch in the lowest numbered packet.
+  return m_pendingPackets.RemoveLowest(expectedSequenceNumber, frame) ? e_ProcessPacket : e_IgnorePacket;
 }
 
 
 bool OpalRTPSession::SyncSource::HandlePendingFrames()
 {
-  while (!m_pendingPackets.empty()) {
-    RTP_DataFrame resequencedPacket = m_pendingPackets.back();
-
-    RTP_SequenceNumber sequenceNumber = resequencedPacket.GetSequenceNumber();
-    RTP_SequenceNumber expectedSequenceNumber = m_lastSequenceNumber + 1;
-    if (sequenceNumber != expectedSequenceNumber)
-      return true;
-
-    m_pendingPackets.pop_back();
-
+  RTP_DataFrame resequencedPacket;
+  while (m_pendingPackets.Remove(m_lastSequenceNumber + 1, resequencedPacket)) {
 #if PTRACING
-    unsigned level = m_pendingPackets.empty() ? 3 : 5;
+    unsigned level = m_pendingPackets.IsEmpty() ? 3 : 5;
     if (PTrace::CanTrace(level)) {
       ostream & trace = PTRACE_BEGIN(level, &m_session);
-      trace << *this << "resequenced out of order packet " << sequenceNumber;
-      if (m_pendingPackets.empty())
+      trace << *this << "resequenced out of order packet " << resequencedPacket.GetSequenceNumber();
+      if (m_pendingPackets.IsEmpty())
         trace << ", completed. Time to resequence=" << m_waitOutOfOrderTimer.GetElapsed();
       else
-        trace << ", " << m_pendingPackets.size() << " remaining.";
+        trace << ", " << m_pendingPackets.GetSize() << " remaining.";
       trace << PTrace::End;
     }
 #endif
 
     // Still more packets, reset timer to allow for later out-of-order packets
-    if (!m_pendingPackets.empty())
-      m_waitOutOfOrderTimer = m_session.GetOutOfOrderWaitTime();
+    if (!m_pendingPackets.IsEmpty())
+      m_waitOutOfOrderTimer = GetOutOfOrderWaitTime();
 
     if (OnReceiveData(resequencedPacket, e_RxOutOfOrder) == e_AbortTransport)
       return false;
   }
 
+  if (m_pendingPackets.IsEmpty())
+    m_retransmitRequested.clear();
+
+  return true;
+}
+
+
+OpalRTPSession::PendingRing::PendingRing()
+  : m_mask(0)
+  , m_count(0)
+{
+}
+
+
+bool OpalRTPSession::PendingRing::Contains(RTP_SequenceNumber sequenceNumber) const
+{
+  if (m_count == 0)
+    return false;
+  const Slot & slot = m_slots[sequenceNumber & m_mask];
+  return slot.m_used && slot.m_sequenceNumber == sequenceNumber;
+}
+
+
+OpalRTPSession::PendingRing::InsertResult OpalRTPSession::PendingRing::Insert(const RTP_DataFrame & frame, RTP_SequenceNumber expectedSequenceNumber)
+{
+  RTP_SequenceNumber sequenceNumber = frame.GetSequenceNumber();
+  size_t offset = (RTP_SequenceNumber)(sequenceNumber - expectedSequenceNumber);
+  if (offset >= m_slots.size()) {
+    size_t size = std::max(m_slots.size(), MinPendingRingSize);
+    while (size <= offset)
+      size *= 2;
+    if (!Resize(size))
+      return e_Overflow;
+  }
+
+  Slot & slot = m_slots[sequenceNumber & m_mask];
+  if (slot.m_used) {
+    if (slot.m_sequenceNumber == sequenceNumber)
+      return e_Duplicate;
+    // Otherwise is left over from before a sequence number jump, replace it
+  }
+  else {
+    slot.m_used = true;
+    ++m_count;
+  }
+
+  slot.m_sequenceNumber = sequenceNumber;
+  slot.m_frame = frame;
+  return e_Inserted;
+}
+
+
+bool OpalRTPSession::PendingRing::Remove(RTP_SequenceNumber sequenceNumber, RTP_DataFrame & frame)
+{
+  if (m_count == 0)
+    return false;
+
+  Slot & slot = m_slots[sequenceNumber & m_mask];
+  if (!slot.m_used || slot.m_sequenceNumber != sequenceNumber)
+    return false;
+
+  frame = slot.m_frame;
+  slot.m_used = false;
+  --m_count;
+  return true;
+}
+
+
+bool OpalRTPSession::PendingRing::RemoveLowest(RTP_SequenceNumber expectedSequenceNumber, RTP_DataFrame & frame)
+{
+  RTP_SequenceNumber sequenceNumber = expectedSequenceNumber;
+  for (size_t i = 0; m_count > 0 && i < m_slots.size(); ++i, ++sequenceNumber) {
+    Slot & slot = m_slots[sequenceNumber & m_mask];
+    if (!slot.m_used)
+      continue;
+
+    if (slot.m_sequenceNumber == sequenceNumber) {
+      frame = slot.m_frame;
+      slot.m_used = false;
+      --m_count;
+      return true;
+    }
+
+    // Behind the expected sequence number, so can never be used
+    PTRACE(2, "incorrect out of order packet, got " << slot.m_sequenceNumber << " expected " << expectedSequenceNumber);
+    slot.m_used = false;
+    --m_count;
+  }
+
+  return false;
+}
+
+
+bool OpalRTPSession::PendingRing::Resize(size_t size)
+{
+  if (size > MaxPendingRingSize)
+    return false;
+
+  std::vector<Slot> slots(size);
+  unsigned mask = (unsigned)size - 1;
+  for (std::vector<Slot>::iterator it = m_slots.begin(); it != m_slots.end(); ++it) {
+    if (it->m_used)
+      slots[it->m_sequenceNumber & mask] = *it;
+  }
+
+  m_slots.swap(slots);
+  m_mask = mask;
   return true;
 }
 
@@ -1089,10 +1306,8 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SendBYE(RTP_SyncSourceId ssrc)
 
     // Now remove the shut down SSRC
     SyncSourceMap::iterator it = m_SSRC.find(ssrc);
-    if (it != m_SSRC.end()) {
-      delete it->second;
-      m_SSRC.erase(it);
-    }
+    if (it != m_SSRC.end())
+      InternalRemoveSyncSource(it);
   }
 
   return status;
@@ -1434,31 +1649,53 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::OnSendData(RTP_DataFrame & fra
   if (GetSyncSource(ssrc, e_Sender, syncSource)) {
     if (syncSource->m_direction == e_Receiver) {
       // Got a loopback
-      if (syncSource->m_loopbackIdentifier != 0)
+      RTP_SyncSourceId receiverSSRC = ssrc;
+      {
+        PWaitAndSignal lock(syncSource->m_mutex);
         ssrc = syncSource->m_loopbackIdentifier;
-      else {
+      }
+
+      if (ssrc == 0) {
         // Look for an unused one
-        SyncSourceMap::iterator it;
-        for (it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
-          if (it->second->m_direction == e_Sender && it->second->m_loopbackIdentifier == 0) {
-            it->second->m_loopbackIdentifier = ssrc;
-            ssrc = it->second->m_sourceIdentifier;
-            PTRACE(4, *this << "using loopback SSRC=" << RTP_TRACE_SRC(ssrc)
-                   << " for receiver SSRC=" << RTP_TRACE_SRC(syncSource->m_sourceIdentifier));
-            break;
+        for (SyncSourceMap::iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
+          SyncSource & sender = *it->second;
+          if (sender.m_direction == e_Sender) {
+            PWaitAndSignal lock(sender.m_mutex);
+            if (sender.m_loopbackIdentifier == 0) {
+              sender.m_loopbackIdentifier = receiverSSRC;
+              ssrc = sender.m_sourceIdentifier;
+              PTRACE(4, *this << "using loopback SSRC=" << RTP_TRACE_SRC(ssrc)
+                     << " for receiver SSRC=" << RTP_TRACE_SRC(receiverSSRC));
+              break;
+            }
           }
         }
 
-        if (it == m_SSRC.end()) {
-          if ((ssrc = AddSyncSource(ssrc, e_Sender)) == 0)
+        if (ssrc == 0) {
+          /* Adding upgrades our read lock to a write lock, which may let
+             another thread remove SSRCs, so no SyncSource pointer obtained
+             before this may be used after it. */
+          if ((ssrc = AddSyncSource(0, e_Sender)) == 0)
             return e_AbortTransport;
 
+          SyncSource * sender;
+          if (GetSyncSource(ssrc, e_Sender, sender)) {
+            PWaitAndSignal lock(sender->m_mutex);
+            sender->m_loopbackIdentifier = receiverSSRC;
+          }
+
           PTRACE(4, *this << "added loopback SSRC=" << RTP_TRACE_SRC(ssrc)
-                 << " for receiver SSRC=" << RTP_TRACE_SRC(syncSource->m_sourceIdentifier));
+                 << " for receiver SSRC=" << RTP_TRACE_SRC(receiverSSRC));
         }
 
-        syncSource->m_loopbackIdentifier = ssrc;
+        SyncSource * receiver;
+        if (!GetSyncSource(receiverSSRC, e_Receiver, receiver))
+          return e_IgnorePacket;
+
+        PWaitAndSignal lock(receiver->m_mutex);
+        receiver->m_loopbackIdentifier = ssrc;
       }
+
       if (!GetSyncSource(ssrc, e_Sender, syncSource))
         return e_AbortTransport;
     }
@@ -1470,6 +1707,8 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::OnSendData(RTP_DataFrame & fra
     GetSyncSource(ssrc, e_Sender, syncSource);
   }
 
+  PWaitAndSignal lock(syncSource->m_mutex);
+
   switch (rewrite) {
     case e_RewriteNothing:
       ++syncSource->m_rtxPackets;
@@ -1483,6 +1722,7 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::OnSendData(RTP_DataFrame & fra
         return e_IgnorePacket;
 
       ++syncSource->m_rtxPackets;
+      PWaitAndSignal rtxLock(rtxSyncSource->m_mutex);
       return rtxSyncSource->OnSendData(frame, rewrite);
 
   }
@@ -1498,9 +1738,18 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::OnSendControl(RTP_ControlFrame
 
 OpalRTPSession::SendReceiveStatus OpalRTPSession::OnPreReceiveData(RTP_DataFrame & frame)
 {
-  for (SyncSourceMap::iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
-    if (!it->second->HandlePendingFrames())
+  // Only need to check the receivers that have out of order packets waiting
+  for (PendingSyncSources::iterator it = m_pendingSyncSources.begin(); it != m_pendingSyncSources.end(); ) {
+    SyncSource & source = **it;
+    PWaitAndSignal lock(source.m_mutex);
+    if (!source.HandlePendingFrames())
       return e_AbortTransport;
+    if (source.m_pendingPackets.IsEmpty()) {
+      source.m_pendingQueued = false;
+      it = m_pendingSyncSources.erase(it);
+    }
+    else
+      ++it;
   }
 
   // Check that the PDU is the right version
@@ -1525,7 +1774,19 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::OnPreReceiveData(RTP_DataFrame
       return e_IgnorePacket;
   }
 
-  return receiver->OnReceiveData(frame, e_RxFromNetwork);
+  SendReceiveStatus status;
+  RTP_ControlFrame::LostPacketMask retransmit;
+  {
+    PWaitAndSignal lock(receiver->m_mutex);
+    status = receiver->OnReceiveData(frame, e_RxFromNetwork);
+    retransmit.swap(receiver->m_retransmitToSend);
+  }
+
+  // Send NACK after releasing the receiver, as it takes other locks
+  if (!retransmit.empty())
+    SendNACK(retransmit, ssrc);
+
+  return status;
 }
 
 
@@ -1855,7 +2116,7 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SendReport(RTP_SyncSourceId ss
     // Clean out old stale SSRC's
     for (SyncSourceMap::iterator it = m_SSRC.begin(); it != m_SSRC.end();) {
       if (it->second->IsStaleReceiver())
-        m_SSRC.erase(it++);
+        InternalRemoveSyncSource(it++);
       else
         ++it;
     }
@@ -1944,7 +2205,13 @@ void OpalRTPSession::GetStatistics(OpalMediaStatistics & statistics, Direction d
   statistics.m_lastReportTime    = 0;
 
   if (statistics.m_SSRC != 0) {
-    GetSyncSource(statistics.m_SSRC, dir).GetStatistics(statistics);
+    SyncSourceMap::const_iterator it = m_SSRC.find(statistics.m_SSRC);
+    if (it != m_SSRC.end()) {
+      PWaitAndSignal lock(it->second->m_mutex);
+      it->second->GetStatistics(statistics);
+    }
+    else
+      m_dummySyncSource.GetStatistics(statistics);
     return;
   }
 
@@ -1955,7 +2222,10 @@ void OpalRTPSession::GetStatistics(OpalMediaStatistics & statistics, Direction d
   for (SyncSourceMap::const_iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
     if (it->second->m_direction == dir) {
       OpalMediaStatistics ssrcStats;
-      it->second->GetStatistics(ssrcStats);
+      {
+        PWaitAndSignal lock(it->second->m_mutex);
+        it->second->GetStatistics(ssrcStats);
+      }
       if (ssrcStats.m_totalPackets > 0) {
         statistics.m_payloadType   = ssrcStats.m_payloadType;
         statistics.m_totalBytes   += ssrcStats.m_totalBytes;
@@ -3083,7 +3353,9 @@ bool OpalRTPSession::SetRemoteAddress(const OpalTransportAddress & remoteAddress
 
 void OpalRTPSession::OnRxDataPacket(OpalMediaTransport &, PBYTEArray data)
 {
-  P_INSTRUMENTED_LOCK_READ_WRITE(return);
+  /* Only need read lock for data, as the SSRC being received is locked
+     individually, so we do not stall any other SSRC, or the transmitter. */
+  P_INSTRUMENTED_LOCK_READ_ONLY(return);
 
   if (data.IsEmpty()) {
     CheckMediaFailed(e_Data);
@@ -3099,6 +3371,7 @@ void OpalRTPSession::OnRxDataPacket(OpalMediaTransport &, PBYTEArray data)
   RTP_ControlFrame control(data, data.GetSize(), false);
   unsigned type = control.GetPayloadType();
   if (type >= RTP_ControlFrame::e_FirstValidPayloadType && type <= RTP_ControlFrame::e_LastValidPayloadType) {
+    P_INSTRUMENTED_LOCK_READ_WRITE2(writeLock, *this);
     if (OnReceiveControl(control) == e_AbortTransport)
       CheckMediaFailed(e_Control);
   }
@@ -3145,7 +3418,8 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::WriteData(RTP_DataFrame & fram
   if (!transport->IsEstablished())
     return e_IgnorePacket;
 
-  if (!LockReadWrite(P_DEBUG_LOCATION))
+  // Read lock only, OnSendData locks the individual SSRC
+  if (!LockReadOnly(P_DEBUG_LOCATION))
     return e_AbortTransport;
 
   SendReceiveStatus status = OnSendData(frame, rewrite);
@@ -3153,11 +3427,13 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::WriteData(RTP_DataFrame & fram
   // For Generic NACK (no rtx) we have to save the encrypted version of the packet
   if (status == e_ProcessPacket && rewrite == e_RewriteHeader && HasFeedback(OpalMediaFormat::e_NACK)) {
     SyncSource * sender;
-    if (GetSyncSource(frame.GetSyncSource(), e_Sender, sender) && sender->m_rtxSSRC == 0)
+    if (GetSyncSource(frame.GetSyncSource(), e_Sender, sender) && sender->m_rtxSSRC == 0) {
+      PWaitAndSignal lock(sender->m_mutex);
       sender->SaveSentData(frame);
+    }
   }
 
-  UnlockReadWrite(P_DEBUG_LOCATION);
+  UnlockReadOnly(P_DEBUG_LOCATION);
 
   switch (status) {
     case e_IgnorePacket :
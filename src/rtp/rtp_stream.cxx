@@ -70,6 +70,8 @@ OpalRTPMediaStream::OpalRTPMediaStream(OpalRTPConnection & conn,
 #if OPAL_JITTER_BUFFER_LATENCY_CHECK
   , m_jbLatencySampleCount(0)
 #endif
+  , m_admissionPacketCount(0)
+  , m_admissionTooLate(0)
 
 {
   /* If we are a source then we should set our buffer size to the max
@@ -371,6 +373,35 @@ PBoolean OpalRTPMediaStream::ReadPacket(RTP_DataFrame & packet)
   }
 #endif // OPAL_JITTER_BUFFER_LATENCY_CHECK    
 
+  /* Track how late, beyond the jitter delay, we are reading packets, and how
+     many were too late to play. These go to admission control in batches,
+     so its lock is not taken for every packet. */
+  if (packet.GetPayloadSize() > 0) {
+    const PTime & networkTime = packet.GetMetaData().m_networkTime;
+    unsigned timeUnits = m_jitterBuffer->GetTimeUnits();
+    if (networkTime.IsValid() && timeUnits > 0) {
+      unsigned jbDelay = m_jitterBuffer->GetCurrentJitterDelay() + 2*m_jitterBuffer->GetPacketTime();
+      PTimeInterval lag = networkTime.GetElapsed() - PTimeInterval(jbDelay/timeUnits);
+      if (m_admissionMaxLag < lag)
+        m_admissionMaxLag = lag;
+    }
+
+    static const unsigned AdmissionReportPackets = 50;
+    if (++m_admissionPacketCount >= AdmissionReportPackets) {
+      OpalAdmissionControllerPtr admission = m_connection.GetEndPoint().GetManager().GetAdmissionController();
+      if (m_admissionMaxLag > 0)
+        admission->OnMediaLag(m_admissionMaxLag);
+
+      unsigned tooLate = m_jitterBuffer->GetPacketsTooLate();
+      if (tooLate > m_admissionTooLate)
+        admission->OnJitterUnderruns(tooLate - m_admissionTooLate);
+
+      m_admissionTooLate = tooLate; // May have gone backwards, if jitter buffer reset
+      m_admissionMaxLag = 0;
+      m_admissionPacketCount = 0;
+    }
+  }
+
   return true;
 }
 
@@ -239,6 +239,37 @@ class PSRTPInitialiser : public PProcessStartup
       PTRACE(2, "Initialising SRTP: " << srtp_get_version_string());
       CHECK_ERROR(srtp_install_log_handler,(srtp_log_handler, NULL));
       CHECK_ERROR(srtp_init,());
+      PTRACE(3, "SRTP AEAD (AES-GCM) crypto suites " << (HasAEAD() ? "available, using OpenSSL" : "not available"));
+    }
+
+    /* The AES-GCM cipher is only compiled into libsrtp when it uses OpenSSL,
+       which also means AES-ICM is via EVP, and thus AES-NI where available.
+       Test by creating a context with a GCM policy. */
+    static bool HasAEAD()
+    {
+      static bool const available = TestAEAD();
+      return available;
+    }
+
+  private:
+    static bool TestAEAD()
+    {
+      BYTE key_salt[SRTP_MAX_KEY_LEN];
+      memset(key_salt, 0, sizeof(key_salt));
+
+      srtp_policy_t policy;
+      memset(&policy, 0, sizeof(policy));
+      srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtp);
+      srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtcp);
+      policy.ssrc.type = ssrc_any_outbound;
+      policy.key = key_salt;
+
+      srtp_ctx_t * context;
+      if (srtp_create(&context, &policy) != srtp_err_status_ok)
+        return false;
+
+      srtp_dealloc(context);
+      return true;
     }
 };
 
@@ -289,6 +320,51 @@ class OpalSRTPCryptoSuite_AES_CM_128_HMAC_SHA1_32 : public OpalSRTPCryptoSuite
 PFACTORY_CREATE(OpalMediaCryptoSuiteFactory, OpalSRTPCryptoSuite_AES_CM_128_HMAC_SHA1_32, AES_CM_128_HMAC_SHA1_32, true);
 
 
+// RFC 7714 AEAD suites, 12 byte salt and 16 byte authentication tag
+class OpalSRTPCryptoSuite_AEAD : public OpalSRTPCryptoSuite
+{
+    PCLASSINFO(OpalSRTPCryptoSuite_AEAD, OpalSRTPCryptoSuite);
+  public:
+#if OPAL_H235_6 || OPAL_H235_8
+    virtual const char * GetOID() const { return ""; } // No H.235 identifier
+#endif
+    virtual bool Supports(const PCaselessString & proto) const { return proto == "sip" && IsAvailable(); }
+    virtual PINDEX GetAuthSaltBits() const { return 96; }
+    virtual bool IsAvailable() const { return PSRTPInitialiser::HasAEAD(); }
+};
+
+
+static PConstCaselessString AEAD_AES_128_GCM("AEAD_AES_128_GCM");
+
+class OpalSRTPCryptoSuite_AEAD_AES_128_GCM : public OpalSRTPCryptoSuite_AEAD
+{
+    PCLASSINFO(OpalSRTPCryptoSuite_AEAD_AES_128_GCM, OpalSRTPCryptoSuite_AEAD);
+  public:
+    virtual const PCaselessString & GetFactoryName() const { return AEAD_AES_128_GCM; }
+    virtual const char * GetDescription() const { return "SRTP: AES-128 GCM"; }
+
+    virtual void SetCryptoPolicy(struct srtp_crypto_policy_t & policy) const { srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy); }
+};
+
+PFACTORY_CREATE(OpalMediaCryptoSuiteFactory, OpalSRTPCryptoSuite_AEAD_AES_128_GCM, AEAD_AES_128_GCM, true);
+
+
+static PConstCaselessString AEAD_AES_256_GCM("AEAD_AES_256_GCM");
+
+class OpalSRTPCryptoSuite_AEAD_AES_256_GCM : public OpalSRTPCryptoSuite_AEAD
+{
+    PCLASSINFO(OpalSRTPCryptoSuite_AEAD_AES_256_GCM, OpalSRTPCryptoSuite_AEAD);
+  public:
+    virtual const PCaselessString & GetFactoryName() const { return AEAD_AES_256_GCM; }
+    virtual const char * GetDescription() const { return "SRTP: AES-256 GCM"; }
+    virtual PINDEX GetCipherKeyBits() const { return 256; }
+
+    virtual void SetCryptoPolicy(struct srtp_crypto_policy_t & policy) const { srtp_crypto_policy_set_aes_gcm_256_16_auth(&policy); }
+};
+
+PFACTORY_CREATE(OpalMediaCryptoSuiteFactory, OpalSRTPCryptoSuite_AEAD_AES_256_GCM, AEAD_AES_256_GCM, true);
+
+
 
 ///////////////////////////////////////////////////////
 
@@ -353,6 +429,12 @@ OpalMediaCryptoKeyInfo * OpalSRTPCryptoSuite::CreateKeyInfo() const
 }
 
 
+bool OpalSRTPCryptoSuite::IsAvailable() const
+{
+  return true;
+}
+
+
 ///////////////////////////////////////////////////////////////////////
 
 OpalSRTPKeyInfo::OpalSRTPKeyInfo(const OpalSRTPCryptoSuite & cryptoSuite)
@@ -464,6 +546,17 @@ PBYTEArray OpalSRTPKeyInfo::GetAuthSalt() const
 }
 
 
+void OpalSRTPKeyInfo::GetKeySalt(BYTE key_salt[MaxKeySaltSize]) const
+{
+  // libsrtp wants the master key immediately followed by the master salt
+  PINDEX keyBytes = std::min(m_cryptoSuite.GetCipherKeyBytes(), m_key.GetSize());
+  PINDEX saltBytes = std::min(std::min(m_cryptoSuite.GetAuthSaltBytes(), m_salt.GetSize()), (PINDEX)MaxKeySaltSize-keyBytes);
+  memset(key_salt, 0, MaxKeySaltSize);
+  memcpy(key_salt, m_key, keyBytes);
+  memcpy(&key_salt[keyBytes], m_salt, saltBytes);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 OpalSRTPSession::OpalSRTPSession(const Init & init)
@@ -533,13 +626,12 @@ bool OpalSRTPSession::ApplyKeyToSRTP(const OpalMediaCryptoKeyInfo & keyInfo, Dir
     return false;
   }
 
-  BYTE tmp_key_salt[32];
-  memset(tmp_key_salt, 0, sizeof(tmp_key_salt));
-  memcpy(tmp_key_salt, keyInfo.GetCipherKey(), std::min((PINDEX)16, keyInfo.GetCipherKey().GetSize()));
-  memcpy(&tmp_key_salt[16], keyInfo.GetAuthSalt(), std::min((PINDEX)14, keyInfo.GetAuthSalt().GetSize()));
+  BYTE tmp_key_salt[OpalSRTPKeyInfo::MaxKeySaltSize];
+  srtpKeyInfo->GetKeySalt(tmp_key_salt);
 
   if (m_keyInfo[dir] != NULL) {
-    if (memcmp(tmp_key_salt, m_keyInfo[dir]->m_key_salt, 32) == 0) {
+    if (&m_keyInfo[dir]->GetCryptoSuite() == &srtpKeyInfo->GetCryptoSuite() &&
+        memcmp(tmp_key_salt, m_keyInfo[dir]->m_key_salt, sizeof(tmp_key_salt)) == 0) {
       PTRACE(3, *this << "crypto key for " << dir << " already set.");
       return true;
     }
@@ -550,6 +642,7 @@ bool OpalSRTPSession::ApplyKeyToSRTP(const OpalMediaCryptoKeyInfo & keyInfo, Dir
     for (SyncSourceMap::iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
       if (it->second->m_direction == dir) {
         RTP_SyncSourceId ssrc = it->first;
+        PWaitAndSignal lock(m_contextMutex);
         if (m_addedStream.erase(ssrc) > 0) {
           srtp_remove_stream(m_context, ssrc);
           PTRACE(4, *this << "removed " << dir << " SRTP stream for SSRC=" << RTP_TRACE_SRC(ssrc));
@@ -562,7 +655,7 @@ bool OpalSRTPSession::ApplyKeyToSRTP(const OpalMediaCryptoKeyInfo & keyInfo, Dir
   }
 
   m_keyInfo[dir] = new OpalSRTPKeyInfo(*srtpKeyInfo);
-  memcpy(m_keyInfo[dir]->m_key_salt, tmp_key_salt, 32);
+  memcpy(m_keyInfo[dir]->m_key_salt, tmp_key_salt, sizeof(tmp_key_salt));
 
   for (SyncSourceMap::iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
     if (it->second->m_direction == dir && !AddStreamToSRTP(it->first, dir))
@@ -604,7 +697,7 @@ RTP_SyncSourceId OpalSRTPSession::AddSyncSource(RTP_SyncSourceId ssrc, Direction
   if (AddStreamToSRTP(ssrc, dir))
     return ssrc;
 
-  m_SSRC.erase(m_SSRC.find(ssrc));
+  InternalRemoveSyncSource(m_SSRC.find(ssrc));
   return 0;
 }
 
@@ -613,6 +706,8 @@ bool OpalSRTPSession::AddStreamToSRTP(RTP_SyncSourceId ssrc, Direction dir)
 {
   // Aleady locked on entry
 
+  PWaitAndSignal lock(m_contextMutex);
+
   if (m_addedStream.find(ssrc) != m_addedStream.end()) {
     PTRACE(4, *this << "already have " << dir << " SRTP stream for SSRC=" << RTP_TRACE_SRC(ssrc));
     return true;
@@ -673,7 +768,7 @@ void OpalSRTPSession::OnRxControlPacket(OpalMediaTransport & transport, PBYTEArr
 
 OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendData(RTP_DataFrame & frame, RewriteMode rewrite)
 {
-  // Aleady locked on entry
+  // Session read locked on entry, libSRTP calls are protected by m_contextMutex
 
   SendReceiveStatus status = OpalRTPSession::OnSendData(frame, rewrite);
   if (status != e_ProcessPacket)
@@ -690,15 +785,20 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendData(RTP_DataFrame & fr
 
   int len = frame.GetPacketSize();
 
-  frame.MakeUnique();
+  /* Protection is in place, but the frame may be shared, e.g. the mixer
+     sending one encoded frame to many streams, so copy on write. Expanding
+     for the trailer first means the copy, if needed, is done only once. */
   frame.SetMinSize(len + SRTP_MAX_TRAILER_LEN);
+  frame.MakeUnique();
 
+  m_contextMutex.Wait();
   status = CheckConsecutiveErrors(
               CHECK_ERROR(
                   srtp_protect, (m_context, frame.GetPointer(), &len),
                   this, ssrc, frame.GetSequenceNumber()
               ),
               e_Sender, e_Data);
+  m_contextMutex.Signal();
   if (status != e_ProcessPacket)
     return status;
 
@@ -712,7 +812,7 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendData(RTP_DataFrame & fr
 
 OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendControl(RTP_ControlFrame & frame)
 {
-  // Aleady locked on entry
+  // Session write locked on entry
 
   SendReceiveStatus status = OpalRTPSession::OnSendControl(frame);
   if (status != e_ProcessPacket)
@@ -726,15 +826,17 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendControl(RTP_ControlFram
 
   int len = frame.GetPacketSize();
 
-  frame.MakeUnique();
   frame.SetMinSize(len + SRTP_MAX_TRAILER_LEN);
+  frame.MakeUnique();
 
+  m_contextMutex.Wait();
   status = CheckConsecutiveErrors(
               CHECK_ERROR(
                   srtp_protect_rtcp, (m_context, frame.GetPointer(), &len),
                   this, ssrc
               ),
               e_Sender, e_Control);
+  m_contextMutex.Signal();
   if (status != e_ProcessPacket)
     return status;
 
@@ -748,7 +850,7 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnSendControl(RTP_ControlFram
 
 OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveData(RTP_DataFrame & frame, ReceiveType rxType)
 {
-  // Aleady locked on entry
+  // Session read locked on entry, libSRTP calls are protected by m_contextMutex
 
   if (rxType == e_RxRetransmission)
     return OpalRTPSession::OnReceiveData(frame, rxType);
@@ -762,20 +864,27 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveData(RTP_DataFrame &
   /* Need to have a receiver SSRC (their sender) or we can't decrypt the RTCP
      packet. Applies only if remote did not tell us about SSRC's via signalling
      (e.g. SDP) and we just acceting anything, if it did tell us valid SSRC's
-     the this fails and we don't use the RTP data as it may be some spoofing. */
-  if (UseSyncSource(ssrc, e_Receiver, false) == NULL)
+     the this fails and we don't use the RTP data as it may be some spoofing.
+     OnPreReceiveData has already added it if allowed, and we are called with
+     the SyncSource locked, so only look up, never add and upgrade the lock. */
+  if (m_syncSourceIndex.Find(ssrc) == NULL)
     return e_IgnorePacket;
 
   int len = frame.GetPacketSize();
 
+  /* The received buffer is shared with every other session on the media
+     transport, e.g. with BUNDLE, so it must not be decrypted in place. This
+     only copies if it is actually shared. */
   frame.MakeUnique();
 
+  m_contextMutex.Wait();
   SendReceiveStatus status = CheckConsecutiveErrors(
                                 CHECK_ERROR(
                                     srtp_unprotect, (m_context, frame.GetPointer(), &len),
                                     this, ssrc, frame.GetSequenceNumber()
                                 ),
                                 e_Receiver, e_Data);
+  m_contextMutex.Signal();
   if (status != e_ProcessPacket)
     return status;
 
@@ -787,11 +896,11 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveData(RTP_DataFrame &
 }
 
 
-OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveControl(RTP_ControlFrame & encoded)
+OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveControl(RTP_ControlFrame & frame)
 {
-  /* Aleady locked on entry */
+  /* Session write locked on entry */
 
-  RTP_SyncSourceId ssrc = encoded.GetSenderSyncSource();
+  RTP_SyncSourceId ssrc = frame.GetSenderSyncSource();
   if (!IsCryptoSecured(e_Receiver)) {
     OPAL_SRTP_TRACE(2, e_Receiver, e_Control, ssrc, 1, "keys not set, cannot protect control");
     return e_IgnorePacket;
@@ -810,17 +919,23 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::OnReceiveControl(RTP_ControlF
 
   m_anyRTCP_SSRC = false;
 
-  RTP_ControlFrame decoded(encoded);
+  /* The received frame wraps, without owning, the buffer that the media
+     transport passes to every session on it, e.g. with BUNDLE and rtcp-mux,
+     and more than one session may accept the SSRC. So decrypt a private
+     copy, leaving the original for the other sessions. */
+  RTP_ControlFrame decoded(frame);
   decoded.MakeUnique();
 
   int len = decoded.GetSize();
 
+  m_contextMutex.Wait();
   SendReceiveStatus status = CheckConsecutiveErrors(
                                 CHECK_ERROR(
                                     srtp_unprotect_rtcp, (m_context, decoded.GetPointer(), &len),
                                     this, ssrc
                                 ),
                                 e_Receiver, e_Control);
+  m_contextMutex.Signal();
   if (status != e_ProcessPacket)
     return status;
 
@@ -855,4 +970,81 @@ OpalRTPSession::SendReceiveStatus OpalSRTPSession::CheckConsecutiveErrors(bool o
 }
 
 
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalSRTPContext::OpalSRTPContext()
+  : m_context(NULL)
+  , m_receiver(false)
+{
+}
+
+
+OpalSRTPContext::~OpalSRTPContext()
+{
+  Close();
+}
+
+
+bool OpalSRTPContext::Open(const OpalSRTPKeyInfo & keyInfo, RTP_SyncSourceId ssrc, bool rx)
+{
+  Close();
+
+  BYTE key_salt[OpalSRTPKeyInfo::MaxKeySaltSize];
+  keyInfo.GetKeySalt(key_salt);
+
+  srtp_policy_t policy;
+  memset(&policy, 0, sizeof(policy));
+  policy.ssrc.type = ssrc_specific;
+  policy.ssrc.value = ssrc;
+  keyInfo.GetCryptoSuite().SetCryptoPolicy(policy.rtp);
+  keyInfo.GetCryptoSuite().SetCryptoPolicy(policy.rtcp);
+  policy.key = key_salt;
+
+  if (!CHECK_ERROR(srtp_create, (&m_context, &policy), NULL, ssrc)) {
+    m_context = NULL;
+    return false;
+  }
+
+  m_receiver = rx;
+  return true;
+}
+
+
+void OpalSRTPContext::Close()
+{
+  if (m_context != NULL) {
+    CHECK_ERROR(srtp_dealloc,(m_context));
+    m_context = NULL;
+  }
+}
+
+
+PINDEX OpalSRTPContext::Process(RTP_DataFrame * frames, PINDEX count)
+{
+  if (m_context == NULL)
+    return 0;
+
+  for (PINDEX i = 0; i < count; ++i) {
+    RTP_DataFrame & frame = frames[i];
+    int len = frame.GetPacketSize();
+
+    if (m_receiver) {
+      if (!CHECK_ERROR(srtp_unprotect, (m_context, frame.GetPointer(), &len), NULL, frame.GetSyncSource(), frame.GetSequenceNumber()))
+        return i;
+    }
+    else {
+      frame.SetMinSize(len + SRTP_MAX_TRAILER_LEN);
+      frame.MakeUnique();
+      if (!CHECK_ERROR(srtp_protect, (m_context, frame.GetPointer(), &len), NULL, frame.GetSyncSource(), frame.GetSequenceNumber()))
+        return i;
+    }
+
+    frame.SetPayloadSize(len - frame.GetHeaderSize());
+  }
+
+  return count;
+}
+
+
 #endif // OPAL_SRTP
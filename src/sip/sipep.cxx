@@ -84,6 +84,7 @@ SIPEndPoint::SIPEndPoint(OpalManager & mgr, unsigned maxThreads)
   , m_shuttingDown(false)
   , m_lastSentCSeq(0)
   , m_defaultAppearanceCode(-1)
+  , m_pendingWorkCount(0)
   , m_threadPool(maxThreads, "SIP Pool")
   , m_onHighPriorityInterfaceChange(PCREATE_InterfaceNotifier(OnHighPriorityInterfaceChange))
   , m_onLowPriorityInterfaceChange(PCREATE_InterfaceNotifier(OnLowPriorityInterfaceChange))
@@ -1260,6 +1261,15 @@ bool SIPEndPoint::OnReceivedINVITE(SIP_PDU * request)
   }
 
   if (call == NULL) {
+    OpalAdmissionControllerPtr admission = m_manager.GetAdmissionController();
+    if (!admission->CanAcceptCall()) {
+      PTRACE(2, "Incoming INVITE for " << request->GetURI() << " rejected by admission control");
+      SIP_PDU response(*request, SIP_PDU::Failure_ServiceUnavailable);
+      response.GetMIME().SetAt("Retry-After", PString(PString::Unsigned, (unsigned)admission->GetRetryAfter().GetSeconds()));
+      response.Send();
+      return false;
+    }
+
     // Get new instance of a call, abort if none created
     call = m_manager.InternalCreateCall();
     if (call == NULL) {
@@ -4432,6 +4432,13 @@ SIPWorkItem::SIPWorkItem(SIPEndPoint & ep, const PString & token)
   , m_token(token)
 {
   PAssert(!token.IsEmpty(), PInvalidParameter);
+  ++m_endpoint.m_pendingWorkCount;
+}
+
+
+SIPWorkItem::~SIPWorkItem()
+{
+  --m_endpoint.m_pendingWorkCount;
 }
 
 